@@ -0,0 +1,192 @@
+#include "audio_output.h"
+#include "sample_convert.h"
+
+#include <alsa/asoundlib.h>
+
+#include <algorithm>
+#include <iostream>
+
+// ALSA in mmap mode: the callback renders straight into the device buffer when
+// the device takes float samples, otherwise into a scratch period that is
+// converted in one pass. Around 40 ms of buffer split into ~10 ms periods.
+
+static const unsigned kBufferUs = 40000;
+static const unsigned kPeriodUs = 10000;
+
+class AlsaOutput : public AudioOutput {
+public:
+    explicit AlsaOutput(std::string device) : device_(std::move(device)) {}
+    ~AlsaOutput() override { Stop(); }
+
+    bool Start(const AudioFormat& format, AudioSource* source) override;
+    void Stop() override;
+    const char* Name() const override { return "alsa"; }
+    int64_t LatencyFrames() const override { return latency_.load(std::memory_order_relaxed); }
+
+private:
+    bool Configure(const AudioFormat& format);
+    void ThreadMain(AudioSource* source);
+    bool Recover(int error);
+
+    std::string device_;
+    snd_pcm_t* pcm_ = nullptr;
+    snd_pcm_format_t sampleFormat_ = SND_PCM_FORMAT_UNKNOWN;
+    AudioFormat format_;
+    snd_pcm_uframes_t periodFrames_ = 0;
+    snd_pcm_uframes_t bufferFrames_ = 0;
+    std::vector<float> scratch_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<int64_t> latency_{0};
+};
+
+bool AlsaOutput::Start(const AudioFormat& format, AudioSource* source) {
+    Stop();
+    if (format.sampleRate <= 0 || format.channels <= 0 || !source) return false;
+    int error = snd_pcm_open(&pcm_, device_.c_str(), SND_PCM_STREAM_PLAYBACK, 0);
+    if (error < 0) {
+        std::cerr << "ALSA: cannot open '" << device_ << "': " << snd_strerror(error) << std::endl;
+        pcm_ = nullptr;
+        return false;
+    }
+    if (!Configure(format)) {
+        snd_pcm_close(pcm_);
+        pcm_ = nullptr;
+        return false;
+    }
+    format_ = format;
+    scratch_.assign(periodFrames_ * format.channels, 0.0f);
+    latency_.store(0);
+    running_.store(true);
+    thread_ = std::thread(&AlsaOutput::ThreadMain, this, source);
+    PromoteToRealtime(thread_);
+    return true;
+}
+
+bool AlsaOutput::Configure(const AudioFormat& format) {
+    snd_pcm_hw_params_t* hw;
+    snd_pcm_hw_params_alloca(&hw);
+    snd_pcm_hw_params_any(pcm_, hw);
+    // Rates the card can't do are converted by alsa-lib's plug layer
+    snd_pcm_hw_params_set_rate_resample(pcm_, hw, 1);
+    if (snd_pcm_hw_params_set_access(pcm_, hw, SND_PCM_ACCESS_MMAP_INTERLEAVED) < 0) {
+        std::cerr << "ALSA: '" << device_ << "' has no mmap access" << std::endl;
+        return false;
+    }
+
+    static const snd_pcm_format_t kFormats[] = {SND_PCM_FORMAT_FLOAT, SND_PCM_FORMAT_S32, SND_PCM_FORMAT_S16};
+    sampleFormat_ = SND_PCM_FORMAT_UNKNOWN;
+    for (snd_pcm_format_t candidate : kFormats) {
+        if (snd_pcm_hw_params_test_format(pcm_, hw, candidate) == 0) {
+            sampleFormat_ = candidate;
+            break;
+        }
+    }
+    if (sampleFormat_ == SND_PCM_FORMAT_UNKNOWN || snd_pcm_hw_params_set_format(pcm_, hw, sampleFormat_) < 0 ||
+        snd_pcm_hw_params_set_channels(pcm_, hw, (unsigned)format.channels) < 0 ||
+        snd_pcm_hw_params_set_rate(pcm_, hw, (unsigned)format.sampleRate, 0) < 0) {
+        std::cerr << "ALSA: '" << device_ << "' can't play " << format.channels << " channels at "
+                  << format.sampleRate << " Hz" << std::endl;
+        return false;
+    }
+
+    unsigned bufferUs = kBufferUs;
+    unsigned periodUs = kPeriodUs;
+    int dir = 0;
+    snd_pcm_hw_params_set_buffer_time_near(pcm_, hw, &bufferUs, &dir);
+    snd_pcm_hw_params_set_period_time_near(pcm_, hw, &periodUs, &dir);
+    int error = snd_pcm_hw_params(pcm_, hw);
+    if (error < 0) {
+        std::cerr << "ALSA: " << snd_strerror(error) << std::endl;
+        return false;
+    }
+    snd_pcm_hw_params_get_buffer_size(hw, &bufferFrames_);
+    snd_pcm_hw_params_get_period_size(hw, &periodFrames_, &dir);
+
+    snd_pcm_sw_params_t* sw;
+    snd_pcm_sw_params_alloca(&sw);
+    snd_pcm_sw_params_current(pcm_, sw);
+    snd_pcm_sw_params_set_avail_min(pcm_, sw, periodFrames_);
+    // mmap commits never start the stream; ThreadMain does once the buffer is full
+    snd_pcm_sw_params_set_start_threshold(pcm_, sw, bufferFrames_);
+    error = snd_pcm_sw_params(pcm_, sw);
+    if (error < 0) {
+        std::cerr << "ALSA: " << snd_strerror(error) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void AlsaOutput::Stop() {
+    running_.store(false);
+    if (thread_.joinable()) thread_.join();
+    if (pcm_) {
+        snd_pcm_drop(pcm_);
+        snd_pcm_close(pcm_);
+        pcm_ = nullptr;
+    }
+    latency_.store(0);
+}
+
+// Underruns and suspends are recoverable; anything else ends the thread and
+// the engine restarts the output once it notices nobody is pulling.
+bool AlsaOutput::Recover(int error) {
+    error = snd_pcm_recover(pcm_, error, 1);
+    if (error < 0) {
+        std::cerr << "ALSA: " << snd_strerror(error) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void AlsaOutput::ThreadMain(AudioSource* source) {
+    const size_t channels = (size_t)format_.channels;
+
+    while (running_.load(std::memory_order_relaxed)) {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(pcm_);
+        if (avail < 0) {
+            if (!Recover((int)avail)) break;
+            continue;
+        }
+        if ((snd_pcm_uframes_t)avail < periodFrames_) {
+            int error = snd_pcm_state(pcm_) == SND_PCM_STATE_PREPARED ? snd_pcm_start(pcm_) : snd_pcm_wait(pcm_, 100);
+            if (error < 0 && !Recover(error)) break;
+            continue;
+        }
+
+        const snd_pcm_channel_area_t* areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t frames = std::min((snd_pcm_uframes_t)avail, periodFrames_);
+        int error = snd_pcm_mmap_begin(pcm_, &areas, &offset, &frames);
+        if (error < 0) {
+            if (!Recover(error)) break;
+            continue;
+        }
+
+        // Interleaved: one area for all channels, stepping a whole frame
+        uint8_t* dst = (uint8_t*)areas[0].addr + (areas[0].first + offset * areas[0].step) / 8;
+        if (sampleFormat_ == SND_PCM_FORMAT_FLOAT) {
+            source->Render((float*)dst, frames);
+        } else {
+            source->Render(scratch_.data(), frames);
+            if (sampleFormat_ == SND_PCM_FORMAT_S32) {
+                ConvertFloatToS32(scratch_.data(), (int32_t*)dst, frames * channels);
+            } else {
+                ConvertFloatToS16(scratch_.data(), (int16_t*)dst, frames * channels);
+            }
+        }
+
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(pcm_, offset, frames);
+        if (committed < 0 || (snd_pcm_uframes_t)committed != frames) {
+            if (!Recover(committed < 0 ? (int)committed : -EPIPE)) break;
+            continue;
+        }
+
+        snd_pcm_sframes_t delay = 0;
+        if (snd_pcm_delay(pcm_, &delay) == 0) latency_.store(std::max<int64_t>(0, delay), std::memory_order_relaxed);
+    }
+}
+
+std::unique_ptr<AudioOutput> CreateAlsaOutput(const std::string& device) {
+    return std::make_unique<AlsaOutput>(device);
+}
@@ -0,0 +1,516 @@
+#include "audio_engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+#include <unordered_map>
+
+// ~250 ms of buffering between the decoder and the output callback
+static const int kRingMs = 250;
+static const size_t kDecodeBlockFrames = 2048;
+// Start opening the next track this long before the current one ends
+static const int kPrepareAheadMs = 10000;
+// Decoded up front on the helper thread, so the join never waits on the disk
+static const int kPrerollMs = 500;
+
+// A decoder whose first frames were decoded ahead of time.
+class PrerolledDecoder : public Decoder {
+public:
+    explicit PrerolledDecoder(std::unique_ptr<Decoder> decoder) : decoder_(std::move(decoder)) {}
+
+    void Preroll(size_t frames) {
+        const size_t channels = (size_t)decoder_->Format().channels;
+        pcm_.resize(frames * channels);
+        size_t got;
+        while (frames_ < frames && (got = decoder_->Read(pcm_.data() + frames_ * channels, frames - frames_)) > 0)
+            frames_ += got;
+    }
+
+    AudioFormat Format() const override { return decoder_->Format(); }
+    int64_t TotalFrames() const override { return decoder_->TotalFrames(); }
+
+    size_t Read(float* out, size_t frames) override {
+        if (pos_ == frames_) return decoder_->Read(out, frames);
+        const size_t channels = (size_t)decoder_->Format().channels;
+        size_t n = std::min(frames, frames_ - pos_);
+        memcpy(out, pcm_.data() + pos_ * channels, n * channels * sizeof(float));
+        pos_ += n;
+        return n;
+    }
+
+    bool Seek(int64_t frame) override {
+        pos_ = frames_;
+        return decoder_->Seek(frame);
+    }
+
+private:
+    std::unique_ptr<Decoder> decoder_;
+    std::vector<float> pcm_;
+    size_t frames_ = 0;
+    size_t pos_ = 0;
+};
+
+// Once the output is running its rate stays put: tracks at other rates are
+// resampled to it, so rate changes neither interrupt playback nor break a
+// gapless join. A different channel count still needs the output restarted.
+static std::unique_ptr<Decoder> FitToOutput(std::unique_ptr<Decoder> decoder, const AudioFormat& output,
+                                            ResamplerQuality quality) {
+    if (!decoder || output.sampleRate <= 0) return decoder;
+    AudioFormat format = decoder->Format();
+    if (format.channels != output.channels || format.sampleRate == output.sampleRate) return decoder;
+    return ResampleDecoder(std::move(decoder), output.sampleRate, quality);
+}
+
+static std::unique_ptr<Decoder> OpenPrerolled(const std::string& path, AudioFormat output, ResamplerQuality quality) {
+    std::unique_ptr<Decoder> decoder = FitToOutput(OpenDecoder(path), output, quality);
+    if (!decoder) return nullptr;
+    auto prerolled = std::make_unique<PrerolledDecoder>(std::move(decoder));
+    prerolled->Preroll((size_t)prerolled->Format().sampleRate * kPrerollMs / 1000);
+    return prerolled;
+}
+
+AudioEngine::~AudioEngine() {
+    Shutdown();
+}
+
+bool AudioEngine::Start(std::unique_ptr<AudioOutput> output) {
+    if (thread_.joinable() || !output) return false;
+    output_ = std::move(output);
+    running_ = true;
+    thread_ = std::thread(&AudioEngine::ThreadMain, this);
+    return true;
+}
+
+void AudioEngine::Shutdown() {
+    if (!thread_.joinable()) return;
+    Command quit{Command::Type::Quit, 0, 0.0, nullptr};
+    while (!commands_.Push(quit)) std::this_thread::yield();
+    sleeping_.store(false);
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        wake_.notify_one();
+    }
+    thread_.join();
+    output_.reset();
+}
+
+void AudioEngine::SetResamplerQuality(ResamplerQuality quality) {
+    if (!thread_.joinable()) resamplerQuality_ = quality;
+}
+
+void AudioEngine::SetPlaylist(std::vector<std::string> paths) {
+    Post({Command::Type::SetPlaylist, 0, 0.0, new std::vector<std::string>(std::move(paths))});
+}
+
+void AudioEngine::UpdatePlaylist(std::vector<std::string> paths) {
+    Post({Command::Type::UpdatePlaylist, 0, 0.0, new std::vector<std::string>(std::move(paths))});
+}
+
+void AudioEngine::Play(int track) { Post({Command::Type::Play, track, 0.0, nullptr}); }
+void AudioEngine::TogglePause() { Post({Command::Type::TogglePause, 0, 0.0, nullptr}); }
+void AudioEngine::Stop() { Post({Command::Type::Stop, 0, 0.0, nullptr}); }
+void AudioEngine::Next() { Post({Command::Type::Next, 0, 0.0, nullptr}); }
+void AudioEngine::Previous() { Post({Command::Type::Previous, 0, 0.0, nullptr}); }
+void AudioEngine::Seek(double seconds) { Post({Command::Type::Seek, 0, seconds, nullptr}); }
+void AudioEngine::SetVolume(float volume) { Post({Command::Type::Volume, 0, (double)volume, nullptr}); }
+
+const PlaybackSnapshot& AudioEngine::Snapshot() {
+    snapshots_.Read(snapshot_);
+    return snapshot_;
+}
+
+void AudioEngine::Post(const Command& command) {
+    if (!commands_.Push(command)) {
+        std::cerr << "Audio command queue is full, dropping command" << std::endl;
+        delete command.playlist;
+        return;
+    }
+    // Only touch the mutex if the decoder thread is actually parked.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.exchange(false)) {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        wake_.notify_one();
+    }
+}
+
+size_t AudioEngine::Render(float* out, size_t frames) {
+    callbacks_.fetch_add(1, std::memory_order_relaxed);
+    const int channels = ring_.Channels();
+
+    uint32_t flush = flushRequest_.load(std::memory_order_acquire);
+    if (flush != flushSeen_) {
+        ring_.DiscardAll();
+        framesPlayed_.store(0, std::memory_order_relaxed);
+        flushSeen_ = flush;
+        flushAck_.store(flush, std::memory_order_release);
+    }
+
+    size_t got = 0;
+    if (playing_.load(std::memory_order_acquire)) {
+        got = ring_.Read(out, frames);
+        framesPlayed_.fetch_add((int64_t)got, std::memory_order_relaxed);
+        if (got < frames && countUnderruns_ && !endOfStream_.load(std::memory_order_acquire)) {
+            underruns_.fetch_add(1, std::memory_order_relaxed);
+            underrunFrames_.fetch_add(frames - got, std::memory_order_relaxed);
+        }
+    }
+
+    // Ramp volume changes over one callback to avoid zipper noise
+    float target = volume_.load(std::memory_order_relaxed);
+    if (got > 0 && (target != 1.0f || appliedVolume_ != 1.0f)) {
+        float gain = appliedVolume_;
+        float step = (target - appliedVolume_) / (float)got;
+        for (size_t i = 0; i < got; i++, gain += step) {
+            for (int c = 0; c < channels; c++) out[i * channels + c] *= gain;
+        }
+    }
+    appliedVolume_ = target;
+
+    if (got < frames) {
+        memset(out + got * channels, 0, (frames - got) * channels * sizeof(float));
+    }
+    tap_.Write(out, frames, channels);
+    return got;
+}
+
+void AudioEngine::ThreadMain() {
+    while (running_) {
+        AdvanceAudibleTrack();
+        Command command;
+        bool seekPending = false;
+        double seekTarget = 0.0;
+        while (commands_.Pop(command)) {
+            // Dragging the progress bar floods seeks; only the last one matters.
+            if (command.type == Command::Type::Seek) {
+                seekPending = true;
+                seekTarget = command.value;
+                continue;
+            }
+            Execute(command);
+        }
+        if (seekPending) SeekTo(seekTarget);
+        if (!running_) break;
+
+        if (state_ == PlaybackState::Playing) FillRing();
+        PublishSnapshot();
+
+        switch (state_) {
+        case PlaybackState::Playing: WaitForCommand(std::chrono::milliseconds(4)); break;
+        case PlaybackState::Paused: WaitForCommand(std::chrono::milliseconds(50)); break;
+        case PlaybackState::Stopped: WaitForCommand(std::chrono::milliseconds(250)); break;
+        }
+    }
+    CloseTrack();
+    DropPrepared();
+    if (outputRunning_) output_->Stop();
+    outputRunning_ = false;
+
+    Command command;
+    while (commands_.Pop(command)) delete command.playlist;
+}
+
+void AudioEngine::WaitForCommand(std::chrono::milliseconds timeout) {
+    sleeping_.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!commands_.Empty()) {
+        sleeping_.store(false);
+        return;
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    wake_.wait_for(lock, timeout, [this] { return !sleeping_.load(); });
+    sleeping_.store(false);
+}
+
+void AudioEngine::Execute(const Command& command) {
+    switch (command.type) {
+    case Command::Type::SetPlaylist:
+        playlist_ = std::move(*command.playlist);
+        delete command.playlist;
+        CloseTrack();
+        DropPrepared();
+        track_ = -1;
+        decoderTrack_ = -1;
+        break;
+    case Command::Type::UpdatePlaylist:
+        RemapPlaylist(std::move(*command.playlist));
+        delete command.playlist;
+        break;
+    case Command::Type::Play:
+        OpenTrack(command.track);
+        break;
+    case Command::Type::TogglePause:
+        if (state_ == PlaybackState::Playing) {
+            playing_.store(false, std::memory_order_release);
+            state_ = PlaybackState::Paused;
+        } else if (state_ == PlaybackState::Paused) {
+            playing_.store(true, std::memory_order_release);
+            state_ = PlaybackState::Playing;
+        } else {
+            OpenTrack(track_ < 0 ? 0 : track_);
+        }
+        break;
+    case Command::Type::Stop:
+        CloseTrack();
+        DropPrepared();
+        break;
+    case Command::Type::Next:
+        if (track_ + 1 < (int)playlist_.size()) OpenTrack(track_ + 1);
+        break;
+    case Command::Type::Previous:
+        if (track_ > 0) OpenTrack(track_ - 1);
+        break;
+    case Command::Type::Seek:
+        SeekTo(command.value);
+        break;
+    case Command::Type::Volume:
+        volume_.store(std::min(std::max((float)command.value, 0.0f), 1.0f), std::memory_order_relaxed);
+        break;
+    case Command::Type::Quit:
+        running_ = false;
+        break;
+    }
+}
+
+void AudioEngine::OpenTrack(int track) {
+    CloseTrack();
+    if (track < 0 || track >= (int)playlist_.size()) return;
+    track_ = track;
+    decoderTrack_ = track;
+
+    std::unique_ptr<Decoder> decoder = TakePrepared(track);
+    if (outputRunning_) decoder = FitToOutput(std::move(decoder), outputFormat_, resamplerQuality_);
+    if (!decoder) return;
+
+    AudioFormat format = decoder->Format();
+    if ((format != outputFormat_ || !outputRunning_) && !OpenOutput(format)) return;
+
+    decoder_ = std::move(decoder);
+    totalFrames_ = decoder_->TotalFrames();
+    positionBase_ = 0;
+    decodePosition_ = 0;
+    endOfStream_.store(false, std::memory_order_release);
+    FillRing();
+    playing_.store(true, std::memory_order_release);
+    state_ = PlaybackState::Playing;
+}
+
+void AudioEngine::RemapPlaylist(std::vector<std::string> paths) {
+    std::unordered_map<std::string_view, int> index;
+    index.reserve(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) index.emplace(paths[i], (int)i);
+    auto remap = [&](int track) {
+        if (track < 0 || track >= (int)playlist_.size()) return -1;
+        auto it = index.find(playlist_[track]);
+        return it == index.end() ? -1 : it->second;
+    };
+
+    int prepared = remap(preparedTrack_);
+    if (preparedTrack_ >= 0 && (prepared < 0 || prepared != remap(decoderTrack_) + 1)) DropPrepared();
+    else preparedTrack_ = prepared;
+    for (Splice& splice : splices_) splice.track = remap(splice.track);
+    track_ = remap(track_);
+    const int decoderTrack = decoderTrack_;
+    decoderTrack_ = remap(decoderTrack_);
+    // Nothing to continue with once the decoder runs dry
+    if (decoderTrack >= 0 && decoderTrack_ < 0) decoderTrack_ = (int)paths.size();
+    playlist_ = std::move(paths);
+}
+
+void AudioEngine::SeekTo(double seconds) {
+    if (!decoder_ && state_ == PlaybackState::Stopped) return;
+    if (!decoder_ || decoderTrack_ != track_) {
+        // Already fully decoded, or the decoder has moved on to the next track;
+        // reopen so we can seek back into the one being heard.
+        PlaybackState state = state_;
+        OpenTrack(track_);
+        if (!decoder_) return;
+        if (state == PlaybackState::Paused) {
+            playing_.store(false, std::memory_order_release);
+            state_ = PlaybackState::Paused;
+        }
+    }
+
+    int64_t frame = (int64_t)(std::max(seconds, 0.0) * outputFormat_.sampleRate);
+    if (totalFrames_ > 0) frame = std::min(frame, totalFrames_);
+
+    // Hold the callback on silence until the ring has been refilled from the new position
+    bool wasPlaying = playing_.exchange(false, std::memory_order_acq_rel);
+    Flush();
+    if (!decoder_->Seek(frame)) {
+        std::cerr << "Seek failed in " << playlist_[track_] << std::endl;
+    }
+    positionBase_ = frame;
+    decodePosition_ = frame;
+    endOfStream_.store(false, std::memory_order_release);
+    FillRing();
+    playing_.store(wasPlaying, std::memory_order_release);
+}
+
+void AudioEngine::PrepareNext() {
+    if (!decoder_ || preparedTrack_ >= 0 || decoderTrack_ + 1 >= (int)playlist_.size()) return;
+    // Unknown length: prepare right away, it costs little more than memory
+    int64_t total = decoder_->TotalFrames();
+    if (total >= 0 && total - decodePosition_ > (int64_t)outputFormat_.sampleRate * kPrepareAheadMs / 1000) return;
+    preparedTrack_ = decoderTrack_ + 1;
+    // The resampler's filter bank is built on the helper thread too
+    preparing_ = std::async(std::launch::async, OpenPrerolled, playlist_[preparedTrack_], outputFormat_,
+                            resamplerQuality_);
+}
+
+std::unique_ptr<Decoder> AudioEngine::TakePrepared(int track) {
+    if (preparedTrack_ != track) {
+        DropPrepared();
+        return OpenDecoder(playlist_[track]);
+    }
+    preparedTrack_ = -1;
+    return preparing_.get();
+}
+
+void AudioEngine::DropPrepared() {
+    // Blocks until the helper is done with the file; opening is quick
+    preparing_ = std::future<std::unique_ptr<Decoder>>();
+    preparedTrack_ = -1;
+}
+
+bool AudioEngine::SpliceNext(int64_t frame) {
+    for (int next = decoderTrack_ + 1; next < (int)playlist_.size(); next++) {
+        std::unique_ptr<Decoder> decoder = FitToOutput(TakePrepared(next), outputFormat_, resamplerQuality_);
+        if (!decoder) continue;  // unreadable; try the one after
+        if (decoder->Format() != outputFormat_) {
+            // Different channel count, needs an output restart; FillRing opens it once the ring has played out
+            std::promise<std::unique_ptr<Decoder>> ready;
+            ready.set_value(std::move(decoder));
+            preparing_ = ready.get_future();
+            preparedTrack_ = next;
+            return false;
+        }
+        splices_.push_back({next, frame, decoder->TotalFrames()});
+        decoder_ = std::move(decoder);
+        decoderTrack_ = next;
+        decodePosition_ = 0;
+        return true;
+    }
+    return false;
+}
+
+int64_t AudioEngine::HeardFrames() const {
+    const int64_t played = framesPlayed_.load(std::memory_order_relaxed);
+    return std::max<int64_t>(0, played - (outputRunning_ ? output_->LatencyFrames() : 0));
+}
+
+void AudioEngine::AdvanceAudibleTrack() {
+    const int64_t played = HeardFrames();
+    while (!splices_.empty() && played >= splices_.front().frame) {
+        const Splice& splice = splices_.front();
+        track_ = splice.track;
+        positionBase_ = -splice.frame;
+        totalFrames_ = splice.totalFrames;
+        splices_.pop_front();
+    }
+}
+
+// The ring is sized for the device format, so a channel change restarts the output.
+bool AudioEngine::OpenOutput(const AudioFormat& format) {
+    if (outputRunning_) output_->Stop();
+    outputRunning_ = false;
+    outputFormat_ = AudioFormat();
+
+    ring_.Allocate((size_t)format.sampleRate * kRingMs / 1000, format.channels);
+    flushSeen_ = flushRequest_.load(std::memory_order_relaxed);
+    countUnderruns_ = output_->IsRealtime();
+    tap_.SetSampleRate(format.sampleRate);
+    if (!output_->Start(format, this)) {
+        std::cerr << "Failed to start audio output '" << output_->Name() << "'" << std::endl;
+        return false;
+    }
+    outputFormat_ = format;
+    outputRunning_ = true;
+    return true;
+}
+
+// Decodes straight into the free space of the ring, no intermediate copy.
+void AudioEngine::FillRing() {
+    if (!decoder_) {
+        // Decoder is done. Once the callback has played everything out, move on
+        // to a next track that couldn't be joined seamlessly, or stop.
+        if (ring_.ReadableFrames() == 0) {
+            if (preparedTrack_ >= 0) {
+                OpenTrack(preparedTrack_);
+            } else {
+                CloseTrack();
+            }
+        }
+        return;
+    }
+    PrepareNext();
+
+    PcmRingBuffer::Span spans[2];
+    ring_.PrepareWrite(spans[0], spans[1]);
+    for (const PcmRingBuffer::Span& span : spans) {
+        size_t done = 0;
+        while (done < span.frames) {
+            size_t want = std::min(span.frames - done, kDecodeBlockFrames);
+            size_t got = decoder_->Read(span.data + done * outputFormat_.channels, want);
+            if (got == 0) {
+                if (SpliceNext(framesWritten_ + (int64_t)done)) continue;
+                ring_.CommitWrite(done);
+                framesWritten_ += (int64_t)done;
+                decoder_.reset();
+                endOfStream_.store(true, std::memory_order_release);
+                return;
+            }
+            done += got;
+            decodePosition_ += (int64_t)got;
+        }
+        ring_.CommitWrite(done);
+        framesWritten_ += (int64_t)done;
+    }
+}
+
+// Asks the callback to drop whatever is buffered and waits for it to confirm.
+void AudioEngine::Flush() {
+    framesWritten_ = 0;
+    splices_.clear();
+    if (!outputRunning_) return;
+    uint32_t request = flushRequest_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    while (flushAck_.load(std::memory_order_acquire) != request) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            std::cerr << "Audio output '" << output_->Name() << "' stopped pulling, restarting it" << std::endl;
+            OpenOutput(outputFormat_);
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+}
+
+void AudioEngine::CloseTrack() {
+    playing_.store(false, std::memory_order_release);
+    decoder_.reset();
+    Flush();
+    endOfStream_.store(false, std::memory_order_release);
+    positionBase_ = 0;
+    totalFrames_ = 0;
+    state_ = PlaybackState::Stopped;
+}
+
+void AudioEngine::PublishSnapshot() {
+    PlaybackSnapshot snapshot;
+    snapshot.state = state_;
+    snapshot.track = track_;
+    snapshot.volume = volume_.load(std::memory_order_relaxed);
+    if (state_ != PlaybackState::Stopped && outputFormat_.sampleRate > 0) {
+        int64_t played = positionBase_ + HeardFrames();
+        snapshot.position = (double)played / outputFormat_.sampleRate;
+        snapshot.duration = totalFrames_ > 0 ? (double)totalFrames_ / outputFormat_.sampleRate : 0.0;
+    }
+    snapshot.stats.callbacks = callbacks_.load(std::memory_order_relaxed);
+    snapshot.stats.underruns = underruns_.load(std::memory_order_relaxed);
+    snapshot.stats.underrunFrames = underrunFrames_.load(std::memory_order_relaxed);
+    snapshot.stats.ringCapacity = ring_.Capacity();
+    if (outputRunning_ && outputFormat_.sampleRate > 0)
+        snapshot.stats.outputLatency = (double)output_->LatencyFrames() / outputFormat_.sampleRate;
+    snapshots_.Publish(snapshot);
+}
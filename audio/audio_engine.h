@@ -0,0 +1,183 @@
+#pragma once
+
+#include "audio_output.h"
+#include "audio_tap.h"
+#include "command_queue.h"
+#include "decoder.h"
+#include "resampler.h"
+#include "ring_buffer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class PlaybackState {
+    Stopped,
+    Playing,
+    Paused,
+};
+
+struct AudioEngineStats {
+    uint64_t callbacks = 0;
+    uint64_t underruns = 0;      // callbacks that could not be filled from the ring
+    uint64_t underrunFrames = 0; // frames of silence inserted by those callbacks
+    size_t ringCapacity = 0;     // frames
+    double outputLatency = 0.0;  // seconds from Render() to the speaker, as the output reports it
+};
+
+// What the UI sees of the engine, published by the decoder thread.
+struct PlaybackSnapshot {
+    PlaybackState state = PlaybackState::Stopped;
+    int track = -1; // index into the playlist
+    double position = 0.0;
+    double duration = 0.0;
+    float volume = 1.0f;
+    AudioEngineStats stats;
+};
+
+// Two threads: the decoder thread owns the decoder and fills a lock-free ring,
+// the output's callback thread drains it through Render(). The UI talks to the
+// decoder thread only through a lock-free command queue and reads state back
+// from a snapshot channel, so neither side ever waits on the other.
+//
+// Playback runs through the playlist gaplessly: near the end of a track the
+// next one is opened and pre-decoded on a helper thread, and when the current
+// decoder runs dry its successor continues writing into the same ring, so the
+// two join sample for sample. The UI switches over once the callback has
+// actually played up to the join. Tracks at another sample rate than the
+// running output are resampled to it.
+class AudioEngine : private AudioSource {
+public:
+    AudioEngine() = default;
+    ~AudioEngine() override;
+
+    AudioEngine(const AudioEngine&) = delete;
+    AudioEngine& operator=(const AudioEngine&) = delete;
+
+    // Call before Start().
+    void SetResamplerQuality(ResamplerQuality quality);
+    bool Start(std::unique_ptr<AudioOutput> output);
+    void Shutdown();
+
+    // Commands. Safe to call from any thread; they return immediately.
+    void SetPlaylist(std::vector<std::string> paths);
+    // Replaces the playlist without interrupting playback: the tracks being
+    // heard and decoded are found again by path. One that is gone plays to
+    // its end and playback stops there.
+    void UpdatePlaylist(std::vector<std::string> paths);
+    void Play(int track);
+    void TogglePause();
+    void Stop();
+    void Next();
+    void Previous();
+    void Seek(double seconds);
+    void SetVolume(float volume);
+
+    // Latest state from the decoder thread. Call from a single (UI) thread.
+    const PlaybackSnapshot& Snapshot();
+    // What the output callback rendered lately, silence included. Any thread.
+    const AudioTap& Tap() const { return tap_; }
+
+private:
+    struct Command {
+        enum class Type : uint8_t { SetPlaylist, UpdatePlaylist, Play, TogglePause, Stop, Next, Previous, Seek, Volume, Quit };
+        Type type;
+        int track;
+        double value;
+        std::vector<std::string>* playlist; // ownership passes to the decoder thread
+    };
+
+    // Output callback thread
+    size_t Render(float* out, size_t frames) override;
+
+    // Any thread
+    void Post(const Command& command);
+
+    // Decoder thread
+    void ThreadMain();
+    void WaitForCommand(std::chrono::milliseconds timeout);
+    void Execute(const Command& command);
+    void OpenTrack(int track);
+    void RemapPlaylist(std::vector<std::string> paths);
+    void SeekTo(double seconds);
+    // Starts opening the track after the decoder's one once it is close to its end.
+    void PrepareNext();
+    // Takes the prepared decoder for `track`, waiting for it if it is still opening.
+    std::unique_ptr<Decoder> TakePrepared(int track);
+    void DropPrepared();
+    // Continues the ring with the next track from ring frame `frame`. False if
+    // it can't follow seamlessly.
+    bool SpliceNext(int64_t frame);
+    // Frames the listener has heard since the last flush: what the callback
+    // took minus what is still queued in the output.
+    int64_t HeardFrames() const;
+    // Moves track_ and the position past joins that have been heard.
+    void AdvanceAudibleTrack();
+    bool OpenOutput(const AudioFormat& format);
+    void FillRing();
+    void Flush();
+    void CloseTrack();
+    void PublishSnapshot();
+
+    std::thread thread_;
+    MpscQueue<Command, 256> commands_;
+    SnapshotChannel<PlaybackSnapshot> snapshots_;
+    PlaybackSnapshot snapshot_; // UI side copy
+
+    // Parking for the decoder thread while it has nothing to do
+    std::atomic<bool> sleeping_{false};
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+
+    // Decoder thread only
+    std::unique_ptr<AudioOutput> output_;
+    std::unique_ptr<Decoder> decoder_;
+    std::vector<std::string> playlist_;
+    AudioFormat outputFormat_;
+    ResamplerQuality resamplerQuality_ = ResamplerQuality::High;
+    PlaybackState state_ = PlaybackState::Stopped;
+    int track_ = -1;          // the one being heard
+    int decoderTrack_ = -1;   // the one being decoded, ahead of track_ around a join
+    int64_t positionBase_ = 0;
+    int64_t totalFrames_ = 0;
+    int64_t decodePosition_ = 0; // frames into decoderTrack_
+    int64_t framesWritten_ = 0;  // into the ring since the last flush
+
+    // Next track, opened on a helper thread
+    std::future<std::unique_ptr<Decoder>> preparing_;
+    int preparedTrack_ = -1;
+
+    // Joins written to the ring that the callback hasn't reached yet
+    struct Splice {
+        int track;
+        int64_t frame; // in framesPlayed_ terms
+        int64_t totalFrames;
+    };
+    std::deque<Splice> splices_;
+    bool outputRunning_ = false;
+    bool running_ = false;
+
+    // Shared between the decoder thread and the callback
+    PcmRingBuffer ring_;
+    std::atomic<bool> playing_{false};
+    std::atomic<bool> endOfStream_{false};
+    std::atomic<float> volume_{1.0f};
+    std::atomic<uint32_t> flushRequest_{0};
+    std::atomic<uint32_t> flushAck_{0};
+    std::atomic<int64_t> framesPlayed_{0};
+    std::atomic<uint64_t> callbacks_{0};
+    std::atomic<uint64_t> underruns_{0};
+    std::atomic<uint64_t> underrunFrames_{0};
+    bool countUnderruns_ = true;
+    AudioTap tap_;
+
+    // Callback only
+    uint32_t flushSeen_ = 0;
+    float appliedVolume_ = 1.0f;
+};
@@ -0,0 +1,207 @@
+#include "audio_output.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Best effort: needs CAP_SYS_NICE or an rtprio limit, otherwise stays SCHED_OTHER.
+void PromoteToRealtime(std::thread& thread) {
+#ifdef __linux__
+    sched_param param{};
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO) + 10;
+    pthread_setschedparam(thread.native_handle(), SCHED_FIFO, &param);
+#else
+    (void)thread;
+#endif
+}
+
+bool NullOutput::Start(const AudioFormat& format, AudioSource* source) {
+    Stop();
+    if (format.sampleRate <= 0 || format.channels <= 0 || !source) return false;
+    latency_.store((int64_t)format.sampleRate * periodMs_ / 1000);
+    running_.store(true);
+    thread_ = std::thread(&NullOutput::ThreadMain, this, format, source);
+    PromoteToRealtime(thread_);
+    return true;
+}
+
+void NullOutput::Stop() {
+    running_.store(false);
+    if (thread_.joinable()) thread_.join();
+}
+
+void NullOutput::ThreadMain(AudioFormat format, AudioSource* source) {
+    const size_t period = (size_t)format.sampleRate * periodMs_ / 1000;
+    std::vector<float> buffer(period * format.channels);
+    auto deadline = std::chrono::steady_clock::now();
+    const auto step = std::chrono::microseconds((int64_t)period * 1000000 / format.sampleRate);
+
+    while (running_.load(std::memory_order_relaxed)) {
+        source->Render(buffer.data(), period);
+        deadline += step;
+        std::this_thread::sleep_until(deadline);
+    }
+}
+
+static void PutLE16(unsigned char* p, uint16_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void PutLE32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+bool WavFileOutput::Start(const AudioFormat& format, AudioSource* source) {
+    Stop();
+    if (format.sampleRate <= 0 || format.channels <= 0 || !source) return false;
+    file_ = fopen(path_.c_str(), "wb");
+    if (!file_) {
+        std::cerr << "Failed to open output file: " << path_ << std::endl;
+        return false;
+    }
+    format_ = format;
+    dataBytes_ = 0;
+    WriteHeader();
+    running_.store(true);
+    thread_ = std::thread(&WavFileOutput::ThreadMain, this, source);
+    return true;
+}
+
+void WavFileOutput::Stop() {
+    running_.store(false);
+    if (thread_.joinable()) thread_.join();
+    if (!file_) return;
+    WriteHeader();
+    fclose(file_);
+    file_ = nullptr;
+}
+
+void WavFileOutput::ThreadMain(AudioSource* source) {
+    const size_t period = 4096;
+    std::vector<float> buffer(period * format_.channels);
+
+    while (running_.load(std::memory_order_relaxed)) {
+        size_t frames = source->Render(buffer.data(), period);
+        if (frames == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        size_t samples = frames * format_.channels;
+        if (fwrite(buffer.data(), sizeof(float), samples, file_) != samples) {
+            std::cerr << "Failed to write output file: " << path_ << std::endl;
+            break;
+        }
+        dataBytes_ += samples * sizeof(float);
+    }
+}
+
+// RIFF/WAVE header with WAVE_FORMAT_IEEE_FLOAT, rewritten with final sizes on Stop()
+void WavFileOutput::WriteHeader() {
+    const uint32_t dataSize = dataBytes_ > 0xFFFFFFF0u - 58 ? 0xFFFFFFF0u - 58 : (uint32_t)dataBytes_;
+    const uint16_t channels = (uint16_t)format_.channels;
+    const uint32_t frameCount = channels ? dataSize / (4 * channels) : 0;
+
+    unsigned char h[58];
+    memcpy(h, "RIFF", 4);
+    PutLE32(h + 4, 50 + dataSize);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    PutLE32(h + 16, 18);
+    PutLE16(h + 20, 3);
+    PutLE16(h + 22, channels);
+    PutLE32(h + 24, (uint32_t)format_.sampleRate);
+    PutLE32(h + 28, (uint32_t)format_.sampleRate * channels * 4);
+    PutLE16(h + 32, (uint16_t)(channels * 4));
+    PutLE16(h + 34, 32);
+    PutLE16(h + 36, 0);
+    memcpy(h + 38, "fact", 4);
+    PutLE32(h + 42, 4);
+    PutLE32(h + 46, frameCount);
+    memcpy(h + 50, "data", 4);
+    PutLE32(h + 54, dataSize);
+
+    long pos = ftell(file_);
+    fseek(file_, 0, SEEK_SET);
+    fwrite(h, 1, sizeof(h), file_);
+    if (pos > (long)sizeof(h)) fseek(file_, pos, SEEK_SET);
+    fflush(file_);
+}
+
+// Starts the first of its outputs that will start, in order.
+class FallbackOutput : public AudioOutput {
+public:
+    explicit FallbackOutput(std::vector<std::unique_ptr<AudioOutput>> outputs) : outputs_(std::move(outputs)) {}
+    ~FallbackOutput() override { Stop(); }
+
+    bool Start(const AudioFormat& format, AudioSource* source) override {
+        Stop();
+        for (const std::unique_ptr<AudioOutput>& output : outputs_) {
+            if (output->Start(format, source)) {
+                active_.store(output.get(), std::memory_order_release);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Stop() override {
+        if (AudioOutput* active = active_.exchange(nullptr, std::memory_order_acq_rel)) active->Stop();
+    }
+
+    // Loaded once: Stop() may clear it on another thread meanwhile. The
+    // outputs themselves live as long as this one does.
+    const char* Name() const override {
+        const AudioOutput* active = active_.load(std::memory_order_acquire);
+        return active ? active->Name() : "auto";
+    }
+    bool IsRealtime() const override {
+        const AudioOutput* active = active_.load(std::memory_order_acquire);
+        return active ? active->IsRealtime() : true;
+    }
+    int64_t LatencyFrames() const override {
+        const AudioOutput* active = active_.load(std::memory_order_acquire);
+        return active ? active->LatencyFrames() : 0;
+    }
+
+private:
+    std::vector<std::unique_ptr<AudioOutput>> outputs_;
+    std::atomic<AudioOutput*> active_{nullptr};
+};
+
+std::unique_ptr<AudioOutput> CreateAudioOutput(const std::string& spec) {
+    if (spec.empty() || spec == "auto") {
+        std::vector<std::unique_ptr<AudioOutput>> outputs;
+#ifdef CATMP3_HAVE_PULSE
+        outputs.push_back(CreatePulseOutput());
+#endif
+#ifdef CATMP3_HAVE_ALSA
+        outputs.push_back(CreateAlsaOutput("default"));
+#endif
+        outputs.push_back(std::make_unique<NullOutput>());
+        return std::make_unique<FallbackOutput>(std::move(outputs));
+    }
+#ifdef CATMP3_HAVE_PULSE
+    if (spec == "pulse") return CreatePulseOutput();
+#endif
+#ifdef CATMP3_HAVE_ALSA
+    if (spec == "alsa") return CreateAlsaOutput("default");
+    if (spec.rfind("alsa:", 0) == 0 && spec.size() > 5) return CreateAlsaOutput(spec.substr(5));
+#endif
+    if (spec.rfind("wav:", 0) == 0 && spec.size() > 4) {
+        return std::make_unique<WavFileOutput>(spec.substr(4));
+    }
+    if (spec.rfind("null:", 0) == 0) {
+        int periodMs = atoi(spec.c_str() + 5);
+        return std::make_unique<NullOutput>(periodMs > 0 ? periodMs : 5);
+    }
+    if (spec != "null") {
+        std::cerr << "Unknown or unavailable audio output '" << spec << "', using null output" << std::endl;
+    }
+    return std::make_unique<NullOutput>();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "decoder.h"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Pulled by the output from its own thread. Implementations must be real-time safe:
+// no locks, no allocation, no I/O.
+class AudioSource {
+public:
+    virtual ~AudioSource() = default;
+    // Fills all `frames` frames of `out` (padding with silence) and returns how many
+    // of them were actual audio rather than padding.
+    virtual size_t Render(float* out, size_t frames) = 0;
+};
+
+class AudioOutput {
+public:
+    virtual ~AudioOutput() = default;
+
+    virtual bool Start(const AudioFormat& format, AudioSource* source) = 0;
+    virtual void Stop() = 0;
+    virtual const char* Name() const = 0;
+    // False for outputs that wait for the source instead of consuming at a fixed rate;
+    // running short of data is not an underrun for them.
+    virtual bool IsRealtime() const { return true; }
+    // Frames rendered but not yet heard: the output's own buffering plus the
+    // device delay as last reported by the driver. Callable from any thread.
+    virtual int64_t LatencyFrames() const { return 0; }
+};
+
+// Discards audio in real time with a fixed period. Useful on machines without sound hardware.
+class NullOutput : public AudioOutput {
+public:
+    explicit NullOutput(int periodMs = 5) : periodMs_(periodMs) {}
+    ~NullOutput() override { Stop(); }
+
+    bool Start(const AudioFormat& format, AudioSource* source) override;
+    void Stop() override;
+    const char* Name() const override { return "null"; }
+    int64_t LatencyFrames() const override { return latency_.load(std::memory_order_relaxed); }
+
+private:
+    void ThreadMain(AudioFormat format, AudioSource* source);
+
+    int periodMs_;
+    std::atomic<int64_t> latency_{0};
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+};
+
+// Renders to a 32-bit float WAV file as fast as the source can deliver.
+// Padding silence (underruns, pauses) is not written.
+class WavFileOutput : public AudioOutput {
+public:
+    explicit WavFileOutput(std::string path) : path_(std::move(path)) {}
+    ~WavFileOutput() override { Stop(); }
+
+    bool Start(const AudioFormat& format, AudioSource* source) override;
+    void Stop() override;
+    const char* Name() const override { return "wav"; }
+    bool IsRealtime() const override { return false; }
+
+private:
+    void ThreadMain(AudioSource* source);
+    void WriteHeader();
+
+    std::string path_;
+    FILE* file_ = nullptr;
+    AudioFormat format_;
+    uint64_t dataBytes_ = 0;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+};
+
+// Raises a callback thread to SCHED_FIFO where the system allows it.
+void PromoteToRealtime(std::thread& thread);
+
+#ifdef CATMP3_HAVE_PULSE
+// PulseAudio, or PipeWire through its PulseAudio server.
+std::unique_ptr<AudioOutput> CreatePulseOutput();
+#endif
+#ifdef CATMP3_HAVE_ALSA
+// ALSA in mmap mode on `device` ("default", "hw:0", ...).
+std::unique_ptr<AudioOutput> CreateAlsaOutput(const std::string& device);
+#endif
+
+// "auto" (PulseAudio/PipeWire, then ALSA, then null), "pulse", "alsa[:<device>]",
+// "null[:<period ms>]" or "wav:<path>". Falls back to the null output for
+// unknown or unavailable names.
+std::unique_ptr<AudioOutput> CreateAudioOutput(const std::string& spec);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// The last moments of what the output rendered, downmixed to mono, for the
+// spectrum display. The output callback writes without ever waiting; readers
+// on other threads copy out a window and then check that the callback hasn't
+// lapped them while they did. Like a seqlock: the callback claims the samples
+// it is about to overwrite before it starts, so a reader that saw even one of
+// them sees the claim too. Samples are relaxed atomics, which costs the
+// callback nothing on common hardware and keeps that race well-defined.
+class AudioTap {
+public:
+    // About 0.7 s at 48 kHz: room for a 4096-point window plus the output's
+    // latency plus whatever the callback writes during a copy
+    static const size_t kCapacity = 1 << 15;
+
+    AudioTap() : samples_(new std::atomic<float>[kCapacity]) {
+        for (size_t i = 0; i < kCapacity; i++) samples_[i].store(0.0f, std::memory_order_relaxed);
+    }
+
+    AudioTap(const AudioTap&) = delete;
+    AudioTap& operator=(const AudioTap&) = delete;
+
+    void SetSampleRate(int rate) { sampleRate_.store(rate, std::memory_order_relaxed); }
+    int SampleRate() const { return sampleRate_.load(std::memory_order_relaxed); }
+
+    // Output callback only
+    void Write(const float* frames, size_t count, int channels) {
+        if (channels <= 0) return;
+        const uint64_t w = written_.load(std::memory_order_relaxed);
+        claimed_.store(w + count, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        const float scale = 1.0f / (float)channels;
+        for (size_t i = 0; i < count; i++) {
+            float sum = 0.0f;
+            for (int c = 0; c < channels; c++) sum += frames[i * channels + c];
+            samples_[(w + i) & (kCapacity - 1)].store(sum * scale, std::memory_order_relaxed);
+        }
+        written_.store(w + count, std::memory_order_release);
+    }
+
+    // Copies the `count` samples that were written up to `delay` samples ago,
+    // oldest first. False if there aren't that many yet, or if they were
+    // overwritten during the copy.
+    bool Read(float* out, size_t count, size_t delay) const {
+        const uint64_t w = written_.load(std::memory_order_acquire);
+        if (count + delay > kCapacity || w < count + delay) return false;
+        const uint64_t start = w - delay - count;
+        for (size_t i = 0; i < count; i++) {
+            out[i] = samples_[(start + i) & (kCapacity - 1)].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return claimed_.load(std::memory_order_relaxed) - start <= kCapacity;
+    }
+
+private:
+    std::unique_ptr<std::atomic<float>[]> samples_;
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> claimed_{0}; // written_ once the Write() under way is done
+    std::atomic<int> sampleRate_{0};
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Bounded lock-free multi-producer/single-consumer queue (Vyukov's cell-sequence scheme).
+// Push() fails instead of blocking when the queue is full.
+template <typename T, size_t Capacity>
+class MpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "T is copied between threads without locks");
+
+public:
+    MpscQueue() {
+        for (size_t i = 0; i < Capacity; i++) cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool Push(const T& value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & (Capacity - 1)];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer thread only.
+    bool Pop(T& value) {
+        Cell& cell = cells_[head_ & (Capacity - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) != head_ + 1) return false;
+        value = cell.value;
+        cell.sequence.store(head_ + Capacity, std::memory_order_release);
+        head_++;
+        return true;
+    }
+
+    // Consumer thread only.
+    bool Empty() const {
+        return cells_[head_ & (Capacity - 1)].sequence.load(std::memory_order_seq_cst) != head_ + 1;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    Cell cells_[Capacity];
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) size_t head_ = 0;
+};
+
+// Wait-free single-writer/single-reader "latest value" channel (triple buffering).
+// The writer never waits for the reader and the reader always gets the newest complete value.
+template <typename T>
+class SnapshotChannel {
+public:
+    void Publish(const T& value) {
+        slots_[back_] = value;
+        back_ = middle_.exchange((uint8_t)(back_ | kFresh), std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    // Returns false if nothing new was published since the last call.
+    bool Read(T& value) {
+        if (!(middle_.load(std::memory_order_relaxed) & kFresh)) return false;
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+        value = slots_[front_];
+        return true;
+    }
+
+private:
+    static const uint8_t kFresh = 4;
+    static const uint8_t kIndexMask = 3;
+
+    T slots_[3];
+    alignas(64) std::atomic<uint8_t> middle_{1};
+    alignas(64) uint8_t back_ = 0;  // writer only
+    alignas(64) uint8_t front_ = 2; // reader only
+};
@@ -0,0 +1,46 @@
+#include "decoder.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+using DecoderFactory = std::unique_ptr<Decoder> (*)(const std::string& path, bool saveIndex);
+
+// Formats that keep no seek index on disk
+template <std::unique_ptr<Decoder> (*Open)(const std::string&)>
+static std::unique_ptr<Decoder> OpenUncached(const std::string& path, bool) {
+    return Open(path);
+}
+
+struct DecoderEntry {
+    const char* extension;
+    DecoderFactory open;
+};
+
+static const DecoderEntry kDecoders[] = {
+    {".wav", OpenUncached<OpenWavDecoder>},
+    {".mp3", OpenMp3Decoder},
+    {".ogg", OpenUncached<OpenVorbisDecoder>},
+    {".flac", OpenUncached<OpenFlacDecoder>},
+#ifdef CATMP3_HAVE_OPUS
+    {".opus", OpenUncached<OpenOpusDecoder>},
+#endif
+};
+
+std::unique_ptr<Decoder> OpenDecoder(const std::string& path, bool saveIndex) {
+    std::string ext = fs::path(path).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+    for (const auto& entry : kDecoders) {
+        if (ext == entry.extension) {
+            std::unique_ptr<Decoder> decoder = entry.open(path, saveIndex);
+            if (!decoder) std::cerr << "Failed to open audio file: " << path << std::endl;
+            return decoder;
+        }
+    }
+    std::cerr << "No decoder for " << ext << " files: " << path << std::endl;
+    return nullptr;
+}
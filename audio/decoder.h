@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct AudioFormat {
+    int sampleRate = 0;
+    int channels = 0;
+};
+
+inline bool operator==(const AudioFormat& a, const AudioFormat& b) {
+    return a.sampleRate == b.sampleRate && a.channels == b.channels;
+}
+inline bool operator!=(const AudioFormat& a, const AudioFormat& b) { return !(a == b); }
+
+// Streaming decoder producing interleaved float frames in [-1, 1].
+class Decoder {
+public:
+    virtual ~Decoder() = default;
+
+    virtual AudioFormat Format() const = 0;
+    // Total length in frames, or -1 when unknown.
+    virtual int64_t TotalFrames() const = 0;
+    // Decodes up to `frames` frames into `out`. Returns 0 at end of stream.
+    virtual size_t Read(float* out, size_t frames) = 0;
+    virtual bool Seek(int64_t frame) = 0;
+};
+
+// Format decoders
+std::unique_ptr<Decoder> OpenWavDecoder(const std::string& path);
+std::unique_ptr<Decoder> OpenMp3Decoder(const std::string& path, bool saveIndex = true);
+std::unique_ptr<Decoder> OpenVorbisDecoder(const std::string& path);
+std::unique_ptr<Decoder> OpenFlacDecoder(const std::string& path);
+#ifdef CATMP3_HAVE_OPUS
+std::unique_ptr<Decoder> OpenOpusDecoder(const std::string& path);
+#endif
+
+// Picks a decoder by file extension. Returns nullptr if the file is not supported.
+// Pass saveIndex = false for decoders thrown away after one pass, so a seek
+// index they build isn't written to the cache alongside the player's own.
+std::unique_ptr<Decoder> OpenDecoder(const std::string& path, bool saveIndex = true);
@@ -0,0 +1,165 @@
+#include "fft.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define FFT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FFT_NEON 1
+#include <arm_neon.h>
+#endif
+
+static const double kPi = 3.14159265358979323846;
+
+RealFft::RealFft(size_t size) : size_(size), half_(size / 2) {
+    int bits = 0;
+    while (((size_t)1 << bits) < half_) bits++;
+    reverse_.resize(half_);
+    for (size_t i = 0; i < half_; i++) {
+        size_t r = 0;
+        for (int b = 0; b < bits; b++) r |= ((i >> b) & 1) << (bits - 1 - b);
+        reverse_[i] = r;
+    }
+
+    stageRe_.resize(half_);
+    stageIm_.resize(half_);
+    for (size_t h = 1; h < half_; h *= 2) {
+        for (size_t k = 0; k < h; k++) {
+            stageRe_[h + k] = (float)std::cos(-kPi * (double)k / (double)h);
+            stageIm_[h + k] = (float)std::sin(-kPi * (double)k / (double)h);
+        }
+    }
+    splitRe_.resize(half_ + 1);
+    splitIm_.resize(half_ + 1);
+    for (size_t k = 0; k <= half_; k++) {
+        splitRe_[k] = (float)std::cos(-2.0 * kPi * (double)k / (double)size_);
+        splitIm_[k] = (float)std::sin(-2.0 * kPi * (double)k / (double)size_);
+    }
+    re_.resize(half_);
+    im_.resize(half_);
+}
+
+// One radix-2 stage: blocks of 2h, twiddle k for the pair (k, h + k)
+#if !FFT_SSE2 && !FFT_NEON
+static void StageScalar(float* re, float* im, size_t n, size_t h, const float* wr, const float* wi) {
+    for (size_t j = 0; j < n; j += 2 * h) {
+        for (size_t k = 0; k < h; k++) {
+            const size_t a = j + k, b = j + h + k;
+            const float tr = re[b] * wr[k] - im[b] * wi[k];
+            const float ti = re[b] * wi[k] + im[b] * wr[k];
+            re[b] = re[a] - tr;
+            im[b] = im[a] - ti;
+            re[a] += tr;
+            im[a] += ti;
+        }
+    }
+}
+#endif
+
+#if FFT_SSE2
+static void StageSse2(float* re, float* im, size_t n, size_t h, const float* wr, const float* wi) {
+    for (size_t j = 0; j < n; j += 2 * h) {
+        for (size_t k = 0; k < h; k += 4) {
+            float* ar = re + j + k;
+            float* ai = im + j + k;
+            float* br = ar + h;
+            float* bi = ai + h;
+            const __m128 twr = _mm_loadu_ps(wr + k), twi = _mm_loadu_ps(wi + k);
+            const __m128 xr = _mm_loadu_ps(br), xi = _mm_loadu_ps(bi);
+            const __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, twr), _mm_mul_ps(xi, twi));
+            const __m128 ti = _mm_add_ps(_mm_mul_ps(xr, twi), _mm_mul_ps(xi, twr));
+            const __m128 yr = _mm_loadu_ps(ar), yi = _mm_loadu_ps(ai);
+            _mm_storeu_ps(br, _mm_sub_ps(yr, tr));
+            _mm_storeu_ps(bi, _mm_sub_ps(yi, ti));
+            _mm_storeu_ps(ar, _mm_add_ps(yr, tr));
+            _mm_storeu_ps(ai, _mm_add_ps(yi, ti));
+        }
+    }
+}
+#endif
+
+#if FFT_NEON
+static void StageNeon(float* re, float* im, size_t n, size_t h, const float* wr, const float* wi) {
+    for (size_t j = 0; j < n; j += 2 * h) {
+        for (size_t k = 0; k < h; k += 4) {
+            float* ar = re + j + k;
+            float* ai = im + j + k;
+            float* br = ar + h;
+            float* bi = ai + h;
+            const float32x4_t twr = vld1q_f32(wr + k), twi = vld1q_f32(wi + k);
+            const float32x4_t xr = vld1q_f32(br), xi = vld1q_f32(bi);
+            const float32x4_t tr = vmlsq_f32(vmulq_f32(xr, twr), xi, twi);
+            const float32x4_t ti = vmlaq_f32(vmulq_f32(xr, twi), xi, twr);
+            const float32x4_t yr = vld1q_f32(ar), yi = vld1q_f32(ai);
+            vst1q_f32(br, vsubq_f32(yr, tr));
+            vst1q_f32(bi, vsubq_f32(yi, ti));
+            vst1q_f32(ar, vaddq_f32(yr, tr));
+            vst1q_f32(ai, vaddq_f32(yi, ti));
+        }
+    }
+}
+#endif
+
+const char* RealFft::KernelName() {
+#if FFT_SSE2
+    return "sse2";
+#elif FFT_NEON
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+void RealFft::Forward(const float* in, float* re, float* im) {
+    const size_t n = half_;
+    float* zr = re_.data();
+    float* zi = im_.data();
+    for (size_t i = 0; i < n; i++) {
+        zr[reverse_[i]] = in[2 * i];
+        zi[reverse_[i]] = in[2 * i + 1];
+    }
+
+    // Spans 2 and 4 together: the twiddles are 1 and -i, no multiplies
+    for (size_t j = 0; j < n; j += 4) {
+        const float r0 = zr[j] + zr[j + 1], i0 = zi[j] + zi[j + 1];
+        const float r1 = zr[j] - zr[j + 1], i1 = zi[j] - zi[j + 1];
+        const float r2 = zr[j + 2] + zr[j + 3], i2 = zi[j + 2] + zi[j + 3];
+        const float r3 = zr[j + 2] - zr[j + 3], i3 = zi[j + 2] - zi[j + 3];
+        zr[j] = r0 + r2;
+        zi[j] = i0 + i2;
+        zr[j + 2] = r0 - r2;
+        zi[j + 2] = i0 - i2;
+        // -i * (r3 + i i3) = i3 - i r3
+        zr[j + 1] = r1 + i3;
+        zi[j + 1] = i1 - r3;
+        zr[j + 3] = r1 - i3;
+        zi[j + 3] = i1 + r3;
+    }
+
+    for (size_t h = 4; h < n; h *= 2) {
+        const float* wr = stageRe_.data() + h;
+        const float* wi = stageIm_.data() + h;
+#if FFT_SSE2
+        StageSse2(zr, zi, n, h, wr, wi);
+#elif FFT_NEON
+        StageNeon(zr, zi, n, h, wr, wi);
+#else
+        StageScalar(zr, zi, n, h, wr, wi);
+#endif
+    }
+
+    // Even and odd samples' spectra from the packed one, E and O, then
+    // X[k] = E[k] + e^(-2 pi i k / size) O[k]
+    for (size_t k = 0; k <= n; k++) {
+        const size_t a = k % n, b = (n - k) % n;
+        const float er = 0.5f * (zr[a] + zr[b]), ei = 0.5f * (zi[a] - zi[b]);
+        const float dr = 0.5f * (zr[a] - zr[b]), di = 0.5f * (zi[a] + zi[b]);
+        // O = -i * D
+        const float orr = di, oi = -dr;
+        re[k] = er + splitRe_[k] * orr - splitIm_[k] * oi;
+        im[k] = ei + splitRe_[k] * oi + splitIm_[k] * orr;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Forward FFT of real input, for spectrum display. A size-N transform runs
+// as a complex FFT of N/2 points (even samples as the real part, odd ones as
+// the imaginary) and a final pass that splits the two halves apart.
+//
+// The complex FFT is iterative, in place on separate real and imaginary
+// arrays: a bit-reversal permutation, a radix-4 pass for the first two
+// stages, then radix-2 stages four butterflies at a time with SSE or NEON.
+// Twiddles are precomputed per stage, so every stage reads them in order.
+class RealFft {
+public:
+    // `size` is a power of two, at least 16
+    explicit RealFft(size_t size);
+
+    size_t Size() const { return size_; }
+    // Bins 0..Size()/2 of the transform of `in` (Size() samples) into `re`
+    // and `im`, each Size()/2 + 1 long. Unscaled.
+    void Forward(const float* in, float* re, float* im);
+    // Name of the butterfly kernel picked for this CPU
+    static const char* KernelName();
+
+private:
+    size_t size_;
+    size_t half_;
+    std::vector<size_t> reverse_;         // bit reversal of the half-size indices
+    std::vector<float> stageRe_, stageIm_; // twiddles of the stage of span 2h at [h, 2h)
+    std::vector<float> splitRe_, splitIm_; // e^(-2 pi i k / size), k = 0..size/2
+    std::vector<float> re_, im_;
+};
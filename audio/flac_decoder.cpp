@@ -0,0 +1,524 @@
+#include "decoder.h"
+#include "flac_dsp.h"
+#include "util/mapped_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Native FLAC. Frames are independent, so a seek only has to find the frame
+// holding the target: the SEEKTABLE narrows it to a span between two seek
+// points, a bisection over frame headers narrows that span further, and the
+// last few frames are walked. Prediction and channel decorrelation run through
+// the SIMD kernels in flac_dsp.cpp.
+
+static const size_t kPrefetchBytes = 1 << 20;
+static const size_t kReleaseBytes = 16 << 20;
+// Below this span seeking decodes forward instead of bisecting
+static const size_t kSeekLinearBytes = 64 << 10;
+static const int kMaxChannels = 8;
+static const int kMaxLpcOrder = 32;
+static const uint64_t kPlaceholderPoint = ~0ull;
+
+static uint32_t ReadBE32(const uint8_t* p) { return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]; }
+static uint64_t ReadBE64(const uint8_t* p) { return (uint64_t)ReadBE32(p) << 32 | ReadBE32(p + 4); }
+
+static uint8_t Crc8(const uint8_t* data, size_t size) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; k++) crc = (uint8_t)((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+    }
+    return crc;
+}
+
+struct FlacCrc16Table {
+    uint16_t table[256];
+    FlacCrc16Table() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t r = i << 8;
+            for (int k = 0; k < 8; k++) r = (r & 0x8000) ? (r << 1) ^ 0x8005 : r << 1;
+            table[i] = (uint16_t)r;
+        }
+    }
+};
+
+static uint16_t Crc16(const uint8_t* data, size_t size) {
+    static const FlacCrc16Table crcTable;
+    uint16_t crc = 0;
+    for (size_t i = 0; i < size; i++) crc = (uint16_t)((crc << 8) ^ crcTable.table[(crc >> 8) ^ data[i]]);
+    return crc;
+}
+
+// MSB-first reader over the mapped file. Reading past the end yields zeros;
+// the frame decoder checks Overrun() once per partition and subframe.
+class FlacBitReader {
+public:
+    FlacBitReader(const uint8_t* data, size_t begin, size_t end) : data_(data), pos_(begin), end_(end) {}
+
+    uint32_t Read(int n) {
+        if (n == 0) return 0;
+        if (bits_ < n) Refill();
+        uint32_t v = (uint32_t)(cache_ >> (64 - n));
+        cache_ <<= n;
+        bits_ -= n;
+        return v;
+    }
+
+    int32_t ReadSigned(int n) {
+        if (n == 0) return 0;
+        uint32_t v = Read(n);
+        return (int32_t)(v << (32 - n)) >> (32 - n);
+    }
+
+    uint32_t ReadUnary() {
+        uint32_t count = 0;
+        for (;;) {
+            if (bits_ == 0) Refill();
+            if (cache_ == 0) {
+                count += (uint32_t)bits_;
+                bits_ = 0;
+                if (Overrun()) return count;
+                continue;
+            }
+            int zeros = __builtin_clzll(cache_);
+            count += (uint32_t)zeros;
+            cache_ <<= zeros + 1;
+            bits_ -= zeros + 1;
+            return count;
+        }
+    }
+
+    // Fills `out` with `count` Rice-coded residuals of parameter `k`.
+    void ReadRice(int32_t* out, int count, int k) {
+        for (int i = 0; i < count; i++) {
+            uint32_t v = (ReadUnary() << k) | Read(k);
+            out[i] = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+        }
+    }
+
+    void AlignToByte() {
+        int drop = bits_ & 7;
+        cache_ <<= drop;
+        bits_ -= drop;
+    }
+    size_t BytePosition() const { return pos_ - (size_t)(bits_ >> 3); }
+    bool Overrun() const { return pos_ * 8 - (size_t)bits_ > end_ * 8; }
+
+private:
+    void Refill() {
+        while (bits_ <= 56) {
+            uint64_t byte = pos_ < end_ ? data_[pos_] : 0;
+            cache_ |= byte << (56 - bits_);
+            pos_++;
+            bits_ += 8;
+        }
+    }
+
+    const uint8_t* data_;
+    size_t pos_;
+    size_t end_;
+    uint64_t cache_ = 0;
+    int bits_ = 0;
+};
+
+struct FlacFrameHeader {
+    uint64_t firstSample = 0;
+    int blocksize = 0;
+    int sampleRate = 0;
+    int channels = 0;
+    int assignment = 0;  // 0..7 independent, 8 left/side, 9 side/right, 10 mid/side
+    int bits = 0;
+    size_t size = 0;     // header bytes, CRC-8 included
+};
+
+struct SeekPoint {
+    uint64_t sample;
+    uint64_t offset;  // from the first frame
+};
+
+class FlacDecoder : public Decoder {
+public:
+    bool Open(const std::string& path);
+
+    AudioFormat Format() const override { return format_; }
+    int64_t TotalFrames() const override { return totalSamples_ ? (int64_t)totalSamples_ : -1; }
+    size_t Read(float* out, size_t frames) override;
+    bool Seek(int64_t frame) override;
+
+private:
+    bool ReadMetadata(size_t offset);
+    bool ParseFrameHeader(size_t offset, FlacFrameHeader* header) const;
+    // Next frame header at or after `offset`, before `limit`.
+    bool FindFrame(size_t offset, size_t limit, FlacFrameHeader* header, size_t* found) const;
+    bool DecodeSubframe(FlacBitReader& bits, int32_t* out, int blocksize, int sampleBits);
+    bool DecodeResidual(FlacBitReader& bits, int32_t* out, int blocksize, int order);
+    // Decodes the frame at pos_ into pcm_. Damaged frames come out silent.
+    bool DecodeFrame();
+
+    MappedFile file_;
+    AudioFormat format_;
+    int bits_ = 0;
+    int maxBlocksize_ = 0;
+    bool variableBlocksize_ = false;
+    uint64_t totalSamples_ = 0;
+    size_t dataStart_ = 0;
+    size_t dataEnd_ = 0;
+    std::vector<SeekPoint> seekPoints_;
+
+    std::vector<int32_t> planes_[kMaxChannels];
+    std::vector<float> pcm_;
+    size_t pos_ = 0;
+    uint64_t frameSample_ = 0;
+    size_t pcmFrames_ = 0;
+    size_t pcmPos_ = 0;
+    size_t prefetchedTo_ = 0;
+    size_t releasedTo_ = 0;
+};
+
+bool FlacDecoder::Open(const std::string& path) {
+    if (!file_.Open(path)) return false;
+    const uint8_t* data = file_.Data();
+    size_t size = file_.Size();
+    dataEnd_ = size;
+
+    size_t offset = 0;
+    if (size >= 10 && memcmp(data, "ID3", 3) == 0) {
+        offset = 10 + ((size_t)(data[6] & 0x7F) << 21 | (size_t)(data[7] & 0x7F) << 14 |
+                       (size_t)(data[8] & 0x7F) << 7 | (size_t)(data[9] & 0x7F));
+        if (data[5] & 0x10) offset += 10;
+    }
+    if (offset + 4 > size || memcmp(data + offset, "fLaC", 4) != 0) return false;
+    if (!ReadMetadata(offset + 4)) {
+        std::cerr << "Unsupported or broken FLAC stream" << std::endl;
+        return false;
+    }
+    for (int c = 0; c < format_.channels; c++) planes_[c].resize((size_t)maxBlocksize_);
+    pcm_.resize((size_t)maxBlocksize_ * format_.channels);
+
+    pos_ = dataStart_;
+    file_.AdviseSequential();
+    file_.WillNeed(pos_, kPrefetchBytes);
+    prefetchedTo_ = pos_ + kPrefetchBytes;
+    return true;
+}
+
+bool FlacDecoder::ReadMetadata(size_t offset) {
+    const uint8_t* data = file_.Data();
+    const size_t size = file_.Size();
+    bool haveInfo = false;
+    for (;;) {
+        if (offset + 4 > size) return false;
+        const bool last = (data[offset] & 0x80) != 0;
+        const int type = data[offset] & 0x7F;
+        const size_t length = (size_t)data[offset + 1] << 16 | (size_t)data[offset + 2] << 8 | data[offset + 3];
+        const uint8_t* block = data + offset + 4;
+        if (offset + 4 + length > size) return false;
+
+        if (type == 0 && length >= 34) {
+            // STREAMINFO: min/max block size, min/max frame size, then 20 bits
+            // of sample rate, 3 of channels - 1, 5 of bits - 1, 36 of samples
+            maxBlocksize_ = block[2] << 8 | block[3];
+            format_.sampleRate = (int)(ReadBE32(block + 10) >> 12);
+            format_.channels = ((block[12] >> 1) & 7) + 1;
+            bits_ = (((block[12] & 1) << 4) | (block[13] >> 4)) + 1;
+            totalSamples_ = (uint64_t)(block[13] & 0x0F) << 32 | ReadBE32(block + 14);
+            haveInfo = true;
+        } else if (type == 3) {
+            // SEEKTABLE: 18-byte points, sorted, placeholders last
+            for (size_t p = 0; p + 18 <= length; p += 18) {
+                SeekPoint point{ReadBE64(block + p), ReadBE64(block + p + 8)};
+                if (point.sample == kPlaceholderPoint) break;
+                seekPoints_.push_back(point);
+            }
+        }
+        offset += 4 + length;
+        if (last) break;
+    }
+    dataStart_ = offset;
+    // The blocking strategy bit of the first frame holds for the whole stream
+    if (offset + 2 <= size) variableBlocksize_ = (data[offset + 1] & 1) != 0;
+    if (!haveInfo || format_.sampleRate == 0 || maxBlocksize_ < 16 || bits_ < 4) return false;
+    return true;
+}
+
+bool FlacDecoder::ParseFrameHeader(size_t offset, FlacFrameHeader* header) const {
+    const uint8_t* data = file_.Data();
+    if (offset + 6 > dataEnd_) return false;
+    const uint8_t* p = data + offset;
+    if (p[0] != 0xFF || (p[1] & 0xFE) != 0xF8) return false;
+    const bool variable = (p[1] & 1) != 0;
+    const int blocksizeCode = p[2] >> 4;
+    const int rateCode = p[2] & 0x0F;
+    const int assignment = p[3] >> 4;
+    const int bitsCode = (p[3] >> 1) & 7;
+    if (blocksizeCode == 0 || rateCode == 15 || assignment > 10 || bitsCode == 3 || (p[3] & 1)) return false;
+
+    // Frame or sample number, UTF-8 style
+    size_t n = 4;
+    uint64_t number = p[n++];
+    int extra = 0;
+    if (number < 0x80 && offset + n + 5 > dataEnd_) return false;
+    if (number >= 0x80) {
+        if (number >= 0xFE) return false;
+        int lead = 0;
+        while (number & (0x80 >> lead)) lead++;
+        if (lead == 1) return false;
+        extra = lead - 1;
+        // Worst case after the number: 2 bytes of block size, 2 of rate, CRC-8
+        if (offset + n + extra + 5 > dataEnd_) return false;
+        number &= 0x7F >> lead;
+        for (int i = 0; i < extra; i++) {
+            if ((p[n] & 0xC0) != 0x80) return false;
+            number = number << 6 | (p[n++] & 0x3F);
+        }
+    }
+
+    int blocksize;
+    if (blocksizeCode == 1) {
+        blocksize = 192;
+    } else if (blocksizeCode <= 5) {
+        blocksize = 576 << (blocksizeCode - 2);
+    } else if (blocksizeCode == 6) {
+        blocksize = p[n++] + 1;
+    } else if (blocksizeCode == 7) {
+        blocksize = (p[n] << 8 | p[n + 1]) + 1;
+        n += 2;
+    } else {
+        blocksize = 256 << (blocksizeCode - 8);
+    }
+
+    static const int kRates[12] = {0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000};
+    int rate;
+    if (rateCode < 12) {
+        rate = rateCode ? kRates[rateCode] : format_.sampleRate;
+    } else if (rateCode == 12) {
+        rate = p[n++] * 1000;
+    } else {
+        rate = (p[n] << 8 | p[n + 1]) * (rateCode == 14 ? 10 : 1);
+        n += 2;
+    }
+
+    static const int kBits[8] = {0, 8, 12, 0, 16, 20, 24, 32};
+    if (Crc8(p, n) != p[n]) return false;
+
+    header->firstSample = variable ? number : number * (uint64_t)maxBlocksize_;
+    header->blocksize = blocksize;
+    header->sampleRate = rate;
+    header->assignment = assignment;
+    header->channels = assignment < 8 ? assignment + 1 : 2;
+    header->bits = bitsCode ? kBits[bitsCode] : bits_;
+    header->size = n + 1;
+    // A header from another stream (or noise that passed the CRC) won't match ours
+    return header->channels == format_.channels && header->bits == bits_ && rate == format_.sampleRate &&
+           blocksize <= maxBlocksize_ && variable == variableBlocksize_;
+}
+
+bool FlacDecoder::FindFrame(size_t offset, size_t limit, FlacFrameHeader* header, size_t* found) const {
+    const uint8_t* data = file_.Data();
+    limit = std::min(limit, dataEnd_);
+    while (offset + 2 <= limit) {
+        const void* hit = memchr(data + offset, 0xFF, limit - offset);
+        if (!hit) return false;
+        offset = (size_t)((const uint8_t*)hit - data);
+        if (ParseFrameHeader(offset, header)) {
+            if (totalSamples_ == 0 || header->firstSample < totalSamples_) {
+                *found = offset;
+                return true;
+            }
+        }
+        offset++;
+    }
+    return false;
+}
+
+bool FlacDecoder::DecodeResidual(FlacBitReader& bits, int32_t* out, int blocksize, int order) {
+    const int method = (int)bits.Read(2);
+    if (method > 1) return false;
+    const int paramBits = method ? 5 : 4;
+    const uint32_t escape = method ? 31 : 15;
+    const int partitionOrder = (int)bits.Read(4);
+    const int partitions = 1 << partitionOrder;
+    const int partitionSize = blocksize >> partitionOrder;
+    if ((partitionSize << partitionOrder) != blocksize || partitionSize < order) return false;
+
+    int32_t* dst = out + order;
+    for (int p = 0; p < partitions; p++) {
+        const int count = p == 0 ? partitionSize - order : partitionSize;
+        const uint32_t param = bits.Read(paramBits);
+        if (param == escape) {
+            const int raw = (int)bits.Read(5);
+            for (int i = 0; i < count; i++) dst[i] = bits.ReadSigned(raw);
+        } else {
+            bits.ReadRice(dst, count, (int)param);
+        }
+        dst += count;
+        if (bits.Overrun()) return false;
+    }
+    return true;
+}
+
+bool FlacDecoder::DecodeSubframe(FlacBitReader& bits, int32_t* out, int blocksize, int sampleBits) {
+    if (bits.Read(1) != 0) return false;
+    const int type = (int)bits.Read(6);
+    int wasted = 0;
+    if (bits.Read(1)) wasted = (int)bits.ReadUnary() + 1;
+    if (wasted >= sampleBits) return false;
+    sampleBits -= wasted;
+
+    if (type == 0) {
+        const int32_t value = bits.ReadSigned(sampleBits);
+        std::fill(out, out + blocksize, value);
+    } else if (type == 1) {
+        for (int i = 0; i < blocksize; i++) out[i] = bits.ReadSigned(sampleBits);
+    } else if (type >= 8 && type <= 12) {
+        const int order = type - 8;
+        if (order > blocksize) return false;
+        for (int i = 0; i < order; i++) out[i] = bits.ReadSigned(sampleBits);
+        if (!DecodeResidual(bits, out, blocksize, order)) return false;
+        FlacRestoreFixed(out, blocksize, order);
+    } else if (type >= 32) {
+        const int order = type - 31;
+        if (order > blocksize) return false;
+        for (int i = 0; i < order; i++) out[i] = bits.ReadSigned(sampleBits);
+        const int precision = (int)bits.Read(4) + 1;
+        if (precision == 16) return false;
+        const int shift = bits.ReadSigned(5);
+        if (shift < 0) return false;
+        int32_t coefs[kMaxLpcOrder];
+        for (int i = 0; i < order; i++) coefs[i] = bits.ReadSigned(precision);
+        if (!DecodeResidual(bits, out, blocksize, order)) return false;
+        int log2Order = 0;
+        while ((2 << log2Order) <= order) log2Order++;
+        FlacRestoreLpc(out, blocksize, coefs, order, shift, sampleBits + precision + log2Order > 32);
+    } else {
+        return false;
+    }
+
+    if (wasted) {
+        for (int i = 0; i < blocksize; i++) out[i] = (int32_t)((uint32_t)out[i] << wasted);
+    }
+    return !bits.Overrun();
+}
+
+bool FlacDecoder::DecodeFrame() {
+    FlacFrameHeader header;
+    size_t start = pos_;
+    if (!ParseFrameHeader(pos_, &header)) {
+        // Lost sync: damaged data or trailing junk
+        if (!FindFrame(pos_ + 1, dataEnd_, &header, &start)) return false;
+    }
+
+    const int blocksize = header.blocksize;
+    FlacBitReader bits(file_.Data(), start + header.size, dataEnd_);
+    bool ok = true;
+    for (int c = 0; c < header.channels && ok; c++) {
+        // The side channel carries one extra bit
+        int sampleBits = header.bits;
+        if ((header.assignment == 8 || header.assignment == 10) && c == 1) sampleBits++;
+        if (header.assignment == 9 && c == 0) sampleBits++;
+        ok = DecodeSubframe(bits, planes_[c].data(), blocksize, sampleBits);
+    }
+    bits.AlignToByte();
+    size_t end = bits.BytePosition() + 2;
+    if (ok && (end > dataEnd_ || Crc16(file_.Data() + start, end - start - 2) != (file_.Data()[end - 2] << 8 | file_.Data()[end - 1])))
+        ok = false;
+
+    if (ok) {
+        if (header.assignment == 8) FlacDecorrelate(FlacStereo::LeftSide, planes_[0].data(), planes_[1].data(), blocksize);
+        if (header.assignment == 9) FlacDecorrelate(FlacStereo::SideRight, planes_[0].data(), planes_[1].data(), blocksize);
+        if (header.assignment == 10) FlacDecorrelate(FlacStereo::MidSide, planes_[0].data(), planes_[1].data(), blocksize);
+        const int32_t* planes[kMaxChannels];
+        for (int c = 0; c < header.channels; c++) planes[c] = planes_[c].data();
+        FlacToFloat(planes, header.channels, blocksize, header.bits, pcm_.data());
+    } else {
+        // Keep the timeline intact and pick up at the next frame
+        std::fill(pcm_.begin(), pcm_.begin() + (size_t)blocksize * format_.channels, 0.0f);
+        FlacFrameHeader next;
+        if (!FindFrame(start + header.size, dataEnd_, &next, &end)) end = dataEnd_;
+    }
+
+    frameSample_ = header.firstSample;
+    pcmFrames_ = (size_t)blocksize;
+    if (totalSamples_ && frameSample_ + pcmFrames_ > totalSamples_)
+        pcmFrames_ = (size_t)(totalSamples_ > frameSample_ ? totalSamples_ - frameSample_ : 0);
+    pcmPos_ = 0;
+    pos_ = end;
+
+    if (pos_ + kPrefetchBytes / 2 > prefetchedTo_) {
+        file_.WillNeed(prefetchedTo_, kPrefetchBytes);
+        prefetchedTo_ += kPrefetchBytes;
+    }
+    if (pos_ > releasedTo_ + kReleaseBytes) {
+        size_t keep = pos_ - kReleaseBytes / 4;
+        file_.Release(releasedTo_, keep - releasedTo_);
+        releasedTo_ = keep;
+    }
+    return true;
+}
+
+size_t FlacDecoder::Read(float* out, size_t frames) {
+    const size_t channels = (size_t)format_.channels;
+    size_t done = 0;
+    while (done < frames) {
+        if (pcmPos_ == pcmFrames_ && !DecodeFrame()) break;
+        size_t n = std::min(frames - done, pcmFrames_ - pcmPos_);
+        memcpy(out + done * channels, pcm_.data() + pcmPos_ * channels, n * channels * sizeof(float));
+        pcmPos_ += n;
+        done += n;
+    }
+    return done;
+}
+
+bool FlacDecoder::Seek(int64_t frame) {
+    if (frame < 0) return false;
+    uint64_t target = (uint64_t)frame;
+    if (totalSamples_) target = std::min(target, totalSamples_);
+
+    // Seek points bracket the target
+    size_t lo = dataStart_;
+    size_t hi = dataEnd_;
+    for (const SeekPoint& point : seekPoints_) {
+        if (dataStart_ + point.offset >= dataEnd_) break;
+        if (point.sample <= target) {
+            lo = std::max(lo, (size_t)(dataStart_ + point.offset));
+        } else {
+            hi = (size_t)(dataStart_ + point.offset);
+            break;
+        }
+    }
+
+    // Narrow down to the last frame starting at or before the target
+    FlacFrameHeader header;
+    size_t found = 0;
+    while (hi - lo > kSeekLinearBytes) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (!FindFrame(mid, hi, &header, &found) || header.firstSample > target) {
+            hi = mid;
+        } else {
+            lo = found;
+        }
+    }
+
+    pos_ = lo;
+    pcmFrames_ = pcmPos_ = 0;
+    file_.WillNeed(pos_, kPrefetchBytes);
+    prefetchedTo_ = pos_ + kPrefetchBytes;
+    releasedTo_ = std::min(releasedTo_, pos_);
+
+    while (DecodeFrame()) {
+        if (target < frameSample_ + pcmFrames_) {
+            pcmPos_ = target > frameSample_ ? (size_t)(target - frameSample_) : 0;
+            return true;
+        }
+    }
+    pcmFrames_ = pcmPos_ = 0;
+    return true;
+}
+
+std::unique_ptr<Decoder> OpenFlacDecoder(const std::string& path) {
+    auto decoder = std::make_unique<FlacDecoder>();
+    if (!decoder->Open(path)) return nullptr;
+    return decoder;
+}
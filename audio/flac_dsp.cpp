@@ -0,0 +1,249 @@
+#include "flac_dsp.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define FLAC_DSP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FLAC_DSP_AVX2 1
+#include <immintrin.h>
+#endif
+
+static const int kMaxLpcOrder = 32;
+
+// The prediction recurrence is serial, so the vector versions work on a block
+// of W outputs at once: every tap whose input lies before the block is summed
+// for all W lanes in parallel (lanes whose input is still inside the block get
+// a zero coefficient), and the small triangle of in-block taps is finished in
+// scalar code as each output becomes known.
+
+static void RestoreLpcScalar(int32_t* s, int begin, int count, const int32_t* c, int order, int shift) {
+    for (int i = begin; i < count; i++) {
+        int32_t sum = 0;
+        for (int j = 0; j < order; j++) sum += c[j] * s[i - 1 - j];
+        s[i] += sum >> shift;
+    }
+}
+
+static void RestoreLpcWideScalar(int32_t* s, int begin, int count, const int32_t* c, int order, int shift) {
+    for (int i = begin; i < count; i++) {
+        int64_t sum = 0;
+        for (int j = 0; j < order; j++) sum += (int64_t)c[j] * s[i - 1 - j];
+        s[i] += (int32_t)(sum >> shift);
+    }
+}
+
+#if FLAC_DSP_SSE2
+// 32-bit lane multiply without SSE4.1's pmulld
+static inline __m128i MulLo32(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static int RestoreLpcSse2(int32_t* s, int count, const int32_t* c, int order, int shift) {
+    __m128i coef[kMaxLpcOrder];
+    for (int j = 0; j < order; j++) {
+        // Lane k takes tap j only when its input s[i + k - 1 - j] precedes the block
+        coef[j] = _mm_setr_epi32(c[j], j >= 1 ? c[j] : 0, j >= 2 ? c[j] : 0, j >= 3 ? c[j] : 0);
+    }
+    alignas(16) int32_t acc[4];
+    int i = order;
+    for (; i + 4 <= count; i += 4) {
+        __m128i sum = _mm_setzero_si128();
+        for (int j = 0; j < order; j++)
+            sum = _mm_add_epi32(sum, MulLo32(_mm_loadu_si128((const __m128i*)(s + i - 1 - j)), coef[j]));
+        _mm_store_si128((__m128i*)acc, sum);
+        for (int k = 0; k < 4; k++) {
+            int32_t v = acc[k];
+            for (int j = 0; j < k && j < order; j++) v += c[j] * s[i + k - 1 - j];
+            s[i + k] += v >> shift;
+        }
+    }
+    return i;
+}
+#endif
+
+#if FLAC_DSP_AVX2
+__attribute__((target("avx2")))
+static int RestoreLpcAvx2(int32_t* s, int count, const int32_t* c, int order, int shift) {
+    __m256i coef[kMaxLpcOrder];
+    for (int j = 0; j < order; j++) {
+        coef[j] = _mm256_setr_epi32(c[j], j >= 1 ? c[j] : 0, j >= 2 ? c[j] : 0, j >= 3 ? c[j] : 0,
+                                    j >= 4 ? c[j] : 0, j >= 5 ? c[j] : 0, j >= 6 ? c[j] : 0, j >= 7 ? c[j] : 0);
+    }
+    alignas(32) int32_t acc[8];
+    int i = order;
+    for (; i + 8 <= count; i += 8) {
+        __m256i sum = _mm256_setzero_si256();
+        for (int j = 0; j < order; j++)
+            sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)(s + i - 1 - j)), coef[j]));
+        _mm256_store_si256((__m256i*)acc, sum);
+        for (int k = 0; k < 8; k++) {
+            int32_t v = acc[k];
+            for (int j = 0; j < k && j < order; j++) v += c[j] * s[i + k - 1 - j];
+            s[i + k] += v >> shift;
+        }
+    }
+    return i;
+}
+
+// 64-bit accumulation, four outputs per block: samples are widened to 64-bit
+// lanes and vpmuldq multiplies their low halves as signed values.
+__attribute__((target("avx2")))
+static int RestoreLpcWideAvx2(int32_t* s, int count, const int32_t* c, int order, int shift) {
+    __m256i coef[kMaxLpcOrder];
+    for (int j = 0; j < order; j++) {
+        coef[j] = _mm256_setr_epi64x(c[j], j >= 1 ? c[j] : 0, j >= 2 ? c[j] : 0, j >= 3 ? c[j] : 0);
+    }
+    alignas(32) int64_t acc[4];
+    int i = order;
+    for (; i + 4 <= count; i += 4) {
+        __m256i sum = _mm256_setzero_si256();
+        for (int j = 0; j < order; j++) {
+            __m256i v = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(s + i - 1 - j)));
+            sum = _mm256_add_epi64(sum, _mm256_mul_epi32(v, coef[j]));
+        }
+        _mm256_store_si256((__m256i*)acc, sum);
+        for (int k = 0; k < 4; k++) {
+            int64_t v = acc[k];
+            for (int j = 0; j < k && j < order; j++) v += (int64_t)c[j] * s[i + k - 1 - j];
+            s[i + k] += (int32_t)(v >> shift);
+        }
+    }
+    return i;
+}
+#endif
+
+void FlacRestoreLpc(int32_t* samples, int count, const int32_t* coefs, int order, int shift, bool wide) {
+    int i = order;
+#if FLAC_DSP_AVX2
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (wide) {
+#if FLAC_DSP_AVX2
+        if (hasAvx2 && order <= kMaxLpcOrder) i = RestoreLpcWideAvx2(samples, count, coefs, order, shift);
+#endif
+        RestoreLpcWideScalar(samples, i, count, coefs, order, shift);
+        return;
+    }
+#if FLAC_DSP_AVX2
+    if (hasAvx2 && order <= kMaxLpcOrder) {
+        i = RestoreLpcAvx2(samples, count, coefs, order, shift);
+    } else
+#endif
+    {
+#if FLAC_DSP_SSE2
+        if (order <= kMaxLpcOrder) i = RestoreLpcSse2(samples, count, coefs, order, shift);
+#endif
+    }
+    RestoreLpcScalar(samples, i, count, coefs, order, shift);
+}
+
+void FlacRestoreFixed(int32_t* s, int count, int order) {
+    switch (order) {
+    case 1:
+        for (int i = 1; i < count; i++) s[i] += s[i - 1];
+        break;
+    case 2:
+        for (int i = 2; i < count; i++) s[i] += 2 * s[i - 1] - s[i - 2];
+        break;
+    case 3:
+        for (int i = 3; i < count; i++) s[i] += 3 * s[i - 1] - 3 * s[i - 2] + s[i - 3];
+        break;
+    case 4:
+        for (int i = 4; i < count; i++) s[i] += 4 * s[i - 1] - 6 * s[i - 2] + 4 * s[i - 3] - s[i - 4];
+        break;
+    default:
+        break;
+    }
+}
+
+#if FLAC_DSP_AVX2
+__attribute__((target("avx2")))
+static int DecorrelateAvx2(FlacStereo mode, int32_t* a, int32_t* b, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+        __m256i left, right;
+        if (mode == FlacStereo::LeftSide) {
+            left = x;
+            right = _mm256_sub_epi32(x, y);
+        } else if (mode == FlacStereo::SideRight) {
+            left = _mm256_add_epi32(x, y);
+            right = y;
+        } else {
+            __m256i mid = _mm256_or_si256(_mm256_slli_epi32(x, 1), _mm256_and_si256(y, _mm256_set1_epi32(1)));
+            left = _mm256_srai_epi32(_mm256_add_epi32(mid, y), 1);
+            right = _mm256_srai_epi32(_mm256_sub_epi32(mid, y), 1);
+        }
+        _mm256_storeu_si256((__m256i*)(a + i), left);
+        _mm256_storeu_si256((__m256i*)(b + i), right);
+    }
+    return i;
+}
+#endif
+
+void FlacDecorrelate(FlacStereo mode, int32_t* a, int32_t* b, int count) {
+    int i = 0;
+#if FLAC_DSP_AVX2
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    if (hasAvx2) i = DecorrelateAvx2(mode, a, b, count);
+#endif
+#if FLAC_DSP_SSE2
+    const __m128i one = _mm_set1_epi32(1);
+    for (; i + 4 <= count; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        __m128i left, right;
+        if (mode == FlacStereo::LeftSide) {
+            left = x;
+            right = _mm_sub_epi32(x, y);
+        } else if (mode == FlacStereo::SideRight) {
+            left = _mm_add_epi32(x, y);
+            right = y;
+        } else {
+            __m128i mid = _mm_or_si128(_mm_slli_epi32(x, 1), _mm_and_si128(y, one));
+            left = _mm_srai_epi32(_mm_add_epi32(mid, y), 1);
+            right = _mm_srai_epi32(_mm_sub_epi32(mid, y), 1);
+        }
+        _mm_storeu_si128((__m128i*)(a + i), left);
+        _mm_storeu_si128((__m128i*)(b + i), right);
+    }
+#endif
+    for (; i < count; i++) {
+        int32_t x = a[i], y = b[i];
+        if (mode == FlacStereo::LeftSide) {
+            b[i] = x - y;
+        } else if (mode == FlacStereo::SideRight) {
+            a[i] = x + y;
+        } else {
+            int32_t mid = (int32_t)((uint32_t)x << 1) | (y & 1);
+            a[i] = (mid + y) >> 1;
+            b[i] = (mid - y) >> 1;
+        }
+    }
+}
+
+void FlacToFloat(const int32_t* const* planes, int channels, int count, int bits, float* out) {
+    const float scale = 1.0f / (float)(1u << (bits - 1));
+    int i = 0;
+#if FLAC_DSP_SSE2
+    if (channels == 2) {
+        const __m128 vscale = _mm_set1_ps(scale);
+        const int32_t* l = planes[0];
+        const int32_t* r = planes[1];
+        for (; i + 4 <= count; i += 4) {
+            __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(l + i))), vscale);
+            __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(r + i))), vscale);
+            _mm_storeu_ps(out + i * 2, _mm_unpacklo_ps(a, b));
+            _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(a, b));
+        }
+    }
+#endif
+    for (; i < count; i++)
+        for (int c = 0; c < channels; c++) out[i * channels + c] = planes[c][i] * scale;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Inner loops of the FLAC decoder. Each has a portable version plus SSE2 and
+// AVX2 variants chosen at first use from what the CPU reports.
+
+// Restores an LPC subframe in place: samples[0, order) hold the warm-up
+// samples, samples[order, count) the residual on entry and the signal on
+// return. `wide` selects 64-bit accumulation, needed once
+// bits per sample + coefficient precision + log2(order) exceeds 32.
+void FlacRestoreLpc(int32_t* samples, int count, const int32_t* coefs, int order, int shift, bool wide);
+
+// Fixed predictors (orders 0..4), same in-place convention.
+void FlacRestoreFixed(int32_t* samples, int count, int order);
+
+enum class FlacStereo {
+    LeftSide,
+    SideRight,
+    MidSide,
+};
+
+// Undoes inter-channel decorrelation: `a` and `b` are the two coded channels
+// on entry and left/right on return.
+void FlacDecorrelate(FlacStereo mode, int32_t* a, int32_t* b, int count);
+
+// Interleaves `channels` planes of `bits`-bit integers into floats in [-1, 1].
+void FlacToFloat(const int32_t* const* planes, int channels, int count, int bits, float* out);
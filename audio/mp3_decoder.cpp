@@ -0,0 +1,453 @@
+#include "decoder.h"
+#include "util/cache_dir.h"
+#include "util/mapped_file.h"
+
+#define MP3DEC_IMPLEMENTATION
+#include "mp3dec.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// MPEG audio Layer III on top of the vendored mp3dec.h. Seeking goes through a
+// frame index so a jump costs the same anywhere in the file:
+//   - VBRI header: exact frame offsets straight from its table,
+//   - otherwise: one header-only pass over the file, cached on disk for big
+//     files. With a Xing/Info header (which gives the length) the pass waits
+//     for the first seek; its byte TOC is not used, as an offset interpolated
+//     from it can't tell which frame it landed on.
+// Encoder delay and padding from the LAME tag (or an iTunSMPB comment) are
+// trimmed so consecutive tracks of an album join without a gap.
+
+static const size_t kPrefetchBytes = 1 << 20;
+static const size_t kReleaseBytes = 16 << 20;
+// One checkpoint per this many frames; the rest of the way is a few header hops.
+static const uint32_t kIndexStride = 32;
+// Scanning a small file is faster than reading a cache entry for it.
+static const size_t kIndexCacheMinBytes = 32 << 20;
+
+// Samples the synthesis filterbank delays its output by, on top of the encoder delay
+static const uint32_t kDecoderDelay = 529;
+
+static const char kIndexMagic[4] = {'M', 'P', '3', 'X'};
+static const uint32_t kIndexVersion = 1;
+
+struct Mp3IndexFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t fileSize;
+    int64_t mtime;
+    uint64_t frames;
+    uint32_t stride;
+    uint32_t count;
+};
+
+static uint32_t ReadBE32(const uint8_t* p) { return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]; }
+static uint16_t ReadBE16(const uint8_t* p) { return (uint16_t)(p[0] << 8 | p[1]); }
+
+class Mp3Decoder : public Decoder {
+public:
+    bool Open(const std::string& path, bool saveIndex);
+
+    AudioFormat Format() const override { return format_; }
+    int64_t TotalFrames() const override { return (int64_t)totalSamples_; }
+    size_t Read(float* out, size_t frames) override;
+    bool Seek(int64_t frame) override;
+
+private:
+    size_t SkipTags();
+    // Frame length at `offset` if it holds a header matching the stream, else 0.
+    size_t FrameAt(size_t offset) const;
+    size_t Resync(size_t offset) const;
+    void ParseVbrHeader();
+    void ParseLameTag(const uint8_t* tag, const uint8_t* end);
+    void ParseItunesGapless(const uint8_t* tag, size_t size);
+    void ScanFrames();
+    // Checkpoints from the cache or a scan, if there are none yet
+    void BuildIndex();
+    bool LoadIndex();
+    void SaveIndex() const;
+    // Byte offset of the first frame at or before `frame`, and that frame's number.
+    size_t Locate(uint64_t frame, uint64_t* located) const;
+    bool DecodeFrame();
+
+    std::string path_;
+    bool saveIndex_ = true;
+    MappedFile file_;
+    std::unique_ptr<mp3dec> dec_;
+    AudioFormat format_;
+    mp3dec_header first_{};
+    uint64_t samplesPerFrame_ = 0;
+    size_t dataStart_ = 0;
+    size_t dataEnd_ = 0;
+
+    uint64_t frameCount_ = 0;
+    std::vector<uint64_t> checkpoints_;  // offset of every kIndexStride-th frame (or VBRI stride)
+    uint32_t checkpointStride_ = kIndexStride;
+
+    // Gapless trimming, in decoded samples
+    bool haveGapless_ = false;
+    uint64_t encoderDelay_ = 0;
+    uint64_t encoderPadding_ = 0;
+    uint64_t leadingSkip_ = 0;
+    uint64_t totalSamples_ = 0;
+
+    size_t pos_ = 0;
+    uint64_t frameNumber_ = 0;
+    float pcm_[MP3DEC_MAX_SAMPLES_PER_FRAME];
+    size_t pcmFrames_ = 0;
+    size_t pcmPos_ = 0;
+    size_t prefetchedTo_ = 0;
+    size_t releasedTo_ = 0;
+};
+
+bool Mp3Decoder::Open(const std::string& path, bool saveIndex) {
+    path_ = path;
+    saveIndex_ = saveIndex;
+    if (!file_.Open(path)) return false;
+    dataEnd_ = SkipTags();
+
+    size_t first = Resync(dataStart_);
+    if (first >= dataEnd_) return false;
+    mp3dec_parse_header(file_.Data() + first, &first_);
+    dataStart_ = first;
+    format_.sampleRate = first_.sample_rate;
+    format_.channels = first_.channels;
+    samplesPerFrame_ = (uint64_t)first_.samples;
+
+    ParseVbrHeader();
+    if (frameCount_ == 0) BuildIndex();
+    if (frameCount_ == 0) return false;
+
+    const uint64_t decoded = frameCount_ * samplesPerFrame_;
+    totalSamples_ = decoded;
+    if (haveGapless_ && encoderDelay_ + encoderPadding_ < decoded) {
+        leadingSkip_ = encoderDelay_ + kDecoderDelay;
+        totalSamples_ = decoded - encoderDelay_ - encoderPadding_;
+    }
+
+    dec_ = std::make_unique<mp3dec>();
+    mp3dec_init(dec_.get());
+    pos_ = dataStart_;
+    file_.AdviseSequential();
+    file_.WillNeed(pos_, kPrefetchBytes);
+    prefetchedTo_ = pos_ + kPrefetchBytes;
+    return true;
+}
+
+// Skips a leading ID3v2 tag and trims a trailing ID3v1 one. Returns the end of the audio data.
+size_t Mp3Decoder::SkipTags() {
+    const uint8_t* data = file_.Data();
+    size_t size = file_.Size();
+    if (size >= 10 && memcmp(data, "ID3", 3) == 0) {
+        size_t tag = 10 + ((size_t)(data[6] & 0x7F) << 21 | (size_t)(data[7] & 0x7F) << 14 |
+                           (size_t)(data[8] & 0x7F) << 7 | (size_t)(data[9] & 0x7F));
+        if (data[5] & 0x10) tag += 10;  // footer
+        dataStart_ = std::min(tag, size);
+        ParseItunesGapless(data, dataStart_);
+    }
+    if (size >= dataStart_ + 128 && memcmp(data + size - 128, "TAG", 3) == 0) size -= 128;
+    return size;
+}
+
+size_t Mp3Decoder::FrameAt(size_t offset) const {
+    if (offset + 4 > dataEnd_) return 0;
+    mp3dec_header h;
+    size_t bytes = (size_t)mp3dec_parse_header(file_.Data() + offset, &h);
+    if (bytes == 0 || offset + bytes > dataEnd_) return 0;
+    if (first_.sample_rate != 0 && (h.sample_rate != first_.sample_rate || h.channels != first_.channels)) return 0;
+    return bytes;
+}
+
+// Finds the next offset holding two back-to-back valid frames (or one that ends the data).
+size_t Mp3Decoder::Resync(size_t offset) const {
+    const uint8_t* data = file_.Data();
+    mp3dec_header a, b;
+    for (; offset + 4 <= dataEnd_; offset++) {
+        if (data[offset] != 0xFF) continue;
+        size_t bytes = (size_t)mp3dec_parse_header(data + offset, &a);
+        if (bytes == 0 || offset + bytes > dataEnd_) continue;
+        if (first_.sample_rate != 0 && (a.sample_rate != first_.sample_rate || a.channels != first_.channels)) continue;
+        size_t next = offset + bytes;
+        if (next + 4 > dataEnd_) return offset;
+        if (mp3dec_parse_header(data + next, &b) && b.sample_rate == a.sample_rate && b.channels == a.channels &&
+            b.lsf == a.lsf)
+            return offset;
+    }
+    return dataEnd_;
+}
+
+// Xing/Info (LAME and most encoders) or VBRI (Fraunhofer) header in the first frame.
+// That frame carries no audio and is skipped.
+void Mp3Decoder::ParseVbrHeader() {
+    const uint8_t* frame = file_.Data() + dataStart_;
+    const size_t bytes = (size_t)first_.frame_bytes;
+    const size_t side = 4 + (first_.protection ? 2 : 0) + (size_t)first_.side_info_bytes;
+
+    if (side + 8 <= bytes && (memcmp(frame + side, "Xing", 4) == 0 || memcmp(frame + side, "Info", 4) == 0)) {
+        const uint8_t* p = frame + side + 4;
+        const uint8_t* end = frame + bytes;
+        uint32_t flags = ReadBE32(p);
+        p += 4;
+        if ((flags & 1) && p + 4 <= end) {
+            frameCount_ = ReadBE32(p);
+            p += 4;
+        }
+        if (flags & 2) p += 4;    // stream bytes
+        if (flags & 4) p += 100;  // TOC
+        if (flags & 8) p += 4;    // quality
+        ParseLameTag(p, end);
+        dataStart_ += bytes;
+        return;
+    }
+
+    if (36 + 26 <= bytes && memcmp(frame + 36, "VBRI", 4) == 0) {
+        const uint8_t* p = frame + 36;
+        uint32_t frames = ReadBE32(p + 14);
+        uint16_t entries = ReadBE16(p + 18);
+        uint16_t scale = ReadBE16(p + 20);
+        uint16_t entrySize = ReadBE16(p + 22);
+        uint16_t framesPerEntry = ReadBE16(p + 24);
+        const uint8_t* table = p + 26;
+        dataStart_ += bytes;
+        frameCount_ = frames;
+        if (entrySize < 1 || entrySize > 4 || framesPerEntry == 0 ||
+            table + (size_t)entries * entrySize > file_.Data() + dataEnd_)
+            return;
+
+        // Entries are byte deltas between checkpoints, scaled by `scale`
+        checkpointStride_ = framesPerEntry;
+        uint64_t offset = dataStart_;
+        checkpoints_.push_back(offset);
+        for (uint16_t i = 0; i < entries; i++) {
+            uint32_t delta = 0;
+            for (uint16_t k = 0; k < entrySize; k++) delta = delta << 8 | table[(size_t)i * entrySize + k];
+            offset += (uint64_t)delta * scale;
+            if (offset >= dataEnd_) break;
+            checkpoints_.push_back(offset);
+        }
+    }
+}
+
+// The LAME extension follows the Xing fields: a 9-byte encoder string, then
+// at offset 21 the encoder delay and padding as two 12-bit numbers.
+// FFmpeg's muxer writes the same layout under its own encoder string.
+void Mp3Decoder::ParseLameTag(const uint8_t* tag, const uint8_t* end) {
+    if (tag + 24 > end || !isalpha(tag[0]) || !isalpha(tag[1]) || !isalpha(tag[2]) || !isalpha(tag[3])) return;
+    encoderDelay_ = (uint64_t)tag[21] << 4 | tag[22] >> 4;
+    encoderPadding_ = (uint64_t)(tag[22] & 0x0F) << 8 | tag[23];
+    haveGapless_ = true;
+}
+
+// iTunes stores gapless info as an ID3v2 comment named "iTunSMPB":
+// " 00000000 DDDDDDDD PPPPPPPP LLLLLLLLLLLLLLLL ..." with delay, padding and
+// length in hex. The LAME tag wins when both are present.
+void Mp3Decoder::ParseItunesGapless(const uint8_t* tag, size_t size) {
+    const int version = tag[3];
+    if (version < 3 || (tag[5] & 0x40)) return;  // v2.2 or extended header: not worth it
+    size_t offset = 10;
+    while (offset + 10 <= size) {
+        const uint8_t* frame = tag + offset;
+        if (frame[0] == 0) break;
+        size_t length = version >= 4 ? ((size_t)(frame[4] & 0x7F) << 21 | (size_t)(frame[5] & 0x7F) << 14 |
+                                        (size_t)(frame[6] & 0x7F) << 7 | (size_t)(frame[7] & 0x7F))
+                                     : (size_t)ReadBE32(frame + 4);
+        if (offset + 10 + length > size) break;
+        // Latin-1 or UTF-8 comment: encoding, language, description, NUL, text
+        const char* body = (const char*)frame + 10;
+        if (memcmp(frame, "COMM", 4) == 0 && length > 13 && (body[0] == 0 || body[0] == 3) &&
+            memcmp(body + 4, "iTunSMPB", 9) == 0) {
+            std::string text(body + 13, length - 13);
+            unsigned int zero = 0, delay = 0, padding = 0;
+            if (sscanf(text.c_str(), "%x %x %x", &zero, &delay, &padding) == 3 && delay < 0x10000 && padding < 0x10000) {
+                encoderDelay_ = delay;
+                encoderPadding_ = padding;
+                haveGapless_ = true;
+            }
+            return;
+        }
+        offset += 10 + length;
+    }
+}
+
+void Mp3Decoder::ScanFrames() {
+    checkpoints_.clear();
+    checkpointStride_ = kIndexStride;
+    frameCount_ = 0;
+    size_t offset = dataStart_;
+    while (offset < dataEnd_) {
+        size_t bytes = FrameAt(offset);
+        if (bytes == 0) {
+            offset = Resync(offset + 1);
+            continue;
+        }
+        if (frameCount_ % kIndexStride == 0) checkpoints_.push_back(offset);
+        frameCount_++;
+        offset += bytes;
+    }
+    // The scan faulted in the whole file; the decoder only needs the start
+    file_.Release(0, file_.Size());
+}
+
+void Mp3Decoder::BuildIndex() {
+    if (!checkpoints_.empty()) return;
+    // The length from the Xing header stands; the scan only places the frames
+    const uint64_t frames = frameCount_;
+    if (!LoadIndex()) {
+        ScanFrames();
+        if (saveIndex_) SaveIndex();
+    }
+    if (frames != 0) frameCount_ = frames;
+}
+
+bool Mp3Decoder::LoadIndex() {
+    if (file_.Size() < kIndexCacheMinBytes) return false;
+    std::string cachePath = CachePathFor("mp3index", path_, ".idx");
+    FileStamp stamp;
+    if (cachePath.empty() || !GetFileStamp(path_, &stamp)) return false;
+
+    MappedFile cache;
+    if (!cache.Open(cachePath) || cache.Size() < sizeof(Mp3IndexFileHeader)) return false;
+    Mp3IndexFileHeader header;
+    memcpy(&header, cache.Data(), sizeof(header));
+    if (memcmp(header.magic, kIndexMagic, 4) != 0 || header.version != kIndexVersion ||
+        header.fileSize != stamp.size || header.mtime != stamp.mtime || header.stride != kIndexStride ||
+        cache.Size() != sizeof(header) + (size_t)header.count * sizeof(uint64_t))
+        return false;
+
+    checkpoints_.resize(header.count);
+    memcpy(checkpoints_.data(), cache.Data() + sizeof(header), (size_t)header.count * sizeof(uint64_t));
+    frameCount_ = header.frames;
+    checkpointStride_ = kIndexStride;
+    return !checkpoints_.empty() && checkpoints_[0] == dataStart_;
+}
+
+void Mp3Decoder::SaveIndex() const {
+    if (file_.Size() < kIndexCacheMinBytes || checkpoints_.empty()) return;
+    std::string cachePath = CachePathFor("mp3index", path_, ".idx");
+    FileStamp stamp;
+    if (cachePath.empty() || !GetFileStamp(path_, &stamp)) return;
+
+    Mp3IndexFileHeader header;
+    memcpy(header.magic, kIndexMagic, 4);
+    header.version = kIndexVersion;
+    header.fileSize = stamp.size;
+    header.mtime = stamp.mtime;
+    header.frames = frameCount_;
+    header.stride = kIndexStride;
+    header.count = (uint32_t)checkpoints_.size();
+
+    std::vector<uint8_t> blob(sizeof(header) + checkpoints_.size() * sizeof(uint64_t));
+    memcpy(blob.data(), &header, sizeof(header));
+    memcpy(blob.data() + sizeof(header), checkpoints_.data(), checkpoints_.size() * sizeof(uint64_t));
+    if (!WriteFileAtomic(cachePath, blob.data(), blob.size()))
+        std::cerr << "Failed to write MP3 index cache: " << cachePath << std::endl;
+}
+
+size_t Mp3Decoder::Locate(uint64_t frame, uint64_t* located) const {
+    // Without an index (frame 0, or the scan found nothing) walk from the start
+    size_t slot = 0;
+    size_t offset = dataStart_;
+    if (!checkpoints_.empty()) {
+        slot = std::min<size_t>((size_t)(frame / checkpointStride_), checkpoints_.size() - 1);
+        offset = (size_t)checkpoints_[slot];
+    }
+    uint64_t number = (uint64_t)slot * checkpointStride_;
+    if (FrameAt(offset) == 0) offset = Resync(offset);
+    while (number < frame) {
+        size_t bytes = FrameAt(offset);
+        if (bytes == 0) break;
+        offset += bytes;
+        number++;
+    }
+    *located = number;
+    return offset;
+}
+
+bool Mp3Decoder::DecodeFrame() {
+    while (pos_ < dataEnd_) {
+        size_t bytes = FrameAt(pos_);
+        if (bytes == 0) {
+            pos_ = Resync(pos_ + 1);
+            continue;
+        }
+        int samples = mp3dec_decode_frame(dec_.get(), file_.Data() + pos_, (int)bytes, pcm_);
+        if (samples == 0) {
+            // Broken frame: keep the timeline intact with silence
+            samples = (int)samplesPerFrame_;
+            std::fill(pcm_, pcm_ + samples * format_.channels, 0.0f);
+        }
+        pos_ += bytes;
+        frameNumber_++;
+        pcmFrames_ = (size_t)samples;
+        pcmPos_ = 0;
+
+        if (pos_ + kPrefetchBytes / 2 > prefetchedTo_) {
+            file_.WillNeed(prefetchedTo_, kPrefetchBytes);
+            prefetchedTo_ += kPrefetchBytes;
+        }
+        if (pos_ - releasedTo_ > kReleaseBytes) {
+            size_t keep = pos_ - kReleaseBytes / 4;
+            file_.Release(releasedTo_, keep - releasedTo_);
+            releasedTo_ = keep;
+        }
+        return true;
+    }
+    return false;
+}
+
+size_t Mp3Decoder::Read(float* out, size_t frames) {
+    const size_t channels = (size_t)format_.channels;
+    const uint64_t end = leadingSkip_ + totalSamples_;
+    size_t done = 0;
+    while (done < frames) {
+        if (pcmPos_ == pcmFrames_ && !DecodeFrame()) break;
+        // Decoded sample number of pcm_[pcmPos_]; trim delay and padding
+        const uint64_t sample = (frameNumber_ - 1) * samplesPerFrame_ + pcmPos_;
+        if (sample < leadingSkip_) {
+            pcmPos_ = (size_t)std::min<uint64_t>(pcmFrames_, pcmPos_ + (leadingSkip_ - sample));
+            continue;
+        }
+        if (sample >= end) break;
+        size_t n = (size_t)std::min<uint64_t>(std::min(frames - done, pcmFrames_ - pcmPos_), end - sample);
+        memcpy(out + done * channels, pcm_ + pcmPos_ * channels, n * channels * sizeof(float));
+        pcmPos_ += n;
+        done += n;
+    }
+    return done;
+}
+
+bool Mp3Decoder::Seek(int64_t frame) {
+    if (frame < 0) return false;
+    uint64_t target = std::min<uint64_t>((uint64_t)frame, totalSamples_) + leadingSkip_;
+    uint64_t targetFrame = target / samplesPerFrame_;
+
+    // Start a few frames early: the bit reservoir and the filterbank overlap need them
+    uint64_t primeFrom = targetFrame > MP3DEC_PRIMING_FRAMES ? targetFrame - MP3DEC_PRIMING_FRAMES : 0;
+    if (primeFrom > 0) BuildIndex();
+    uint64_t located = 0;
+    pos_ = Locate(primeFrom, &located);
+    frameNumber_ = located;
+    mp3dec_init(dec_.get());
+    pcmFrames_ = pcmPos_ = 0;
+
+    file_.WillNeed(pos_, kPrefetchBytes);
+    prefetchedTo_ = pos_ + kPrefetchBytes;
+    releasedTo_ = std::min(releasedTo_, pos_);
+
+    while (frameNumber_ < targetFrame) {
+        if (!DecodeFrame()) return true;
+    }
+    pcmFrames_ = pcmPos_ = 0;
+    if (DecodeFrame()) pcmPos_ = std::min<size_t>(pcmFrames_, (size_t)(target - targetFrame * samplesPerFrame_));
+    return true;
+}
+
+std::unique_ptr<Decoder> OpenMp3Decoder(const std::string& path, bool saveIndex) {
+    auto decoder = std::make_unique<Mp3Decoder>();
+    if (!decoder->Open(path, saveIndex)) return nullptr;
+    return decoder;
+}
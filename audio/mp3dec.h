@@ -0,0 +1,1064 @@
+/* mp3dec.h - MPEG-1/2/2.5 Layer III decoder, single header, no dependencies
+
+   Do this:
+      #define MP3DEC_IMPLEMENTATION
+   before you include this file in *one* C or C++ file to create the implementation.
+
+   Usage:
+      mp3dec dec;
+      mp3dec_init(&dec);
+      mp3dec_header hdr;
+      int bytes = mp3dec_parse_header(data, &hdr);          // frame length, 0 if not a Layer III header
+      int n = mp3dec_decode_frame(&dec, data, bytes, pcm);    // samples per channel, interleaved float
+
+   Frames must be fed in stream order; the bit reservoir and the filterbank
+   history live in `mp3dec`. After a seek, call mp3dec_init() and decode a
+   few frames before the target to rebuild them (see MP3DEC_PRIMING_FRAMES).
+
+   Layers I and II and free-format streams are not supported.
+*/
+
+#ifndef MP3DEC_H
+#define MP3DEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MP3DEC_MAX_SAMPLES_PER_FRAME (1152 * 2)
+#define MP3DEC_MAX_FRAME_BYTES 1441
+/* Frames to decode and discard before a seek target so the reservoir and overlap are valid */
+#define MP3DEC_PRIMING_FRAMES 10
+
+typedef struct {
+    int lsf;          /* MPEG-2/2.5: one granule per frame, different side info */
+    int mpeg25;
+    int protection;   /* 16-bit CRC follows the header */
+    int bitrate_kbps;
+    int sample_rate;
+    int sr_index;     /* 0..8, row in the scalefactor band tables */
+    int mode;         /* 0 stereo, 1 joint stereo, 2 dual channel, 3 mono */
+    int mode_ext;
+    int channels;
+    int frame_bytes;
+    int samples;      /* per channel */
+    int side_info_bytes;
+} mp3dec_header;
+
+typedef struct {
+    float overlap[2][32][18];
+    float synth_v[2][1024];
+    int synth_off;
+    int reserv;
+    unsigned char maindata[2048 + 16];
+    float scf_prev[2][40]; /* granule 0 scalefactors for scfsi reuse */
+
+    /* Tables built by mp3dec_init() */
+    float imdct36[36][18];
+    float imdct12[12][6];
+    float win_long[4][36];
+    float win_short[12];
+    float synth_n[64][32];
+    float synth_d[512];
+    short synth_vidx[512];
+    float pow43[129];
+} mp3dec;
+
+void mp3dec_init(mp3dec* dec);
+int mp3dec_parse_header(const unsigned char* h, mp3dec_header* hdr);
+/* Decodes one frame (header included) into interleaved float PCM. Returns samples per
+   channel, 0 on a broken frame. If the reservoir is missing (right after a seek) the
+   frame decodes to silence. */
+int mp3dec_decode_frame(mp3dec* dec, const unsigned char* frame, int frame_bytes, float* pcm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MP3DEC_H */
+
+#ifdef MP3DEC_IMPLEMENTATION
+
+#include <math.h>
+#include <string.h>
+
+#define MP3DEC_PI 3.14159265358979323846
+
+static const int mp3dec_bitrates[2][15] = {
+    {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+    {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+};
+
+static const int mp3dec_sample_rates[9] = {44100, 48000, 32000, 22050, 24000, 16000, 11025, 12000, 8000};
+
+/* Scalefactor band widths, long blocks (22 bands) and short blocks (13 bands) */
+static const unsigned char mp3dec_sfb_long[9][22] = {
+    {4, 4, 4, 4, 4, 4, 6, 6, 8, 8, 10, 12, 16, 20, 24, 28, 34, 42, 50, 54, 76, 158},
+    {4, 4, 4, 4, 4, 4, 6, 6, 6, 8, 10, 12, 16, 18, 22, 28, 34, 40, 46, 54, 54, 192},
+    {4, 4, 4, 4, 4, 4, 6, 6, 8, 10, 12, 16, 20, 24, 30, 38, 46, 56, 68, 84, 102, 26},
+    {6, 6, 6, 6, 6, 6, 8, 10, 12, 14, 16, 20, 24, 28, 32, 38, 46, 52, 60, 68, 58, 54},
+    {6, 6, 6, 6, 6, 6, 8, 10, 12, 14, 16, 18, 22, 26, 32, 38, 46, 54, 62, 70, 76, 36},
+    {6, 6, 6, 6, 6, 6, 8, 10, 12, 14, 16, 20, 24, 28, 32, 38, 46, 52, 60, 68, 58, 54},
+    {6, 6, 6, 6, 6, 6, 8, 10, 12, 14, 16, 20, 24, 28, 32, 38, 46, 52, 60, 68, 58, 54},
+    {6, 6, 6, 6, 6, 6, 8, 10, 12, 14, 16, 20, 24, 28, 32, 38, 46, 52, 60, 68, 58, 54},
+    {12, 12, 12, 12, 12, 12, 16, 20, 24, 28, 32, 40, 48, 56, 64, 76, 90, 2, 2, 2, 2, 2},
+};
+
+static const unsigned char mp3dec_sfb_short[9][13] = {
+    {4, 4, 4, 4, 6, 8, 10, 12, 14, 18, 22, 30, 56},
+    {4, 4, 4, 4, 6, 6, 10, 12, 14, 16, 20, 26, 66},
+    {4, 4, 4, 4, 6, 8, 12, 16, 20, 26, 34, 42, 12},
+    {4, 4, 4, 6, 6, 8, 10, 14, 18, 26, 32, 42, 18},
+    {4, 4, 4, 6, 8, 10, 12, 14, 18, 24, 32, 44, 12},
+    {4, 4, 4, 6, 8, 10, 12, 14, 18, 24, 30, 40, 18},
+    {4, 4, 4, 6, 8, 10, 12, 14, 18, 24, 30, 40, 18},
+    {4, 4, 4, 6, 8, 10, 12, 14, 18, 24, 30, 40, 18},
+    {8, 8, 8, 12, 16, 20, 24, 28, 36, 2, 2, 2, 26},
+};
+
+static const unsigned char mp3dec_pretab[22] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 3, 2, 0};
+
+static const unsigned char mp3dec_slen[16][2] = {
+    {0, 0}, {0, 1}, {0, 2}, {0, 3}, {3, 0}, {1, 1}, {1, 2}, {1, 3},
+    {2, 1}, {2, 2}, {2, 3}, {3, 1}, {3, 2}, {3, 3}, {4, 2}, {4, 3},
+};
+
+/* MPEG-2 scalefactor partitions: [slen table][long, short, mixed][partition] */
+static const unsigned char mp3dec_nr_of_sfb[6][3][4] = {
+    {{6, 5, 5, 5}, {9, 9, 9, 9}, {6, 9, 9, 9}},
+    {{6, 5, 7, 3}, {9, 9, 12, 6}, {6, 9, 12, 6}},
+    {{11, 10, 0, 0}, {18, 18, 0, 0}, {15, 18, 0, 0}},
+    {{7, 7, 7, 0}, {12, 12, 12, 0}, {6, 15, 12, 0}},
+    {{6, 6, 6, 3}, {12, 9, 9, 6}, {6, 12, 9, 6}},
+    {{8, 8, 5, 0}, {15, 12, 9, 0}, {6, 18, 9, 0}},
+};
+
+/* Huffman decoding: two-level lookup tables generated from the ISO 11172-3 code tables.
+   Leaf: (bits consumed << 8) | (x << 4 | y).  Node: 0x8000 | (sub bits << 12) | offset. */
+static const unsigned short mp3dec_huff_lut[] = {
+    0x0311, 0x0301, 0x0210, 0x0210, 0x0100, 0x0100, 0x0100, 0x0100, 0x0622, 0x0602, 0x0512, 0x0512,
+    0x0521, 0x0521, 0x0520, 0x0520, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311,
+    0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0310, 0x0310, 0x0310, 0x0310,
+    0x0310, 0x0310, 0x0310, 0x0310, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0622, 0x0602, 0x0512, 0x0512, 0x0521, 0x0521, 0x0520, 0x0520, 0x0310, 0x0310, 0x0310, 0x0310,
+    0x0310, 0x0310, 0x0310, 0x0310, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211,
+    0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0201, 0x0201, 0x0201, 0x0201,
+    0x0201, 0x0201, 0x0201, 0x0201, 0x0201, 0x0201, 0x0201, 0x0201, 0x0201, 0x0201, 0x0201, 0x0201,
+    0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200,
+    0x0200, 0x0200, 0x0200, 0x0200, 0xa040, 0x0631, 0x9044, 0x9046, 0x0612, 0x0621, 0x0602, 0x0620,
+    0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0301, 0x0301, 0x0301, 0x0301,
+    0x0301, 0x0301, 0x0301, 0x0301, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0233, 0x0223, 0x0132, 0x0132,
+    0x0113, 0x0103, 0x0130, 0x0122, 0x9040, 0x0623, 0x0632, 0x0630, 0x0513, 0x0513, 0x0531, 0x0531,
+    0x0522, 0x0522, 0x0502, 0x0502, 0x0412, 0x0412, 0x0412, 0x0412, 0x0421, 0x0421, 0x0421, 0x0421,
+    0x0420, 0x0420, 0x0420, 0x0420, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301,
+    0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211,
+    0x0211, 0x0211, 0x0211, 0x0211, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310,
+    0x0300, 0x0300, 0x0300, 0x0300, 0x0300, 0x0300, 0x0300, 0x0300, 0x0133, 0x0103, 0xc040, 0xb050,
+    0xa058, 0x905c, 0xa05e, 0x9062, 0x9064, 0x0612, 0x0521, 0x0521, 0x0602, 0x0620, 0x0411, 0x0411,
+    0x0411, 0x0411, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0310, 0x0310,
+    0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0455, 0x0445, 0x0454, 0x0453, 0x0335, 0x0335, 0x0344, 0x0344, 0x0325, 0x0325,
+    0x0352, 0x0352, 0x0215, 0x0215, 0x0215, 0x0215, 0x0251, 0x0251, 0x0305, 0x0334, 0x0250, 0x0250,
+    0x0343, 0x0333, 0x0224, 0x0242, 0x0114, 0x0114, 0x0141, 0x0140, 0x0204, 0x0223, 0x0232, 0x0203,
+    0x0113, 0x0131, 0x0130, 0x0122, 0xd040, 0xb060, 0xa068, 0xa06c, 0xa070, 0x0622, 0x0602, 0x0620,
+    0x0412, 0x0412, 0x0412, 0x0412, 0x0421, 0x0421, 0x0421, 0x0421, 0x0211, 0x0211, 0x0211, 0x0211,
+    0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211, 0x0211,
+    0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0310, 0x0310, 0x0310, 0x0310,
+    0x0310, 0x0310, 0x0310, 0x0310, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200,
+    0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0555, 0x0554, 0x0445, 0x0445,
+    0x0353, 0x0353, 0x0353, 0x0353, 0x0435, 0x0435, 0x0444, 0x0444, 0x0325, 0x0325, 0x0325, 0x0325,
+    0x0352, 0x0352, 0x0352, 0x0352, 0x0305, 0x0305, 0x0305, 0x0305, 0x0215, 0x0215, 0x0215, 0x0215,
+    0x0215, 0x0215, 0x0215, 0x0215, 0x0251, 0x0251, 0x0334, 0x0343, 0x0350, 0x0333, 0x0224, 0x0224,
+    0x0242, 0x0214, 0x0141, 0x0141, 0x0204, 0x0240, 0x0223, 0x0232, 0x0213, 0x0231, 0x0203, 0x0230,
+    0xb040, 0xa048, 0x904c, 0xa04e, 0x9052, 0x9054, 0x0614, 0x0641, 0x0623, 0x0632, 0x0513, 0x0513,
+    0x0531, 0x0531, 0x0603, 0x0630, 0x0522, 0x0522, 0x0502, 0x0502, 0x0412, 0x0412, 0x0412, 0x0412,
+    0x0421, 0x0421, 0x0421, 0x0421, 0x0420, 0x0420, 0x0420, 0x0420, 0x0311, 0x0311, 0x0311, 0x0311,
+    0x0311, 0x0311, 0x0311, 0x0311, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301,
+    0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0300, 0x0300, 0x0300, 0x0300,
+    0x0300, 0x0300, 0x0300, 0x0300, 0x0355, 0x0345, 0x0235, 0x0235, 0x0253, 0x0253, 0x0354, 0x0305,
+    0x0244, 0x0225, 0x0252, 0x0215, 0x0151, 0x0134, 0x0143, 0x0143, 0x0250, 0x0204, 0x0124, 0x0142,
+    0x0133, 0x0140, 0xd040, 0xc060, 0xc070, 0xb080, 0xb088, 0xa090, 0x9094, 0x9096, 0x0612, 0x0621,
+    0x0602, 0x0620, 0x0411, 0x0411, 0x0411, 0x0411, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301,
+    0x0301, 0x0301, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0577, 0x0567, 0x0576, 0x0557, 0x0575, 0x0566,
+    0x0447, 0x0447, 0x0474, 0x0474, 0x0456, 0x0456, 0x0465, 0x0465, 0x0437, 0x0437, 0x0473, 0x0473,
+    0x0446, 0x0446, 0x0555, 0x0554, 0x0463, 0x0463, 0x0327, 0x0327, 0x0327, 0x0327, 0x0372, 0x0372,
+    0x0372, 0x0372, 0x0464, 0x0407, 0x0370, 0x0370, 0x0362, 0x0362, 0x0445, 0x0435, 0x0306, 0x0306,
+    0x0453, 0x0444, 0x0217, 0x0217, 0x0217, 0x0217, 0x0271, 0x0271, 0x0271, 0x0271, 0x0336, 0x0336,
+    0x0326, 0x0326, 0x0425, 0x0452, 0x0315, 0x0315, 0x0351, 0x0351, 0x0434, 0x0443, 0x0216, 0x0216,
+    0x0261, 0x0261, 0x0260, 0x0260, 0x0305, 0x0350, 0x0324, 0x0342, 0x0333, 0x0304, 0x0214, 0x0214,
+    0x0241, 0x0241, 0x0240, 0x0223, 0x0232, 0x0203, 0x0113, 0x0131, 0x0130, 0x0122, 0xd040, 0xc060,
+    0xa070, 0xb074, 0xb07c, 0xa084, 0xa088, 0xb08c, 0xa094, 0x9098, 0x0613, 0x0631, 0x909a, 0x0622,
+    0x0521, 0x0521, 0x0412, 0x0412, 0x0412, 0x0412, 0x0502, 0x0502, 0x0520, 0x0520, 0x0311, 0x0311,
+    0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301,
+    0x0301, 0x0301, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0200, 0x0200,
+    0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200, 0x0200,
+    0x0200, 0x0200, 0x0477, 0x0477, 0x0467, 0x0467, 0x0476, 0x0476, 0x0475, 0x0475, 0x0466, 0x0466,
+    0x0447, 0x0447, 0x0474, 0x0474, 0x0557, 0x0555, 0x0456, 0x0456, 0x0465, 0x0465, 0x0337, 0x0337,
+    0x0337, 0x0337, 0x0373, 0x0373, 0x0373, 0x0373, 0x0346, 0x0346, 0x0346, 0x0346, 0x0445, 0x0454,
+    0x0435, 0x0453, 0x0227, 0x0227, 0x0227, 0x0227, 0x0272, 0x0272, 0x0272, 0x0272, 0x0364, 0x0364,
+    0x0307, 0x0307, 0x0171, 0x0171, 0x0217, 0x0270, 0x0236, 0x0236, 0x0263, 0x0263, 0x0260, 0x0260,
+    0x0344, 0x0325, 0x0352, 0x0305, 0x0215, 0x0215, 0x0162, 0x0162, 0x0162, 0x0162, 0x0226, 0x0206,
+    0x0116, 0x0116, 0x0161, 0x0161, 0x0251, 0x0234, 0x0250, 0x0250, 0x0343, 0x0333, 0x0224, 0x0224,
+    0x0242, 0x0242, 0x0214, 0x0241, 0x0204, 0x0240, 0x0123, 0x0132, 0x0103, 0x0130, 0xc040, 0xb050,
+    0xa058, 0xb05c, 0xb064, 0x906c, 0xa06e, 0xa072, 0x9076, 0x9078, 0xa07a, 0x907e, 0x0633, 0x0641,
+    0x0623, 0x0632, 0x9080, 0x0630, 0x0513, 0x0513, 0x0531, 0x0531, 0x0522, 0x0522, 0x0412, 0x0412,
+    0x0412, 0x0412, 0x0421, 0x0421, 0x0421, 0x0421, 0x0502, 0x0502, 0x0520, 0x0520, 0x0400, 0x0400,
+    0x0400, 0x0400, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0301, 0x0301,
+    0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0301, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310,
+    0x0310, 0x0310, 0x0477, 0x0467, 0x0376, 0x0376, 0x0357, 0x0357, 0x0375, 0x0375, 0x0366, 0x0366,
+    0x0347, 0x0347, 0x0374, 0x0374, 0x0365, 0x0365, 0x0256, 0x0256, 0x0237, 0x0237, 0x0373, 0x0355,
+    0x0227, 0x0227, 0x0272, 0x0246, 0x0264, 0x0217, 0x0271, 0x0271, 0x0307, 0x0370, 0x0236, 0x0236,
+    0x0263, 0x0263, 0x0245, 0x0245, 0x0254, 0x0254, 0x0244, 0x0244, 0x0306, 0x0305, 0x0126, 0x0162,
+    0x0161, 0x0161, 0x0216, 0x0260, 0x0235, 0x0253, 0x0225, 0x0252, 0x0115, 0x0151, 0x0134, 0x0143,
+    0x0250, 0x0204, 0x0124, 0x0124, 0x0142, 0x0114, 0x0140, 0x0103, 0xe040, 0xe130, 0xd170, 0xd190,
+    0xc1b0, 0xb1c0, 0xc1c8, 0xb1d8, 0xa1e0, 0xa1e4, 0x91e8, 0x91ea, 0x0612, 0x0621, 0x0602, 0x0620,
+    0x0411, 0x0411, 0x0411, 0x0411, 0x0401, 0x0401, 0x0401, 0x0401, 0x0310, 0x0310, 0x0310, 0x0310,
+    0x0310, 0x0310, 0x0310, 0x0310, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0xe080, 0xc0c2, 0xc0d2, 0xb0e2, 0xa0ea, 0xa0ee, 0xb0f2, 0xa0fa, 0x90fe, 0xa100, 0xa104, 0xa108,
+    0xa10c, 0xa110, 0x061f, 0x06f1, 0x06f0, 0x9114, 0x9116, 0x9118, 0x06e2, 0x911a, 0x061e, 0x06e1,
+    0x911c, 0x911e, 0x9120, 0x9122, 0x9124, 0x9126, 0x06c6, 0x063d, 0x9128, 0x062d, 0x06d2, 0x061d,
+    0x06b7, 0x912a, 0x912c, 0x06c3, 0x912e, 0x064b, 0x05d1, 0x05d1, 0x060d, 0x06d0, 0x068a, 0x06a8,
+    0x064c, 0x06c4, 0x066b, 0x06b6, 0x053c, 0x053c, 0x052c, 0x052c, 0x05c2, 0x05c2, 0x055b, 0x055b,
+    0x06b5, 0x0689, 0x051c, 0x051c, 0x90c0, 0x06fd, 0x05ed, 0x05ed, 0x04ff, 0x04ff, 0x04ff, 0x04ff,
+    0x04ef, 0x04ef, 0x04ef, 0x04ef, 0x04df, 0x04df, 0x04df, 0x04df, 0x04ee, 0x04ee, 0x04ee, 0x04ee,
+    0x04cf, 0x04cf, 0x04cf, 0x04cf, 0x04de, 0x04de, 0x04de, 0x04de, 0x04bf, 0x04bf, 0x04bf, 0x04bf,
+    0x04fb, 0x04fb, 0x04fb, 0x04fb, 0x04ce, 0x04ce, 0x04ce, 0x04ce, 0x04dc, 0x04dc, 0x04dc, 0x04dc,
+    0x05af, 0x05af, 0x05e9, 0x05e9, 0x03ec, 0x03ec, 0x03ec, 0x03ec, 0x03ec, 0x03ec, 0x03ec, 0x03ec,
+    0x03dd, 0x03dd, 0x03dd, 0x03dd, 0x03dd, 0x03dd, 0x03dd, 0x03dd, 0x01fe, 0x01fc, 0x04fa, 0x04cd,
+    0x03be, 0x03be, 0x03eb, 0x03eb, 0x039f, 0x039f, 0x03f9, 0x03f9, 0x03ea, 0x03ea, 0x03bd, 0x03bd,
+    0x03db, 0x03db, 0x038f, 0x038f, 0x03f8, 0x03f8, 0x03cc, 0x03cc, 0x04ae, 0x049e, 0x038e, 0x038e,
+    0x047f, 0x047e, 0x02f7, 0x02f7, 0x02f7, 0x02f7, 0x02da, 0x02da, 0x03ad, 0x03bc, 0x03cb, 0x03f6,
+    0x026f, 0x026f, 0x02e8, 0x025f, 0x029d, 0x02d9, 0x02f5, 0x02e7, 0x02ac, 0x02bb, 0x024f, 0x024f,
+    0x02f4, 0x02f4, 0x03ca, 0x03e6, 0x02f3, 0x02f3, 0x013f, 0x013f, 0x028d, 0x02d8, 0x012f, 0x01f2,
+    0x026e, 0x029c, 0x010f, 0x010f, 0x02c9, 0x025e, 0x01ab, 0x01ab, 0x027d, 0x02d7, 0x014e, 0x014e,
+    0x02c8, 0x02d6, 0x013e, 0x013e, 0x01b9, 0x01b9, 0x029b, 0x02aa, 0x01ba, 0x01e5, 0x01e4, 0x018c,
+    0x016d, 0x01e3, 0x012e, 0x010e, 0x01e0, 0x015d, 0x01d5, 0x017c, 0x01c7, 0x014d, 0x018b, 0x01b8,
+    0x01d4, 0x019a, 0x01a9, 0x016c, 0x01d3, 0x017b, 0x015c, 0x01c5, 0x0199, 0x017a, 0x01a7, 0x0197,
+    0x05c1, 0x05c1, 0x0698, 0x060c, 0x05c0, 0x05c0, 0x06b4, 0x066a, 0x06a6, 0x0679, 0x053b, 0x053b,
+    0x05b3, 0x05b3, 0x0688, 0x065a, 0x052b, 0x052b, 0x06a5, 0x0669, 0x05a4, 0x05a4, 0x0678, 0x0687,
+    0x0594, 0x0594, 0x0677, 0x0676, 0x04b2, 0x04b2, 0x04b2, 0x04b2, 0x041b, 0x041b, 0x041b, 0x041b,
+    0x04b1, 0x04b1, 0x04b1, 0x04b1, 0x050b, 0x050b, 0x05b0, 0x05b0, 0x0596, 0x0596, 0x054a, 0x054a,
+    0x053a, 0x053a, 0x05a3, 0x05a3, 0x0559, 0x0559, 0x0595, 0x0595, 0x042a, 0x042a, 0x042a, 0x042a,
+    0x04a2, 0x04a2, 0x04a2, 0x04a2, 0x041a, 0x041a, 0x04a1, 0x04a1, 0x050a, 0x0568, 0x04a0, 0x04a0,
+    0x0586, 0x0549, 0x0493, 0x0493, 0x0539, 0x0558, 0x0585, 0x0567, 0x0429, 0x0429, 0x0492, 0x0492,
+    0x0557, 0x0575, 0x0438, 0x0438, 0x0483, 0x0483, 0x0566, 0x0547, 0x0574, 0x0556, 0x0565, 0x0573,
+    0x0319, 0x0319, 0x0319, 0x0319, 0x0391, 0x0391, 0x0391, 0x0391, 0x0409, 0x0409, 0x0490, 0x0490,
+    0x0448, 0x0448, 0x0484, 0x0484, 0x0472, 0x0472, 0x0546, 0x0564, 0x0328, 0x0328, 0x0328, 0x0328,
+    0x0382, 0x0382, 0x0382, 0x0382, 0x0318, 0x0318, 0x0318, 0x0318, 0x0437, 0x0427, 0x0317, 0x0317,
+    0x0371, 0x0371, 0x0455, 0x0407, 0x0470, 0x0436, 0x0463, 0x0445, 0x0454, 0x0426, 0x0462, 0x0435,
+    0x0281, 0x0281, 0x0308, 0x0380, 0x0316, 0x0361, 0x0306, 0x0360, 0x0453, 0x0444, 0x0325, 0x0325,
+    0x0352, 0x0352, 0x0305, 0x0305, 0x0215, 0x0215, 0x0215, 0x0215, 0x0251, 0x0251, 0x0251, 0x0251,
+    0x0334, 0x0343, 0x0350, 0x0324, 0x0342, 0x0333, 0x0214, 0x0214, 0x0141, 0x0141, 0x0204, 0x0240,
+    0x0223, 0x0232, 0x0113, 0x0113, 0x0131, 0x0103, 0x0130, 0x0122, 0xe040, 0xe08e, 0xd0ce, 0xd0ee,
+    0xc10e, 0xc11e, 0xc12e, 0xc13e, 0xb14e, 0xb156, 0xa15e, 0xb162, 0xa16a, 0xb16e, 0xa176, 0xb17a,
+    0xa182, 0x9186, 0x9188, 0xa18a, 0x918e, 0x9190, 0x0641, 0x9192, 0x0623, 0x0632, 0x9194, 0x0613,
+    0x0631, 0x0630, 0x0522, 0x0522, 0x0512, 0x0512, 0x0521, 0x0521, 0x0502, 0x0502, 0x0520, 0x0520,
+    0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0311, 0x0401, 0x0401, 0x0401, 0x0401,
+    0x0410, 0x0410, 0x0410, 0x0410, 0x0300, 0x0300, 0x0300, 0x0300, 0x0300, 0x0300, 0x0300, 0x0300,
+    0x9080, 0x9082, 0x06ee, 0x9084, 0x9086, 0x9088, 0x06fb, 0x908a, 0x06dd, 0x06af, 0x06fa, 0x06be,
+    0x06eb, 0x06cd, 0x06dc, 0x069f, 0x06f9, 0x06ea, 0x06bd, 0x06db, 0x068f, 0x06f8, 0x06cc, 0x069e,
+    0x06e9, 0x067f, 0x06f7, 0x06ad, 0x06da, 0x06bc, 0x066f, 0x908c, 0x05cb, 0x05cb, 0x05f6, 0x05f6,
+    0x068e, 0x06e8, 0x065f, 0x069d, 0x05f5, 0x05f5, 0x057e, 0x057e, 0x05e7, 0x05e7, 0x05ac, 0x05ac,
+    0x05ca, 0x05ca, 0x05bb, 0x05bb, 0x06d9, 0x068d, 0x054f, 0x054f, 0x05f4, 0x05f4, 0x053f, 0x053f,
+    0x05f3, 0x05f3, 0x05d8, 0x05d8, 0x01ff, 0x01ef, 0x01fe, 0x01df, 0x01fd, 0x01cf, 0x01fc, 0x01de,
+    0x01ed, 0x01bf, 0x01ce, 0x01ec, 0x01ae, 0x010f, 0x05e6, 0x05e6, 0x052f, 0x052f, 0x05f2, 0x05f2,
+    0x066e, 0x06f0, 0x051f, 0x051f, 0x05f1, 0x05f1, 0x059c, 0x059c, 0x05c9, 0x05c9, 0x055e, 0x055e,
+    0x05ab, 0x05ab, 0x05ba, 0x05ba, 0x05e5, 0x05e5, 0x057d, 0x057d, 0x05d7, 0x05d7, 0x054e, 0x054e,
+    0x05e4, 0x05e4, 0x058c, 0x058c, 0x05c8, 0x05c8, 0x053e, 0x053e, 0x056d, 0x056d, 0x05d6, 0x05d6,
+    0x05e3, 0x05e3, 0x059b, 0x059b, 0x05b9, 0x05b9, 0x052e, 0x052e, 0x05aa, 0x05aa, 0x05e2, 0x05e2,
+    0x051e, 0x051e, 0x05e1, 0x05e1, 0x060e, 0x06e0, 0x055d, 0x055d, 0x05d5, 0x05d5, 0x057c, 0x05c7,
+    0x054d, 0x058b, 0x04d4, 0x04d4, 0x05b8, 0x059a, 0x05a9, 0x056c, 0x05c6, 0x053d, 0x04d3, 0x04d3,
+    0x04d2, 0x04d2, 0x052d, 0x050d, 0x041d, 0x041d, 0x047b, 0x047b, 0x04b7, 0x04b7, 0x04d1, 0x04d1,
+    0x055c, 0x05d0, 0x04c5, 0x04c5, 0x048a, 0x048a, 0x04a8, 0x04a8, 0x044c, 0x044c, 0x04c4, 0x04c4,
+    0x046b, 0x046b, 0x04b6, 0x04b6, 0x0599, 0x050c, 0x043c, 0x043c, 0x04c3, 0x04c3, 0x047a, 0x047a,
+    0x04a7, 0x04a7, 0x04a6, 0x04a6, 0x05c0, 0x050b, 0x03c2, 0x03c2, 0x03c2, 0x03c2, 0x042c, 0x042c,
+    0x045b, 0x045b, 0x04b5, 0x041c, 0x0489, 0x0498, 0x04c1, 0x044b, 0x04b4, 0x046a, 0x043b, 0x0479,
+    0x03b3, 0x03b3, 0x0497, 0x0488, 0x042b, 0x045a, 0x03b2, 0x03b2, 0x04a5, 0x041b, 0x03b1, 0x03b1,
+    0x04b0, 0x0469, 0x0496, 0x044a, 0x04a4, 0x0478, 0x0487, 0x043a, 0x03a3, 0x03a3, 0x0359, 0x0359,
+    0x0395, 0x0395, 0x032a, 0x032a, 0x03a2, 0x03a2, 0x031a, 0x031a, 0x03a1, 0x03a1, 0x040a, 0x04a0,
+    0x0368, 0x0368, 0x0386, 0x0386, 0x0349, 0x0349, 0x0394, 0x0394, 0x0339, 0x0339, 0x0393, 0x0393,
+    0x0477, 0x0409, 0x0358, 0x0358, 0x0385, 0x0385, 0x0329, 0x0367, 0x0376, 0x0392, 0x0291, 0x0291,
+    0x0319, 0x0390, 0x0348, 0x0384, 0x0357, 0x0375, 0x0338, 0x0383, 0x0366, 0x0347, 0x0228, 0x0282,
+    0x0218, 0x0281, 0x0374, 0x0308, 0x0380, 0x0356, 0x0365, 0x0337, 0x0373, 0x0346, 0x0227, 0x0272,
+    0x0264, 0x0217, 0x0255, 0x0255, 0x0271, 0x0271, 0x0307, 0x0370, 0x0236, 0x0236, 0x0263, 0x0245,
+    0x0254, 0x0226, 0x0262, 0x0262, 0x0216, 0x0216, 0x0306, 0x0360, 0x0235, 0x0235, 0x0161, 0x0161,
+    0x0253, 0x0244, 0x0125, 0x0152, 0x0115, 0x0151, 0x0205, 0x0250, 0x0134, 0x0134, 0x0143, 0x0124,
+    0x0142, 0x0133, 0x0114, 0x0104, 0x0140, 0x0103, 0xd040, 0xe060, 0xe0d8, 0xe148, 0xe19a, 0xd1da,
+    0xc1fa, 0xc20a, 0xb21a, 0xb222, 0x922a, 0xa22c, 0x0612, 0x0621, 0x0602, 0x0620, 0x0411, 0x0411,
+    0x0411, 0x0411, 0x0401, 0x0401, 0x0401, 0x0401, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310, 0x0310,
+    0x0310, 0x0310, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x05ef, 0x05fe,
+    0x05df, 0x05fd, 0x05cf, 0x05fc, 0x05bf, 0x05fb, 0x04af, 0x04af, 0x05fa, 0x059f, 0x05f9, 0x05f8,
+    0x048f, 0x048f, 0x047f, 0x047f, 0x04f7, 0x04f7, 0x046f, 0x046f, 0x04f6, 0x04f6, 0x02ff, 0x02ff,
+    0x02ff, 0x02ff, 0x02ff, 0x02ff, 0x02ff, 0x02ff, 0x045f, 0x045f, 0x045f, 0x045f, 0x04f5, 0x04f5,
+    0x04f5, 0x04f5, 0x034f, 0x034f, 0x034f, 0x034f, 0x034f, 0x034f, 0x034f, 0x034f, 0x03f4, 0x03f4,
+    0x03f4, 0x03f4, 0x03f4, 0x03f4, 0x03f4, 0x03f4, 0x03f3, 0x03f3, 0x03f3, 0x03f3, 0x03f3, 0x03f3,
+    0x03f3, 0x03f3, 0x03f0, 0x03f0, 0x03f0, 0x03f0, 0x03f0, 0x03f0, 0x03f0, 0x03f0, 0x043f, 0x043f,
+    0x043f, 0x043f, 0xd0a0, 0xb0c0, 0xb0c8, 0xb0d0, 0x02f2, 0x02f2, 0x02f2, 0x02f2, 0x02f2, 0x02f2,
+    0x02f2, 0x02f2, 0x02f2, 0x02f2, 0x02f2, 0x02f2, 0x02f2, 0x02f2, 0x02f2, 0x02f2, 0x04ce, 0x04ce,
+    0x05ec, 0x05dd, 0x03de, 0x03de, 0x03de, 0x03de, 0x03e9, 0x03e9, 0x03e9, 0x03e9, 0x04ea, 0x04ea,
+    0x04d9, 0x04d9, 0x02ee, 0x02ee, 0x02ee, 0x02ee, 0x02ee, 0x02ee, 0x02ee, 0x02ee, 0x03ed, 0x03ed,
+    0x03ed, 0x03ed, 0x03eb, 0x03eb, 0x03eb, 0x03eb, 0x02be, 0x02be, 0x02cd, 0x02cd, 0x03dc, 0x03db,
+    0x02ae, 0x02ae, 0x02cc, 0x02cc, 0x03ad, 0x03da, 0x037e, 0x03ac, 0x02ca, 0x02ca, 0x03c9, 0x037d,
+    0x025e, 0x025e, 0x01bd, 0x01bd, 0x01bd, 0x01bd, 0x032f, 0x032f, 0x032f, 0x032f, 0x032f, 0x032f,
+    0x032f, 0x032f, 0x030f, 0x030f, 0x030f, 0x030f, 0x030f, 0x030f, 0x030f, 0x030f, 0x021f, 0x021f,
+    0x021f, 0x021f, 0x021f, 0x021f, 0x021f, 0x021f, 0x021f, 0x021f, 0x021f, 0x021f, 0x021f, 0x021f,
+    0x021f, 0x021f, 0x02f1, 0x02f1, 0x02f1, 0x02f1, 0x02f1, 0x02f1, 0x02f1, 0x02f1, 0x02f1, 0x02f1,
+    0x02f1, 0x02f1, 0x02f1, 0x02f1, 0x02f1, 0x02f1, 0xa118, 0xa11c, 0xa120, 0x9124, 0xa126, 0xa12a,
+    0x912e, 0xa130, 0xa134, 0xa138, 0xa13c, 0x06e3, 0x9140, 0x9142, 0x9144, 0x9146, 0x019e, 0x019e,
+    0x02bc, 0x02cb, 0x028e, 0x02e8, 0x029d, 0x02e7, 0x02bb, 0x028d, 0x02d8, 0x026e, 0x01e6, 0x019c,
+    0x02ab, 0x02ba, 0x02e5, 0x02d7, 0x014e, 0x014e, 0x02e4, 0x028c, 0x01c8, 0x013e, 0x016d, 0x016d,
+    0x02d6, 0x029b, 0x02b9, 0x02aa, 0x01e1, 0x01e1, 0x01d4, 0x01d4, 0x02b8, 0x02a9, 0x017b, 0x017b,
+    0x02b7, 0x02d0, 0x010e, 0x01e0, 0x015d, 0x01d5, 0x017c, 0x01c7, 0x014d, 0x018b, 0x9188, 0x918a,
+    0x918c, 0x060d, 0x918e, 0x9190, 0x9192, 0x063c, 0x9194, 0x061c, 0x06c0, 0x9196, 0x05e2, 0x05e2,
+    0x062e, 0x061e, 0x06d3, 0x062d, 0x06d2, 0x06d1, 0x063b, 0x9198, 0x051d, 0x051d, 0x06c4, 0x066b,
+    0x06c3, 0x06a7, 0x052c, 0x052c, 0x06c2, 0x06b5, 0x06c1, 0x060c, 0x064b, 0x06b4, 0x066a, 0x06a6,
+    0x05b3, 0x05b3, 0x065a, 0x06a5, 0x052b, 0x052b, 0x05b2, 0x05b2, 0x051b, 0x051b, 0x05b1, 0x05b1,
+    0x060b, 0x06b0, 0x0669, 0x0696, 0x064a, 0x06a4, 0x0678, 0x0687, 0x05a3, 0x05a3, 0x063a, 0x0659,
+    0x052a, 0x052a, 0x019a, 0x016c, 0x01c6, 0x013d, 0x015c, 0x01c5, 0x018a, 0x01a8, 0x0199, 0x014c,
+    0x01b6, 0x017a, 0x015b, 0x0189, 0x0198, 0x0179, 0x0197, 0x0188, 0x0695, 0x0668, 0x05a1, 0x05a1,
+    0x0686, 0x0677, 0x0594, 0x0594, 0x0649, 0x0657, 0x0567, 0x0567, 0x04a2, 0x04a2, 0x04a2, 0x04a2,
+    0x041a, 0x041a, 0x041a, 0x041a, 0x050a, 0x050a, 0x05a0, 0x05a0, 0x0539, 0x0539, 0x0593, 0x0593,
+    0x0558, 0x0558, 0x0585, 0x0585, 0x0429, 0x0429, 0x0429, 0x0429, 0x0492, 0x0492, 0x0492, 0x0492,
+    0x0576, 0x0576, 0x0509, 0x0509, 0x0419, 0x0419, 0x0419, 0x0419, 0x0491, 0x0491, 0x0491, 0x0491,
+    0x0590, 0x0590, 0x0548, 0x0548, 0x0584, 0x0584, 0x0575, 0x0575, 0x0538, 0x0538, 0x0583, 0x0583,
+    0x0566, 0x0528, 0x0482, 0x0482, 0x0547, 0x0574, 0x0418, 0x0418, 0x0481, 0x0481, 0x0480, 0x0480,
+    0x0508, 0x0556, 0x0437, 0x0437, 0x0473, 0x0473, 0x0565, 0x0546, 0x0427, 0x0427, 0x0472, 0x0472,
+    0x0564, 0x0555, 0x0407, 0x0407, 0x0317, 0x0317, 0x0317, 0x0317, 0x0371, 0x0371, 0x0470, 0x0436,
+    0x0463, 0x0445, 0x0454, 0x0426, 0x0362, 0x0362, 0x0316, 0x0316, 0x0361, 0x0361, 0x0406, 0x0460,
+    0x0353, 0x0353, 0x0435, 0x0444, 0x0325, 0x0325, 0x0352, 0x0352, 0x0251, 0x0251, 0x0251, 0x0251,
+    0x0315, 0x0315, 0x0305, 0x0305, 0x0334, 0x0343, 0x0350, 0x0324, 0x0342, 0x0333, 0x0214, 0x0214,
+    0x0241, 0x0241, 0x0304, 0x0340, 0x0223, 0x0223, 0x0232, 0x0232, 0x0113, 0x0131, 0x0203, 0x0230,
+    0x0122, 0x0122, 0xa040, 0xa044, 0xa048, 0x904c, 0xa04e, 0x9052, 0x9054, 0x9056, 0x9058, 0x905a,
+    0xa05c, 0xd060, 0x04ff, 0x04ff, 0x04ff, 0x04ff, 0xe080, 0xc0c0, 0xc0d0, 0xd0e0, 0xd100, 0xc120,
+    0xc130, 0xb140, 0xb148, 0xb150, 0xc158, 0xc168, 0xa178, 0xa17c, 0xa180, 0xb184, 0xb18c, 0xa194,
+    0x9198, 0x919a, 0xa19c, 0x91a0, 0x0613, 0x0631, 0x91a2, 0x0622, 0x0512, 0x0512, 0x0521, 0x0521,
+    0x0602, 0x0620, 0x0411, 0x0411, 0x0411, 0x0411, 0x0401, 0x0401, 0x0401, 0x0401, 0x0410, 0x0410,
+    0x0410, 0x0410, 0x0400, 0x0400, 0x0400, 0x0400, 0x02ef, 0x02fe, 0x02df, 0x02fd, 0x02cf, 0x02fc,
+    0x02bf, 0x02fb, 0x01fa, 0x01fa, 0x02af, 0x029f, 0x01f9, 0x01f8, 0x028f, 0x027f, 0x01f7, 0x01f7,
+    0x016f, 0x01f6, 0x015f, 0x01f5, 0x014f, 0x01f4, 0x013f, 0x01f3, 0x012f, 0x01f2, 0x01f1, 0x01f1,
+    0x021f, 0x02f0, 0x030f, 0x030f, 0x030f, 0x030f, 0x05ee, 0x05de, 0x05ed, 0x05ce, 0x05ec, 0x05dd,
+    0x05be, 0x05eb, 0x05cd, 0x05dc, 0x05ae, 0x05ea, 0x05bd, 0x05db, 0x05cc, 0x059e, 0x05e9, 0x05ad,
+    0x05da, 0x05bc, 0x05cb, 0x058e, 0x05e8, 0x059d, 0x05d9, 0x057e, 0x05e7, 0x05ac, 0x05ca, 0x05ca,
+    0x05bb, 0x05bb, 0x058d, 0x058d, 0x05d8, 0x05d8, 0x060e, 0x06e0, 0x050d, 0x050d, 0x04e6, 0x04e6,
+    0x04e6, 0x04e6, 0x056e, 0x056e, 0x059c, 0x059c, 0x04c9, 0x04c9, 0x04c9, 0x04c9, 0x045e, 0x045e,
+    0x045e, 0x045e, 0x04ba, 0x04ba, 0x04ba, 0x04ba, 0x04e5, 0x04e5, 0x04e5, 0x04e5, 0x05ab, 0x05ab,
+    0x057d, 0x057d, 0x04d7, 0x04d7, 0x04d7, 0x04d7, 0x04e4, 0x04e4, 0x04e4, 0x04e4, 0x048c, 0x048c,
+    0x048c, 0x048c, 0x04c8, 0x04c8, 0x04c8, 0x04c8, 0x054e, 0x054e, 0x052e, 0x052e, 0x043e, 0x043e,
+    0x043e, 0x043e, 0x046d, 0x04d6, 0x04e3, 0x049b, 0x04b9, 0x04aa, 0x04e2, 0x041e, 0x04e1, 0x045d,
+    0x04d5, 0x047c, 0x04c7, 0x044d, 0x048b, 0x04b8, 0x04d4, 0x049a, 0x04a9, 0x046c, 0x04c6, 0x043d,
+    0x04d3, 0x042d, 0x04d2, 0x041d, 0x047b, 0x04b7, 0x04d1, 0x045c, 0x04c5, 0x048a, 0x04a8, 0x04a8,
+    0x0499, 0x0499, 0x044c, 0x044c, 0x04c4, 0x04c4, 0x046b, 0x046b, 0x04b6, 0x04b6, 0x05d0, 0x050c,
+    0x043c, 0x043c, 0x04c3, 0x04c3, 0x047a, 0x047a, 0x04a7, 0x04a7, 0x042c, 0x042c, 0x04c2, 0x04c2,
+    0x045b, 0x045b, 0x04b5, 0x04b5, 0x041c, 0x041c, 0x0489, 0x0489, 0x0498, 0x0498, 0x04c1, 0x04c1,
+    0x044b, 0x044b, 0x05c0, 0x050b, 0x043b, 0x043b, 0x05b0, 0x050a, 0x041a, 0x041a, 0x03b4, 0x03b4,
+    0x03b4, 0x03b4, 0x046a, 0x046a, 0x04a6, 0x04a6, 0x0479, 0x0479, 0x0497, 0x0497, 0x05a0, 0x0509,
+    0x0490, 0x0490, 0x03b3, 0x03b3, 0x0388, 0x0388, 0x042b, 0x045a, 0x03b2, 0x03b2, 0x04a5, 0x041b,
+    0x04b1, 0x0469, 0x0396, 0x0396, 0x03a4, 0x03a4, 0x044a, 0x0478, 0x0387, 0x0387, 0x033a, 0x033a,
+    0x03a3, 0x03a3, 0x0359, 0x0359, 0x0395, 0x0395, 0x032a, 0x032a, 0x03a2, 0x03a2, 0x03a1, 0x0368,
+    0x0386, 0x0377, 0x0349, 0x0394, 0x0339, 0x0393, 0x0358, 0x0385, 0x0329, 0x0367, 0x0376, 0x0392,
+    0x0319, 0x0391, 0x0348, 0x0384, 0x0357, 0x0375, 0x0338, 0x0383, 0x0366, 0x0328, 0x0382, 0x0382,
+    0x0318, 0x0318, 0x0347, 0x0347, 0x0374, 0x0374, 0x0381, 0x0381, 0x0408, 0x0480, 0x0356, 0x0356,
+    0x0365, 0x0365, 0x0317, 0x0317, 0x0407, 0x0470, 0x0273, 0x0273, 0x0273, 0x0273, 0x0337, 0x0337,
+    0x0327, 0x0327, 0x0272, 0x0272, 0x0272, 0x0272, 0x0246, 0x0264, 0x0255, 0x0271, 0x0236, 0x0263,
+    0x0245, 0x0254, 0x0226, 0x0262, 0x0216, 0x0261, 0x0306, 0x0360, 0x0235, 0x0235, 0x0253, 0x0253,
+    0x0244, 0x0244, 0x0225, 0x0225, 0x0252, 0x0252, 0x0215, 0x0215, 0x0305, 0x0350, 0x0151, 0x0151,
+    0x0234, 0x0243, 0x0124, 0x0142, 0x0133, 0x0114, 0x0141, 0x0141, 0x0204, 0x0240, 0x0123, 0x0132,
+    0x0103, 0x0130, 0x060b, 0x060f, 0x060d, 0x060e, 0x0607, 0x0605, 0x0509, 0x0509, 0x0506, 0x0506,
+    0x0503, 0x0503, 0x050a, 0x050a, 0x050c, 0x050c, 0x0402, 0x0402, 0x0402, 0x0402, 0x0401, 0x0401,
+    0x0401, 0x0401, 0x0404, 0x0404, 0x0404, 0x0404, 0x0408, 0x0408, 0x0408, 0x0408, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+    0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100,
+};
+
+/* Per table_select: start in mp3dec_huff_lut, root bits, linbits. Index 32 is count1 table A. */
+static const unsigned short mp3dec_huff_start[33] = {
+    0, 0, 8, 72, 0, 136, 208, 274, 376, 492, 578, 730, 886, 1016, 0, 1508,
+    1914, 1914, 1914, 1914, 1914, 1914, 1914, 1914, 2474, 2474, 2474, 2474, 2474, 2474, 2474, 2474,
+    2894,
+};
+static const unsigned char mp3dec_huff_root[33] = {
+    0, 3, 6, 6, 0, 6, 6, 6, 6, 6, 6, 6, 6, 6, 0, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    6,
+};
+static const unsigned char mp3dec_linbits[32] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 2, 3, 4, 6, 8, 10, 13, 4, 5, 6, 7, 8, 9, 11, 13,
+};
+
+/* First half of the synthesis window D[] in units of 1/65536; the rest follows by symmetry */
+static const int mp3dec_synth_window[257] = {
+    0, -1, -1, -1, -1, -1, -1, -2, -2, -2, -2, -3,
+    -3, -4, -4, -5, -5, -6, -7, -7, -8, -9, -10, -11,
+    -13, -14, -16, -17, -19, -21, -24, -26, -29, -31, -35, -38,
+    -41, -45, -49, -53, -58, -63, -68, -73, -79, -85, -91, -97,
+    -104, -111, -117, -125, -132, -139, -147, -154, -161, -169, -176, -183,
+    -190, -196, -202, -208, 213, 218, 222, 225, 227, 228, 228, 227,
+    224, 221, 215, 208, 200, 189, 177, 163, 146, 127, 106, 83,
+    57, 29, -2, -36, -72, -111, -153, -197, -244, -294, -347, -401,
+    -459, -519, -581, -645, -711, -779, -848, -919, -991, -1064, -1137, -1210,
+    -1283, -1356, -1428, -1498, -1567, -1634, -1698, -1759, -1817, -1870, -1919, -1962,
+    -2001, -2032, -2057, -2075, -2085, -2087, -2080, -2063, 2037, 2000, 1952, 1893,
+    1822, 1739, 1644, 1535, 1414, 1280, 1131, 970, 794, 605, 402, 185,
+    -45, -288, -545, -814, -1095, -1388, -1692, -2006, -2330, -2663, -3004, -3351,
+    -3705, -4063, -4425, -4788, -5153, -5517, -5879, -6237, -6589, -6935, -7271, -7597,
+    -7910, -8209, -8491, -8755, -8998, -9219, -9416, -9585, -9727, -9838, -9916, -9959,
+    -9966, -9935, -9863, -9750, -9592, -9389, -9139, -8840, -8492, -8092, -7640, -7134,
+    6574, 5959, 5288, 4561, 3776, 2935, 2037, 1082, 70, -998, -2122, -3300,
+    -4533, -5818, -7154, -8540, -9975, -11455, -12980, -14548, -16155, -17799, -19478, -21189,
+    -22929, -24694, -26482, -28289, -30112, -31947, -33791, -35640, -37489, -39336, -41176, -43006,
+    -44821, -46617, -48390, -50137, -51853, -53534, -55178, -56778, -58333, -59838, -61289, -62684,
+    -64019, -65290, -66494, -67629, -68692, -69679, -70590, -71420, -72169, -72835, -73415, -73908,
+    -74313, -74630, -74856, -74992, 75038,
+};
+
+typedef struct {
+    int part2_3_length;
+    int big_values;
+    int global_gain;
+    int scalefac_compress;
+    int block_type;
+    int mixed;
+    int table_select[3];
+    int subblock_gain[3];
+    int region1_start;
+    int region2_start;
+    int preflag;
+    int scalefac_scale;
+    int count1_table;
+} mp3dec_granule;
+
+typedef struct {
+    const unsigned char* buf;
+    int pos;
+} mp3dec_bits;
+
+static unsigned mp3dec_peek(const mp3dec_bits* bs, int n) {
+    const unsigned char* p = bs->buf + (bs->pos >> 3);
+    unsigned cache = ((unsigned)p[0] << 24 | (unsigned)p[1] << 16 | (unsigned)p[2] << 8 | p[3]) << (bs->pos & 7);
+    return n ? cache >> (32 - n) : 0;
+}
+
+static unsigned mp3dec_get(mp3dec_bits* bs, int n) {
+    unsigned v = mp3dec_peek(bs, n);
+    bs->pos += n;
+    return v;
+}
+
+static int mp3dec_huff(mp3dec_bits* bs, int table) {
+    const unsigned short* lut = mp3dec_huff_lut + mp3dec_huff_start[table];
+    int bits = mp3dec_huff_root[table];
+    unsigned e = lut[mp3dec_peek(bs, bits)];
+    while (e & 0x8000) {
+        bs->pos += bits;
+        bits = (e >> 12) & 7;
+        e = lut[(e & 0xFFF) + mp3dec_peek(bs, bits)];
+    }
+    bs->pos += e >> 8;
+    return e & 0xFF;
+}
+
+void mp3dec_init(mp3dec* dec) {
+    int i, k;
+    memset(dec, 0, sizeof(*dec));
+
+    for (i = 0; i < 36; i++)
+        for (k = 0; k < 18; k++)
+            dec->imdct36[i][k] = (float)cos(MP3DEC_PI / 72.0 * (2 * i + 1 + 18) * (2 * k + 1));
+    for (i = 0; i < 12; i++)
+        for (k = 0; k < 6; k++)
+            dec->imdct12[i][k] = (float)cos(MP3DEC_PI / 24.0 * (2 * i + 1 + 6) * (2 * k + 1));
+
+    /* Block types 0 (normal), 1 (start), 3 (stop); 2 uses win_short */
+    for (i = 0; i < 36; i++) {
+        float s = (float)sin(MP3DEC_PI / 36.0 * (i + 0.5));
+        dec->win_long[0][i] = s;
+        dec->win_long[1][i] = i < 18 ? s : i < 24 ? 1.0f : i < 30 ? (float)sin(MP3DEC_PI / 12.0 * (i - 18 + 0.5)) : 0.0f;
+        dec->win_long[3][i] = i < 6 ? 0.0f : i < 12 ? (float)sin(MP3DEC_PI / 12.0 * (i - 6 + 0.5)) : i < 18 ? 1.0f : s;
+        dec->win_long[2][i] = s;
+    }
+    for (i = 0; i < 12; i++) dec->win_short[i] = (float)sin(MP3DEC_PI / 12.0 * (i + 0.5));
+
+    for (i = 0; i < 64; i++)
+        for (k = 0; k < 32; k++)
+            dec->synth_n[i][k] = (float)cos((16 + i) * (2 * k + 1) * MP3DEC_PI / 64.0);
+    for (i = 0; i < 257; i++) {
+        int v = mp3dec_synth_window[i];
+        dec->synth_d[i] = v / 65536.0f;
+        if ((i & 63) != 0) v = -v;
+        if (i != 0) dec->synth_d[512 - i] = v / 65536.0f;
+    }
+    /* U[] gathers V[] in 32-sample runs: U[64i + j] = V[128i + j], U[64i + 32 + j] = V[128i + 96 + j] */
+    for (i = 0; i < 512; i++) {
+        int block = i >> 6, r = i & 63;
+        dec->synth_vidx[i] = (short)(block * 128 + (r < 32 ? r : r + 64));
+    }
+
+    for (i = 0; i < 129; i++) dec->pow43[i] = (float)pow((double)i, 4.0 / 3.0);
+}
+
+int mp3dec_parse_header(const unsigned char* h, mp3dec_header* hdr) {
+    int version, layer, br, sr;
+    if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) return 0;
+    version = (h[1] >> 3) & 3; /* 0 = 2.5, 1 = reserved, 2 = MPEG-2, 3 = MPEG-1 */
+    layer = (h[1] >> 1) & 3;   /* 1 = Layer III */
+    br = h[2] >> 4;
+    sr = (h[2] >> 2) & 3;
+    if (version == 1 || layer != 1 || br == 0 || br == 15 || sr == 3) return 0;
+
+    hdr->lsf = version != 3;
+    hdr->mpeg25 = version == 0;
+    hdr->protection = !(h[1] & 1);
+    hdr->sr_index = (version == 3 ? 0 : version == 2 ? 3 : 6) + sr;
+    hdr->sample_rate = mp3dec_sample_rates[hdr->sr_index];
+    hdr->bitrate_kbps = mp3dec_bitrates[hdr->lsf][br];
+    hdr->mode = h[3] >> 6;
+    hdr->mode_ext = (h[3] >> 4) & 3;
+    hdr->channels = hdr->mode == 3 ? 1 : 2;
+    hdr->samples = hdr->lsf ? 576 : 1152;
+    hdr->frame_bytes = (hdr->lsf ? 72 : 144) * hdr->bitrate_kbps * 1000 / hdr->sample_rate + ((h[2] >> 1) & 1);
+    hdr->side_info_bytes = hdr->lsf ? (hdr->channels == 1 ? 9 : 17) : (hdr->channels == 1 ? 17 : 32);
+    return hdr->frame_bytes;
+}
+
+static int mp3dec_read_side_info(mp3dec_bits* bs, const mp3dec_header* hdr, int* main_data_begin,
+                                 int scfsi[2], mp3dec_granule gr[2][2]) {
+    int ngr = hdr->lsf ? 1 : 2, nch = hdr->channels;
+    int g, ch;
+    const unsigned char* sfb_long = mp3dec_sfb_long[hdr->sr_index];
+
+    if (hdr->lsf) {
+        *main_data_begin = (int)mp3dec_get(bs, 8);
+        mp3dec_get(bs, nch == 1 ? 1 : 2);
+    } else {
+        *main_data_begin = (int)mp3dec_get(bs, 9);
+        mp3dec_get(bs, nch == 1 ? 5 : 3);
+        for (ch = 0; ch < nch; ch++) scfsi[ch] = (int)mp3dec_get(bs, 4);
+    }
+
+    for (g = 0; g < ngr; g++) {
+        for (ch = 0; ch < nch; ch++) {
+            mp3dec_granule* gi = &gr[g][ch];
+            int region0 = 0, region1 = 0, i, sum;
+            gi->part2_3_length = (int)mp3dec_get(bs, 12);
+            gi->big_values = (int)mp3dec_get(bs, 9);
+            if (gi->big_values > 288) return 0;
+            gi->global_gain = (int)mp3dec_get(bs, 8);
+            gi->scalefac_compress = (int)mp3dec_get(bs, hdr->lsf ? 9 : 4);
+            if (mp3dec_get(bs, 1)) {
+                gi->block_type = (int)mp3dec_get(bs, 2);
+                if (gi->block_type == 0) return 0;
+                gi->mixed = (int)mp3dec_get(bs, 1);
+                gi->table_select[0] = (int)mp3dec_get(bs, 5);
+                gi->table_select[1] = (int)mp3dec_get(bs, 5);
+                gi->table_select[2] = 0;
+                for (i = 0; i < 3; i++) gi->subblock_gain[i] = (int)mp3dec_get(bs, 3);
+                /* Implicit regions: region0 ends after 8 long bands (36 lines for short blocks) */
+                if (gi->block_type == 2) {
+                    gi->region1_start = hdr->sr_index == 8 ? 72 : 36;
+                } else {
+                    for (i = 0, sum = 0; i < 8; i++) sum += sfb_long[i];
+                    gi->region1_start = sum;
+                }
+                gi->region2_start = 576;
+            } else {
+                gi->block_type = 0;
+                gi->mixed = 0;
+                for (i = 0; i < 3; i++) gi->table_select[i] = (int)mp3dec_get(bs, 5);
+                for (i = 0; i < 3; i++) gi->subblock_gain[i] = 0;
+                region0 = (int)mp3dec_get(bs, 4);
+                region1 = (int)mp3dec_get(bs, 3);
+                for (i = 0, sum = 0; i <= region0 && i < 22; i++) sum += sfb_long[i];
+                gi->region1_start = sum;
+                for (; i <= region0 + region1 + 1 && i < 22; i++) sum += sfb_long[i];
+                gi->region2_start = sum;
+            }
+            gi->preflag = hdr->lsf ? 0 : (int)mp3dec_get(bs, 1);
+            gi->scalefac_scale = (int)mp3dec_get(bs, 1);
+            gi->count1_table = (int)mp3dec_get(bs, 1);
+        }
+    }
+    return 1;
+}
+
+/* Band layout of a granule in bitstream order. Short bands appear once per window
+   (sfb0 w0, sfb0 w1, sfb0 w2, sfb1 w0, ...). Returns the number of bands and the
+   index of the first short band (== count when there are none). */
+static int mp3dec_bands(const mp3dec_header* hdr, const mp3dec_granule* gi, unsigned char* widths, int* first_short) {
+    const unsigned char* l = mp3dec_sfb_long[hdr->sr_index];
+    const unsigned char* s = mp3dec_sfb_short[hdr->sr_index];
+    int n = 0, sfb, w, lines = 0;
+    if (gi->block_type != 2) {
+        for (sfb = 0; sfb < 22; sfb++) widths[n++] = l[sfb];
+        *first_short = n;
+        return n;
+    }
+    sfb = 0;
+    if (gi->mixed) {
+        /* Two long subbands (36 lines), then short blocks from the band starting at line 36 */
+        while (lines < 36) {
+            lines += l[n];
+            widths[n] = l[n];
+            n++;
+        }
+        sfb = 3;
+    }
+    *first_short = n;
+    for (; sfb < 13; sfb++)
+        for (w = 0; w < 3; w++) widths[n++] = s[sfb];
+    return n;
+}
+
+/* Reads part 2 (scalefactors) into scf[] in band order. is_max[] receives the
+   illegal intensity position per band. */
+static void mp3dec_read_scalefactors(mp3dec* dec, mp3dec_bits* bs, const mp3dec_header* hdr, const mp3dec_granule* gi,
+                                     int gr, int ch, int scfsi, int nbands, int first_short,
+                                     float* scf, int* is_max, int* preflag, int* intensity_scale) {
+    int i, n = 0;
+    for (i = 0; i < 40; i++) {
+        scf[i] = 0;
+        is_max[i] = 7;
+    }
+    *preflag = gi->preflag;
+    *intensity_scale = 0;
+
+    if (!hdr->lsf) {
+        int slen1 = mp3dec_slen[gi->scalefac_compress][0];
+        int slen2 = mp3dec_slen[gi->scalefac_compress][1];
+        if (gi->block_type == 2) {
+            /* mixed: 8 long bands + short sfb 3..11; plain: short sfb 0..11. sfb < 6 use slen1 */
+            int long_bands = first_short, count = nbands - 3;
+            for (i = 0; i < count; i++) {
+                int sfb = i < long_bands ? i : (i - long_bands) / 3 + (gi->mixed ? 3 : 0);
+                int slen = (i < long_bands || sfb < 6) ? slen1 : slen2;
+                scf[i] = (float)mp3dec_get(bs, slen);
+            }
+        } else {
+            static const int groups[5] = {0, 6, 11, 16, 21};
+            int gidx;
+            for (gidx = 0; gidx < 4; gidx++) {
+                int slen = gidx < 2 ? slen1 : slen2;
+                for (i = groups[gidx]; i < groups[gidx + 1]; i++) {
+                    if (gr == 1 && (scfsi & (8 >> gidx)))
+                        scf[i] = dec->scf_prev[ch][i];
+                    else
+                        scf[i] = (float)mp3dec_get(bs, slen);
+                }
+            }
+        }
+        for (i = 0; i < 40; i++) dec->scf_prev[ch][i] = scf[i];
+        return;
+    }
+
+    {
+        int slen[4] = {0, 0, 0, 0}, table, part, k;
+        int sfc = gi->scalefac_compress;
+        int bt = gi->block_type == 2 ? (gi->mixed ? 2 : 1) : 0;
+        if ((hdr->mode_ext & 1) && hdr->mode == 1 && ch == 1) {
+            int isc = sfc >> 1;
+            *intensity_scale = sfc & 1;
+            if (isc < 180) {
+                slen[0] = isc / 36;
+                slen[1] = (isc % 36) / 6;
+                slen[2] = isc % 6;
+                table = 3;
+            } else if (isc < 244) {
+                isc -= 180;
+                slen[0] = (isc & 63) >> 4;
+                slen[1] = (isc & 15) >> 2;
+                slen[2] = isc & 3;
+                table = 4;
+            } else {
+                isc -= 244;
+                slen[0] = isc / 3;
+                slen[1] = isc % 3;
+                table = 5;
+            }
+            *preflag = 0;
+        } else if (sfc < 400) {
+            slen[0] = (sfc >> 4) / 5;
+            slen[1] = (sfc >> 4) % 5;
+            slen[2] = (sfc & 15) >> 2;
+            slen[3] = sfc & 3;
+            table = 0;
+            *preflag = 0;
+        } else if (sfc < 500) {
+            sfc -= 400;
+            slen[0] = (sfc >> 2) / 5;
+            slen[1] = (sfc >> 2) % 5;
+            slen[2] = sfc & 3;
+            table = 1;
+            *preflag = 0;
+        } else {
+            sfc -= 500;
+            slen[0] = sfc / 3;
+            slen[1] = sfc % 3;
+            table = 2;
+            *preflag = 1;
+        }
+        for (part = 0; part < 4; part++) {
+            for (k = 0; k < mp3dec_nr_of_sfb[table][bt][part] && n < 40; k++, n++) {
+                scf[n] = (float)mp3dec_get(bs, slen[part]);
+                is_max[n] = (1 << slen[part]) - 1;
+            }
+        }
+    }
+}
+
+/* Part 3: big_values pairs then count1 quads, up to bit `end` */
+static int mp3dec_read_huffman(mp3dec_bits* bs, const mp3dec_granule* gi, int end, int* is) {
+    int i = 0, limit = gi->big_values * 2;
+    int r1 = gi->region1_start < limit ? gi->region1_start : limit;
+    int r2 = gi->region2_start < limit ? gi->region2_start : limit;
+
+    while (i < limit) {
+        int region_end = i < r1 ? r1 : i < r2 ? r2 : limit;
+        int table = gi->table_select[i < r1 ? 0 : i < r2 ? 1 : 2];
+        int linbits = mp3dec_linbits[table];
+        if (table == 0 || table == 4 || table == 14) {
+            for (; i < region_end; i++) is[i] = 0;
+            continue;
+        }
+        for (; i < region_end; i += 2) {
+            int v;
+            if (bs->pos > end) return i; /* corrupt granule */
+            v = mp3dec_huff(bs, table);
+            int x = v >> 4, y = v & 15;
+            if (x == 15 && linbits) x += (int)mp3dec_get(bs, linbits);
+            if (x && mp3dec_get(bs, 1)) x = -x;
+            if (y == 15 && linbits) y += (int)mp3dec_get(bs, linbits);
+            if (y && mp3dec_get(bs, 1)) y = -y;
+            is[i] = x;
+            is[i + 1] = y;
+        }
+    }
+
+    while (i + 4 <= 576 && bs->pos < end) {
+        int v = gi->count1_table ? 15 - (int)mp3dec_get(bs, 4) : mp3dec_huff(bs, 32);
+        int q[4], k;
+        q[0] = (v >> 3) & 1;
+        q[1] = (v >> 2) & 1;
+        q[2] = (v >> 1) & 1;
+        q[3] = v & 1;
+        for (k = 0; k < 4; k++)
+            if (q[k] && mp3dec_get(bs, 1)) q[k] = -1;
+        if (bs->pos > end) break; /* ran into the next granule: the last quad is garbage */
+        for (k = 0; k < 4; k++) is[i + k] = q[k];
+        i += 4;
+    }
+    return i;
+}
+
+static void mp3dec_requantize(const mp3dec* dec, const mp3dec_granule* gi, const int* is, int nz,
+                              const unsigned char* widths, int nbands, int first_short,
+                              const float* scf, int preflag, float* xr) {
+    static const float frac[4] = {1.0f, 1.18920712f, 1.41421356f, 1.68179283f};
+    int b, i = 0, shift = gi->scalefac_scale ? 2 : 1;
+    for (b = 0; b < nbands && i < nz; b++) {
+        int end = i + widths[b];
+        int q = gi->global_gain - 210;
+        int s;
+        float gain;
+        if (b >= first_short) {
+            q -= 8 * gi->subblock_gain[(b - first_short) % 3];
+            s = (int)scf[b];
+        } else {
+            s = (int)scf[b] + (preflag ? mp3dec_pretab[b] : 0);
+        }
+        q -= (s << shift);
+        gain = ldexpf(frac[q & 3], q >> 2);
+        for (; i < end && i < nz; i++) {
+            int v = is[i];
+            int a = v < 0 ? -v : v;
+            float m = a < 129 ? dec->pow43[a] : (float)a * cbrtf((float)a);
+            xr[i] = (v < 0 ? -m : m) * gain;
+        }
+    }
+    for (; i < 576; i++) xr[i] = 0.0f;
+}
+
+static void mp3dec_ms(float* l, float* r, int from, int to) {
+    const float k = 0.70710678f;
+    int i;
+    for (i = from; i < to; i++) {
+        float m = l[i], s = r[i];
+        l[i] = (m + s) * k;
+        r[i] = (m - s) * k;
+    }
+}
+
+static void mp3dec_stereo(const mp3dec_header* hdr, const mp3dec_granule* gi, float* l, float* r, int nz,
+                          const unsigned char* widths, int nbands, int first_short,
+                          const float* scf_r, const int* is_max, int intensity_scale) {
+    int ms = hdr->mode == 1 && (hdr->mode_ext & 2);
+    int is = hdr->mode == 1 && (hdr->mode_ext & 1);
+    int starts[41], b, w;
+    int is_band[40];
+
+    if (!ms && !is) return;
+    if (!is) {
+        mp3dec_ms(l, r, 0, 576);
+        return;
+    }
+
+    for (b = 0, starts[0] = 0; b < nbands; b++) starts[b + 1] = starts[b] + widths[b];
+    for (b = 0; b < nbands; b++) is_band[b] = 0;
+
+    /* Intensity coding covers the bands above the last non-zero right-channel band
+       (per window for short blocks). */
+    {
+        int short_nonzero = 0;
+        for (w = 0; w < 3 && first_short < nbands; w++) {
+            int last = -1;
+            for (b = first_short + w; b < nbands; b += 3) {
+                int i;
+                for (i = starts[b]; i < starts[b + 1]; i++)
+                    if (r[i] != 0.0f) {
+                        last = b;
+                        break;
+                    }
+            }
+            if (last >= 0) short_nonzero = 1;
+            for (b = (last >= 0 ? last + 3 : first_short + w); b < nbands; b += 3) is_band[b] = 1;
+        }
+        if (first_short > 0 && !short_nonzero) {
+            int nzr = 0, i;
+            for (i = starts[first_short] - 1; i >= 0; i--)
+                if (r[i] != 0.0f) {
+                    nzr = i + 1;
+                    break;
+                }
+            for (b = 0; b < first_short; b++)
+                if (starts[b] >= nzr) is_band[b] = 1;
+        }
+    }
+    (void)nz;
+    (void)gi;
+
+    for (b = 0; b < nbands; b++) {
+        int from = starts[b], to = starts[b + 1], i;
+        int pos, illegal;
+        /* The top band carries no scalefactor and reuses the one below it */
+        int src = b;
+        if (first_short == nbands && b == nbands - 1) src = b - 1;
+        else if (first_short < nbands && b >= nbands - 3) src = b - 3;
+        if (!is_band[b]) {
+            if (ms) mp3dec_ms(l, r, from, to);
+            continue;
+        }
+        pos = (int)scf_r[src];
+        illegal = pos == is_max[src];
+        if (illegal) {
+            if (ms) mp3dec_ms(l, r, from, to);
+            continue;
+        }
+        if (!hdr->lsf) {
+            double a = pos * MP3DEC_PI / 12.0;
+            float kl = (float)(sin(a) / (sin(a) + cos(a)));
+            float kr = (float)(cos(a) / (sin(a) + cos(a)));
+            for (i = from; i < to; i++) {
+                float v = l[i];
+                l[i] = v * kl;
+                r[i] = v * kr;
+            }
+        } else {
+            float io = intensity_scale ? 0.70710678f : 0.84089642f;
+            float kl = 1.0f, kr = 1.0f;
+            if (pos & 1) kl = powf(io, (float)((pos + 1) >> 1));
+            else if (pos) kr = powf(io, (float)(pos >> 1));
+            for (i = from; i < to; i++) {
+                float v = l[i];
+                l[i] = v * kl;
+                r[i] = v * kr;
+            }
+        }
+    }
+}
+
+/* Short blocks are coded band by band, window by window; the IMDCT wants them interleaved */
+static void mp3dec_reorder(float* xr, const unsigned char* widths, int nbands, int first_short) {
+    float tmp[576];
+    int b, start = 0;
+    for (b = 0; b < first_short; b++) start += widths[b];
+    for (b = first_short; b < nbands; b += 3) {
+        int width = widths[b], j, w;
+        for (w = 0; w < 3; w++)
+            for (j = 0; j < width; j++) tmp[3 * j + w] = xr[start + w * width + j];
+        memcpy(xr + start, tmp, sizeof(float) * 3 * width);
+        start += 3 * width;
+    }
+}
+
+static void mp3dec_antialias(float* xr, int subbands) {
+    static const float cs[8] = {0.857492926f, 0.881741997f, 0.949628649f, 0.983314592f,
+                                0.995517816f, 0.999160558f, 0.999899195f, 0.999993155f};
+    static const float ca[8] = {-0.514495755f, -0.471731969f, -0.313377454f, -0.181913200f,
+                                -0.094574193f, -0.040965583f, -0.014198569f, -0.003699975f};
+    int sb, i;
+    for (sb = 1; sb < subbands; sb++) {
+        for (i = 0; i < 8; i++) {
+            float a = xr[sb * 18 - 1 - i], b = xr[sb * 18 + i];
+            xr[sb * 18 - 1 - i] = a * cs[i] - b * ca[i];
+            xr[sb * 18 + i] = b * cs[i] + a * ca[i];
+        }
+    }
+}
+
+/* IMDCT, windowing and overlap-add for one channel; out[t][sb] is the subband sample matrix */
+static void mp3dec_hybrid(mp3dec* dec, const mp3dec_granule* gi, int ch, const float* xr, float out[18][32]) {
+    int sb, i, k, w;
+    for (sb = 0; sb < 32; sb++) {
+        const float* x = xr + sb * 18;
+        float* ov = dec->overlap[ch][sb];
+        float z[36];
+        int is_short = gi->block_type == 2 && !(gi->mixed && sb < 2);
+        if (is_short) {
+            for (i = 0; i < 36; i++) z[i] = 0.0f;
+            for (w = 0; w < 3; w++) {
+                for (i = 0; i < 12; i++) {
+                    float sum = 0.0f;
+                    for (k = 0; k < 6; k++) sum += x[3 * k + w] * dec->imdct12[i][k];
+                    z[6 + 6 * w + i] += sum * dec->win_short[i];
+                }
+            }
+        } else {
+            const float* win = dec->win_long[gi->block_type == 2 ? 0 : gi->block_type];
+            for (i = 0; i < 36; i++) {
+                float sum = 0.0f;
+                for (k = 0; k < 18; k++) sum += x[k] * dec->imdct36[i][k];
+                z[i] = sum * win[i];
+            }
+        }
+        for (i = 0; i < 18; i++) {
+            float v = z[i] + ov[i];
+            ov[i] = z[i + 18];
+            /* Frequency inversion of odd subbands */
+            out[i][sb] = (sb & 1) && (i & 1) ? -v : v;
+        }
+    }
+}
+
+static void mp3dec_synth(mp3dec* dec, int ch, int off, const float* s, float* pcm, int stride) {
+    float* v = dec->synth_v[ch];
+    int i, j, k;
+    for (i = 0; i < 64; i++) {
+        float sum = 0.0f;
+        for (k = 0; k < 32; k++) sum += dec->synth_n[i][k] * s[k];
+        v[(off + i) & 1023] = sum;
+    }
+    for (j = 0; j < 32; j++) {
+        float sum = 0.0f;
+        for (i = 0; i < 16; i++) {
+            int u = j + 32 * i;
+            sum += v[(off + dec->synth_vidx[u]) & 1023] * dec->synth_d[u];
+        }
+        pcm[j * stride] = sum;
+    }
+}
+
+int mp3dec_decode_frame(mp3dec* dec, const unsigned char* frame, int frame_bytes, float* pcm) {
+    mp3dec_header hdr;
+    mp3dec_granule gr[2][2];
+    mp3dec_bits bs;
+    int scfsi[2] = {0, 0};
+    int main_data_begin, md_offset, md_bytes, reserv, total, start;
+    int ngr, nch, g, ch, t;
+
+    if (frame_bytes < 4 || mp3dec_parse_header(frame, &hdr) != frame_bytes) return 0;
+    ngr = hdr.lsf ? 1 : 2;
+    nch = hdr.channels;
+
+    md_offset = 4 + (hdr.protection ? 2 : 0) + hdr.side_info_bytes;
+    if (md_offset > frame_bytes) return 0;
+    bs.buf = frame + 4 + (hdr.protection ? 2 : 0);
+    bs.pos = 0;
+    if (!mp3dec_read_side_info(&bs, &hdr, &main_data_begin, scfsi, gr)) return 0;
+
+    /* Bit reservoir: this frame's main data starts main_data_begin bytes back */
+    md_bytes = frame_bytes - md_offset;
+    reserv = dec->reserv;
+    memcpy(dec->maindata + reserv, frame + md_offset, (size_t)md_bytes);
+    total = reserv + md_bytes;
+    memset(dec->maindata + total, 0, 16);
+    start = reserv - main_data_begin;
+
+    if (start < 0) {
+        memset(pcm, 0, sizeof(float) * (size_t)(hdr.samples * nch));
+    } else {
+        int part_start = start * 8;
+        for (g = 0; g < ngr; g++) {
+            float xr[2][576];
+            float subband[2][18][32];
+            unsigned char widths[2][40];
+            int nbands[2], first_short[2], nz[2];
+            float scf[2][40];
+            int is_max[2][40];
+            int intensity_scale = 0;
+
+            for (ch = 0; ch < nch; ch++) {
+                mp3dec_granule* gi = &gr[g][ch];
+                int is[576 + 4];
+                int preflag, iscale, end = part_start + gi->part2_3_length;
+                bs.buf = dec->maindata;
+                bs.pos = part_start;
+                nbands[ch] = mp3dec_bands(&hdr, gi, widths[ch], &first_short[ch]);
+                mp3dec_read_scalefactors(dec, &bs, &hdr, gi, g, ch, scfsi[ch], nbands[ch], first_short[ch],
+                                         scf[ch], is_max[ch], &preflag, &iscale);
+                if (ch == 1) intensity_scale = iscale;
+                if (end > total * 8) end = total * 8;
+                nz[ch] = mp3dec_read_huffman(&bs, gi, end, is);
+                mp3dec_requantize(dec, gi, is, nz[ch], widths[ch], nbands[ch], first_short[ch], scf[ch], preflag, xr[ch]);
+                part_start += gi->part2_3_length;
+            }
+
+            if (nch == 2) {
+                mp3dec_stereo(&hdr, &gr[g][0], xr[0], xr[1], nz[0] > nz[1] ? nz[0] : nz[1], widths[1], nbands[1],
+                              first_short[1], scf[1], is_max[1], intensity_scale);
+            }
+
+            for (ch = 0; ch < nch; ch++) {
+                mp3dec_granule* gi = &gr[g][ch];
+                if (gi->block_type == 2) {
+                    mp3dec_reorder(xr[ch], widths[ch], nbands[ch], first_short[ch]);
+                    if (gi->mixed) mp3dec_antialias(xr[ch], 2);
+                } else {
+                    mp3dec_antialias(xr[ch], 32);
+                }
+                mp3dec_hybrid(dec, gi, ch, xr[ch], subband[ch]);
+            }
+
+            for (t = 0; t < 18; t++) {
+                dec->synth_off = (dec->synth_off - 64) & 1023;
+                for (ch = 0; ch < nch; ch++) {
+                    mp3dec_synth(dec, ch, dec->synth_off, subband[ch][t], pcm + ((g * 18 + t) * 32) * nch + ch, nch);
+                }
+            }
+        }
+    }
+
+    /* Keep at most 511 bytes (the largest main_data_begin) for the next frame */
+    if (total > 511) {
+        memmove(dec->maindata, dec->maindata + total - 511, 511);
+        dec->reserv = 511;
+    } else {
+        dec->reserv = total;
+    }
+    return hdr.samples;
+}
+
+#endif /* MP3DEC_IMPLEMENTATION */
@@ -0,0 +1,260 @@
+#include "ogg_reader.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const size_t kMaxPageSize = 27 + 255 + 255 * 255;
+// Below this span the bisection gives way to a forward walk
+static const size_t kBisectLinearBytes = 64 << 10;
+
+static uint32_t ReadLE32(const uint8_t* p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+
+struct OggCrcTable {
+    uint32_t table[256];
+    OggCrcTable() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t r = i << 24;
+            for (int k = 0; k < 8; k++) r = (r & 0x80000000u) ? (r << 1) ^ 0x04C11DB7u : r << 1;
+            table[i] = r;
+        }
+    }
+};
+
+static uint32_t OggCrc(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static const OggCrcTable crcTable;
+    for (size_t i = 0; i < size; i++) crc = (crc << 8) ^ crcTable.table[(crc >> 24) ^ data[i]];
+    return crc;
+}
+
+void OggReader::Attach(const uint8_t* data, size_t size) {
+    data_ = data;
+    size_ = size;
+    locked_ = false;
+    havePage_ = false;
+    ended_ = false;
+}
+
+bool OggReader::ParsePage(size_t offset, OggPage* page) const {
+    if (offset + 27 > size_) return false;
+    const uint8_t* p = data_ + offset;
+    if (memcmp(p, "OggS", 4) != 0 || p[4] != 0) return false;
+    int segments = p[26];
+    if (offset + 27 + segments > size_) return false;
+    size_t body = 0;
+    for (int i = 0; i < segments; i++) body += p[27 + i];
+    size_t header = 27 + (size_t)segments;
+    if (offset + header + body > size_) return false;
+
+    // CRC over the page with its own CRC field zeroed
+    static const uint8_t zeros[4] = {0, 0, 0, 0};
+    uint32_t crc = OggCrc(p, 22);
+    crc = OggCrc(zeros, 4, crc);
+    crc = OggCrc(p + 26, header - 26 + body, crc);
+    if (crc != ReadLE32(p + 22)) return false;
+
+    page->offset = offset;
+    page->headerSize = header;
+    page->bodySize = body;
+    page->flags = p[5];
+    page->granule = (int64_t)((uint64_t)ReadLE32(p + 6) | (uint64_t)ReadLE32(p + 10) << 32);
+    page->serial = ReadLE32(p + 14);
+    page->lacing = p + 27;
+    page->segments = segments;
+    return true;
+}
+
+bool OggReader::FindPage(size_t offset, size_t limit, OggPage* page) const {
+    limit = std::min(limit, size_);
+    while (offset + 4 <= limit) {
+        const void* hit = memchr(data_ + offset, 'O', limit - offset);
+        if (!hit) return false;
+        offset = (size_t)((const uint8_t*)hit - data_);
+        if (ParsePage(offset, page) && (!locked_ || page->serial == serial_)) return true;
+        offset++;
+    }
+    return false;
+}
+
+bool OggReader::Begin() {
+    OggPage first;
+    locked_ = false;
+    if (!FindPage(0, std::min(size_, kMaxPageSize * 2), &first) || !(first.flags & OggPage::kFirst)) return false;
+    serial_ = first.serial;
+    locked_ = true;
+    Rewind(first);
+    return true;
+}
+
+bool OggReader::LoadPage(size_t offset) {
+    OggPage page;
+    if (!FindPage(offset, size_, &page)) return false;
+    // A new beginning-of-stream page means a chained file: stop at the link
+    if ((page.flags & OggPage::kFirst) && havePage_) return false;
+    page_ = page;
+    havePage_ = true;
+    segment_ = 0;
+    bodyPos_ = page.offset + page.headerSize;
+    return true;
+}
+
+void OggReader::Rewind(const OggPage& page, bool afterCompleted) {
+    page_ = page;
+    havePage_ = true;
+    ended_ = false;
+    segment_ = 0;
+    bodyPos_ = page.offset + page.headerSize;
+    assembly_.clear();
+
+    // Skip the tail of a packet that started on an earlier page
+    if (page.flags & OggPage::kContinued) {
+        while (segment_ < page.segments) {
+            uint8_t lace = page.lacing[segment_++];
+            bodyPos_ += lace;
+            if (lace < 255) break;
+        }
+    }
+    if (afterCompleted) {
+        int last = -1;
+        for (int i = segment_; i < page.segments; i++)
+            if (page.lacing[i] < 255) last = i;
+        for (; segment_ <= last; segment_++) bodyPos_ += page.lacing[segment_];
+    }
+}
+
+bool OggReader::LastPacketStart(const OggPage& page, const uint8_t** data, size_t* size) const {
+    int last = -1;
+    for (int i = 0; i < page.segments; i++)
+        if (page.lacing[i] < 255) last = i;
+    if (last < 0) return false;
+
+    // Walk back to the segment after the previous packet end
+    int first = last;
+    while (first > 0 && page.lacing[first - 1] == 255) first--;
+    if (first == 0 && (page.flags & OggPage::kContinued)) return false;
+
+    size_t start = page.offset + page.headerSize;
+    for (int i = 0; i < first; i++) start += page.lacing[i];
+    size_t length = 0;
+    for (int i = first; i <= last; i++) length += page.lacing[i];
+    *data = data_ + start;
+    *size = length;
+    return true;
+}
+
+bool OggReader::NextPacket(OggPacket* packet) {
+    if (!havePage_ || ended_) return false;
+    assembly_.clear();
+    bool spanning = false;
+    size_t start = bodyPos_;
+    size_t length = 0;
+
+    for (;;) {
+        if (segment_ >= page_.segments) {
+            if (page_.flags & OggPage::kLast) {
+                ended_ = true;
+                return false;
+            }
+            // Packet continues on the next page
+            if (length > 0 || spanning) {
+                assembly_.insert(assembly_.end(), data_ + start, data_ + start + length);
+                spanning = true;
+            }
+            if (!LoadPage(page_.End())) {
+                ended_ = true;
+                return false;
+            }
+            if (spanning && !(page_.flags & OggPage::kContinued)) {
+                // Lost the continuation; drop the partial packet
+                assembly_.clear();
+                spanning = false;
+            } else if (!spanning && (page_.flags & OggPage::kContinued)) {
+                // Picked up mid-packet after a gap; its head is gone
+                while (segment_ < page_.segments) {
+                    uint8_t lace = page_.lacing[segment_++];
+                    bodyPos_ += lace;
+                    if (lace < 255) break;
+                }
+            }
+            start = bodyPos_;
+            length = 0;
+            continue;
+        }
+
+        uint8_t lace = page_.lacing[segment_++];
+        bodyPos_ += lace;
+        length += lace;
+        if (lace < 255) break;
+    }
+
+    bool last = true;
+    for (int i = segment_; i < page_.segments; i++)
+        if (page_.lacing[i] < 255) last = false;
+
+    if (spanning) {
+        assembly_.insert(assembly_.end(), data_ + start, data_ + start + length);
+        packet->data = assembly_.data();
+        packet->size = assembly_.size();
+    } else {
+        packet->data = data_ + start;
+        packet->size = length;
+    }
+    packet->lastOnPage = last;
+    packet->granule = last ? page_.granule : -1;
+    packet->endOfStream = last && (page_.flags & OggPage::kLast);
+    return true;
+}
+
+bool OggReader::BisectGranule(int64_t target, size_t begin, OggPage* page) const {
+    size_t lo = begin;
+    size_t hi = size_;
+    bool found = false;
+    OggPage probe;
+
+    while (hi - lo > kBisectLinearBytes) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (!FindPage(mid, std::min(hi, mid + kMaxPageSize), &probe)) {
+            hi = mid;
+            continue;
+        }
+        // Pages without a granule don't order anything; look a bit further
+        bool more = true;
+        while (probe.granule == -1 && more) more = FindPage(probe.End(), std::min(hi, probe.End() + kMaxPageSize), &probe);
+        if (probe.granule == -1) {
+            hi = mid;
+        } else if (probe.granule < target) {
+            *page = probe;
+            found = true;
+            lo = probe.End();
+        } else {
+            hi = mid;
+        }
+    }
+
+    size_t offset = lo;
+    while (FindPage(offset, size_, &probe)) {
+        if (probe.granule != -1) {
+            if (probe.granule >= target) break;
+            *page = probe;
+            found = true;
+        }
+        offset = probe.End();
+    }
+    return found;
+}
+
+int64_t OggReader::LastGranule() const {
+    size_t end = size_;
+    while (end > 0) {
+        size_t begin = end > kMaxPageSize ? end - kMaxPageSize : 0;
+        int64_t granule = -1;
+        OggPage probe;
+        size_t offset = begin;
+        while (FindPage(offset, end, &probe)) {
+            if (probe.granule != -1) granule = probe.granule;
+            offset = probe.End();
+        }
+        if (granule != -1) return granule;
+        end = begin;
+    }
+    return -1;
+}
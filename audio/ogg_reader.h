@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Ogg framing (RFC 3533) over an in-memory file image, typically a MappedFile.
+// Follows the first logical bitstream only; pages of other streams are
+// skipped and a chained stream ends playback.
+struct OggPage {
+    enum Flags : uint8_t {
+        kContinued = 0x01,
+        kFirst = 0x02,
+        kLast = 0x04,
+    };
+
+    size_t offset = 0;
+    size_t headerSize = 0;
+    size_t bodySize = 0;
+    int64_t granule = -1;  // -1: no packet ends on this page
+    uint32_t serial = 0;
+    uint8_t flags = 0;
+    const uint8_t* lacing = nullptr;
+    int segments = 0;
+
+    size_t End() const { return offset + headerSize + bodySize; }
+};
+
+struct OggPacket {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    // Set on the last packet completed on a page
+    bool lastOnPage = false;
+    int64_t granule = -1;
+    bool endOfStream = false;
+};
+
+class OggReader {
+public:
+    void Attach(const uint8_t* data, size_t size);
+
+    // Validates the page at `offset`, CRC included.
+    bool ParsePage(size_t offset, OggPage* page) const;
+    // First page of our stream starting at or after `offset` and before `limit`.
+    bool FindPage(size_t offset, size_t limit, OggPage* page) const;
+    // Locks onto the stream of the first page. Call before reading packets.
+    bool Begin();
+
+    // Packet iteration. Packets that fit in one page point into the file;
+    // ones spanning pages are assembled into an internal buffer that stays
+    // valid until the next call.
+    bool NextPacket(OggPacket* packet);
+    // Restarts packet reading at a page. A packet continued from the previous
+    // page is dropped; with `afterCompleted`, every packet that finishes on
+    // this page is dropped too and reading starts with the unfinished tail.
+    void Rewind(const OggPage& page, bool afterCompleted = false);
+    // Start of the last packet completed on `page`, if that packet begins on it.
+    bool LastPacketStart(const OggPage& page, const uint8_t** data, size_t* size) const;
+
+    // Last page with a granule below `target`, found by bisection over
+    // [begin, end of file). False if no such page exists after `begin`.
+    bool BisectGranule(int64_t target, size_t begin, OggPage* page) const;
+    // Granule of the final page, -1 if the stream has none.
+    int64_t LastGranule() const;
+
+    // Page the last packet came from
+    const OggPage& CurrentPage() const { return page_; }
+    uint32_t Serial() const { return serial_; }
+    size_t Size() const { return size_; }
+
+private:
+    bool LoadPage(size_t offset);
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    uint32_t serial_ = 0;
+    bool locked_ = false;
+
+    OggPage page_;
+    bool havePage_ = false;
+    int segment_ = 0;
+    size_t bodyPos_ = 0;
+    bool ended_ = false;
+    std::vector<uint8_t> assembly_;
+};
@@ -0,0 +1,247 @@
+#include "decoder.h"
+#include "ogg_reader.h"
+#include "sample_convert.h"
+#include "util/mapped_file.h"
+
+#include <opus_multistream.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Opus in Ogg (RFC 7845) through the system libopus, which has a struct
+// OpusDecoder of its own; hence the name. Output is always 48 kHz.
+// Positions follow the granule minus the header's pre-skip; a seek bisects to a
+// page well ahead of the target and decodes forward from there so the decoder
+// state has converged by the time output resumes.
+
+static const size_t kPrefetchBytes = 1 << 20;
+static const size_t kReleaseBytes = 16 << 20;
+static const int kOpusRate = 48000;
+static const int kMaxPacketFrames = 5760;  // 120 ms
+// RFC 7845 asks for at least 80 ms; CELT's band energy prediction only halves
+// its error per 20 ms frame, so 80 ms still leaves an audible step on dense
+// material. 320 ms brings it below -90 dB for about a millisecond of decoding.
+static const int64_t kSeekPreroll = 15360;
+
+static uint16_t ReadLE16(const uint8_t* p) { return (uint16_t)(p[0] | p[1] << 8); }
+
+struct OpusMSDecoderDeleter {
+    void operator()(OpusMSDecoder* dec) const { opus_multistream_decoder_destroy(dec); }
+};
+
+class OggOpusDecoder : public Decoder {
+public:
+    bool Open(const std::string& path);
+
+    AudioFormat Format() const override { return format_; }
+    int64_t TotalFrames() const override { return totalFrames_; }
+    size_t Read(float* out, size_t frames) override;
+    bool Seek(int64_t frame) override;
+
+private:
+    bool ReadHeaders();
+    int64_t MeasureStart();
+    bool DecodePacket();
+    void Restart();
+
+    MappedFile file_;
+    OggReader ogg_;
+    std::unique_ptr<OpusMSDecoder, OpusMSDecoderDeleter> dec_;
+    AudioFormat format_;
+    OggPage firstAudioPage_;
+    int preSkip_ = 0;
+    int mappingFamily_ = 0;
+    int64_t startGranule_ = 0;  // granule of the first decoded sample
+    int64_t totalFrames_ = -1;
+
+    // Granule of the next sample the decoder will produce
+    int64_t granule_ = 0;
+    std::vector<float> pcm_;
+    int64_t pcmPosition_ = 0;  // output frame of pcm_[0]
+    size_t pcmFrames_ = 0;
+    size_t pcmPos_ = 0;
+    bool ended_ = false;
+
+    size_t prefetchedTo_ = 0;
+    size_t releasedTo_ = 0;
+};
+
+bool OggOpusDecoder::Open(const std::string& path) {
+    if (!file_.Open(path)) return false;
+    ogg_.Attach(file_.Data(), file_.Size());
+    if (!ogg_.Begin() || !ReadHeaders()) return false;
+
+    pcm_.resize((size_t)kMaxPacketFrames * format_.channels);
+    startGranule_ = MeasureStart();
+    int64_t last = ogg_.LastGranule();
+    if (last >= 0) totalFrames_ = std::max<int64_t>(0, last - startGranule_ - preSkip_);
+
+    file_.AdviseSequential();
+    Restart();
+    return true;
+}
+
+bool OggOpusDecoder::ReadHeaders() {
+    // Identification header: version, channels, pre-skip, input rate, gain, mapping
+    OggPacket packet;
+    if (!ogg_.NextPacket(&packet) || packet.size < 19 || memcmp(packet.data, "OpusHead", 8) != 0 ||
+        (packet.data[8] >> 4) != 0) {
+        std::cerr << "Not an Opus stream" << std::endl;
+        return false;
+    }
+    const uint8_t* head = packet.data;
+    const int channels = head[9];
+    preSkip_ = ReadLE16(head + 10);
+    const int16_t gain = (int16_t)ReadLE16(head + 16);
+    mappingFamily_ = head[18];
+
+    int streams = 1;
+    int coupled = channels - 1;
+    unsigned char mapping[255] = {0, 1};
+    if (mappingFamily_ != 0) {
+        if (packet.size < 21 + (size_t)channels) return false;
+        streams = head[19];
+        coupled = head[20];
+        memcpy(mapping, head + 21, (size_t)channels);
+    }
+    if (channels < 1 || channels > 8 || (mappingFamily_ == 0 && channels > 2)) {
+        std::cerr << "Unsupported Opus channel layout" << std::endl;
+        return false;
+    }
+
+    int error = OPUS_OK;
+    dec_.reset(opus_multistream_decoder_create(kOpusRate, channels, streams, coupled, mapping, &error));
+    if (!dec_ || error != OPUS_OK) return false;
+    // Output gain is Q7.8 dB, applied by libopus
+    if (gain != 0) opus_multistream_decoder_ctl(dec_.get(), OPUS_SET_GAIN(gain));
+    format_.sampleRate = kOpusRate;
+    format_.channels = channels;
+
+    // Comment header; it may span pages but always finishes its last one
+    if (!ogg_.NextPacket(&packet) || packet.size < 8 || memcmp(packet.data, "OpusTags", 8) != 0) return false;
+    return ogg_.FindPage(ogg_.CurrentPage().End(), file_.Size(), &firstAudioPage_);
+}
+
+// The first audio page's granule counts the samples of the packets ending on
+// it, so anything else means the stream was cut from a longer one.
+int64_t OggOpusDecoder::MeasureStart() {
+    ogg_.Rewind(firstAudioPage_);
+    OggPacket packet;
+    int64_t produced = 0;
+    while (ogg_.NextPacket(&packet)) {
+        int frames = opus_packet_get_nb_samples(packet.data, (opus_int32)packet.size, kOpusRate);
+        if (frames > 0) produced += frames;
+        if (packet.lastOnPage) return std::max<int64_t>(0, packet.granule - produced);
+    }
+    return 0;
+}
+
+void OggOpusDecoder::Restart() {
+    ogg_.Rewind(firstAudioPage_);
+    opus_multistream_decoder_ctl(dec_.get(), OPUS_RESET_STATE);
+    granule_ = startGranule_;
+    pcmFrames_ = pcmPos_ = 0;
+    ended_ = false;
+    file_.WillNeed(firstAudioPage_.offset, kPrefetchBytes);
+    prefetchedTo_ = firstAudioPage_.offset + kPrefetchBytes;
+    releasedTo_ = 0;
+}
+
+bool OggOpusDecoder::DecodePacket() {
+    OggPacket packet;
+    while (!ended_) {
+        if (!ogg_.NextPacket(&packet)) {
+            ended_ = true;
+            break;
+        }
+        int frames = opus_multistream_decode_float(dec_.get(), packet.data, (opus_int32)packet.size, pcm_.data(),
+                                                   kMaxPacketFrames, 0);
+        if (frames <= 0) {
+            // Silence where a packet won't decode, so the positions after it
+            // stay right and an end of stream on it still counts
+            frames = opus_packet_get_nb_samples(packet.data, (opus_int32)packet.size, kOpusRate);
+            frames = frames > 0 ? std::min(frames, kMaxPacketFrames) : 0;
+            std::fill_n(pcm_.data(), (size_t)frames * format_.channels, 0.0f);
+        }
+        if (packet.endOfStream) ended_ = true;
+        if (frames == 0) continue;
+
+        // Drop the pre-skip at the start and anything past the declared end
+        const int64_t first = granule_ - startGranule_ - preSkip_;
+        granule_ += frames;
+        int64_t skip = std::max<int64_t>(0, -first);
+        int64_t last = first + frames;
+        if (totalFrames_ >= 0) last = std::min(last, totalFrames_);
+        if (last - first - skip <= 0) continue;
+
+        pcmPosition_ = first;
+        pcmPos_ = (size_t)skip;
+        pcmFrames_ = (size_t)(last - first);
+        if (mappingFamily_ == 1) ReorderVorbisChannels(pcm_.data(), pcmFrames_, format_.channels);
+
+        const size_t pos = ogg_.CurrentPage().offset;
+        if (pos + kPrefetchBytes / 2 > prefetchedTo_) {
+            file_.WillNeed(prefetchedTo_, kPrefetchBytes);
+            prefetchedTo_ += kPrefetchBytes;
+        }
+        if (pos > releasedTo_ + kReleaseBytes) {
+            size_t keep = pos - kReleaseBytes / 4;
+            file_.Release(releasedTo_, keep - releasedTo_);
+            releasedTo_ = keep;
+        }
+        return true;
+    }
+    return false;
+}
+
+size_t OggOpusDecoder::Read(float* out, size_t frames) {
+    const size_t channels = (size_t)format_.channels;
+    size_t done = 0;
+    while (done < frames) {
+        if (pcmPos_ == pcmFrames_ && !DecodePacket()) break;
+        size_t n = std::min(frames - done, pcmFrames_ - pcmPos_);
+        memcpy(out + done * channels, pcm_.data() + pcmPos_ * channels, n * channels * sizeof(float));
+        pcmPos_ += n;
+        done += n;
+    }
+    return done;
+}
+
+bool OggOpusDecoder::Seek(int64_t frame) {
+    if (frame < 0) return false;
+    if (totalFrames_ >= 0) frame = std::min(frame, totalFrames_);
+
+    // Packets completed on the found page end at its granule, so decoding
+    // resumes exactly there with the packet that follows
+    const int64_t target = frame + startGranule_ + preSkip_;
+    OggPage page;
+    if (target - kSeekPreroll > startGranule_ &&
+        ogg_.BisectGranule(target - kSeekPreroll, firstAudioPage_.offset, &page)) {
+        ogg_.Rewind(page, true);
+        opus_multistream_decoder_ctl(dec_.get(), OPUS_RESET_STATE);
+        granule_ = page.granule;
+        pcmFrames_ = pcmPos_ = 0;
+        ended_ = false;
+        file_.WillNeed(page.offset, kPrefetchBytes);
+        prefetchedTo_ = page.offset + kPrefetchBytes;
+        releasedTo_ = std::min(releasedTo_, page.offset);
+    } else {
+        Restart();
+    }
+
+    while (DecodePacket()) {
+        if (frame < pcmPosition_ + (int64_t)pcmFrames_) {
+            pcmPos_ = std::max(pcmPos_, (size_t)std::max<int64_t>(0, frame - pcmPosition_));
+            break;
+        }
+    }
+    return true;
+}
+
+std::unique_ptr<Decoder> OpenOpusDecoder(const std::string& path) {
+    auto decoder = std::make_unique<OggOpusDecoder>();
+    if (!decoder->Open(path)) return nullptr;
+    return decoder;
+}
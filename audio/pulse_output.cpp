@@ -0,0 +1,100 @@
+#include "audio_output.h"
+
+#include <pulse/error.h>
+#include <pulse/simple.h>
+
+#include <iostream>
+
+// PulseAudio through the blocking simple API; on PipeWire systems this talks
+// to pipewire-pulse. Each write blocks until the server has room, which paces
+// the callback thread. The server keeps about 40 ms queued.
+
+static const int kPeriodMs = 10;
+static const pa_usec_t kTargetLatencyUs = 40000;
+
+class PulseOutput : public AudioOutput {
+public:
+    ~PulseOutput() override { Stop(); }
+
+    bool Start(const AudioFormat& format, AudioSource* source) override;
+    void Stop() override;
+    const char* Name() const override { return "pulse"; }
+    int64_t LatencyFrames() const override { return latency_.load(std::memory_order_relaxed); }
+
+private:
+    void ThreadMain(AudioSource* source);
+
+    pa_simple* stream_ = nullptr;
+    AudioFormat format_;
+    std::vector<float> buffer_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<int64_t> latency_{0};
+};
+
+bool PulseOutput::Start(const AudioFormat& format, AudioSource* source) {
+    Stop();
+    if (format.sampleRate <= 0 || format.channels <= 0 || format.channels > PA_CHANNELS_MAX || !source) return false;
+
+    pa_sample_spec spec;
+    spec.format = PA_SAMPLE_FLOAT32NE;
+    spec.rate = (uint32_t)format.sampleRate;
+    spec.channels = (uint8_t)format.channels;
+    // Decoders hand out WAV channel order
+    pa_channel_map map;
+    pa_channel_map_init_extend(&map, spec.channels, PA_CHANNEL_MAP_WAVEEX);
+
+    pa_buffer_attr attr;
+    attr.maxlength = (uint32_t)-1;
+    attr.tlength = (uint32_t)pa_usec_to_bytes(kTargetLatencyUs, &spec);
+    attr.prebuf = (uint32_t)-1;
+    attr.minreq = (uint32_t)-1;
+    attr.fragsize = (uint32_t)-1;
+
+    int error = 0;
+    stream_ = pa_simple_new(nullptr, "CatMp3", PA_STREAM_PLAYBACK, nullptr, "Music", &spec, &map, &attr, &error);
+    if (!stream_) {
+        std::cerr << "PulseAudio: " << pa_strerror(error) << std::endl;
+        return false;
+    }
+    format_ = format;
+    buffer_.assign((size_t)format.sampleRate * kPeriodMs / 1000 * format.channels, 0.0f);
+    latency_.store(0);
+    running_.store(true);
+    thread_ = std::thread(&PulseOutput::ThreadMain, this, source);
+    PromoteToRealtime(thread_);
+    return true;
+}
+
+void PulseOutput::Stop() {
+    running_.store(false);
+    if (thread_.joinable()) thread_.join();
+    if (stream_) {
+        pa_simple_flush(stream_, nullptr);
+        pa_simple_free(stream_);
+        stream_ = nullptr;
+    }
+    latency_.store(0);
+}
+
+void PulseOutput::ThreadMain(AudioSource* source) {
+    const size_t period = buffer_.size() / format_.channels;
+    int error = 0;
+
+    while (running_.load(std::memory_order_relaxed)) {
+        source->Render(buffer_.data(), period);
+        if (pa_simple_write(stream_, buffer_.data(), buffer_.size() * sizeof(float), &error) < 0) {
+            // Server gone; the engine restarts the output once it notices
+            std::cerr << "PulseAudio: " << pa_strerror(error) << std::endl;
+            break;
+        }
+        pa_usec_t latency = pa_simple_get_latency(stream_, &error);
+        if (latency != (pa_usec_t)-1) {
+            latency_.store((int64_t)(latency * (uint64_t)format_.sampleRate / 1000000), std::memory_order_relaxed);
+        }
+    }
+}
+
+std::unique_ptr<AudioOutput> CreatePulseOutput() {
+    return std::make_unique<PulseOutput>();
+}
@@ -0,0 +1,362 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#if defined(__SSE__) || defined(_M_X64)
+#define RESAMPLER_SSE 1
+#include <xmmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RESAMPLER_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RESAMPLER_NEON 1
+#include <arm_neon.h>
+#endif
+
+static const int kMaxPhases = 1024;
+static const int kMaxTaps = 1024;
+// Input frames buffered per channel beyond one filter window
+static const size_t kBlockFrames = 1024;
+
+struct QualityPreset {
+    const char* name;
+    int taps;
+    double attenuationDb;
+};
+
+static const QualityPreset kPresets[] = {
+    {"low", 16, 60.0},
+    {"medium", 32, 80.0},
+    {"high", 64, 100.0},
+    {"best", 128, 120.0},
+};
+
+ResamplerQuality ParseResamplerQuality(const char* name, ResamplerQuality fallback) {
+    if (!name) return fallback;
+    for (int i = 0; i < 4; i++)
+        if (strcmp(name, kPresets[i].name) == 0) return (ResamplerQuality)i;
+    return fallback;
+}
+
+const char* ResamplerQualityName(ResamplerQuality quality) { return kPresets[(int)quality].name; }
+
+// Dot products over the filter length, which is always a multiple of 8
+
+static float DotScalar(const float* a, const float* b, int n) {
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (int i = 0; i < n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+#if RESAMPLER_SSE
+static float DotSse(const float* a, const float* b, int n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 sum = _mm_add_ps(acc0, acc1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+#endif
+
+#if RESAMPLER_AVX2
+__attribute__((target("avx2,fma")))
+static float DotAvx2(const float* a, const float* b, int n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    if (i < n) acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    __m256 sum8 = _mm256_add_ps(acc0, acc1);
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+#endif
+
+#if RESAMPLER_NEON
+static float DotNeon(const float* a, const float* b, int n) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (int i = 0; i < n; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float32x4_t sum = vaddq_f32(acc0, acc1);
+    float32x2_t half = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+    return vget_lane_f32(vpadd_f32(half, half), 0);
+}
+#endif
+
+using DotKernel = float (*)(const float*, const float*, int);
+
+struct DotDispatch {
+    DotKernel kernel = DotScalar;
+    const char* name = "scalar";
+    DotDispatch() {
+#if RESAMPLER_NEON
+        kernel = DotNeon;
+        name = "neon";
+#endif
+#if RESAMPLER_SSE
+        kernel = DotSse;
+        name = "sse";
+#endif
+#if RESAMPLER_AVX2
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            kernel = DotAvx2;
+            name = "avx2";
+        }
+#endif
+    }
+};
+
+static const DotDispatch& Dot() {
+    static const DotDispatch dispatch;
+    return dispatch;
+}
+
+// Zeroth-order modified Bessel function of the first kind, for the Kaiser window
+static double BesselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 64; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-17) break;
+    }
+    return sum;
+}
+
+bool Resampler::Configure(int inRate, int outRate, int channels, ResamplerQuality quality) {
+    if (inRate <= 0 || outRate <= 0 || channels <= 0) return false;
+    const int64_t g = std::gcd((int64_t)inRate, (int64_t)outRate);
+    up_ = outRate / g;
+    down_ = inRate / g;
+    channels_ = channels;
+    phases_ = up_ <= kMaxPhases ? (int)up_ : kMaxPhases;
+
+    // Kaiser design (Kaiser 1974): transition width from length and attenuation.
+    // Widths are relative to the lower of the two Nyquist frequencies, so when
+    // decimating the filter is stretched by the ratio to keep the same response.
+    const QualityPreset& preset = kPresets[(int)quality];
+    const double attenuation = preset.attenuationDb;
+    const double beta = 0.1102 * (attenuation - 8.7);
+    const double transition = 2.0 * (attenuation - 7.95) / (14.36 * preset.taps);
+    const double ratio = std::min(1.0, (double)up_ / (double)down_);
+    // Centre the transition a quarter-width below Nyquist: what aliases back
+    // then lands in the transition band and never in the passband
+    const double cutoff = (1.0 - transition / 4.0) * ratio;
+    int taps = (int)std::ceil(preset.taps / ratio);
+    taps = std::min(kMaxTaps, (taps + 7) & ~7);
+    taps_ = taps;
+
+    // Row q holds the filter for a fractional delay of q / phases_; the extra
+    // last row (delay 1) lets interpolated phases read row q + 1 unconditionally
+    const double half = taps / 2.0;
+    const double i0Beta = BesselI0(beta);
+    bank_.assign((size_t)(phases_ + 1) * taps, 0.0f);
+    for (int q = 0; q <= phases_; q++) {
+        float* row = bank_.data() + (size_t)q * taps;
+        double sum = 0.0;
+        std::vector<double> h(taps);
+        for (int k = 0; k < taps; k++) {
+            const double x = half - 1.0 - k + (double)q / phases_;
+            const double r = x / half;
+            const double window = std::fabs(r) < 1.0 ? BesselI0(beta * std::sqrt(1.0 - r * r)) / i0Beta : 0.0;
+            const double arg = M_PI * cutoff * x;
+            const double sinc = std::fabs(arg) < 1e-12 ? 1.0 : std::sin(arg) / arg;
+            h[k] = cutoff * sinc * window;
+            sum += h[k];
+        }
+        // Unity gain at DC for every phase, so there is no ripple at the phase rate
+        for (int k = 0; k < taps; k++) row[k] = (float)(h[k] / sum);
+    }
+
+    capacity_ = (size_t)taps + kBlockFrames;
+    history_.assign(capacity_ * channels, 0.0f);
+    Reset(0);
+    return true;
+}
+
+int64_t Resampler::Reset(int64_t frame) {
+    base_ = frame * down_ / up_;
+    phase_ = frame * down_ % up_;
+    ended_ = false;
+    inputEnd_ = 0;
+
+    // History starts at the first frame of the window; anything before the
+    // stream start is silence
+    const int64_t windowStart = base_ - taps_ / 2 + 1;
+    historyStart_ = windowStart;
+    historyFrames_ = 0;
+    if (windowStart < 0) {
+        historyFrames_ = (size_t)std::min<int64_t>(-windowStart, (int64_t)capacity_);
+        std::fill(history_.begin(), history_.end(), 0.0f);
+    }
+    return std::max<int64_t>(0, windowStart);
+}
+
+void Resampler::EndInput() {
+    if (ended_) return;
+    ended_ = true;
+    inputEnd_ = historyStart_ + (int64_t)historyFrames_;
+}
+
+int64_t Resampler::OutputFrames(int64_t frames) const { return (frames * up_ + down_ - 1) / down_; }
+
+const char* Resampler::KernelName() const { return Dot().name; }
+
+// Drops history the next output no longer reaches
+void Resampler::Compact() {
+    const int64_t windowStart = base_ - taps_ / 2 + 1;
+    const int64_t drop = std::min<int64_t>(windowStart - historyStart_, (int64_t)historyFrames_);
+    if (drop <= 0) return;
+    const size_t keep = historyFrames_ - (size_t)drop;
+    for (int c = 0; c < channels_; c++) {
+        float* h = history_.data() + (size_t)c * capacity_;
+        memmove(h, h + drop, keep * sizeof(float));
+    }
+    historyStart_ += drop;
+    historyFrames_ = keep;
+}
+
+void Resampler::Produce(float* out) {
+    const DotKernel dot = Dot().kernel;
+    const size_t start = (size_t)(base_ - taps_ / 2 + 1 - historyStart_);
+    if (phases_ == up_) {
+        const float* row = bank_.data() + (size_t)phase_ * taps_;
+        for (int c = 0; c < channels_; c++) out[c] = dot(history_.data() + (size_t)c * capacity_ + start, row, taps_);
+    } else {
+        const int64_t position = phase_ * phases_;
+        const float* row = bank_.data() + (size_t)(position / up_) * taps_;
+        const float frac = (float)(position % up_) / (float)up_;
+        for (int c = 0; c < channels_; c++) {
+            const float* h = history_.data() + (size_t)c * capacity_ + start;
+            float a = dot(h, row, taps_);
+            float b = dot(h, row + taps_, taps_);
+            out[c] = a + (b - a) * frac;
+        }
+    }
+    phase_ += down_;
+    base_ += phase_ / up_;
+    phase_ %= up_;
+}
+
+size_t Resampler::Process(const float* in, size_t inFrames, size_t* consumed, float* out, size_t outFrames) {
+    size_t used = 0;
+    size_t produced = 0;
+    while (produced < outFrames) {
+        if (ended_ && base_ >= inputEnd_) break;
+        const int64_t windowEnd = base_ + taps_ / 2 + 1;
+        const int64_t available = historyStart_ + (int64_t)historyFrames_;
+        if (windowEnd <= available) {
+            Produce(out + produced * channels_);
+            produced++;
+            continue;
+        }
+
+        // Need more input: real frames, or silence past the end
+        Compact();
+        size_t space = capacity_ - historyFrames_;
+        size_t n = ended_ ? (size_t)std::min<int64_t>((int64_t)space, windowEnd - available)
+                          : std::min(space, inFrames - used);
+        if (n == 0) break;
+        for (int c = 0; c < channels_; c++) {
+            float* h = history_.data() + (size_t)c * capacity_ + historyFrames_;
+            if (ended_) {
+                std::fill(h, h + n, 0.0f);
+            } else {
+                const float* src = in + used * channels_ + c;
+                for (size_t i = 0; i < n; i++) h[i] = src[i * channels_];
+            }
+        }
+        historyFrames_ += n;
+        if (!ended_) used += n;
+    }
+    if (consumed) *consumed = used;
+    return produced;
+}
+
+class ResamplingDecoder : public Decoder {
+public:
+    ResamplingDecoder(std::unique_ptr<Decoder> decoder, int outRate) : decoder_(std::move(decoder)) {
+        format_ = decoder_->Format();
+        format_.sampleRate = outRate;
+        scratch_.resize(kBlockFrames * format_.channels);
+    }
+
+    bool Configure(ResamplerQuality quality) {
+        return resampler_.Configure(decoder_->Format().sampleRate, format_.sampleRate, format_.channels, quality);
+    }
+
+    AudioFormat Format() const override { return format_; }
+
+    int64_t TotalFrames() const override {
+        int64_t frames = decoder_->TotalFrames();
+        return frames < 0 ? -1 : resampler_.OutputFrames(frames);
+    }
+
+    size_t Read(float* out, size_t frames) override {
+        const size_t channels = (size_t)format_.channels;
+        size_t done = 0;
+        while (done < frames) {
+            if (scratchPos_ == scratchFrames_ && !ended_) {
+                scratchFrames_ = decoder_->Read(scratch_.data(), kBlockFrames);
+                scratchPos_ = 0;
+                if (scratchFrames_ == 0) {
+                    ended_ = true;
+                    resampler_.EndInput();
+                }
+            }
+            size_t used = 0;
+            size_t n = resampler_.Process(scratch_.data() + scratchPos_ * channels, scratchFrames_ - scratchPos_, &used,
+                                          out + done * channels, frames - done);
+            scratchPos_ += used;
+            done += n;
+            if (n == 0 && ended_) break;
+        }
+        return done;
+    }
+
+    bool Seek(int64_t frame) override {
+        scratchFrames_ = scratchPos_ = 0;
+        ended_ = false;
+        return decoder_->Seek(resampler_.Reset(frame));
+    }
+
+private:
+    std::unique_ptr<Decoder> decoder_;
+    Resampler resampler_;
+    AudioFormat format_;
+    std::vector<float> scratch_;
+    size_t scratchFrames_ = 0;
+    size_t scratchPos_ = 0;
+    bool ended_ = false;
+};
+
+std::unique_ptr<Decoder> ResampleDecoder(std::unique_ptr<Decoder> decoder, int outRate, ResamplerQuality quality) {
+    if (!decoder) return nullptr;
+    auto resampled = std::make_unique<ResamplingDecoder>(std::move(decoder), outRate);
+    if (!resampled->Configure(quality)) return nullptr;
+    return resampled;
+}
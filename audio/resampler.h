@@ -0,0 +1,80 @@
+#pragma once
+
+#include "decoder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+enum class ResamplerQuality {
+    Low,    // 16 taps, 60 dB stopband
+    Medium, // 32 taps, 80 dB
+    High,   // 64 taps, 100 dB
+    Best,   // 128 taps, 120 dB
+};
+
+// "low", "medium", "high" or "best"; anything else gives `fallback`.
+ResamplerQuality ParseResamplerQuality(const char* name, ResamplerQuality fallback);
+const char* ResamplerQualityName(ResamplerQuality quality);
+
+// Kaiser-windowed sinc, polyphase. Rates whose reduced ratio needs at most
+// kMaxPhases filter phases (every common pair: 44.1<->48, 96->44.1, ...) are
+// converted exactly with one precomputed phase per output position; other
+// ratios interpolate between neighbouring phases of a 1024-phase bank.
+// Timing is tracked with integers, so there is no drift however long the
+// stream runs, and output frame j is exactly input time j * inRate / outRate.
+//
+// Everything is allocated in Configure(); Process() works block by block on
+// interleaved frames without allocating.
+class Resampler {
+public:
+    bool Configure(int inRate, int outRate, int channels, ResamplerQuality quality);
+
+    // Restarts the stream at output frame `frame`. Returns the input frame the
+    // source has to continue from (the filter needs some history before it).
+    int64_t Reset(int64_t frame = 0);
+    // No more input follows; Process() pads with silence and stops at the
+    // output frame matching the end of the input.
+    void EndInput();
+
+    // Consumes up to `inFrames` frames of `in` (reporting how many in
+    // `consumed`) and writes up to `outFrames` frames to `out`. Returns the
+    // number of frames written.
+    size_t Process(const float* in, size_t inFrames, size_t* consumed, float* out, size_t outFrames);
+
+    // Output length for an input of `frames` frames.
+    int64_t OutputFrames(int64_t frames) const;
+    int Taps() const { return taps_; }
+    int Phases() const { return phases_; }
+    // Dot-product kernel picked for this CPU
+    const char* KernelName() const;
+
+private:
+    void Compact();
+    void Produce(float* out);
+
+    int channels_ = 0;
+    int64_t up_ = 1;     // reduced outRate / gcd
+    int64_t down_ = 1;   // reduced inRate / gcd
+    int taps_ = 0;
+    int phases_ = 0;     // filter phases in the bank; == up_ for exact ratios
+    std::vector<float> bank_; // (phases_ + 1) rows of taps_ coefficients
+
+    // Per channel input history, planar, `capacity_` frames each
+    std::vector<float> history_;
+    size_t capacity_ = 0;
+    int64_t historyStart_ = 0; // stream frame of history column 0
+    size_t historyFrames_ = 0;
+
+    // Next output frame: window starts at stream frame base_ - taps_/2 + 1,
+    // fractional position phase_ / up_
+    int64_t base_ = 0;
+    int64_t phase_ = 0;
+    bool ended_ = false;
+    int64_t inputEnd_ = 0;
+};
+
+// Presents `decoder` at `outRate`. Seeks, length and end of stream are mapped
+// through the rate ratio.
+std::unique_ptr<Decoder> ResampleDecoder(std::unique_ptr<Decoder> decoder, int outRate, ResamplerQuality quality);
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+// Wait-free single-producer/single-consumer ring of interleaved float frames.
+// One thread writes, one thread reads; neither ever blocks or allocates.
+// Indices grow monotonically and are masked on access, so capacity is a power of two.
+class PcmRingBuffer {
+public:
+    struct Span {
+        float* data = nullptr;
+        size_t frames = 0;
+    };
+
+    PcmRingBuffer() = default;
+    PcmRingBuffer(const PcmRingBuffer&) = delete;
+    PcmRingBuffer& operator=(const PcmRingBuffer&) = delete;
+
+    // Not thread-safe: only call while neither side is running.
+    void Allocate(size_t minFrames, int channels) {
+        size_t capacity = 1;
+        while (capacity < minFrames) capacity <<= 1;
+        capacity_ = capacity;
+        mask_ = capacity - 1;
+        channels_ = channels;
+        storage_.reset(new float[capacity * channels]());
+        write_.index.store(0, std::memory_order_relaxed);
+        read_.index.store(0, std::memory_order_relaxed);
+    }
+
+    size_t Capacity() const { return capacity_; }
+    int Channels() const { return channels_; }
+
+    // Producer side
+
+    size_t WritableFrames() const {
+        uint64_t r = read_.index.load(std::memory_order_acquire);
+        return capacity_ - (size_t)(write_.index.load(std::memory_order_relaxed) - r);
+    }
+
+    // Free space as up to two contiguous spans (the second one is non-empty when it wraps).
+    size_t PrepareWrite(Span& first, Span& second) {
+        uint64_t r = read_.index.load(std::memory_order_acquire);
+        uint64_t w = write_.index.load(std::memory_order_relaxed);
+        return Split(w, capacity_ - (size_t)(w - r), first, second);
+    }
+
+    void CommitWrite(size_t frames) {
+        write_.index.store(write_.index.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+    }
+
+    size_t Write(const float* frames, size_t count) {
+        Span first, second;
+        count = std::min(count, PrepareWrite(first, second));
+        size_t head = std::min(count, first.frames);
+        memcpy(first.data, frames, head * channels_ * sizeof(float));
+        if (count > head) memcpy(second.data, frames + head * channels_, (count - head) * channels_ * sizeof(float));
+        CommitWrite(count);
+        return count;
+    }
+
+    // Consumer side
+
+    size_t ReadableFrames() const {
+        uint64_t w = write_.index.load(std::memory_order_acquire);
+        return (size_t)(w - read_.index.load(std::memory_order_relaxed));
+    }
+
+    size_t PrepareRead(Span& first, Span& second) {
+        uint64_t w = write_.index.load(std::memory_order_acquire);
+        uint64_t r = read_.index.load(std::memory_order_relaxed);
+        return Split(r, (size_t)(w - r), first, second);
+    }
+
+    void CommitRead(size_t frames) {
+        read_.index.store(read_.index.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+    }
+
+    size_t Read(float* out, size_t count) {
+        Span first, second;
+        count = std::min(count, PrepareRead(first, second));
+        size_t head = std::min(count, first.frames);
+        memcpy(out, first.data, head * channels_ * sizeof(float));
+        if (count > head) memcpy(out + head * channels_, second.data, (count - head) * channels_ * sizeof(float));
+        CommitRead(count);
+        return count;
+    }
+
+    // Drops everything the producer has published so far.
+    void DiscardAll() {
+        read_.index.store(write_.index.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    size_t Split(uint64_t index, size_t frames, Span& first, Span& second) const {
+        size_t offset = (size_t)(index & mask_);
+        size_t head = std::min(frames, capacity_ - offset);
+        first.data = storage_.get() + offset * channels_;
+        first.frames = head;
+        second.data = storage_.get();
+        second.frames = frames - head;
+        return frames;
+    }
+
+    // Read and write indices on separate cache lines so the two threads don't false-share.
+    struct alignas(64) Side {
+        std::atomic<uint64_t> index{0};
+    };
+
+    Side write_;
+    Side read_;
+    alignas(64) std::unique_ptr<float[]> storage_;
+    size_t capacity_ = 0;
+    size_t mask_ = 0;
+    int channels_ = 0;
+};
@@ -0,0 +1,204 @@
+#include "sample_convert.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SAMPLE_CONVERT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SAMPLE_CONVERT_SSSE3 1
+#include <tmmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SAMPLE_CONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+void ConvertU8ToFloat(const uint8_t* in, float* out, size_t samples) {
+    const float scale = 1.0f / 128.0f;
+    size_t i = 0;
+#if SAMPLE_CONVERT_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128 vscale = _mm_set1_ps(scale);
+    for (; i + 16 <= samples; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(v, zero), bias);
+        __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(v, zero), bias);
+        // Sign-extend 16 -> 32 by unpacking into the high half and shifting back down
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16)), vscale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16)), vscale));
+        _mm_storeu_ps(out + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16)), vscale));
+        _mm_storeu_ps(out + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16)), vscale));
+    }
+#endif
+    for (; i < samples; i++) out[i] = ((int)in[i] - 128) * scale;
+}
+
+void ConvertS16ToFloat(const uint8_t* in, float* out, size_t samples) {
+    const float scale = 1.0f / 32768.0f;
+    size_t i = 0;
+#if SAMPLE_CONVERT_SSE2
+    const __m128 vscale = _mm_set1_ps(scale);
+    for (; i + 8 <= samples; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i * 2));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), vscale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), vscale));
+    }
+#elif SAMPLE_CONVERT_NEON
+    for (; i + 8 <= samples; i += 8) {
+        int16x8_t v = vreinterpretq_s16_u8(vld1q_u8(in + i * 2));
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+        vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+    }
+#endif
+    for (; i < samples; i++) {
+        int16_t s;
+        memcpy(&s, in + i * 2, 2);
+        out[i] = s * scale;
+    }
+}
+
+#if SAMPLE_CONVERT_SSSE3
+// Four packed 24-bit samples per 12 bytes: shuffle each into the top of a 32-bit
+// lane and arithmetic-shift back down to sign-extend.
+__attribute__((target("ssse3")))
+static size_t ConvertS24ToFloatSsse3(const uint8_t* in, float* out, size_t samples) {
+    const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128 vscale = _mm_set1_ps(1.0f / 8388608.0f);
+    size_t i = 0;
+    // Each load reads 16 bytes but consumes 12, so stop while a full load is still in bounds
+    for (; i + 6 <= samples; i += 4) {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + i * 3)), shuffle);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(v, 8)), vscale));
+    }
+    return i;
+}
+#endif
+
+void ConvertS24ToFloat(const uint8_t* in, float* out, size_t samples) {
+    size_t i = 0;
+#if SAMPLE_CONVERT_SSSE3
+    static const bool hasSsse3 = __builtin_cpu_supports("ssse3");
+    if (hasSsse3) i = ConvertS24ToFloatSsse3(in, out, samples);
+#endif
+    const float scale = 1.0f / 8388608.0f;
+    for (; i < samples; i++) {
+        const uint8_t* p = in + i * 3;
+        int32_t s = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8;
+        out[i] = s * scale;
+    }
+}
+
+void ConvertS32ToFloat(const uint8_t* in, float* out, size_t samples) {
+    const float scale = 1.0f / 2147483648.0f;
+    size_t i = 0;
+#if SAMPLE_CONVERT_SSE2
+    const __m128 vscale = _mm_set1_ps(scale);
+    for (; i + 8 <= samples; i += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(in + i * 4));
+        __m128i b = _mm_loadu_si128((const __m128i*)(in + i * 4 + 16));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(a), vscale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(b), vscale));
+    }
+#elif SAMPLE_CONVERT_NEON
+    for (; i + 4 <= samples; i += 4) {
+        int32x4_t v = vreinterpretq_s32_u8(vld1q_u8(in + i * 4));
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(v), scale));
+    }
+#endif
+    for (; i < samples; i++) {
+        int32_t s;
+        memcpy(&s, in + i * 4, 4);
+        out[i] = s * scale;
+    }
+}
+
+void ConvertF32ToFloat(const uint8_t* in, float* out, size_t samples) {
+    memcpy(out, in, samples * sizeof(float));
+}
+
+void ConvertF64ToFloat(const uint8_t* in, float* out, size_t samples) {
+    size_t i = 0;
+#if SAMPLE_CONVERT_SSE2
+    for (; i + 4 <= samples; i += 4) {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd((const double*)(in + i * 8)));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd((const double*)(in + i * 8 + 16)));
+        _mm_storeu_ps(out + i, _mm_movelh_ps(lo, hi));
+    }
+#endif
+    for (; i < samples; i++) {
+        double s;
+        memcpy(&s, in + i * 8, 8);
+        out[i] = (float)s;
+    }
+}
+
+void ConvertFloatToS16(const float* in, int16_t* out, size_t samples) {
+    size_t i = 0;
+#if SAMPLE_CONVERT_SSE2
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    for (; i + 8 <= samples; i += 8) {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lo), hi);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), lo), hi);
+        // +1.0 becomes 32768, which the saturating pack turns into 32767
+        __m128i v = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(a, scale)), _mm_cvtps_epi32(_mm_mul_ps(b, scale)));
+        _mm_storeu_si128((__m128i*)(out + i), v);
+    }
+#endif
+    for (; i < samples; i++) {
+        float s = in[i] * 32768.0f;
+        s = s < -32768.0f ? -32768.0f : (s > 32767.0f ? 32767.0f : s);
+        out[i] = (int16_t)lrintf(s);
+    }
+}
+
+void ConvertFloatToS32(const float* in, int32_t* out, size_t samples) {
+    // Largest float below 1.0, so full scale never overflows
+    const float top = 0.99999994f;
+    size_t i = 0;
+#if SAMPLE_CONVERT_SSE2
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(top);
+    const __m128 scale = _mm_set1_ps(2147483648.0f);
+    for (; i + 4 <= samples; i += 4) {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lo), hi);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_cvtps_epi32(_mm_mul_ps(a, scale)));
+    }
+#endif
+    for (; i < samples; i++) {
+        float s = in[i] < -1.0f ? -1.0f : (in[i] > top ? top : in[i]);
+        out[i] = (int32_t)lrintf(s * 2147483648.0f);
+    }
+}
+
+// Vorbis I spec 4.3.9 layouts, indexed by channel count
+static const uint8_t kVorbisToWav[9][8] = {
+    {0},
+    {0},
+    {0, 1},
+    {0, 2, 1},
+    {0, 1, 2, 3},
+    {0, 2, 1, 3, 4},
+    {0, 2, 1, 5, 3, 4},
+    {0, 2, 1, 6, 5, 3, 4},
+    {0, 2, 1, 7, 5, 6, 3, 4},
+};
+
+void ReorderVorbisChannels(float* pcm, size_t frames, int channels) {
+    if (channels < 3 || channels > 8 || channels == 4) return;
+    const uint8_t* order = kVorbisToWav[channels];
+    float frame[8];
+    for (size_t i = 0; i < frames; i++, pcm += channels) {
+        memcpy(frame, pcm, sizeof(float) * channels);
+        for (int c = 0; c < channels; c++) pcm[c] = frame[order[c]];
+    }
+}
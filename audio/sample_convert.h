@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Little-endian integer/float PCM to float in [-1, 1]. Sources may be unaligned
+// (they usually point straight into a memory-mapped file).
+void ConvertU8ToFloat(const uint8_t* in, float* out, size_t samples);
+void ConvertS16ToFloat(const uint8_t* in, float* out, size_t samples);
+void ConvertS24ToFloat(const uint8_t* in, float* out, size_t samples);
+void ConvertS32ToFloat(const uint8_t* in, float* out, size_t samples);
+void ConvertF32ToFloat(const uint8_t* in, float* out, size_t samples);
+void ConvertF64ToFloat(const uint8_t* in, float* out, size_t samples);
+
+// Float to native-endian integer PCM for output devices, clipped to full scale.
+void ConvertFloatToS16(const float* in, int16_t* out, size_t samples);
+void ConvertFloatToS32(const float* in, int32_t* out, size_t samples);
+
+// Reorders interleaved frames from Vorbis channel order (also used by Opus
+// mapping family 1) to the WAV order the rest of the player uses.
+void ReorderVorbisChannels(float* pcm, size_t frames, int channels);
@@ -0,0 +1,81 @@
+#include "spectrum.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const float kMinHz = 30.0f;
+static const float kMaxHz = 16000.0f;
+static const float kTiltDbPerOctave = 3.0f;
+static const float kTiltPivotHz = 1000.0f;
+// A bar is full at kTopDb (a sine at that level, after the tilt) and empty
+// kRangeDb below
+static const float kTopDb = -6.0f;
+static const float kRangeDb = 60.0f;
+static const float kAttackSeconds = 0.015f;
+static const float kDecaySeconds = 0.35f;
+
+static const double kPi = 3.14159265358979323846;
+
+SpectrumAnalyzer::SpectrumAnalyzer(size_t fftSize) : fft_(fftSize) {
+    window_.resize(fftSize);
+    for (size_t i = 0; i < fftSize; i++) window_[i] = (float)(0.5 - 0.5 * std::cos(2.0 * kPi * (double)i / fftSize));
+    windowed_.resize(fftSize);
+    re_.resize(fftSize / 2 + 1);
+    im_.resize(fftSize / 2 + 1);
+    power_.resize(fftSize / 2 + 1);
+}
+
+void SpectrumAnalyzer::Layout(int sampleRate, int bars) {
+    sampleRate_ = sampleRate;
+    bars_.resize((size_t)bars, 0.0f);
+    firstBin_.resize(bars_.size());
+    lastBin_.resize(bars_.size());
+    centreBin_.resize(bars_.size());
+    tiltDb_.resize(bars_.size());
+
+    const float binHz = (float)sampleRate / (float)fft_.Size();
+    const float maxHz = std::min(kMaxHz, 0.45f * (float)sampleRate);
+    const float ratio = maxHz / kMinHz;
+    for (int b = 0; b < bars; b++) {
+        const float low = kMinHz * std::pow(ratio, (float)b / (float)bars);
+        const float high = kMinHz * std::pow(ratio, (float)(b + 1) / (float)bars);
+        const float centre = std::sqrt(low * high);
+        firstBin_[b] = (size_t)std::ceil(low / binHz);
+        lastBin_[b] = std::min((size_t)std::ceil(high / binHz), power_.size());
+        centreBin_[b] = centre / binHz;
+        tiltDb_[b] = kTiltDbPerOctave * std::log2(centre / kTiltPivotHz);
+    }
+}
+
+void SpectrumAnalyzer::Update(const float* samples, int sampleRate, int bars, float seconds) {
+    if (sampleRate <= 0 || bars <= 0) return;
+    if (sampleRate != sampleRate_ || (size_t)bars != bars_.size()) Layout(sampleRate, bars);
+
+    const size_t size = fft_.Size();
+    for (size_t i = 0; i < size; i++) windowed_[i] = samples[i] * window_[i];
+    fft_.Forward(windowed_.data(), re_.data(), im_.data());
+    for (size_t k = 0; k < power_.size(); k++) power_[k] = re_[k] * re_[k] + im_[k] * im_[k];
+
+    // A full-scale sine peaks at size / 4 through the Hann window
+    const float scaleDb = 20.0f * std::log10(4.0f / (float)size);
+    const float attack = 1.0f - std::exp(-seconds / kAttackSeconds);
+    const float decay = 1.0f - std::exp(-seconds / kDecaySeconds);
+    for (size_t b = 0; b < bars_.size(); b++) {
+        float power = 0.0f;
+        if (lastBin_[b] > firstBin_[b]) {
+            power = *std::max_element(power_.begin() + firstBin_[b], power_.begin() + lastBin_[b]);
+        } else {
+            const size_t bin = std::min((size_t)centreBin_[b], power_.size() - 2);
+            const float t = centreBin_[b] - (float)bin;
+            power = power_[bin] + (power_[bin + 1] - power_[bin]) * t;
+        }
+        const float db = 10.0f * std::log10(power + 1e-20f) + scaleDb + tiltDb_[b];
+        const float level = std::min(std::max((db - (kTopDb - kRangeDb)) / kRangeDb, 0.0f), 1.0f);
+        bars_[b] += (level - bars_[b]) * (level > bars_[b] ? attack : decay);
+    }
+}
+
+void SpectrumAnalyzer::Decay(float seconds) {
+    const float decay = 1.0f - std::exp(-seconds / kDecaySeconds);
+    for (float& bar : bars_) bar -= bar * decay;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "fft.h"
+
+#include <cstddef>
+#include <vector>
+
+// Spectrum bars for the player window. Each update takes the latest window
+// of mono samples, applies a Hann window, transforms it and folds the power
+// spectrum into bars spaced evenly in log frequency, 30 Hz to 16 kHz: a
+// bar's level is its loudest bin, or for bars narrower than a bin (the bass,
+// with a 4096-point window) the spectrum interpolated at its centre. Levels
+// are in dB, tilted up by 3 dB per octave so that typical music, which falls
+// off about that fast, reads level, and mapped to 0..1 over the top 60 dB.
+// Bars rise quickly and fall slowly.
+//
+// Meant for the UI thread: a 4096-point update is a few tens of microseconds.
+class SpectrumAnalyzer {
+public:
+    explicit SpectrumAnalyzer(size_t fftSize = 4096);
+
+    size_t WindowSize() const { return fft_.Size(); }
+    // `samples` holds WindowSize() samples at `sampleRate`; `seconds` have
+    // passed since the previous update.
+    void Update(const float* samples, int sampleRate, int bars, float seconds);
+    // Lets the bars fall as if the input had gone silent
+    void Decay(float seconds);
+
+    const std::vector<float>& Bars() const { return bars_; } // 0..1
+
+private:
+    void Layout(int sampleRate, int bars);
+
+    RealFft fft_;
+    std::vector<float> window_;
+    std::vector<float> windowed_;
+    std::vector<float> re_, im_, power_;
+
+    // Bins of each bar, for the rate and bar count they were laid out for
+    int sampleRate_ = 0;
+    std::vector<size_t> firstBin_, lastBin_; // lastBin_ exclusive
+    std::vector<float> centreBin_;           // fractional, for narrow bars
+    std::vector<float> tiltDb_;
+    std::vector<float> bars_;
+};
@@ -0,0 +1,284 @@
+#include "decoder.h"
+#include "ogg_reader.h"
+#include "sample_convert.h"
+#include "util/mapped_file.h"
+
+#define VORBISDEC_IMPLEMENTATION
+#include "vorbisdec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Ogg Vorbis on top of the vendored vorbisdec.h. Seeking bisects over page
+// granule positions, so a jump costs a logarithmic number of page reads plus
+// one block of priming. The most recent packets stay decoded, which makes
+// short backward seeks (scrubbing the progress bar) free.
+
+static const size_t kPrefetchBytes = 1 << 20;
+static const size_t kReleaseBytes = 16 << 20;
+static const int kCachedPackets = 32;
+
+struct VorbisDecoderDeleter {
+    void operator()(vorbisdec* dec) const { vorbisdec_destroy(dec); }
+};
+
+// One decoded packet; `position` is the stream frame of its first sample
+struct CachedPacket {
+    int64_t position = 0;
+    size_t frames = 0;
+    std::vector<float> pcm;
+};
+
+class VorbisDecoder : public Decoder {
+public:
+    bool Open(const std::string& path);
+
+    AudioFormat Format() const override { return format_; }
+    int64_t TotalFrames() const override { return totalFrames_; }
+    size_t Read(float* out, size_t frames) override;
+    bool Seek(int64_t frame) override;
+
+private:
+    bool ReadHeaders();
+    int64_t MeasureStart();
+    // Decodes the next packet onto the end of the cache. False at end of stream.
+    bool DecodePacket();
+    void Restart();
+    void ClearCache();
+    const CachedPacket* FindCached(int64_t position) const;
+
+    MappedFile file_;
+    OggReader ogg_;
+    std::unique_ptr<vorbisdec, VorbisDecoderDeleter> dec_;
+    AudioFormat format_;
+    OggPage firstAudioPage_;
+    int64_t startGranule_ = 0;  // granule of the first decoded sample (negative: trim)
+    int64_t endGranule_ = -1;
+    int64_t totalFrames_ = -1;
+
+    // Granule of the next sample the decoder will produce
+    int64_t granule_ = 0;
+    int64_t readPosition_ = 0;
+    bool ended_ = false;
+
+    CachedPacket cache_[kCachedPackets];
+    int cacheFirst_ = 0;
+    int cacheCount_ = 0;
+
+    size_t prefetchedTo_ = 0;
+    size_t releasedTo_ = 0;
+};
+
+bool VorbisDecoder::Open(const std::string& path) {
+    if (!file_.Open(path)) return false;
+    ogg_.Attach(file_.Data(), file_.Size());
+    if (!ogg_.Begin()) return false;
+    dec_.reset(vorbisdec_create());
+    if (!dec_ || !ReadHeaders()) return false;
+
+    format_.sampleRate = vorbisdec_sample_rate(dec_.get());
+    format_.channels = vorbisdec_channels(dec_.get());
+    for (CachedPacket& packet : cache_) packet.pcm.resize((size_t)vorbisdec_max_frames(dec_.get()) * format_.channels);
+
+    startGranule_ = MeasureStart();
+    endGranule_ = ogg_.LastGranule();
+    if (endGranule_ >= 0) totalFrames_ = std::max<int64_t>(0, endGranule_ - std::max<int64_t>(0, startGranule_));
+
+    file_.AdviseSequential();
+    Restart();
+    return true;
+}
+
+bool VorbisDecoder::ReadHeaders() {
+    OggPacket packet;
+    for (int i = 0; i < 3; i++) {
+        if (!ogg_.NextPacket(&packet) || !vorbisdec_header(dec_.get(), packet.data, (int)packet.size)) {
+            std::cerr << "Unsupported or broken Vorbis stream" << std::endl;
+            return false;
+        }
+    }
+    // The setup header finishes its page; audio starts on the next one
+    return ogg_.FindPage(ogg_.CurrentPage().End(), file_.Size(), &firstAudioPage_);
+}
+
+// Vorbis starts counting granules with the first sample the encoder meant to
+// keep. The packets on the first audio page produce more samples than its
+// granule says when the encoder asked for leading samples to be dropped, or
+// fewer when the stream was cut from the middle of a longer one.
+int64_t VorbisDecoder::MeasureStart() {
+    ogg_.Rewind(firstAudioPage_);
+    OggPacket packet;
+    int64_t produced = 0;
+    int previous = 0;
+    while (ogg_.NextPacket(&packet)) {
+        int blocksize = vorbisdec_packet_blocksize(dec_.get(), packet.data, (int)packet.size);
+        if (blocksize == 0) continue;
+        if (previous) produced += previous / 4 + blocksize / 4;
+        previous = blocksize;
+        if (packet.lastOnPage) return packet.granule - produced;
+    }
+    return 0;
+}
+
+void VorbisDecoder::Restart() {
+    ogg_.Rewind(firstAudioPage_);
+    vorbisdec_reset(dec_.get());
+    granule_ = startGranule_;
+    ended_ = false;
+    ClearCache();
+    readPosition_ = 0;
+    file_.WillNeed(firstAudioPage_.offset, kPrefetchBytes);
+    prefetchedTo_ = firstAudioPage_.offset + kPrefetchBytes;
+    releasedTo_ = 0;
+}
+
+void VorbisDecoder::ClearCache() {
+    cacheFirst_ = 0;
+    cacheCount_ = 0;
+}
+
+const CachedPacket* VorbisDecoder::FindCached(int64_t position) const {
+    for (int i = 0; i < cacheCount_; i++) {
+        const CachedPacket& packet = cache_[(cacheFirst_ + i) % kCachedPackets];
+        if (position >= packet.position && position < packet.position + (int64_t)packet.frames) return &packet;
+    }
+    return nullptr;
+}
+
+bool VorbisDecoder::DecodePacket() {
+    OggPacket packet;
+    while (!ended_) {
+        if (!ogg_.NextPacket(&packet)) {
+            ended_ = true;
+            break;
+        }
+
+        if (cacheCount_ == kCachedPackets) {
+            cacheFirst_ = (cacheFirst_ + 1) % kCachedPackets;
+            cacheCount_--;
+        }
+        CachedPacket* slot = &cache_[(cacheFirst_ + cacheCount_) % kCachedPackets];
+        int frames = vorbisdec_decode(dec_.get(), packet.data, (int)packet.size, slot->pcm.data());
+
+        // Positions come from the granule counter; trim samples before the
+        // stream start and past the end the last page declares
+        int64_t first = granule_;
+        int64_t last = granule_ + frames;
+        if (packet.endOfStream && packet.granule >= 0 && packet.granule < last) last = std::max(first, packet.granule);
+        granule_ += frames;
+        if (packet.lastOnPage && packet.granule >= 0 && !packet.endOfStream) granule_ = packet.granule;
+        if (packet.endOfStream) ended_ = true;
+
+        int64_t skip = std::max<int64_t>(0, -first);
+        const int64_t base = std::max<int64_t>(0, startGranule_);
+        if (last - first - skip <= 0) continue;
+        if (skip > 0) {
+            memmove(slot->pcm.data(), slot->pcm.data() + skip * format_.channels,
+                    (size_t)(frames - skip) * format_.channels * sizeof(float));
+        }
+        slot->position = first + skip - base;
+        slot->frames = (size_t)(last - first - skip);
+        ReorderVorbisChannels(slot->pcm.data(), slot->frames, format_.channels);
+        cacheCount_++;
+
+        const size_t pos = ogg_.CurrentPage().offset;
+        if (pos + kPrefetchBytes / 2 > prefetchedTo_) {
+            file_.WillNeed(prefetchedTo_, kPrefetchBytes);
+            prefetchedTo_ += kPrefetchBytes;
+        }
+        if (pos > releasedTo_ + kReleaseBytes) {
+            size_t keep = pos - kReleaseBytes / 4;
+            file_.Release(releasedTo_, keep - releasedTo_);
+            releasedTo_ = keep;
+        }
+        return true;
+    }
+    return false;
+}
+
+size_t VorbisDecoder::Read(float* out, size_t frames) {
+    const size_t channels = (size_t)format_.channels;
+    size_t done = 0;
+    while (done < frames) {
+        const CachedPacket* packet = FindCached(readPosition_);
+        if (!packet) {
+            if (!DecodePacket()) break;
+            continue;
+        }
+        size_t offset = (size_t)(readPosition_ - packet->position);
+        size_t n = std::min(frames - done, packet->frames - offset);
+        memcpy(out + done * channels, packet->pcm.data() + offset * channels, n * channels * sizeof(float));
+        done += n;
+        readPosition_ += (int64_t)n;
+    }
+    return done;
+}
+
+bool VorbisDecoder::Seek(int64_t frame) {
+    if (frame < 0) return false;
+    if (totalFrames_ >= 0) frame = std::min(frame, totalFrames_);
+
+    // Still decoded from a moment ago
+    if (FindCached(frame)) {
+        readPosition_ = frame;
+        return true;
+    }
+
+    // Land on a page that ends at least a long block before the target, so the
+    // packets after it cover the target once the overlap is primed
+    const int64_t base = std::max<int64_t>(0, startGranule_);
+    const int64_t target = frame + base;
+    const int longBlock = vorbisdec_max_frames(dec_.get()) * 2;
+    OggPage page;
+    const uint8_t* lastData = nullptr;
+    size_t lastSize = 0;
+    bool found = target - longBlock > 0 &&
+                 ogg_.BisectGranule(target - longBlock, firstAudioPage_.End(), &page) &&
+                 ogg_.LastPacketStart(page, &lastData, &lastSize);
+    int previousBlock = found ? vorbisdec_packet_blocksize(dec_.get(), lastData, (int)lastSize) : 0;
+
+    if (!found || previousBlock == 0) {
+        Restart();
+    } else {
+        // The page granule marks the end of its last packet's output. The first
+        // packet after it only primes the overlap; output resumes at the
+        // granule that packet would have ended on.
+        ogg_.Rewind(page, true);
+        vorbisdec_reset(dec_.get());
+        ClearCache();
+        ended_ = false;
+        OggPacket packet;
+        int blocksize = 0;
+        while (blocksize == 0) {
+            if (!ogg_.NextPacket(&packet)) {
+                ended_ = true;
+                break;
+            }
+            blocksize = vorbisdec_packet_blocksize(dec_.get(), packet.data, (int)packet.size);
+        }
+        if (blocksize) {
+            CachedPacket& scratch = cache_[0];
+            vorbisdec_decode(dec_.get(), packet.data, (int)packet.size, scratch.pcm.data());
+            granule_ = page.granule + previousBlock / 4 + blocksize / 4;
+            if (packet.lastOnPage && packet.granule >= 0) granule_ = packet.granule;
+        }
+        size_t offset = page.offset;
+        file_.WillNeed(offset, kPrefetchBytes);
+        prefetchedTo_ = offset + kPrefetchBytes;
+        releasedTo_ = std::min(releasedTo_, offset);
+    }
+
+    readPosition_ = frame;
+    while (!FindCached(readPosition_)) {
+        if (!DecodePacket()) break;
+    }
+    return true;
+}
+
+std::unique_ptr<Decoder> OpenVorbisDecoder(const std::string& path) {
+    auto decoder = std::make_unique<VorbisDecoder>();
+    if (!decoder->Open(path)) return nullptr;
+    return decoder;
+}
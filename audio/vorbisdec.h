@@ -0,0 +1,1105 @@
+/* vorbisdec.h - Vorbis I audio decoder, single header, no dependencies
+
+   Do this:
+      #define VORBISDEC_IMPLEMENTATION
+   before you include this file in *one* C or C++ file to create the implementation.
+
+   Usage:
+      vorbisdec* dec = vorbisdec_create();
+      vorbisdec_header(dec, packet, bytes);             // three times: identification, comment, setup
+      int n = vorbisdec_decode(dec, packet, bytes, pcm); // frames, interleaved float
+      vorbisdec_destroy(dec);
+
+   The container is not handled here; feed it raw packets in stream order.
+   pcm must hold vorbisdec_max_frames() * channels floats. The first audio
+   packet after vorbisdec_reset() only primes the overlap and yields 0 frames.
+
+   Floor type 0 (unused by every encoder since 2000) is not supported.
+*/
+
+#ifndef VORBISDEC_H
+#define VORBISDEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct vorbisdec vorbisdec;
+
+vorbisdec* vorbisdec_create(void);
+void vorbisdec_destroy(vorbisdec* dec);
+
+/* Feeds header packets in order. Returns 1 when accepted, 0 on a malformed or unsupported stream. */
+int vorbisdec_header(vorbisdec* dec, const unsigned char* packet, int bytes);
+/* All three headers seen */
+int vorbisdec_ready(const vorbisdec* dec);
+
+int vorbisdec_channels(const vorbisdec* dec);
+int vorbisdec_sample_rate(const vorbisdec* dec);
+int vorbisdec_max_frames(const vorbisdec* dec);
+
+/* Block size of an audio packet without decoding it, 0 if it is not an audio packet.
+   A packet yields (previous block size + its block size) / 4 frames. */
+int vorbisdec_packet_blocksize(const vorbisdec* dec, const unsigned char* packet, int bytes);
+
+/* Decodes one audio packet. Returns frames written to pcm (interleaved). */
+int vorbisdec_decode(vorbisdec* dec, const unsigned char* packet, int bytes, float* pcm);
+
+/* Forgets the overlap buffer, e.g. after a seek */
+void vorbisdec_reset(vorbisdec* dec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VORBISDEC_H */
+
+#ifdef VORBISDEC_IMPLEMENTATION
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VORBISDEC_PI 3.14159265358979323846
+#define VORBISDEC_FAST_BITS 10
+#define VORBISDEC_MAX_CHANNELS 255
+#define VORBISDEC_MAX_FLOOR1_VALUES 300
+
+static const float vorbisdec_inverse_db[256] = {
+    1.0649863e-07f, 1.1341951e-07f, 1.2079015e-07f, 1.2863978e-07f, 1.369995e-07f, 1.459025e-07f,
+    1.5538409e-07f, 1.6548181e-07f, 1.7623574e-07f, 1.8768856e-07f, 1.998856e-07f, 2.1287531e-07f,
+    2.2670913e-07f, 2.4144197e-07f, 2.5713223e-07f, 2.7384212e-07f, 2.9163792e-07f, 3.1059022e-07f,
+    3.307741e-07f, 3.5226967e-07f, 3.7516213e-07f, 3.995423e-07f, 4.2550681e-07f, 4.5315863e-07f,
+    4.8260745e-07f, 5.1397001e-07f, 5.4737063e-07f, 5.8294188e-07f, 6.2082472e-07f, 6.6116939e-07f,
+    7.0413591e-07f, 7.4989464e-07f, 7.9862701e-07f, 8.5052631e-07f, 9.0579829e-07f, 9.6466215e-07f,
+    1.0273513e-06f, 1.0941144e-06f, 1.1652161e-06f, 1.2409384e-06f, 1.3215816e-06f, 1.4074654e-06f,
+    1.4989305e-06f, 1.5963394e-06f, 1.7000785e-06f, 1.8105592e-06f, 1.9282195e-06f, 2.053526e-06f,
+    2.1869757e-06f, 2.3290977e-06f, 2.4804558e-06f, 2.6416496e-06f, 2.813319e-06f, 2.9961443e-06f,
+    3.1908505e-06f, 3.3982101e-06f, 3.6190449e-06f, 3.8542307e-06f, 4.1047006e-06f, 4.3714472e-06f,
+    4.6555283e-06f, 4.9580708e-06f, 5.2802739e-06f, 5.6234162e-06f, 5.9888571e-06f, 6.3780467e-06f,
+    6.7925284e-06f, 7.2339453e-06f, 7.7040477e-06f, 8.2047e-06f, 8.7378876e-06f, 9.3057251e-06f,
+    9.9104636e-06f, 1.0554501e-05f, 1.1240392e-05f, 1.1970856e-05f, 1.2748789e-05f, 1.3577278e-05f,
+    1.4459606e-05f, 1.5399271e-05f, 1.6400005e-05f, 1.7465769e-05f, 1.8600793e-05f, 1.9809577e-05f,
+    2.1096914e-05f, 2.2467912e-05f, 2.3928002e-05f, 2.5482977e-05f, 2.7139005e-05f, 2.890265e-05f,
+    3.078091e-05f, 3.2781227e-05f, 3.4911533e-05f, 3.7180282e-05f, 3.9596467e-05f, 4.2169668e-05f,
+    4.4910092e-05f, 4.7828602e-05f, 5.0936775e-05f, 5.4246932e-05f, 5.7772202e-05f, 6.1526567e-05f,
+    6.552491e-05f, 6.9783084e-05f, 7.4317984e-05f, 7.9147583e-05f, 8.4291038e-05f, 8.976875e-05f,
+    9.5602423e-05f, 0.00010181521f, 0.00010843174f, 0.00011547824f, 0.00012298267f, 0.00013097477f,
+    0.00013948625f, 0.00014855085f, 0.00015820454f, 0.00016848555f, 0.00017943469f, 0.00019109536f,
+    0.00020351382f, 0.0002167393f, 0.00023082423f, 0.00024582449f, 0.00026179955f, 0.00027881275f,
+    0.00029693157f, 0.00031622787f, 0.00033677815f, 0.00035866388f, 0.00038197188f, 0.00040679457f,
+    0.00043323037f, 0.0004613841f, 0.00049136748f, 0.00052329927f, 0.00055730622f, 0.00059352309f,
+    0.00063209358f, 0.00067317061f, 0.00071691698f, 0.00076350628f, 0.00081312325f, 0.00086596457f,
+    0.00092223985f, 0.00098217221f, 0.0010459992f, 0.0011139743f, 0.0011863665f, 0.0012634633f,
+    0.0013455702f, 0.0014330129f, 0.0015261382f, 0.0016253153f, 0.0017309374f, 0.0018434235f,
+    0.0019632196f, 0.0020908006f, 0.0022266726f, 0.0023713743f, 0.0025254795f, 0.0026895993f,
+    0.0028643848f, 0.0030505287f, 0.0032487691f, 0.0034598925f, 0.0036847359f, 0.0039241905f,
+    0.0041792067f, 0.0044507948f, 0.0047400328f, 0.0050480668f, 0.0053761187f, 0.005725489f,
+    0.0060975635f, 0.0064938175f, 0.0069158226f, 0.0073652514f, 0.0078438874f, 0.0083536273f,
+    0.0088964924f, 0.009474637f, 0.010090352f, 0.01074608f, 0.011444421f, 0.012188144f,
+    0.012980198f, 0.013823725f, 0.014722068f, 0.015678791f, 0.016697686f, 0.017782796f,
+    0.018938422f, 0.020169148f, 0.021479854f, 0.022875736f, 0.024362329f, 0.025945531f,
+    0.027631618f, 0.029427277f, 0.031339627f, 0.03337625f, 0.035545226f, 0.037855156f,
+    0.0403152f, 0.042935107f, 0.045725275f, 0.048696756f, 0.051861349f, 0.05523159f,
+    0.058820851f, 0.062643364f, 0.066714279f, 0.07104975f, 0.075666964f, 0.080584228f,
+    0.085821047f, 0.09139818f, 0.097337745f, 0.1036633f, 0.11039993f, 0.11757434f,
+    0.12521498f, 0.13335215f, 0.14201812f, 0.15124726f, 0.16107617f, 0.17154381f,
+    0.18269168f, 0.19456401f, 0.20720787f, 0.22067343f, 0.23501402f, 0.25028655f,
+    0.26655158f, 0.28387362f, 0.30232131f, 0.32196787f, 0.34289113f, 0.36517414f,
+    0.3889052f, 0.41417846f, 0.44109413f, 0.4697589f, 0.50028646f, 0.53279793f,
+    0.56742209f, 0.60429639f, 0.64356697f, 0.68538958f, 0.72993004f, 0.77736503f,
+    0.82788259f, 0.88168305f, 0.9389798f, 1.0f
+};
+
+typedef struct {
+    int dimensions;
+    int entries;
+    unsigned char* lengths; /* 0 = unused entry */
+    short fast[1 << VORBISDEC_FAST_BITS]; /* entry for the next FAST_BITS bits, -1 = use sorted[] */
+    unsigned int* sorted_codes;           /* MSB-aligned codewords, ascending */
+    int* sorted_entries;
+    int sorted_count;
+    float* vq; /* entries x dimensions, NULL if the book has no lookup */
+} vorbisdec_codebook;
+
+typedef struct {
+    int partitions;
+    unsigned char partition_class[32];
+    unsigned char class_dims[16];
+    unsigned char class_subclasses[16];
+    unsigned char class_masterbook[16];
+    short subclass_books[16][8];
+    int multiplier;
+    int values;
+    int x[VORBISDEC_MAX_FLOOR1_VALUES];
+    short sorted[VORBISDEC_MAX_FLOOR1_VALUES]; /* value indices ordered by x */
+    short low[VORBISDEC_MAX_FLOOR1_VALUES];
+    short high[VORBISDEC_MAX_FLOOR1_VALUES];
+} vorbisdec_floor1;
+
+typedef struct {
+    int type;
+    int begin;
+    int end;
+    int partition_size;
+    int classifications;
+    int classbook;
+    short books[64][8];
+} vorbisdec_residue;
+
+typedef struct {
+    int submaps;
+    int coupling_steps;
+    unsigned char magnitude[256];
+    unsigned char angle[256];
+    unsigned char mux[256];
+    unsigned char submap_floor[16];
+    unsigned char submap_residue[16];
+} vorbisdec_mapping;
+
+typedef struct {
+    int blockflag;
+    int mapping;
+} vorbisdec_mode;
+
+/* IMDCT of size n through a DCT-IV computed with an n/4-point complex FFT */
+typedef struct {
+    int n;
+    float* pre;    /* n/4 complex twiddles */
+    float* post;   /* n/4 complex */
+    float* fft;    /* n/8 complex */
+    int* bitrev;   /* n/4 */
+    float* work;   /* n/4 complex */
+    float* dct;    /* n/2 */
+} vorbisdec_imdct;
+
+struct vorbisdec {
+    int headers;
+    int channels;
+    int sample_rate;
+    int blocksize[2];
+
+    int codebook_count;
+    vorbisdec_codebook* codebooks;
+    int floor_count;
+    vorbisdec_floor1* floors;
+    int residue_count;
+    vorbisdec_residue* residues;
+    int mapping_count;
+    vorbisdec_mapping* mappings;
+    int mode_count;
+    vorbisdec_mode modes[64];
+
+    float* slope[2]; /* rising window half, blocksize[i] / 2 long */
+    vorbisdec_imdct imdct[2];
+
+    float* spectrum[VORBISDEC_MAX_CHANNELS]; /* blocksize[1] / 2, reused as the residue vector */
+    float* block[VORBISDEC_MAX_CHANNELS];    /* blocksize[1], windowed IMDCT output */
+    float* overlap[VORBISDEC_MAX_CHANNELS];  /* right half of the previous block */
+    float* interleave;                       /* residue type 2 scratch, channels * blocksize[1] / 2 */
+    int* classes;                            /* residue classifications scratch */
+    int prev_n;                              /* previous block size, 0 after a reset */
+};
+
+/* Bit reader, LSB first as Vorbis packs it */
+
+typedef struct {
+    const unsigned char* data;
+    int bytes;
+    long pos;
+} vorbisdec_bits;
+
+static unsigned vorbisdec_peek(const vorbisdec_bits* bs, int n) {
+    long byte = bs->pos >> 3;
+    int shift = (int)(bs->pos & 7);
+    unsigned long long v = 0;
+    int i;
+    if (byte + 8 <= bs->bytes) {
+        for (i = 0; i < 8; i++) v |= (unsigned long long)bs->data[byte + i] << (8 * i);
+    } else {
+        for (i = 0; i < 8 && byte + i < bs->bytes; i++) v |= (unsigned long long)bs->data[byte + i] << (8 * i);
+    }
+    v >>= shift;
+    return n >= 32 ? (unsigned)v : (unsigned)(v & ((1ull << n) - 1));
+}
+
+static unsigned vorbisdec_get(vorbisdec_bits* bs, int n) {
+    unsigned v;
+    if (n == 0) return 0;
+    v = vorbisdec_peek(bs, n);
+    bs->pos += n;
+    return v;
+}
+
+static int vorbisdec_eop(const vorbisdec_bits* bs) { return bs->pos > (long)bs->bytes * 8; }
+
+static int vorbisdec_ilog(unsigned v) {
+    int n = 0;
+    while (v) {
+        n++;
+        v >>= 1;
+    }
+    return n;
+}
+
+static unsigned vorbisdec_reverse(unsigned v) {
+    v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+    v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+    v = ((v >> 4) & 0x0F0F0F0Fu) | ((v & 0x0F0F0F0Fu) << 4);
+    v = ((v >> 8) & 0x00FF00FFu) | ((v & 0x00FF00FFu) << 8);
+    return (v >> 16) | (v << 16);
+}
+
+static float vorbisdec_float32(unsigned x) {
+    double mantissa = (double)(x & 0x1FFFFF);
+    int exponent = (int)((x & 0x7FE00000u) >> 21);
+    if (x & 0x80000000u) mantissa = -mantissa;
+    return (float)ldexp(mantissa, exponent - 788);
+}
+
+/* Codebooks */
+
+static int vorbisdec_lookup1_values(int entries, int dimensions) {
+    int r = (int)floor(pow((double)entries, 1.0 / dimensions));
+    while (pow((double)r + 1, dimensions) <= entries) r++;
+    while (r > 0 && pow((double)r, dimensions) > entries) r--;
+    return r;
+}
+
+static int vorbisdec_sort_codes(const void* a, const void* b) {
+    unsigned x = ((const unsigned*)a)[0], y = ((const unsigned*)b)[0];
+    return x < y ? -1 : x > y;
+}
+
+/* Assigns canonical codewords from the lengths and builds the lookup tables */
+static int vorbisdec_build_huffman(vorbisdec_codebook* cb) {
+    unsigned available[33];
+    unsigned* pairs;
+    int i, k, count = 0;
+
+    memset(available, 0, sizeof(available));
+    for (i = 0; i < (1 << VORBISDEC_FAST_BITS); i++) cb->fast[i] = -1;
+    for (i = 0; i < cb->entries; i++)
+        if (cb->lengths[i]) count++;
+    cb->sorted_count = count;
+    if (count == 0) return 1;
+
+    pairs = (unsigned*)malloc(sizeof(unsigned) * 2 * (size_t)count);
+    cb->sorted_codes = (unsigned*)malloc(sizeof(unsigned) * (size_t)count);
+    cb->sorted_entries = (int*)malloc(sizeof(int) * (size_t)count);
+    if (!pairs || !cb->sorted_codes || !cb->sorted_entries) {
+        free(pairs);
+        return 0;
+    }
+
+    count = 0;
+    for (i = 0; i < cb->entries; i++) {
+        int len = cb->lengths[i], z;
+        unsigned code;
+        if (!len) continue;
+        if (count == 0) {
+            /* First codeword is all zeros; every shorter prefix leaves its sibling free */
+            code = 0;
+            for (k = 1; k <= len; k++) available[k] = 1u << (32 - k);
+        } else {
+            z = len;
+            while (z > 0 && !available[z]) z--;
+            if (z == 0) {
+                free(pairs);
+                return 0; /* over-specified code */
+            }
+            code = available[z];
+            available[z] = 0;
+            for (k = len; k > z; k--) available[k] = code + (1u << (32 - k));
+        }
+        pairs[2 * count] = code;
+        pairs[2 * count + 1] = (unsigned)i;
+        count++;
+
+        if (len <= VORBISDEC_FAST_BITS && cb->entries <= 32767) {
+            unsigned rev = vorbisdec_reverse(code);
+            for (k = 0; k < (1 << (VORBISDEC_FAST_BITS - len)); k++)
+                cb->fast[rev | ((unsigned)k << len)] = (short)i;
+        }
+    }
+
+    qsort(pairs, (size_t)count, sizeof(unsigned) * 2, vorbisdec_sort_codes);
+    for (i = 0; i < count; i++) {
+        cb->sorted_codes[i] = pairs[2 * i];
+        cb->sorted_entries[i] = (int)pairs[2 * i + 1];
+    }
+    free(pairs);
+    return 1;
+}
+
+static int vorbisdec_decode_entry(vorbisdec_bits* bs, const vorbisdec_codebook* cb) {
+    int entry, lo, hi;
+    unsigned v;
+    if (cb->sorted_count == 0) return -1;
+    entry = cb->fast[vorbisdec_peek(bs, VORBISDEC_FAST_BITS)];
+    if (entry < 0) {
+        /* Largest codeword <= the next 32 bits read MSB first */
+        v = vorbisdec_reverse(vorbisdec_peek(bs, 32));
+        lo = 0;
+        hi = cb->sorted_count;
+        while (hi - lo > 1) {
+            int mid = (lo + hi) >> 1;
+            if (cb->sorted_codes[mid] <= v) lo = mid;
+            else hi = mid;
+        }
+        entry = cb->sorted_entries[lo];
+    }
+    bs->pos += cb->lengths[entry];
+    if (vorbisdec_eop(bs)) return -1;
+    return entry;
+}
+
+static int vorbisdec_read_codebook(vorbisdec_bits* bs, vorbisdec_codebook* cb) {
+    int i, lookup_type;
+
+    if (vorbisdec_get(bs, 24) != 0x564342) return 0;
+    cb->dimensions = (int)vorbisdec_get(bs, 16);
+    cb->entries = (int)vorbisdec_get(bs, 24);
+    if (cb->dimensions == 0 && cb->entries != 0) return 0;
+    cb->lengths = (unsigned char*)calloc((size_t)cb->entries + 1, 1);
+    if (!cb->lengths) return 0;
+
+    if (!vorbisdec_get(bs, 1)) {
+        int sparse = (int)vorbisdec_get(bs, 1);
+        for (i = 0; i < cb->entries; i++) {
+            if (!sparse || vorbisdec_get(bs, 1)) cb->lengths[i] = (unsigned char)(vorbisdec_get(bs, 5) + 1);
+        }
+    } else {
+        int entry = 0, len = (int)vorbisdec_get(bs, 5) + 1;
+        while (entry < cb->entries) {
+            int number = (int)vorbisdec_get(bs, vorbisdec_ilog((unsigned)(cb->entries - entry)));
+            if (len > 32 || entry + number > cb->entries) return 0;
+            memset(cb->lengths + entry, len, (size_t)number);
+            entry += number;
+            len++;
+        }
+    }
+    if (vorbisdec_eop(bs) || !vorbisdec_build_huffman(cb)) return 0;
+
+    lookup_type = (int)vorbisdec_get(bs, 4);
+    if (lookup_type == 1 || lookup_type == 2) {
+        float minimum = vorbisdec_float32(vorbisdec_get(bs, 32));
+        float delta = vorbisdec_float32(vorbisdec_get(bs, 32));
+        int value_bits = (int)vorbisdec_get(bs, 4) + 1;
+        int sequence = (int)vorbisdec_get(bs, 1);
+        int values, e, d;
+        unsigned short* mult;
+
+        if (lookup_type == 1) values = vorbisdec_lookup1_values(cb->entries, cb->dimensions);
+        else values = cb->entries * cb->dimensions;
+        if ((double)cb->entries * cb->dimensions > (1 << 22)) return 0;
+
+        mult = (unsigned short*)malloc(sizeof(unsigned short) * ((size_t)values + 1));
+        cb->vq = (float*)malloc(sizeof(float) * ((size_t)cb->entries * cb->dimensions + 1));
+        if (!mult || !cb->vq) {
+            free(mult);
+            return 0;
+        }
+        for (i = 0; i < values; i++) mult[i] = (unsigned short)vorbisdec_get(bs, value_bits);
+
+        for (e = 0; e < cb->entries; e++) {
+            float last = 0.0f;
+            int divisor = 1;
+            for (d = 0; d < cb->dimensions; d++) {
+                int offset = lookup_type == 1 ? (e / divisor) % values : e * cb->dimensions + d;
+                float v = mult[offset] * delta + minimum + last;
+                cb->vq[e * cb->dimensions + d] = v;
+                if (sequence) last = v;
+                if (lookup_type == 1) divisor *= values;
+            }
+        }
+        free(mult);
+    } else if (lookup_type != 0) {
+        return 0;
+    }
+    return !vorbisdec_eop(bs);
+}
+
+/* Floor type 1 */
+
+static int vorbisdec_read_floor1(vorbisdec_bits* bs, vorbisdec_floor1* f, int codebooks) {
+    int i, j, max_class = -1, rangebits;
+
+    f->partitions = (int)vorbisdec_get(bs, 5);
+    for (i = 0; i < f->partitions; i++) {
+        f->partition_class[i] = (unsigned char)vorbisdec_get(bs, 4);
+        if (f->partition_class[i] > max_class) max_class = f->partition_class[i];
+    }
+    for (i = 0; i <= max_class; i++) {
+        f->class_dims[i] = (unsigned char)(vorbisdec_get(bs, 3) + 1);
+        f->class_subclasses[i] = (unsigned char)vorbisdec_get(bs, 2);
+        if (f->class_subclasses[i]) {
+            f->class_masterbook[i] = (unsigned char)vorbisdec_get(bs, 8);
+            if (f->class_masterbook[i] >= codebooks) return 0;
+        }
+        for (j = 0; j < (1 << f->class_subclasses[i]); j++) {
+            f->subclass_books[i][j] = (short)((int)vorbisdec_get(bs, 8) - 1);
+            if (f->subclass_books[i][j] >= codebooks) return 0;
+        }
+    }
+    f->multiplier = (int)vorbisdec_get(bs, 2) + 1;
+    rangebits = (int)vorbisdec_get(bs, 4);
+    f->x[0] = 0;
+    f->x[1] = 1 << rangebits;
+    f->values = 2;
+    for (i = 0; i < f->partitions; i++) {
+        int cls = f->partition_class[i];
+        for (j = 0; j < f->class_dims[cls]; j++) {
+            if (f->values >= VORBISDEC_MAX_FLOOR1_VALUES) return 0;
+            f->x[f->values++] = (int)vorbisdec_get(bs, rangebits);
+        }
+    }
+
+    /* Sort order and neighbours depend only on the X list */
+    for (i = 0; i < f->values; i++) f->sorted[i] = (short)i;
+    for (i = 1; i < f->values; i++) {
+        short v = f->sorted[i];
+        for (j = i; j > 0 && f->x[f->sorted[j - 1]] > f->x[v]; j--) f->sorted[j] = f->sorted[j - 1];
+        f->sorted[j] = v;
+    }
+    for (i = 2; i < f->values; i++) {
+        int low = 0, high = 1, lx = -1, hx = 1 << 30;
+        for (j = 0; j < i; j++) {
+            if (f->x[j] < f->x[i] && f->x[j] > lx) {
+                lx = f->x[j];
+                low = j;
+            }
+            if (f->x[j] > f->x[i] && f->x[j] < hx) {
+                hx = f->x[j];
+                high = j;
+            }
+        }
+        f->low[i] = (short)low;
+        f->high[i] = (short)high;
+    }
+    return !vorbisdec_eop(bs);
+}
+
+static int vorbisdec_render_point(int x0, int y0, int x1, int y1, int x) {
+    int dy = y1 - y0, adx = x1 - x0, ady = dy < 0 ? -dy : dy;
+    int off = ady * (x - x0) / adx;
+    return dy < 0 ? y0 - off : y0 + off;
+}
+
+static void vorbisdec_render_line(int x0, int y0, int x1, int y1, int n, float* out) {
+    int dy = y1 - y0, adx = x1 - x0, ady = dy < 0 ? -dy : dy;
+    int base = dy / adx, sy = dy < 0 ? base - 1 : base + 1;
+    int x = x0, y = y0, err = 0;
+    ady -= (base < 0 ? -base : base) * adx;
+    if (x1 > n) x1 = n;
+    if (x < x1) out[x] = vorbisdec_inverse_db[y & 255];
+    for (x = x0 + 1; x < x1; x++) {
+        err += ady;
+        if (err >= adx) {
+            err -= adx;
+            y += sy;
+        } else {
+            y += base;
+        }
+        out[x] = vorbisdec_inverse_db[y & 255];
+    }
+}
+
+/* Decodes the floor for one channel into curve[0..n/2). Returns 0 if the channel is unused. */
+static int vorbisdec_decode_floor1(vorbisdec* dec, vorbisdec_bits* bs, const vorbisdec_floor1* f, int n2, float* curve) {
+    static const int ranges[4] = {256, 128, 86, 64};
+    int y[VORBISDEC_MAX_FLOOR1_VALUES], final_y[VORBISDEC_MAX_FLOOR1_VALUES];
+    unsigned char step2[VORBISDEC_MAX_FLOOR1_VALUES];
+    int range = ranges[f->multiplier - 1], bits = vorbisdec_ilog((unsigned)range - 1);
+    int i, j, offset = 2;
+    int lx, ly, hx, hy;
+
+    if (!vorbisdec_get(bs, 1)) return 0;
+    y[0] = (int)vorbisdec_get(bs, bits);
+    y[1] = (int)vorbisdec_get(bs, bits);
+    for (i = 0; i < f->partitions; i++) {
+        int cls = f->partition_class[i];
+        int cdim = f->class_dims[cls], cbits = f->class_subclasses[cls];
+        int csub = (1 << cbits) - 1, cval = 0;
+        if (cbits) {
+            cval = vorbisdec_decode_entry(bs, &dec->codebooks[f->class_masterbook[cls]]);
+            if (cval < 0) return 0;
+        }
+        for (j = 0; j < cdim; j++) {
+            int book = f->subclass_books[cls][cval & csub];
+            cval >>= cbits;
+            if (book >= 0) {
+                int v = vorbisdec_decode_entry(bs, &dec->codebooks[book]);
+                if (v < 0) return 0;
+                y[offset + j] = v;
+            } else {
+                y[offset + j] = 0;
+            }
+        }
+        offset += cdim;
+    }
+
+    /* Amplitude values: each point is coded relative to the line through its neighbours */
+    step2[0] = step2[1] = 1;
+    final_y[0] = y[0];
+    final_y[1] = y[1];
+    for (i = 2; i < f->values; i++) {
+        int low = f->low[i], high = f->high[i];
+        int predicted = vorbisdec_render_point(f->x[low], final_y[low], f->x[high], final_y[high], f->x[i]);
+        int val = y[i], highroom = range - predicted, lowroom = predicted;
+        int room = (highroom < lowroom ? highroom : lowroom) * 2;
+        if (val) {
+            step2[low] = step2[high] = step2[i] = 1;
+            if (val >= room) final_y[i] = highroom > lowroom ? val - lowroom + predicted : predicted - val + highroom - 1;
+            else final_y[i] = (val & 1) ? predicted - ((val + 1) >> 1) : predicted + (val >> 1);
+        } else {
+            step2[i] = 0;
+            final_y[i] = predicted;
+        }
+    }
+
+    /* Curve: line segments between the active points, in X order */
+    lx = 0;
+    ly = final_y[f->sorted[0]] * f->multiplier;
+    hx = 0;
+    hy = ly;
+    for (i = 1; i < f->values; i++) {
+        int k = f->sorted[i];
+        if (!step2[k]) continue;
+        hy = final_y[k] * f->multiplier;
+        hx = f->x[k];
+        if (lx < hx) vorbisdec_render_line(lx, ly, hx, hy, n2, curve);
+        lx = hx;
+        ly = hy;
+    }
+    for (i = hx; i < n2; i++) curve[i] = vorbisdec_inverse_db[hy & 255];
+    return 1;
+}
+
+/* Residues */
+
+static int vorbisdec_read_residue(vorbisdec_bits* bs, vorbisdec_residue* r, int codebooks) {
+    unsigned char cascade[64];
+    int i, j;
+    r->begin = (int)vorbisdec_get(bs, 24);
+    r->end = (int)vorbisdec_get(bs, 24);
+    r->partition_size = (int)vorbisdec_get(bs, 24) + 1;
+    r->classifications = (int)vorbisdec_get(bs, 6) + 1;
+    r->classbook = (int)vorbisdec_get(bs, 8);
+    if (r->classbook >= codebooks) return 0;
+    for (i = 0; i < r->classifications; i++) {
+        int low = (int)vorbisdec_get(bs, 3);
+        int high = vorbisdec_get(bs, 1) ? (int)vorbisdec_get(bs, 5) : 0;
+        cascade[i] = (unsigned char)(high * 8 + low);
+    }
+    for (i = 0; i < r->classifications; i++) {
+        for (j = 0; j < 8; j++) {
+            r->books[i][j] = (short)((cascade[i] & (1 << j)) ? (int)vorbisdec_get(bs, 8) : -1);
+            if (r->books[i][j] >= codebooks) return 0;
+        }
+    }
+    return !vorbisdec_eop(bs);
+}
+
+/* Adds one partition of VQ values into v. Format 0 interleaves a vector's
+   dimensions across the partition, formats 1 and 2 lay them out in order. */
+static int vorbisdec_decode_partition(vorbisdec_bits* bs, const vorbisdec_codebook* cb, int type, float* v, int n) {
+    int dims = cb->dimensions, i, k;
+    if (!cb->vq) return 0;
+    if (type == 0) {
+        int step = n / dims;
+        for (i = 0; i < step; i++) {
+            int e = vorbisdec_decode_entry(bs, cb);
+            if (e < 0) return 0;
+            for (k = 0; k < dims; k++) v[i + k * step] += cb->vq[e * dims + k];
+        }
+    } else {
+        for (i = 0; i < n;) {
+            int e = vorbisdec_decode_entry(bs, cb);
+            if (e < 0) return 0;
+            for (k = 0; k < dims && i < n; k++) v[i++] += cb->vq[e * dims + k];
+        }
+    }
+    return 1;
+}
+
+static void vorbisdec_decode_residue(vorbisdec* dec, vorbisdec_bits* bs, const vorbisdec_residue* r, float** vectors,
+                                     const int* do_not_decode, int count, int n2) {
+    const vorbisdec_codebook* classbook = &dec->codebooks[r->classbook];
+    int size = r->type == 2 ? n2 * count : n2;
+    int begin = r->begin < size ? r->begin : size;
+    int end = r->end < size ? r->end : size;
+    int psize = r->partition_size;
+    int partitions = (end - begin) / psize;
+    int per_word = classbook->dimensions;
+    int vecs = r->type == 2 ? 1 : count;
+    float* targets[VORBISDEC_MAX_CHANNELS];
+    int skip[VORBISDEC_MAX_CHANNELS];
+    int pass, ch, i;
+
+    if (r->type == 2) {
+        int any = 0;
+        for (ch = 0; ch < count; ch++)
+            if (!do_not_decode[ch]) any = 1;
+        if (!any) return;
+        memset(dec->interleave, 0, sizeof(float) * (size_t)size);
+        targets[0] = dec->interleave;
+        skip[0] = 0;
+    } else {
+        for (ch = 0; ch < count; ch++) {
+            targets[ch] = vectors[ch];
+            skip[ch] = do_not_decode[ch];
+        }
+    }
+
+    if (partitions > 0 && per_word > 0) {
+        for (pass = 0; pass < 8; pass++) {
+            int p = 0;
+            while (p < partitions) {
+                if (pass == 0) {
+                    for (ch = 0; ch < vecs; ch++) {
+                        int word;
+                        if (skip[ch]) continue;
+                        word = vorbisdec_decode_entry(bs, classbook);
+                        if (word < 0) goto done;
+                        for (i = per_word - 1; i >= 0; i--) {
+                            if (p + i < partitions) dec->classes[ch * partitions + p + i] = word % r->classifications;
+                            word /= r->classifications;
+                        }
+                    }
+                }
+                for (i = 0; i < per_word && p < partitions; i++, p++) {
+                    for (ch = 0; ch < vecs; ch++) {
+                        int book;
+                        if (skip[ch]) continue;
+                        book = r->books[dec->classes[ch * partitions + p]][pass];
+                        if (book < 0) continue;
+                        if (!vorbisdec_decode_partition(bs, &dec->codebooks[book], r->type, targets[ch] + begin + p * psize,
+                                                        psize))
+                            goto done;
+                    }
+                }
+            }
+        }
+    }
+done:
+    if (r->type == 2) {
+        for (ch = 0; ch < count; ch++)
+            for (i = 0; i < n2; i++) vectors[ch][i] = dec->interleave[i * count + ch];
+    }
+}
+
+/* IMDCT */
+
+static int vorbisdec_imdct_init(vorbisdec_imdct* m, int n) {
+    int h = n / 4, i, bits = 0;
+    m->n = n;
+    m->pre = (float*)malloc(sizeof(float) * 2 * (size_t)h);
+    m->post = (float*)malloc(sizeof(float) * 2 * (size_t)h);
+    m->fft = (float*)malloc(sizeof(float) * (size_t)(h > 1 ? h : 2));
+    m->bitrev = (int*)malloc(sizeof(int) * (size_t)h);
+    m->work = (float*)malloc(sizeof(float) * 2 * (size_t)h);
+    m->dct = (float*)malloc(sizeof(float) * 2 * (size_t)h);
+    if (!m->pre || !m->post || !m->fft || !m->bitrev || !m->work || !m->dct) return 0;
+
+    for (i = 0; i < h; i++) {
+        double a = -VORBISDEC_PI * (4 * i + 1) / (2.0 * n);
+        double b = -VORBISDEC_PI * i / (n / 2.0);
+        m->pre[2 * i] = (float)cos(a);
+        m->pre[2 * i + 1] = (float)sin(a);
+        m->post[2 * i] = (float)cos(b);
+        m->post[2 * i + 1] = (float)sin(b);
+    }
+    for (i = 0; i < h / 2; i++) {
+        double a = -2.0 * VORBISDEC_PI * i / h;
+        m->fft[2 * i] = (float)cos(a);
+        m->fft[2 * i + 1] = (float)sin(a);
+    }
+    while ((1 << bits) < h) bits++;
+    for (i = 0; i < h; i++) {
+        int r = 0, k;
+        for (k = 0; k < bits; k++)
+            if (i & (1 << k)) r |= 1 << (bits - 1 - k);
+        m->bitrev[i] = r;
+    }
+    return 1;
+}
+
+static void vorbisdec_imdct_free(vorbisdec_imdct* m) {
+    free(m->pre);
+    free(m->post);
+    free(m->fft);
+    free(m->bitrev);
+    free(m->work);
+    free(m->dct);
+}
+
+/* In-place radix-2 FFT over h complex values already in bit-reversed order */
+static void vorbisdec_fft(const vorbisdec_imdct* m, float* z) {
+    int h = m->n / 4, len, i, k;
+    for (len = 2; len <= h; len <<= 1) {
+        int half = len >> 1, step = h / len;
+        for (i = 0; i < h; i += len) {
+            for (k = 0; k < half; k++) {
+                float wr = m->fft[2 * k * step], wi = m->fft[2 * k * step + 1];
+                float* a = z + 2 * (i + k);
+                float* b = z + 2 * (i + k + half);
+                float tr = b[0] * wr - b[1] * wi;
+                float ti = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+}
+
+/* y[0..n) = sum_k x[k] cos(2pi/n (i + 1/2 + n/4)(k + 1/2)), x has n/2 values */
+static void vorbisdec_imdct_run(const vorbisdec_imdct* m, const float* x, float* y) {
+    int n = m->n, half = n / 2, h = n / 4, i;
+    float* z = m->work;
+    float* u = m->dct;
+
+    for (i = 0; i < h; i++) {
+        float re = x[2 * i], im = x[half - 1 - 2 * i];
+        float wr = m->pre[2 * i], wi = m->pre[2 * i + 1];
+        int j = m->bitrev[i];
+        z[2 * j] = re * wr - im * wi;
+        z[2 * j + 1] = re * wi + im * wr;
+    }
+    vorbisdec_fft(m, z);
+    for (i = 0; i < h; i++) {
+        float re = z[2 * i], im = z[2 * i + 1];
+        float wr = m->post[2 * i], wi = m->post[2 * i + 1];
+        u[2 * i] = re * wr - im * wi;
+        u[half - 1 - 2 * i] = -(re * wi + im * wr);
+    }
+
+    /* Unfold the n/2-point DCT-IV into the n outputs using its odd symmetries */
+    for (i = 0; i < h; i++) y[i] = u[i + h];
+    for (i = h; i < 3 * h; i++) y[i] = -u[3 * h - 1 - i];
+    for (i = 3 * h; i < n; i++) y[i] = -u[i - 3 * h];
+}
+
+/* Setup and packets */
+
+vorbisdec* vorbisdec_create(void) { return (vorbisdec*)calloc(1, sizeof(vorbisdec)); }
+
+void vorbisdec_destroy(vorbisdec* dec) {
+    int i;
+    if (!dec) return;
+    for (i = 0; i < dec->codebook_count; i++) {
+        free(dec->codebooks[i].lengths);
+        free(dec->codebooks[i].sorted_codes);
+        free(dec->codebooks[i].sorted_entries);
+        free(dec->codebooks[i].vq);
+    }
+    free(dec->codebooks);
+    free(dec->floors);
+    free(dec->residues);
+    free(dec->mappings);
+    for (i = 0; i < 2; i++) {
+        free(dec->slope[i]);
+        vorbisdec_imdct_free(&dec->imdct[i]);
+    }
+    for (i = 0; i < dec->channels; i++) {
+        free(dec->spectrum[i]);
+        free(dec->block[i]);
+        free(dec->overlap[i]);
+    }
+    free(dec->interleave);
+    free(dec->classes);
+    free(dec);
+}
+
+static int vorbisdec_read_setup(vorbisdec* dec, vorbisdec_bits* bs) {
+    int i, j, ch;
+
+    dec->codebook_count = (int)vorbisdec_get(bs, 8) + 1;
+    dec->codebooks = (vorbisdec_codebook*)calloc((size_t)dec->codebook_count, sizeof(vorbisdec_codebook));
+    if (!dec->codebooks) return 0;
+    for (i = 0; i < dec->codebook_count; i++)
+        if (!vorbisdec_read_codebook(bs, &dec->codebooks[i])) return 0;
+
+    /* Time domain transforms: placeholders, must be zero */
+    j = (int)vorbisdec_get(bs, 6) + 1;
+    for (i = 0; i < j; i++)
+        if (vorbisdec_get(bs, 16) != 0) return 0;
+
+    dec->floor_count = (int)vorbisdec_get(bs, 6) + 1;
+    dec->floors = (vorbisdec_floor1*)calloc((size_t)dec->floor_count, sizeof(vorbisdec_floor1));
+    if (!dec->floors) return 0;
+    for (i = 0; i < dec->floor_count; i++) {
+        if (vorbisdec_get(bs, 16) != 1) return 0; /* floor 0 */
+        if (!vorbisdec_read_floor1(bs, &dec->floors[i], dec->codebook_count)) return 0;
+    }
+
+    dec->residue_count = (int)vorbisdec_get(bs, 6) + 1;
+    dec->residues = (vorbisdec_residue*)calloc((size_t)dec->residue_count, sizeof(vorbisdec_residue));
+    if (!dec->residues) return 0;
+    for (i = 0; i < dec->residue_count; i++) {
+        dec->residues[i].type = (int)vorbisdec_get(bs, 16);
+        if (dec->residues[i].type > 2) return 0;
+        if (!vorbisdec_read_residue(bs, &dec->residues[i], dec->codebook_count)) return 0;
+    }
+
+    dec->mapping_count = (int)vorbisdec_get(bs, 6) + 1;
+    dec->mappings = (vorbisdec_mapping*)calloc((size_t)dec->mapping_count, sizeof(vorbisdec_mapping));
+    if (!dec->mappings) return 0;
+    for (i = 0; i < dec->mapping_count; i++) {
+        vorbisdec_mapping* m = &dec->mappings[i];
+        int chbits = vorbisdec_ilog((unsigned)dec->channels - 1);
+        if (vorbisdec_get(bs, 16) != 0) return 0;
+        m->submaps = vorbisdec_get(bs, 1) ? (int)vorbisdec_get(bs, 4) + 1 : 1;
+        if (vorbisdec_get(bs, 1)) {
+            m->coupling_steps = (int)vorbisdec_get(bs, 8) + 1;
+            for (j = 0; j < m->coupling_steps; j++) {
+                m->magnitude[j] = (unsigned char)vorbisdec_get(bs, chbits);
+                m->angle[j] = (unsigned char)vorbisdec_get(bs, chbits);
+                if (m->magnitude[j] == m->angle[j] || m->magnitude[j] >= dec->channels || m->angle[j] >= dec->channels)
+                    return 0;
+            }
+        }
+        if (vorbisdec_get(bs, 2) != 0) return 0;
+        for (ch = 0; ch < dec->channels; ch++) {
+            m->mux[ch] = m->submaps > 1 ? (unsigned char)vorbisdec_get(bs, 4) : 0;
+            if (m->mux[ch] >= m->submaps) return 0;
+        }
+        for (j = 0; j < m->submaps; j++) {
+            vorbisdec_get(bs, 8);
+            m->submap_floor[j] = (unsigned char)vorbisdec_get(bs, 8);
+            m->submap_residue[j] = (unsigned char)vorbisdec_get(bs, 8);
+            if (m->submap_floor[j] >= dec->floor_count || m->submap_residue[j] >= dec->residue_count) return 0;
+        }
+    }
+
+    dec->mode_count = (int)vorbisdec_get(bs, 6) + 1;
+    for (i = 0; i < dec->mode_count; i++) {
+        dec->modes[i].blockflag = (int)vorbisdec_get(bs, 1);
+        if (vorbisdec_get(bs, 16) != 0 || vorbisdec_get(bs, 16) != 0) return 0;
+        dec->modes[i].mapping = (int)vorbisdec_get(bs, 8);
+        if (dec->modes[i].mapping >= dec->mapping_count) return 0;
+    }
+    if (!vorbisdec_get(bs, 1) || vorbisdec_eop(bs)) return 0;
+
+    /* Working buffers */
+    {
+        int n = dec->blocksize[1], max_partitions = 0, k;
+        for (i = 0; i < 2; i++) {
+            int half = dec->blocksize[i] / 2;
+            dec->slope[i] = (float*)malloc(sizeof(float) * (size_t)half);
+            if (!dec->slope[i] || !vorbisdec_imdct_init(&dec->imdct[i], dec->blocksize[i])) return 0;
+            for (k = 0; k < half; k++) {
+                double s = sin((k + 0.5) / half * VORBISDEC_PI / 2);
+                dec->slope[i][k] = (float)sin(VORBISDEC_PI / 2 * s * s);
+            }
+        }
+        for (ch = 0; ch < dec->channels; ch++) {
+            dec->spectrum[ch] = (float*)malloc(sizeof(float) * (size_t)n / 2);
+            dec->block[ch] = (float*)malloc(sizeof(float) * (size_t)n);
+            dec->overlap[ch] = (float*)calloc((size_t)n / 2, sizeof(float));
+            if (!dec->spectrum[ch] || !dec->block[ch] || !dec->overlap[ch]) return 0;
+        }
+        for (i = 0; i < dec->residue_count; i++) {
+            const vorbisdec_residue* r = &dec->residues[i];
+            int size = r->type == 2 ? n / 2 * dec->channels : n / 2;
+            int end = r->end < size ? r->end : size;
+            int begin = r->begin < end ? r->begin : end;
+            int p = (end - begin) / r->partition_size + 8;
+            if (p > max_partitions) max_partitions = p;
+        }
+        dec->interleave = (float*)malloc(sizeof(float) * (size_t)n / 2 * (size_t)dec->channels);
+        dec->classes = (int*)malloc(sizeof(int) * (size_t)max_partitions * (size_t)dec->channels);
+        if (!dec->interleave || !dec->classes) return 0;
+    }
+    return 1;
+}
+
+int vorbisdec_header(vorbisdec* dec, const unsigned char* packet, int bytes) {
+    vorbisdec_bits bs;
+    int type;
+    if (bytes < 7 || memcmp(packet + 1, "vorbis", 6) != 0) return 0;
+    type = packet[0];
+    bs.data = packet + 7;
+    bs.bytes = bytes - 7;
+    bs.pos = 0;
+
+    if (dec->headers == 0 && type == 1) {
+        unsigned bs0, bs1;
+        if (vorbisdec_get(&bs, 32) != 0) return 0;
+        dec->channels = (int)vorbisdec_get(&bs, 8);
+        dec->sample_rate = (int)vorbisdec_get(&bs, 32);
+        vorbisdec_get(&bs, 32);
+        vorbisdec_get(&bs, 32);
+        vorbisdec_get(&bs, 32);
+        bs0 = vorbisdec_get(&bs, 4);
+        bs1 = vorbisdec_get(&bs, 4);
+        if (!vorbisdec_get(&bs, 1) || vorbisdec_eop(&bs)) return 0;
+        if (dec->channels == 0 || dec->sample_rate == 0 || bs0 < 6 || bs1 > 13 || bs0 > bs1) return 0;
+        dec->blocksize[0] = 1 << bs0;
+        dec->blocksize[1] = 1 << bs1;
+        dec->headers = 1;
+        return 1;
+    }
+    if (dec->headers == 1 && type == 3) {
+        dec->headers = 2;
+        return 1;
+    }
+    if (dec->headers == 2 && type == 5) {
+        if (!vorbisdec_read_setup(dec, &bs)) return 0;
+        dec->headers = 3;
+        return 1;
+    }
+    return 0;
+}
+
+int vorbisdec_ready(const vorbisdec* dec) { return dec->headers == 3; }
+int vorbisdec_channels(const vorbisdec* dec) { return dec->channels; }
+int vorbisdec_sample_rate(const vorbisdec* dec) { return dec->sample_rate; }
+int vorbisdec_max_frames(const vorbisdec* dec) { return dec->blocksize[1] / 2; }
+
+void vorbisdec_reset(vorbisdec* dec) { dec->prev_n = 0; }
+
+int vorbisdec_packet_blocksize(const vorbisdec* dec, const unsigned char* packet, int bytes) {
+    vorbisdec_bits bs;
+    int mode;
+    if (dec->headers != 3 || bytes < 1) return 0;
+    bs.data = packet;
+    bs.bytes = bytes;
+    bs.pos = 0;
+    if (vorbisdec_get(&bs, 1) != 0) return 0;
+    mode = (int)vorbisdec_get(&bs, vorbisdec_ilog((unsigned)dec->mode_count - 1));
+    if (mode >= dec->mode_count) return 0;
+    return dec->blocksize[dec->modes[mode].blockflag];
+}
+
+int vorbisdec_decode(vorbisdec* dec, const unsigned char* packet, int bytes, float* pcm) {
+    vorbisdec_bits bs;
+    const vorbisdec_mapping* map;
+    int mode, blockflag, n, n2, prev_flag = 0, next_flag = 0;
+    int used[VORBISDEC_MAX_CHANNELS];
+    int ch, i, s, frames, prev_n;
+    int left_start, left_n, right_start, right_n;
+    const int nch = dec->channels;
+
+    if (dec->headers != 3 || bytes < 1) return 0;
+    bs.data = packet;
+    bs.bytes = bytes;
+    bs.pos = 0;
+    if (vorbisdec_get(&bs, 1) != 0) return 0;
+    mode = (int)vorbisdec_get(&bs, vorbisdec_ilog((unsigned)dec->mode_count - 1));
+    if (mode >= dec->mode_count) return 0;
+    blockflag = dec->modes[mode].blockflag;
+    map = &dec->mappings[dec->modes[mode].mapping];
+    n = dec->blocksize[blockflag];
+    n2 = n / 2;
+    if (blockflag) {
+        prev_flag = (int)vorbisdec_get(&bs, 1);
+        next_flag = (int)vorbisdec_get(&bs, 1);
+    }
+
+    /* Floors first: a channel with no floor has no residue either, unless coupling needs it */
+    for (ch = 0; ch < nch; ch++) {
+        const vorbisdec_floor1* f = &dec->floors[map->submap_floor[map->mux[ch]]];
+        used[ch] = vorbisdec_decode_floor1(dec, &bs, f, n2, dec->block[ch]);
+        memset(dec->spectrum[ch], 0, sizeof(float) * (size_t)n2);
+    }
+    for (i = 0; i < map->coupling_steps; i++) {
+        if (used[map->magnitude[i]] || used[map->angle[i]]) {
+            used[map->magnitude[i]] |= 2;
+            used[map->angle[i]] |= 2;
+        }
+    }
+
+    for (s = 0; s < map->submaps; s++) {
+        float* vectors[VORBISDEC_MAX_CHANNELS];
+        int skip[VORBISDEC_MAX_CHANNELS];
+        int count = 0;
+        for (ch = 0; ch < nch; ch++) {
+            if (map->mux[ch] != s) continue;
+            vectors[count] = dec->spectrum[ch];
+            skip[count] = !used[ch];
+            count++;
+        }
+        vorbisdec_decode_residue(dec, &bs, &dec->residues[map->submap_residue[s]], vectors, skip, count, n2);
+    }
+
+    for (i = map->coupling_steps - 1; i >= 0; i--) {
+        float* m = dec->spectrum[map->magnitude[i]];
+        float* a = dec->spectrum[map->angle[i]];
+        int k;
+        for (k = 0; k < n2; k++) {
+            float mv = m[k], av = a[k];
+            if (mv > 0) {
+                if (av > 0) a[k] = mv - av;
+                else {
+                    a[k] = mv;
+                    m[k] = mv + av;
+                }
+            } else {
+                if (av > 0) a[k] = mv + av;
+                else {
+                    a[k] = mv;
+                    m[k] = mv - av;
+                }
+            }
+        }
+    }
+
+    /* Window geometry: a long block next to a short one overlaps over the short length only */
+    if (blockflag && !prev_flag) {
+        left_start = n / 4 - dec->blocksize[0] / 4;
+        left_n = dec->blocksize[0] / 2;
+    } else {
+        left_start = 0;
+        left_n = n2;
+    }
+    if (blockflag && !next_flag) {
+        right_start = n * 3 / 4 - dec->blocksize[0] / 4;
+        right_n = dec->blocksize[0] / 2;
+    } else {
+        right_start = n2;
+        right_n = n2;
+    }
+
+    for (ch = 0; ch < nch; ch++) {
+        float* spec = dec->spectrum[ch];
+        float* out = dec->block[ch];
+        const float* ls = dec->slope[left_n == n2 ? blockflag : 0];
+        const float* rs = ls;
+        if (used[ch] & 1) {
+            /* The floor curve was rendered into block[] */
+            for (i = 0; i < n2; i++) spec[i] *= out[i];
+        } else {
+            memset(spec, 0, sizeof(float) * (size_t)n2);
+        }
+        vorbisdec_imdct_run(&dec->imdct[blockflag], spec, out);
+
+        rs = dec->slope[right_n == n2 ? blockflag : 0];
+        for (i = 0; i < left_start; i++) out[i] = 0.0f;
+        for (i = 0; i < left_n; i++) out[left_start + i] *= ls[i];
+        for (i = 0; i < right_n; i++) out[right_start + i] *= rs[right_n - 1 - i];
+        for (i = right_start + right_n; i < n; i++) out[i] = 0.0f;
+    }
+
+    /* Overlap-add from the previous block's centre to this block's centre */
+    prev_n = dec->prev_n;
+    frames = prev_n ? prev_n / 4 + n / 4 : 0;
+    for (ch = 0; ch < nch; ch++) {
+        const float* cur = dec->block[ch];
+        float* ov = dec->overlap[ch];
+        int offset = n / 4 - prev_n / 4; /* index into cur of the first output frame */
+        for (i = 0; i < frames; i++) {
+            int c = offset + i;
+            float v = i < prev_n / 2 ? ov[i] : 0.0f;
+            if (c >= 0 && c < n) v += cur[c];
+            pcm[i * nch + ch] = v;
+        }
+        memcpy(ov, cur + n2, sizeof(float) * (size_t)n2);
+    }
+    dec->prev_n = n;
+    return frames;
+}
+
+#endif /* VORBISDEC_IMPLEMENTATION */
@@ -0,0 +1,301 @@
+#include "waveform.h"
+
+#include "decoder.h"
+#include "util/cache_dir.h"
+#include "util/mapped_file.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+static const char kCacheMagic[4] = {'W', 'A', 'V', 'P'};
+static const uint32_t kCacheVersion = 1;
+static const size_t kDecodeBlockFrames = 4096;
+// Levels stop merging once they are this small
+static const size_t kTopLevelPeaks = 32;
+// Shorter stretches aren't worth a thread (and a decoder) of their own
+static const int kMinSegmentSeconds = 30;
+static const unsigned kMaxThreads = 16;
+
+// Only level 0 is stored; the rest is rebuilt on load
+struct WaveformFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t fileSize;
+    int64_t mtime;
+    int64_t frames;
+    uint32_t sampleRate;
+    uint32_t baseFrames;
+    uint64_t count;
+};
+
+static WaveformPeak Quantize(float min, float max, double sumSquares, size_t samples) {
+    WaveformPeak peak;
+    peak.min = (int8_t)std::lrint(std::min(std::max(min, -1.0f), 1.0f) * 127.0f);
+    peak.max = (int8_t)std::lrint(std::min(std::max(max, -1.0f), 1.0f) * 127.0f);
+    const double rms = samples ? std::sqrt(sumSquares / (double)samples) : 0.0;
+    peak.rms = (uint8_t)std::lrint(std::min(rms, 1.0) * 255.0);
+    return peak;
+}
+
+// Level-0 peaks of frames [start, end) of `decoder` (to the end of the
+// stream if `end` is negative). `start` is a multiple of kBaseFrames.
+static bool DecodePeaks(Decoder& decoder, int64_t start, int64_t end, const std::atomic<bool>* cancel,
+                        std::vector<WaveformPeak>& out, int64_t* decoded) {
+    const int channels = decoder.Format().channels;
+    if (channels <= 0 || (start > 0 && !decoder.Seek(start))) return false;
+    std::vector<float> block(kDecodeBlockFrames * channels);
+    float min = 0.0f, max = 0.0f;
+    double sumSquares = 0.0;
+    size_t inPeak = 0; // frames
+    int64_t position = start;
+    while (end < 0 || position < end) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) return false;
+        size_t want = kDecodeBlockFrames;
+        if (end >= 0) want = (size_t)std::min<int64_t>((int64_t)want, end - position);
+        const size_t got = decoder.Read(block.data(), want);
+        if (got == 0) break;
+        position += (int64_t)got;
+
+        for (size_t i = 0; i < got;) {
+            const size_t n = std::min(got - i, (size_t)Waveform::kBaseFrames - inPeak);
+            const float* s = block.data() + i * channels;
+            float lo = inPeak ? min : s[0], hi = inPeak ? max : s[0];
+            float squares = 0.0f;
+            for (size_t j = 0; j < n * channels; j++) {
+                lo = std::min(lo, s[j]);
+                hi = std::max(hi, s[j]);
+                squares += s[j] * s[j];
+            }
+            min = lo;
+            max = hi;
+            sumSquares += squares;
+            inPeak += n;
+            i += n;
+            if (inPeak == (size_t)Waveform::kBaseFrames) {
+                out.push_back(Quantize(min, max, sumSquares, inPeak * channels));
+                inPeak = 0;
+                sumSquares = 0.0;
+            }
+        }
+    }
+    if (inPeak > 0) out.push_back(Quantize(min, max, sumSquares, inPeak * channels));
+    *decoded = position - start;
+    return true;
+}
+
+std::unique_ptr<Waveform> Waveform::Compute(const std::string& path, const std::atomic<bool>* cancel) {
+    // Seek indexes are left for the player to cache: these decoders only use them
+    std::unique_ptr<Decoder> decoder = OpenDecoder(path, false);
+    if (!decoder) return nullptr;
+    const AudioFormat format = decoder->Format();
+    const int64_t total = decoder->TotalFrames();
+
+    // Stretches of whole peaks, one per thread; the last one runs to the end
+    // of the stream, whatever the length claimed
+    size_t segments = 1;
+    if (total > 0) {
+        const unsigned cores = std::min(kMaxThreads, std::max(1u, std::thread::hardware_concurrency()));
+        const int64_t minFrames = (int64_t)format.sampleRate * kMinSegmentSeconds;
+        segments = (size_t)std::max<int64_t>(1, std::min<int64_t>(cores, total / std::max<int64_t>(minFrames, 1)));
+    }
+    const int64_t peaks = total > 0 ? (total + kBaseFrames - 1) / kBaseFrames : 0;
+    const int64_t peaksPerSegment = (peaks + (int64_t)segments - 1) / (int64_t)segments;
+
+    std::vector<std::vector<WaveformPeak>> parts(segments);
+    std::vector<int64_t> decoded(segments, 0);
+    std::vector<char> ok(segments, 0);
+    const auto run = [&](size_t segment, Decoder* own) {
+        std::unique_ptr<Decoder> opened;
+        if (!own) {
+            opened = OpenDecoder(path, false);
+            own = opened.get();
+        }
+        const int64_t start = (int64_t)segment * peaksPerSegment * kBaseFrames;
+        const int64_t end = segment + 1 < segments ? start + peaksPerSegment * kBaseFrames : -1;
+        ok[segment] = own && DecodePeaks(*own, start, end, cancel, parts[segment], &decoded[segment]);
+    };
+    std::vector<std::thread> threads;
+    for (size_t segment = 1; segment < segments; segment++) threads.emplace_back(run, segment, nullptr);
+    run(0, decoder.get());
+    for (std::thread& thread : threads) thread.join();
+    if (cancel && cancel->load(std::memory_order_relaxed)) return nullptr;
+
+    if (std::find(ok.begin(), ok.end(), 0) != ok.end()) {
+        // A decoder that can't seek after all: once more, front to back
+        if (segments == 1 || !(decoder = OpenDecoder(path, false))) return nullptr;
+        parts.assign(1, {});
+        decoded.assign(1, 0);
+        if (!DecodePeaks(*decoder, 0, -1, cancel, parts[0], &decoded[0])) return nullptr;
+    }
+
+    auto waveform = std::make_unique<Waveform>();
+    waveform->sampleRate_ = format.sampleRate;
+    for (size_t i = 0; i < parts.size(); i++) {
+        waveform->peaks_.insert(waveform->peaks_.end(), parts[i].begin(), parts[i].end());
+        waveform->frames_ += decoded[i];
+    }
+    if (waveform->peaks_.empty()) return nullptr;
+    waveform->BuildLevels();
+    return waveform;
+}
+
+void Waveform::BuildLevels() {
+    levelStart_.assign(1, 0);
+    levelStart_.push_back(peaks_.size());
+    while (LevelSize(Levels() - 1) > kTopLevelPeaks) {
+        const size_t below = levelStart_[Levels() - 1];
+        const size_t count = LevelSize(Levels() - 1);
+        for (size_t i = 0; i < count; i += 2) {
+            WaveformPeak a = peaks_[below + i];
+            if (i + 1 < count) {
+                const WaveformPeak b = peaks_[below + i + 1];
+                a.min = std::min(a.min, b.min);
+                a.max = std::max(a.max, b.max);
+                a.rms = (uint8_t)std::lrint(std::sqrt(((double)a.rms * a.rms + (double)b.rms * b.rms) / 2.0));
+            }
+            peaks_.push_back(a);
+        }
+        levelStart_.push_back(peaks_.size());
+    }
+}
+
+void Waveform::Columns(int columns, std::vector<WaveformPeak>& out) const {
+    out.assign(columns > 0 ? (size_t)columns : 0, WaveformPeak());
+    if (out.empty()) return;
+    // The coarsest level with a peak per column: at most two peaks per column
+    size_t level = 0;
+    while (level + 1 < Levels() && LevelSize(level + 1) >= out.size()) level++;
+    const WaveformPeak* peaks = Level(level);
+    const size_t count = LevelSize(level);
+    for (size_t c = 0; c < out.size(); c++) {
+        const size_t first = c * count / out.size();
+        const size_t last = std::max(first + 1, (c + 1) * count / out.size());
+        WaveformPeak column = peaks[first];
+        double squares = 0.0;
+        for (size_t i = first; i < last; i++) {
+            column.min = std::min(column.min, peaks[i].min);
+            column.max = std::max(column.max, peaks[i].max);
+            squares += (double)peaks[i].rms * peaks[i].rms;
+        }
+        column.rms = (uint8_t)std::lrint(std::sqrt(squares / (double)(last - first)));
+        out[c] = column;
+    }
+}
+
+std::unique_ptr<Waveform> Waveform::Load(const std::string& path) {
+    const std::string cachePath = CachePathFor("waveform", path, ".peaks");
+    FileStamp stamp;
+    if (cachePath.empty() || !GetFileStamp(path, &stamp)) return nullptr;
+
+    MappedFile cache;
+    if (!cache.Open(cachePath) || cache.Size() < sizeof(WaveformFileHeader)) return nullptr;
+    WaveformFileHeader header;
+    memcpy(&header, cache.Data(), sizeof(header));
+    if (memcmp(header.magic, kCacheMagic, 4) != 0 || header.version != kCacheVersion ||
+        header.fileSize != stamp.size || header.mtime != stamp.mtime || header.baseFrames != (uint32_t)kBaseFrames ||
+        header.count == 0 || cache.Size() != sizeof(header) + header.count * sizeof(WaveformPeak))
+        return nullptr;
+
+    auto waveform = std::make_unique<Waveform>();
+    waveform->sampleRate_ = (int)header.sampleRate;
+    waveform->frames_ = header.frames;
+    waveform->peaks_.resize(header.count);
+    memcpy(waveform->peaks_.data(), cache.Data() + sizeof(header), header.count * sizeof(WaveformPeak));
+    waveform->BuildLevels();
+    return waveform;
+}
+
+bool Waveform::Save(const std::string& path) const {
+    const std::string cachePath = CachePathFor("waveform", path, ".peaks");
+    FileStamp stamp;
+    if (cachePath.empty() || !GetFileStamp(path, &stamp)) return false;
+
+    WaveformFileHeader header;
+    memcpy(header.magic, kCacheMagic, 4);
+    header.version = kCacheVersion;
+    header.fileSize = stamp.size;
+    header.mtime = stamp.mtime;
+    header.frames = frames_;
+    header.sampleRate = (uint32_t)sampleRate_;
+    header.baseFrames = kBaseFrames;
+    header.count = LevelSize(0);
+
+    std::vector<uint8_t> blob(sizeof(header) + LevelSize(0) * sizeof(WaveformPeak));
+    memcpy(blob.data(), &header, sizeof(header));
+    memcpy(blob.data() + sizeof(header), Level(0), LevelSize(0) * sizeof(WaveformPeak));
+    if (!WriteFileAtomic(cachePath, blob.data(), blob.size())) {
+        std::cerr << "Failed to write waveform cache: " << cachePath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+WaveformLoader::~WaveformLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        cancel_.store(true);
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+const Waveform* WaveformLoader::Get(const std::string& path) {
+    if (path != path_) {
+        path_ = path;
+        waveform_.reset();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            wanted_ = path;
+            request_++;
+            cancel_.store(true);
+        }
+        if (!thread_.joinable()) thread_ = std::thread(&WaveformLoader::WorkerMain, this);
+        wake_.notify_one();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (doneReady_ && doneRequest_ == request_) {
+        waveform_ = std::move(done_);
+        doneReady_ = false;
+    }
+    return waveform_.get();
+}
+
+bool WaveformLoader::Loading() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return working_;
+}
+
+void WaveformLoader::WorkerMain() {
+    // Requests, not paths: A -> B -> A while A is being made cancels the
+    // first A, and the second one has to start over
+    uint64_t handled = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [&] { return stop_ || request_ != handled; });
+        if (stop_) return;
+        const std::string path = wanted_;
+        const uint64_t request = request_;
+        handled = request;
+        if (path.empty()) continue;
+        cancel_.store(false);
+        working_ = true;
+        lock.unlock();
+
+        std::unique_ptr<Waveform> waveform = Waveform::Load(path);
+        if (!waveform) {
+            waveform = Waveform::Compute(path, &cancel_);
+            if (waveform) waveform->Save(path);
+        }
+
+        lock.lock();
+        working_ = false;
+        if (waveform && request_ == request) {
+            done_ = std::move(waveform);
+            doneRequest_ = request;
+            doneReady_ = true;
+        }
+    }
+}
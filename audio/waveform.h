@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loudness of a stretch of audio, all channels together, quantized to a byte
+// each: min and max sample (-127..127 for -1..1) and RMS (0..255 for 0..1).
+struct WaveformPeak {
+    int8_t min = 0;
+    int8_t max = 0;
+    uint8_t rms = 0;
+};
+
+// Overview of a whole track for the progress bar, as a pyramid: level 0 has a
+// peak per kBaseFrames frames, each level above merges pairs of the one below,
+// up to a few dozen peaks. Drawing picks the coarsest level that still has a
+// peak per pixel, so it costs O(width) however long the track is.
+class Waveform {
+public:
+    static const int kBaseFrames = 1024;
+
+    // Decodes the whole file, on all cores when the format can seek: every
+    // thread opens the file itself and takes a stretch of it. `cancel` is
+    // checked between blocks. nullptr if the file can't be decoded or `cancel`
+    // was set.
+    static std::unique_ptr<Waveform> Compute(const std::string& path, const std::atomic<bool>* cancel);
+    // From the cache, if there is an entry for this version of the file
+    static std::unique_ptr<Waveform> Load(const std::string& path);
+    bool Save(const std::string& path) const;
+
+    int SampleRate() const { return sampleRate_; }
+    int64_t Frames() const { return frames_; }
+    size_t Levels() const { return levelStart_.size() - 1; }
+    size_t LevelSize(size_t level) const { return levelStart_[level + 1] - levelStart_[level]; }
+    const WaveformPeak* Level(size_t level) const { return peaks_.data() + levelStart_[level]; }
+
+    // `columns` peaks spanning the whole track, into `out`
+    void Columns(int columns, std::vector<WaveformPeak>& out) const;
+
+private:
+    // Builds the levels above level 0, which is all of peaks_ on entry
+    void BuildLevels();
+
+    int sampleRate_ = 0;
+    int64_t frames_ = 0;
+    std::vector<WaveformPeak> peaks_;   // every level, finest first
+    std::vector<size_t> levelStart_;    // levelStart_[i]..levelStart_[i + 1] is level i
+};
+
+// Keeps the overview of one track (the one playing) at hand: loaded from the
+// cache or computed on a thread of its own, then saved for next time. Asking
+// for another track abandons work on the previous one.
+class WaveformLoader {
+public:
+    WaveformLoader() = default;
+    ~WaveformLoader();
+
+    WaveformLoader(const WaveformLoader&) = delete;
+    WaveformLoader& operator=(const WaveformLoader&) = delete;
+
+    // Call every frame with the track to show, or an empty path for none.
+    // Returns its overview, or nullptr while it is being made or if it can't be.
+    const Waveform* Get(const std::string& path);
+    bool Loading() const;
+
+private:
+    void WorkerMain();
+
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::string wanted_;
+    uint64_t request_ = 0;      // bumped on every change of wanted_
+    bool working_ = false;
+    std::atomic<bool> cancel_{false};
+    uint64_t doneRequest_ = 0;  // the request done_ answers
+    std::unique_ptr<Waveform> done_;
+    bool doneReady_ = false;
+
+    // UI only
+    std::string path_;
+    std::unique_ptr<Waveform> waveform_;
+};
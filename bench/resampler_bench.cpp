@@ -0,0 +1,85 @@
+// Realtime factor of the resampler on one core: seconds of audio converted per
+// second of CPU, for every quality preset and the usual rate pairs.
+//
+//   resampler_bench [seconds of audio per run, default 30]
+
+#include "audio/resampler.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static const size_t kBlockFrames = 1024;
+static const int kChannels = 2;
+
+struct RatePair {
+    int in;
+    int out;
+};
+
+static const RatePair kRates[] = {
+    {44100, 48000},
+    {48000, 44100},
+    {96000, 48000},
+    {96000, 44100},
+    {44100, 96000},
+};
+
+static double Measure(const RatePair& rates, ResamplerQuality quality, double seconds, Resampler* resampler) {
+    resampler->Configure(rates.in, rates.out, kChannels, quality);
+
+    // A second of noise, fed in decoder-sized blocks over and over
+    std::vector<float> input((size_t)rates.in * kChannels);
+    uint32_t seed = 1;
+    for (float& s : input) {
+        seed = seed * 1664525u + 1013904223u;
+        s = (float)(int32_t)seed / 2147483648.0f;
+    }
+    std::vector<float> output((kBlockFrames * rates.out / rates.in + 2) * kChannels);
+
+    const int64_t total = (int64_t)(seconds * rates.in);
+    const size_t inputFrames = (size_t)rates.in;
+    int64_t fed = 0;
+    size_t pos = 0;
+    float sink = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    while (fed < total) {
+        size_t n = std::min(kBlockFrames, inputFrames - pos);
+        size_t consumed = 0;
+        size_t produced;
+        do {
+            produced = resampler->Process(input.data() + pos * kChannels, n, &consumed, output.data(),
+                                          output.size() / kChannels);
+            if (produced > 0) sink += output[0];
+        } while (consumed == 0 && produced > 0);
+        pos = (pos + consumed) % inputFrames;
+        fed += (int64_t)consumed;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (sink == 12345.0f) printf(" ");  // keep the work observable
+    return seconds / elapsed;
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 30.0;
+    if (seconds <= 0.0) seconds = 30.0;
+
+    Resampler resampler;
+    resampler.Configure(44100, 48000, kChannels, ResamplerQuality::Low);
+    printf("kernel: %s, %d channels, %.0f s of audio per run\n\n", resampler.KernelName(), kChannels, seconds);
+    printf("%-8s %-14s %6s %7s %12s\n", "quality", "rates", "taps", "phases", "realtime x");
+
+    for (int q = 0; q < 4; q++) {
+        ResamplerQuality quality = (ResamplerQuality)q;
+        for (const RatePair& rates : kRates) {
+            double factor = Measure(rates, quality, seconds, &resampler);
+            char name[32];
+            snprintf(name, sizeof(name), "%d->%d", rates.in, rates.out);
+            printf("%-8s %-14s %6d %7d %12.0f\n", ResamplerQualityName(quality), name, resampler.Taps(),
+                   resampler.Phases(), factor);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+// Cost of shrinking a cover to thumbnail size, as the texture loader does
+// for every cover not yet in the thumbnail pack.
+//
+//   resize_bench [source size, default 3000] [thumbnail size, default 256]
+
+#include "gfx/image_resize.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static const int kRuns = 20;
+
+int main(int argc, char** argv) {
+    int size = argc > 1 ? atoi(argv[1]) : 3000;
+    int thumbnail = argc > 2 ? atoi(argv[2]) : 256;
+    if (size <= 0) size = 3000;
+    if (thumbnail <= 0) thumbnail = 256;
+
+    // Noise, so nothing about the content helps
+    std::vector<uint8_t> source((size_t)size * size * 4);
+    uint32_t seed = 1;
+    for (uint8_t& byte : source) {
+        seed = seed * 1664525u + 1013904223u;
+        byte = (uint8_t)(seed >> 24);
+    }
+    std::vector<uint8_t> out((size_t)thumbnail * thumbnail * 4);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < kRuns; run++) ResizeRgba(source.data(), size, size, out.data(), thumbnail, thumbnail);
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("kernel: %s, %dx%d to %dx%d\n", ResizeKernelName(), size, size, thumbnail, thumbnail);
+    printf("%.2f ms per image, %.2f ns per source pixel\n", elapsed / kRuns,
+           elapsed * 1e6 / kRuns / ((double)size * size));
+    unsigned sum = 0;
+    for (uint8_t byte : out) sum += byte;
+    printf("mean %.1f (noise averages to ~127.5)\n", (double)sum / out.size());
+    return 0;
+}
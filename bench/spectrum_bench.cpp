@@ -0,0 +1,55 @@
+// Cost of one spectrum update as the UI runs it every frame: a window read
+// out of the playback tap, the FFT and the binning into bars.
+//
+//   spectrum_bench [window size, default 4096] [bars, default 50]
+
+#include "audio/audio_tap.h"
+#include "audio/spectrum.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static const int kSampleRate = 48000;
+static const int kChannels = 2;
+static const int kRuns = 2000;
+
+int main(int argc, char** argv) {
+    size_t size = argc > 1 ? (size_t)atol(argv[1]) : 4096;
+    int bars = argc > 2 ? atoi(argv[2]) : 50;
+    if (size < 16 || (size & (size - 1)) != 0) size = 4096;
+    if (bars <= 0) bars = 50;
+
+    // A second of a 1 kHz tone over noise, through the tap as the callback would
+    AudioTap tap;
+    std::vector<float> block(kSampleRate * kChannels);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < block.size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        const float noise = (float)(int32_t)seed / 2147483648.0f * 0.01f;
+        block[i] = 0.5f * (float)std::sin(2.0 * 3.14159265358979 * 1000.0 * (double)(i / kChannels) / kSampleRate) +
+                   noise;
+    }
+    tap.Write(block.data(), kSampleRate, kChannels);
+
+    SpectrumAnalyzer spectrum(size);
+    std::vector<float> samples(spectrum.WindowSize());
+    auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < kRuns; run++) {
+        if (!tap.Read(samples.data(), samples.size(), (size_t)run % 1024)) return 1;
+        spectrum.Update(samples.data(), kSampleRate, bars, 1.0f / 60.0f);
+    }
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("kernel: %s, %zu-point window, %d bars\n", RealFft::KernelName(), size, bars);
+    printf("%.4f ms per update\n", elapsed / kRuns);
+    const std::vector<float>& levels = spectrum.Bars();
+    int loudest = 0;
+    for (int b = 1; b < bars; b++) {
+        if (levels[b] > levels[loudest]) loudest = b;
+    }
+    printf("loudest bar %d of %d (level %.2f)\n", loudest, bars, levels[loudest]);
+    return 0;
+}
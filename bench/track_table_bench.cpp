@@ -0,0 +1,184 @@
+// Memory footprint and sort times of the library's track storage: the column
+// table (TrackTable) against per-track heap strings, a path and a display
+// name per track plus a TrackInfo (what the list used to be). Tracks are
+// synthetic but shaped like a real library: ~50 tracks per artist, ~10 per
+// album, a handful of genres.
+//
+//   track_table_bench [tracks, default 1000000]
+
+#include "library/track_table.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+// Live heap bytes, from a size header in front of every allocation
+static size_t gHeapBytes = 0;
+
+void* operator new(size_t size) {
+    size_t* p = (size_t*)malloc(size + 16);
+    if (!p) throw std::bad_alloc();
+    *p = size;
+    gHeapBytes += size;
+    return (char*)p + 16;
+}
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    size_t* p = (size_t*)((char*)ptr - 16);
+    gHeapBytes -= *p;
+    free(p);
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
+
+struct Strings {
+    std::vector<std::string> paths;
+    std::vector<std::string> names;
+    std::vector<TrackInfo> info;
+};
+
+static const char* const kWords[] = {
+    "love", "night", "blue", "heart", "river", "light", "dream", "fire", "rain", "shadow", "city", "summer",
+    "ghost", "song", "road", "home", "silver", "wild", "dance", "echo", "golden", "winter", "stone", "sky",
+};
+static const char* const kGenres[] = {"Rock", "Jazz", "Electronic", "Classical", "Hip-Hop", "Folk", "Metal", "Pop"};
+
+static std::string Words(std::mt19937& rng, int count) {
+    std::string text;
+    for (int i = 0; i < count; i++) {
+        if (i) text += ' ';
+        text += kWords[rng() % (sizeof(kWords) / sizeof(kWords[0]))];
+    }
+    text[0] = (char)toupper(text[0]);
+    return text;
+}
+
+static void Generate(size_t tracks, std::vector<std::string>* paths, std::vector<TrackInfo>* info) {
+    std::mt19937 rng(1);
+    const std::string root = "/home/user/Music";
+    for (size_t artist = 0; paths->size() < tracks; artist++) {
+        const std::string artistName = Words(rng, 2) + " " + std::to_string(artist);
+        const std::string genre = kGenres[artist % (sizeof(kGenres) / sizeof(kGenres[0]))];
+        for (int album = 0; album < 5 && paths->size() < tracks; album++) {
+            const std::string albumName = Words(rng, 3);
+            const uint16_t year = (uint16_t)(1960 + rng() % 60);
+            for (int track = 1; track <= 10 && paths->size() < tracks; track++) {
+                TrackInfo t;
+                t.title = Words(rng, 1 + rng() % 4);
+                t.artist = artistName;
+                t.album = albumName;
+                t.genre = genre;
+                t.year = year;
+                t.track = (uint16_t)track;
+                t.duration = 120 + rng() % 300;
+                t.bitrate = 128 + rng() % 900;
+                t.sampleRate = 44100;
+                t.channels = 2;
+                char number[8];
+                snprintf(number, sizeof(number), "%02d", track);
+                paths->push_back(root + "/" + artistName + "/" + std::to_string(year) + " - " + albumName + "/" +
+                                 number + " - " + t.title + ".flac");
+                info->push_back(std::move(t));
+            }
+        }
+    }
+}
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Less>
+static double TimeSort(size_t n, Less less) {
+    std::vector<uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(7));
+    auto start = std::chrono::steady_clock::now();
+    std::sort(order.begin(), order.end(), less);
+    return MillisecondsSince(start);
+}
+
+int main(int argc, char** argv) {
+    const size_t n = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+    const size_t rootLength = strlen("/home/user/Music/");
+
+    std::vector<std::string> sourcePaths;
+    std::vector<TrackInfo> sourceInfo;
+    sourcePaths.reserve(n);
+    sourceInfo.reserve(n);
+    Generate(n, &sourcePaths, &sourceInfo);
+    std::sort(sourcePaths.begin(), sourcePaths.end());
+
+    // Both built the way the library builds them: one entry per track, the
+    // paths first, the tags as they come in
+    size_t before = gHeapBytes;
+    auto start = std::chrono::steady_clock::now();
+    Strings strings;
+    for (size_t i = 0; i < n; i++) {
+        strings.paths.push_back(sourcePaths[i]);
+        strings.names.push_back(sourcePaths[i].substr(rootLength));
+        strings.info.push_back(sourceInfo[i]);
+    }
+    const double stringsBuild = MillisecondsSince(start);
+    const size_t stringsBytes = gHeapBytes - before;
+
+    before = gHeapBytes;
+    start = std::chrono::steady_clock::now();
+    TrackTable table;
+    table.SetRoot("/home/user/Music");
+    for (size_t i = 0; i < n; i++) table.Append(sourcePaths[i]);
+    for (size_t i = 0; i < n; i++) table.SetInfo(i, sourceInfo[i], true);
+    const double tableBuild = MillisecondsSince(start);
+    const size_t tableBytes = gHeapBytes - before;
+
+    printf("%zu tracks, %zu artists, %zu albums\n\n", n, table.Artists().Count() - 1, table.Albums().Count() - 1);
+    printf("%-28s %14s %14s\n", "", "strings", "TrackTable");
+    printf("%-28s %11.1f MB %11.1f MB\n", "heap", stringsBytes / 1048576.0, tableBytes / 1048576.0);
+    printf("%-28s %11.1f B  %11.1f B\n", "per track", (double)stringsBytes / n, (double)tableBytes / n);
+    printf("%-28s %11.1f ms %11.1f ms\n", "build", stringsBuild, tableBuild);
+
+    const auto& s = strings;
+    const TrackTable& t = table;
+    printf("%-28s %11.1f ms %11.1f ms\n", "sort by path",
+           TimeSort(n, [&](uint32_t a, uint32_t b) { return s.paths[a] < s.paths[b]; }),
+           TimeSort(n, [&](uint32_t a, uint32_t b) { return t.Path(a) < t.Path(b); }));
+
+    printf("%-28s %11.1f ms %11.1f ms\n", "sort by title",
+           TimeSort(n, [&](uint32_t a, uint32_t b) { return s.info[a].title < s.info[b].title; }),
+           TimeSort(n, [&](uint32_t a, uint32_t b) { return t.Title(a) < t.Title(b); }));
+
+    // The table sorts on integer keys: string ranks from the pools, built
+    // once per sort (and counted here), packed with the track number
+    const double stringsArtist = TimeSort(n, [&](uint32_t a, uint32_t b) {
+        const TrackInfo& x = s.info[a];
+        const TrackInfo& y = s.info[b];
+        if (int c = x.artist.compare(y.artist)) return c < 0;
+        if (int c = x.album.compare(y.album)) return c < 0;
+        return x.track < y.track;
+    });
+    start = std::chrono::steady_clock::now();
+    const std::vector<uint32_t> artistRanks = t.Artists().Ranks();
+    const std::vector<uint32_t> albumRanks = t.Albums().Ranks();
+    std::vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = (uint64_t)artistRanks[t.ArtistIds()[i]] << 40 | (uint64_t)albumRanks[t.AlbumIds()[i]] << 16 |
+                  t.Track(i);
+    }
+    const double keyTime = MillisecondsSince(start);
+    const double tableArtist = TimeSort(n, [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+    printf("%-28s %11.1f ms %11.1f ms\n", "sort by artist/album/track", stringsArtist, keyTime + tableArtist);
+
+    printf("%-28s %11.1f ms %11.1f ms\n", "sort by duration",
+           TimeSort(n, [&](uint32_t a, uint32_t b) { return s.info[a].duration < s.info[b].duration; }),
+           TimeSort(n, [&](uint32_t a, uint32_t b) { return t.DurationsMs()[a] < t.DurationsMs()[b]; }));
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "bc1.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+size_t Bc1Size(int width, int height) { return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 8; }
+
+static uint16_t To565(const float* color) {
+    const int r = std::min(std::max((int)std::lrint(color[0] * 31.0f / 255.0f), 0), 31);
+    const int g = std::min(std::max((int)std::lrint(color[1] * 63.0f / 255.0f), 0), 63);
+    const int b = std::min(std::max((int)std::lrint(color[2] * 31.0f / 255.0f), 0), 31);
+    return (uint16_t)(r << 11 | g << 5 | b);
+}
+
+// What the decoder turns a 565 endpoint back into
+static void From565(uint16_t c, int* out) {
+    const int r = c >> 11, g = c >> 5 & 63, b = c & 31;
+    out[0] = r << 3 | r >> 2;
+    out[1] = g << 2 | g >> 4;
+    out[2] = b << 3 | b >> 2;
+}
+
+// Indices of the nearest palette color into `indices` (2 bits each, pixel 0
+// lowest); returns the squared error. c0 > c1: four colors, two of them
+// interpolated. c0 == c1 would be the three-color mode, so it gets index 0
+// throughout.
+static uint32_t PickIndices(const uint8_t pixels[16][3], uint16_t c0, uint16_t c1, uint32_t* indices) {
+    int palette[4][3];
+    From565(c0, palette[0]);
+    From565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    const int colors = c0 == c1 ? 1 : 4;
+    uint32_t error = 0;
+    *indices = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0, bestDistance = 1 << 30;
+        for (int p = 0; p < colors; p++) {
+            const int dr = pixels[i][0] - palette[p][0], dg = pixels[i][1] - palette[p][1],
+                      db = pixels[i][2] - palette[p][2];
+            const int distance = dr * dr + dg * dg + db * db;
+            if (distance < bestDistance) best = p, bestDistance = distance;
+        }
+        *indices |= (uint32_t)best << (i * 2);
+        error += (uint32_t)bestDistance;
+    }
+    return error;
+}
+
+// c0 must come out above c1 for four colors; swapping the endpoints swaps
+// the roles of indices 0/1 and 2/3
+static void Order(uint16_t* c0, uint16_t* c1) {
+    if (*c0 < *c1) std::swap(*c0, *c1);
+}
+
+static void EncodeBlock(const uint8_t pixels[16][3], uint8_t* out) {
+    float mean[3] = {};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++) mean[c] += pixels[i][c] / 16.0f;
+    float cov[6] = {}; // rr rg rb gg gb bb
+    for (int i = 0; i < 16; i++) {
+        const float r = pixels[i][0] - mean[0], g = pixels[i][1] - mean[1], b = pixels[i][2] - mean[2];
+        cov[0] += r * r, cov[1] += r * g, cov[2] += r * b, cov[3] += g * g, cov[4] += g * b, cov[5] += b * b;
+    }
+    // Principal axis by power iteration, from the luminance direction
+    float axis[3] = {0.299f, 0.587f, 0.114f};
+    for (int iteration = 0; iteration < 8; iteration++) {
+        const float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        const float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        const float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        const float length = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+        if (length < 1e-6f) break;
+        axis[0] = x / length, axis[1] = y / length, axis[2] = z / length;
+    }
+    int lo = 0, hi = 0;
+    float loDot = 1e30f, hiDot = -1e30f;
+    for (int i = 0; i < 16; i++) {
+        const float dot = pixels[i][0] * axis[0] + pixels[i][1] * axis[1] + pixels[i][2] * axis[2];
+        if (dot < loDot) loDot = dot, lo = i;
+        if (dot > hiDot) hiDot = dot, hi = i;
+    }
+    float end0[3], end1[3];
+    for (int c = 0; c < 3; c++) end0[c] = pixels[hi][c], end1[c] = pixels[lo][c];
+    uint16_t c0 = To565(end0), c1 = To565(end1);
+    Order(&c0, &c1);
+    uint32_t indices;
+    uint32_t error = PickIndices(pixels, c0, c1, &indices);
+
+    // Least squares: with each pixel at a fixed share of the way between the
+    // endpoints, solve for the endpoints that fit best
+    if (c0 != c1 && error > 0) {
+        static const float kShare[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+        float aa = 0, ab = 0, bb = 0, ax[3] = {}, bx[3] = {};
+        for (int i = 0; i < 16; i++) {
+            const float a = kShare[indices >> (i * 2) & 3], b = 1.0f - a;
+            aa += a * a, ab += a * b, bb += b * b;
+            for (int c = 0; c < 3; c++) ax[c] += a * pixels[i][c], bx[c] += b * pixels[i][c];
+        }
+        const float det = aa * bb - ab * ab;
+        if (std::fabs(det) > 1e-6f) {
+            for (int c = 0; c < 3; c++) {
+                end0[c] = (ax[c] * bb - bx[c] * ab) / det;
+                end1[c] = (bx[c] * aa - ax[c] * ab) / det;
+            }
+            uint16_t r0 = To565(end0), r1 = To565(end1);
+            Order(&r0, &r1);
+            uint32_t refined;
+            const uint32_t refinedError = PickIndices(pixels, r0, r1, &refined);
+            if (refinedError < error) c0 = r0, c1 = r1, indices = refined;
+        }
+    }
+    out[0] = (uint8_t)c0, out[1] = (uint8_t)(c0 >> 8);
+    out[2] = (uint8_t)c1, out[3] = (uint8_t)(c1 >> 8);
+    for (int i = 0; i < 4; i++) out[4 + i] = (uint8_t)(indices >> (i * 8));
+}
+
+void EncodeBc1(const uint8_t* rgba, int width, int height, uint8_t* out) {
+    uint8_t pixels[16][3];
+    for (int by = 0; by < height; by += 4) {
+        for (int bx = 0; bx < width; bx += 4) {
+            for (int i = 0; i < 16; i++) {
+                const int x = std::min(bx + i % 4, width - 1), y = std::min(by + i / 4, height - 1);
+                memcpy(pixels[i], rgba + ((size_t)y * width + x) * 4, 3);
+            }
+            EncodeBlock(pixels, out);
+            out += 8;
+        }
+    }
+}
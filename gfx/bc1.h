@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Bytes of a BC1 (DXT1) image: 8 per 4x4 block, partial blocks included
+size_t Bc1Size(int width, int height);
+
+// Encodes an opaque RGBA8 image (alpha is ignored) to BC1, blocks in rows,
+// into Bc1Size() bytes at `out`. Per block, the endpoints are the colors
+// furthest apart along the block's principal axis, refined once by least
+// squares over the indices they give; every pixel then takes the nearest of
+// the four palette colors. Blocks past the right or bottom edge repeat the
+// last pixel.
+//
+// Four bits a pixel against 32 for RGBA8 is where the 8x comes from; covers
+// survive it well, being photos and paintings more than line art.
+void EncodeBc1(const uint8_t* rgba, int width, int height, uint8_t* out);
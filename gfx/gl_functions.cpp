@@ -0,0 +1,23 @@
+#include "gl_functions.h"
+
+template <typename F>
+static void Load(F& function, const char* name) {
+    function = reinterpret_cast<F>(glfwGetProcAddress(name));
+}
+
+const GlFunctions& Gl() {
+    static const GlFunctions functions = [] {
+        GlFunctions f;
+        Load(f.GenBuffers, "glGenBuffers");
+        Load(f.DeleteBuffers, "glDeleteBuffers");
+        Load(f.BindBuffer, "glBindBuffer");
+        Load(f.BufferData, "glBufferData");
+        Load(f.MapBuffer, "glMapBuffer");
+        Load(f.MapBufferRange, "glMapBufferRange");
+        Load(f.UnmapBuffer, "glUnmapBuffer");
+        Load(f.CompressedTexImage2D, "glCompressedTexImage2D");
+        f.s3tc = glfwExtensionSupported("GL_EXT_texture_compression_s3tc") == GLFW_TRUE;
+        return f;
+    }();
+    return functions;
+}
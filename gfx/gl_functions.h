@@ -0,0 +1,53 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+
+#include <cstddef>
+
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_WRITE_ONLY
+#define GL_WRITE_ONLY 0x88B9
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_INVALIDATE_BUFFER_BIT
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#endif
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+// GL entry points past 1.1, which the system headers don't reliably declare
+// (Windows' gl.h stops there), looked up through GLFW. Null when the context
+// doesn't have them.
+struct GlFunctions {
+    void(APIENTRY* GenBuffers)(GLsizei count, GLuint* buffers) = nullptr;
+    void(APIENTRY* DeleteBuffers)(GLsizei count, const GLuint* buffers) = nullptr;
+    void(APIENTRY* BindBuffer)(GLenum target, GLuint buffer) = nullptr;
+    void(APIENTRY* BufferData)(GLenum target, ptrdiff_t size, const void* data, GLenum usage) = nullptr;
+    void*(APIENTRY* MapBuffer)(GLenum target, GLenum access) = nullptr;
+    void*(APIENTRY* MapBufferRange)(GLenum target, ptrdiff_t offset, ptrdiff_t length, GLbitfield access) = nullptr;
+    GLboolean(APIENTRY* UnmapBuffer)(GLenum target) = nullptr;
+    void(APIENTRY* CompressedTexImage2D)(GLenum target, GLint level, GLenum format, GLsizei width, GLsizei height,
+                                         GLint border, GLsizei size, const void* data) = nullptr;
+    bool s3tc = false; // GL_EXT_texture_compression_s3tc
+
+    // Pixel buffer objects (GL 2.1)
+    bool HasPixelBuffers() const {
+        return GenBuffers && DeleteBuffers && BindBuffer && BufferData && MapBuffer && UnmapBuffer;
+    }
+    // BC1-3 textures; desktop drivers all have them, some GLES ones don't
+    bool HasS3tc() const { return CompressedTexImage2D && s3tc; }
+};
+
+// Looked up on first use; the GL context has to be current by then.
+const GlFunctions& Gl();
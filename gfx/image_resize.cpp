@@ -0,0 +1,190 @@
+#include "image_resize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define RESIZE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RESIZE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Source pixels under each destination pixel along one axis, with the share
+// of each: taps first[i]..first[i] + count[i] - 1, weights from offset[i]
+struct Taps {
+    std::vector<int> first, count, offset;
+    std::vector<float> weights;
+};
+
+static Taps MakeTaps(int from, int to) {
+    Taps taps;
+    const double scale = (double)from / to;
+    for (int i = 0; i < to; i++) {
+        taps.offset.push_back((int)taps.weights.size());
+        if (scale < 1.0) {
+            // Enlarging: the one pixel under this one's center, whole
+            taps.first.push_back(std::min((int)((i + 0.5) * scale), from - 1));
+            taps.weights.push_back(1.0f);
+            taps.count.push_back(1);
+            continue;
+        }
+        const double lo = i * scale, hi = std::min((i + 1) * scale, (double)from);
+        const int first = std::min((int)lo, from - 1);
+        int count = 0;
+        for (int s = first; s < hi; s++, count++)
+            taps.weights.push_back((float)((std::min(hi, s + 1.0) - std::max(lo, (double)s)) / scale));
+        taps.first.push_back(first);
+        taps.count.push_back(count);
+    }
+    return taps;
+}
+
+// One source row into `out`, dstWidth pixels of four floats
+static void FilterRow(const uint8_t* row, const Taps& taps, int dstWidth, float* out) {
+    for (int x = 0; x < dstWidth; x++) {
+        const uint8_t* p = row + (size_t)taps.first[x] * 4;
+        const float* w = taps.weights.data() + taps.offset[x];
+        const int count = taps.count[x];
+#if RESIZE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < count; k++) {
+            int32_t bytes;
+            memcpy(&bytes, p + k * 4, 4);
+            const __m128i wide = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(wide), _mm_set1_ps(w[k])));
+        }
+        _mm_storeu_ps(out + x * 4, sum);
+#elif RESIZE_NEON
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for (int k = 0; k < count; k++) {
+            uint32_t bytes;
+            memcpy(&bytes, p + k * 4, 4);
+            const uint16x8_t wide = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(bytes)));
+            sum = vmlaq_n_f32(sum, vcvtq_f32_u32(vmovl_u16(vget_low_u16(wide))), w[k]);
+        }
+        vst1q_f32(out + x * 4, sum);
+#else
+        float sum[4] = {};
+        for (int k = 0; k < count; k++)
+            for (int c = 0; c < 4; c++) sum[c] += p[k * 4 + c] * w[k];
+        memcpy(out + x * 4, sum, sizeof(sum));
+#endif
+    }
+}
+
+// sum += weight * row, over `size` floats (a multiple of four)
+static void Accumulate(float* sum, const float* row, float weight, size_t size) {
+    size_t i = 0;
+#if RESIZE_SSE2
+    const __m128 w = _mm_set1_ps(weight);
+    for (; i < size; i += 4)
+        _mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(sum + i), _mm_mul_ps(_mm_loadu_ps(row + i), w)));
+#elif RESIZE_NEON
+    for (; i < size; i += 4) vst1q_f32(sum + i, vmlaq_n_f32(vld1q_f32(sum + i), vld1q_f32(row + i), weight));
+#endif
+    for (; i < size; i++) sum[i] += row[i] * weight;
+}
+
+// Rounded and clamped to bytes
+static void StoreRow(const float* sum, size_t size, uint8_t* out) {
+    size_t i = 0;
+#if RESIZE_SSE2
+    for (; i + 16 <= size; i += 16) {
+        __m128i q[4];
+        for (int j = 0; j < 4; j++) q[j] = _mm_cvtps_epi32(_mm_loadu_ps(sum + i + j * 4));
+        const __m128i words = _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3]));
+        _mm_storeu_si128((__m128i*)(out + i), words);
+    }
+#elif RESIZE_NEON
+    for (; i + 8 <= size; i += 8) {
+        const int16x4_t a = vqmovn_s32(vcvtq_s32_f32(vaddq_f32(vld1q_f32(sum + i), vdupq_n_f32(0.5f))));
+        const int16x4_t b = vqmovn_s32(vcvtq_s32_f32(vaddq_f32(vld1q_f32(sum + i + 4), vdupq_n_f32(0.5f))));
+        vst1_u8(out + i, vqmovun_s16(vcombine_s16(a, b)));
+    }
+#endif
+    for (; i < size; i++) out[i] = (uint8_t)std::min(std::max(std::lrint(sum[i]), 0L), 255L);
+}
+
+void ResizeRgba(const uint8_t* src, int width, int height, uint8_t* dst, int dstWidth, int dstHeight) {
+    if (width <= 0 || height <= 0 || dstWidth <= 0 || dstHeight <= 0) return;
+    const Taps horizontal = MakeTaps(width, dstWidth);
+    const Taps vertical = MakeTaps(height, dstHeight);
+    const size_t rowFloats = (size_t)dstWidth * 4;
+    std::vector<float> row(rowFloats), sum(rowFloats);
+    // Rows on the boundary between two destination rows serve both
+    int filtered = -1;
+    for (int y = 0; y < dstHeight; y++) {
+        std::fill(sum.begin(), sum.end(), 0.0f);
+        const float* w = vertical.weights.data() + vertical.offset[y];
+        for (int k = 0; k < vertical.count[y]; k++) {
+            const int sy = vertical.first[y] + k;
+            if (sy != filtered) {
+                FilterRow(src + (size_t)sy * width * 4, horizontal, dstWidth, row.data());
+                filtered = sy;
+            }
+            Accumulate(sum.data(), row.data(), w[k], rowFloats);
+        }
+        StoreRow(sum.data(), rowFloats, dst + (size_t)y * rowFloats);
+    }
+}
+
+void HalveRgba(const uint8_t* src, int width, int height, uint8_t* dst) {
+    const int dstWidth = std::max(1, width / 2), dstHeight = std::max(1, height / 2);
+    if (width % 2 != 0 || height % 2 != 0) {
+        ResizeRgba(src, width, height, dst, dstWidth, dstHeight);
+        return;
+    }
+    const size_t stride = (size_t)width * 4;
+    for (int y = 0; y < dstHeight; y++) {
+        const uint8_t* top = src + (size_t)y * 2 * stride;
+        const uint8_t* bottom = top + stride;
+        uint8_t* out = dst + (size_t)y * dstWidth * 4;
+        int x = 0;
+#if RESIZE_SSE2
+        // Four source pixels a row into two: vertical sums in 16 bits, then
+        // each pixel's upper half added onto the lower
+        const __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi16(2);
+        for (; x + 2 <= dstWidth; x += 2) {
+            const __m128i a = _mm_loadu_si128((const __m128i*)(top + x * 8));
+            const __m128i b = _mm_loadu_si128((const __m128i*)(bottom + x * 8));
+            const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+            __m128i sum = _mm_unpacklo_epi64(_mm_add_epi16(lo, _mm_srli_si128(lo, 8)),
+                                             _mm_add_epi16(hi, _mm_srli_si128(hi, 8)));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+            _mm_storel_epi64((__m128i*)(out + x * 4), _mm_packus_epi16(sum, zero));
+        }
+#elif RESIZE_NEON
+        // Sixteen source pixels a row into eight, a channel per register
+        for (; x + 8 <= dstWidth; x += 8) {
+            const uint8x16x4_t a = vld4q_u8(top + x * 8);
+            const uint8x16x4_t b = vld4q_u8(bottom + x * 8);
+            uint8x8x4_t half;
+            for (int c = 0; c < 4; c++)
+                half.val[c] = vrshrn_n_u16(vaddq_u16(vpaddlq_u8(a.val[c]), vpaddlq_u8(b.val[c])), 2);
+            vst4_u8(out + x * 4, half);
+        }
+#endif
+        for (; x < dstWidth; x++)
+            for (int c = 0; c < 4; c++)
+                out[x * 4 + c] = (uint8_t)((top[x * 8 + c] + top[x * 8 + 4 + c] + bottom[x * 8 + c] +
+                                            bottom[x * 8 + 4 + c] + 2) >> 2);
+    }
+}
+
+const char* ResizeKernelName() {
+#if RESIZE_SSE2
+    return "sse2";
+#elif RESIZE_NEON
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
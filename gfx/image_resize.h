@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+// Shrinks an RGBA8 image by area averaging: every destination pixel is the
+// mean of the source pixels it covers, those cut by its edges weighted by the
+// part inside. That is a box filter as wide as the scale factor, which keeps
+// covers free of aliasing at any ratio, down to 1/20 and beyond, and costs a
+// multiply-add per source pixel and channel. Enlarging degenerates to nearest
+// neighbour. Alpha is averaged like the colors (straight, not premultiplied).
+//
+// Rows are filtered horizontally into floats, a pixel (four channels) per
+// SSE or NEON register, then summed vertically four channels at a time; each
+// source row is filtered once. `dst` is dstWidth x dstHeight, tightly packed.
+void ResizeRgba(const uint8_t* src, int width, int height, uint8_t* dst, int dstWidth, int dstHeight);
+
+// The next mipmap level of an RGBA8 image: max(1, width / 2) x max(1,
+// height / 2). Even sizes average 2x2 blocks, rounded, sixteen source bytes
+// per row at a time; odd ones go through ResizeRgba(), which weighs the
+// pixel straddling two destination pixels right.
+void HalveRgba(const uint8_t* src, int width, int height, uint8_t* dst);
+
+// Name of the kernel picked for this CPU
+const char* ResizeKernelName();
@@ -0,0 +1,342 @@
+#include "texture_loader.h"
+
+#include "gl_functions.h"
+#include "library/cover_art.h"
+#include "stb_image.h"
+#include "util/cache_dir.h"
+#include "util/hash.h"
+#include "util/mapped_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// Sent to the GPU per frame, at least one image whatever its size
+static const size_t kUploadBudgetBytes = 4 << 20;
+// Decoded and waiting for upload; workers pause beyond this
+static const size_t kMaxDecodedBytes = 64 << 20;
+// A request not renewed for this many frames is dropped before decoding
+static const uint64_t kStaleFrames = 120;
+static const unsigned kMaxWorkers = 4;
+// Textures held by default; a few dozen large covers or a thousand thumbnails
+static const uint64_t kDefaultBudgetBytes = 256 << 20;
+// Entries (failed ones included) beyond this go too, oldest first
+static const size_t kMaxEntries = 4096;
+
+TextureLoader::TextureLoader() : budget_(kDefaultBudgetBytes) {
+    compress_.store(Gl().HasS3tc());
+    const unsigned workers = std::min(kMaxWorkers, std::max(1u, std::thread::hardware_concurrency() / 2));
+    for (unsigned i = 0; i < workers; i++) workers_.emplace_back(&TextureLoader::WorkerMain, this);
+}
+
+TextureLoader::~TextureLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wakeWorkers_.notify_all();
+    for (std::thread& worker : workers_) worker.join();
+}
+
+GLuint TextureLoader::Placeholder() {
+    if (placeholder_ == 0) {
+        static const uint8_t kGray[4 * 4] = {64, 64, 64, 255, 64, 64, 64, 255, 64, 64, 64, 255, 64, 64, 64, 255};
+        glGenTextures(1, &placeholder_);
+        glBindTexture(GL_TEXTURE_2D, placeholder_);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, kGray);
+    }
+    return placeholder_;
+}
+
+// Covers and thumbnails are told apart from whole image files by what
+// follows a NUL, which no path has
+std::string TextureLoader::Key(const std::string& path, TextureSource source, int thumbnail) {
+    if (source == TextureSource::File && thumbnail == 0) return path;
+    std::string key = path;
+    key += '\0';
+    key += source == TextureSource::File ? 'f' : 'c';
+    key += std::to_string(thumbnail);
+    return key;
+}
+
+GLuint TextureLoader::Get(const std::string& path, TextureSource source, int pixels) {
+    const int thumbnail = pixels > 0 ? ThumbnailSize(pixels) : 0;
+    const std::string key = Key(path, source, thumbnail);
+    auto [it, added] = entries_.try_emplace(key);
+    Entry& entry = it->second;
+    if (added) entry.recent = recent_.insert(recent_.begin(), key);
+    if (added || entry.used != frame_) {
+        entry.used = frame_;
+        recent_.splice(recent_.begin(), recent_, entry.recent);
+        (entry.texture != 0 || entry.failed ? hits_ : misses_)++;
+    }
+    if (entry.texture != 0) return entry.texture;
+    if (entry.failed) return Placeholder();
+    if (!entry.job) {
+        entry.job = std::make_shared<Job>();
+        entry.job->key = key;
+        entry.job->path = path;
+        entry.job->source = source;
+        entry.job->thumbnail = thumbnail;
+        entry.job->wanted.store(frame_, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(entry.job);
+        }
+        wakeWorkers_.notify_one();
+    }
+    entry.job->wanted.store(frame_, std::memory_order_relaxed);
+    return Placeholder();
+}
+
+void TextureLoader::SetCompression(bool enabled) { compress_.store(enabled && Gl().HasS3tc()); }
+
+bool TextureLoader::Ready(const std::string& path, TextureSource source, int pixels) const {
+    auto it = entries_.find(Key(path, source, pixels > 0 ? ThumbnailSize(pixels) : 0));
+    return it != entries_.end() && it->second.texture != 0;
+}
+
+bool TextureLoader::Failed(const std::string& path, TextureSource source, int pixels) const {
+    auto it = entries_.find(Key(path, source, pixels > 0 ? ThumbnailSize(pixels) : 0));
+    return it != entries_.end() && it->second.failed;
+}
+
+void TextureLoader::Upload() {
+    currentFrame_.store(++frame_, std::memory_order_relaxed);
+    size_t budget = kUploadBudgetBytes;
+    bool first = true;
+    for (;;) {
+        Decoded image;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (decoded_.empty()) break;
+            const size_t bytes = decoded_.front().pixels.size();
+            if (!first && bytes > budget) break;
+            image = std::move(decoded_.front());
+            decoded_.pop_front();
+            decodedBytes_ -= bytes;
+        }
+        wakeWorkers_.notify_one();
+        first = false;
+        budget -= std::min(budget, image.pixels.size());
+
+        auto it = entries_.find(image.key);
+        if (it == entries_.end()) continue;
+        Entry& entry = it->second;
+        entry.job.reset();
+        if (image.dropped) continue; // asked for again, it is queued again
+        if (image.pixels.empty()) {
+            entry.failed = true;
+            continue;
+        }
+        UploadImage(entry, image);
+    }
+    Evict();
+}
+
+void TextureLoader::Evict() {
+    // Oldest first, up to the first one drawn in the last frame; those still
+    // loading are passed over, and those that failed only go for the count
+    auto over = [this] { return residentBytes_ > budget_ || entries_.size() > kMaxEntries; };
+    for (auto it = recent_.end(); it != recent_.begin() && over();) {
+        --it;
+        auto found = entries_.find(*it);
+        Entry& entry = found->second;
+        if (entry.used + 1 >= frame_) break;
+        if (entry.job || (entry.texture == 0 && entries_.size() <= kMaxEntries)) continue;
+        if (entry.texture != 0) {
+            glDeleteTextures(1, &entry.texture);
+            residentBytes_ -= entry.bytes;
+            evictions_++;
+            evictedBytes_ += entry.bytes;
+        }
+        it = recent_.erase(it);
+        entries_.erase(found);
+    }
+}
+
+void TextureLoader::UploadImage(Entry& entry, const Decoded& image) {
+    const GlFunctions& gl = Gl();
+    glGenTextures(1, &entry.texture);
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels - 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    uploadedBytes_ += image.pixels.size();
+    entry.bytes = image.pixels.size();
+    residentBytes_ += entry.bytes;
+
+    // Every level from `base`: the pixels, or offsets into the bound buffer
+    const auto uploadLevels = [&](const uint8_t* base) {
+        size_t offset = 0;
+        for (int level = 0, w = image.width, h = image.height; level < image.levels; level++) {
+            const size_t bytes = LevelBytes(image.format, w, h);
+            if (image.format == TextureFormat::Bc1)
+                gl.CompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, w, h, 0, (GLsizei)bytes,
+                                        base + offset);
+            else
+                glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, base + offset);
+            offset += bytes;
+            w = std::max(1, w / 2);
+            h = std::max(1, h / 2);
+        }
+    };
+
+    if (gl.HasPixelBuffers()) {
+        if (!pixelBuffersReady_) {
+            gl.GenBuffers(3, pixelBuffers_);
+            pixelBuffersReady_ = true;
+        }
+        // Orphaning the buffer's storage lets the driver hand out fresh memory
+        // instead of waiting for the previous transfer from it
+        gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers_[nextPixelBuffer_]);
+        nextPixelBuffer_ = (nextPixelBuffer_ + 1) % 3;
+        const ptrdiff_t bytes = (ptrdiff_t)image.pixels.size();
+        gl.BufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        void* mapped = gl.MapBufferRange
+                           ? gl.MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                               GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT)
+                           : gl.MapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+        if (mapped) {
+            memcpy(mapped, image.pixels.data(), image.pixels.size());
+            gl.UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            uploadLevels(nullptr);
+            gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return;
+        }
+        gl.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    uploadLevels(image.pixels.data());
+}
+
+void TextureLoader::Release() {
+    for (auto& [path, entry] : entries_) {
+        if (entry.texture != 0) glDeleteTextures(1, &entry.texture);
+    }
+    entries_.clear();
+    recent_.clear();
+    residentBytes_ = 0;
+    if (placeholder_ != 0) glDeleteTextures(1, &placeholder_);
+    placeholder_ = 0;
+    if (pixelBuffersReady_) Gl().DeleteBuffers(3, pixelBuffers_);
+    pixelBuffersReady_ = false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.clear();
+    decoded_.clear();
+    decodedBytes_ = 0;
+}
+
+TextureLoaderStats TextureLoader::Stats() const {
+    TextureLoaderStats stats;
+    for (const auto& [path, entry] : entries_) stats.textures += entry.texture != 0;
+    stats.uploadedBytes = uploadedBytes_;
+    stats.residentBytes = residentBytes_;
+    stats.budgetBytes = budget_;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.evictions = evictions_;
+    stats.evictedBytes = evictedBytes_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.waiting = jobs_.size() + decoded_.size();
+    stats.decoded = decodedCount_;
+    stats.failed = failedCount_;
+    stats.thumbnailsLoaded = thumbnailsLoaded_;
+    stats.thumbnailsMade = thumbnailsMade_;
+    return stats;
+}
+
+ThumbnailPack& TextureLoader::Pack() {
+    std::call_once(packOpened_, [this] {
+        const std::string dir = CacheDir("thumbnails");
+        if (!dir.empty()) pack_.Open(dir + "/thumbnails.pack");
+    });
+    return pack_;
+}
+
+bool TextureLoader::Decode(const Job& job, Decoded& image) {
+    // Plenty of tracks have no cover; only a broken one is worth a word
+    std::vector<uint8_t> cover;
+    MappedFile file;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    if (job.source == TextureSource::TrackCover) {
+        if (!ReadCoverArt(job.path, &cover)) return false;
+        data = cover.data();
+        size = cover.size();
+    } else if (file.Open(job.path)) {
+        data = file.Data();
+        size = file.Size();
+    } else {
+        std::cerr << "Failed to load image: " << job.path << std::endl;
+        return false;
+    }
+
+    uint64_t hash = 0;
+    Thumbnail thumbnail;
+    const bool compress = compress_.load();
+    const auto take = [&image](Thumbnail& thumbnail) {
+        image.width = thumbnail.width;
+        image.height = thumbnail.height;
+        image.format = thumbnail.format;
+        image.levels = thumbnail.levels;
+        image.pixels = std::move(thumbnail.pixels);
+    };
+    if (job.thumbnail > 0) {
+        hash = ContentHash64(data, size);
+        if (Pack().Find(hash, job.thumbnail, compress, &thumbnail)) {
+            take(thumbnail);
+            std::lock_guard<std::mutex> lock(mutex_);
+            thumbnailsLoaded_++;
+            return true;
+        }
+    }
+
+    int channels = 0;
+    unsigned char* pixels = stbi_load_from_memory(data, (int)size, &image.width, &image.height, &channels, 4);
+    if (!pixels) {
+        const char* what = job.source == TextureSource::TrackCover ? "cover art" : "image";
+        std::cerr << "Failed to decode " << what << ": " << job.path << std::endl;
+        return false;
+    }
+    if (job.thumbnail > 0) {
+        thumbnail = MakeThumbnail(pixels, image.width, image.height, job.thumbnail, compress);
+        stbi_image_free(pixels);
+        Pack().Add(hash, job.thumbnail, thumbnail);
+        take(thumbnail);
+        std::lock_guard<std::mutex> lock(mutex_);
+        thumbnailsMade_++;
+        return true;
+    }
+    image.pixels.assign(pixels, pixels + (size_t)image.width * image.height * 4);
+    stbi_image_free(pixels);
+    return true;
+}
+
+void TextureLoader::WorkerMain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wakeWorkers_.wait(lock, [this] { return stop_ || (!jobs_.empty() && decodedBytes_ < kMaxDecodedBytes); });
+        if (stop_) return;
+        std::shared_ptr<Job> job = std::move(jobs_.back());
+        jobs_.pop_back();
+
+        Decoded image;
+        image.key = job->key;
+        const uint64_t now = currentFrame_.load(std::memory_order_relaxed);
+        if (now - std::min(now, job->wanted.load(std::memory_order_relaxed)) > kStaleFrames) {
+            image.dropped = true;
+            decoded_.push_back(std::move(image));
+            continue;
+        }
+
+        lock.unlock();
+        const bool ok = Decode(*job, image);
+        lock.lock();
+        (ok ? decodedCount_ : failedCount_)++;
+        decodedBytes_ += image.pixels.size();
+        decoded_.push_back(std::move(image));
+    }
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "thumbnail_pack.h"
+
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Where the image for a path comes from
+enum class TextureSource {
+    File,       // the path is an image file
+    TrackCover, // the path is a track: its embedded cover or the folder's (ReadCoverArt)
+};
+
+struct TextureLoaderStats {
+    size_t textures = 0; // uploaded and held
+    size_t waiting = 0;  // to decode or to upload
+    uint64_t decoded = 0;
+    uint64_t failed = 0;
+    uint64_t uploadedBytes = 0;
+    uint64_t residentBytes = 0; // held by the textures, as uploaded
+    uint64_t budgetBytes = 0;
+    // Lookups: the first Get() of an image in a frame. A hit finds it
+    // uploaded (or known to have none), a miss has to wait for it.
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t evictedBytes = 0;
+    uint64_t thumbnailsLoaded = 0; // found in the pack
+    uint64_t thumbnailsMade = 0;   // decoded and shrunk
+};
+
+// Images as GL textures without ever decoding on the UI thread. Get() hands
+// out the texture right away if it is there, and otherwise a placeholder
+// while worker threads decode the file. Decoded images wait in a bounded
+// queue (workers stop decoding when it is full) until Upload(), once a
+// frame, sends them to the GPU, up to a byte budget per frame, through a
+// ring of pixel buffer objects where the context has them: the copy into
+// the buffer is all the frame pays, the transfer itself is the driver's.
+//
+// The most recently requested images are decoded first, and requests nobody
+// has asked for again in a while are dropped, so scrolling past a long list
+// of covers decodes the ones on screen, not the backlog.
+//
+// Asked for at a display size, images come as thumbnails instead (see
+// ThumbnailPack): looked up by the hash of the encoded file first, decoded
+// and shrunk only if they aren't in the pack yet, so a grid of covers costs a
+// read and a hash per cover on every launch after the first, not a JPEG
+// decode at full resolution. Thumbnails come with mipmaps, made on the
+// workers, and compressed to BC1 where the driver takes it: an eighth of the
+// memory of RGBA8, a sixth with the mipmaps.
+//
+// Textures are kept in least recently used order and evicted once they hold
+// more than a byte budget (what was uploaded, mipmaps and compression
+// included: as much as the driver keeps), oldest first. Those drawn in the
+// last frame stay whatever the budget, so a grid of covers larger than it
+// overshoots instead of reloading on every frame.
+//
+// Everything but the workers runs on the GL thread.
+class TextureLoader {
+public:
+    TextureLoader();
+    ~TextureLoader();
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    // The texture for the image at `path`, or the placeholder until it is
+    // loaded (and for good if it can't be). With `pixels` > 0, a thumbnail at
+    // least that big where the image is, in the next fixed size up.
+    GLuint Get(const std::string& path, TextureSource source = TextureSource::File, int pixels = 0);
+    bool Ready(const std::string& path, TextureSource source = TextureSource::File, int pixels = 0) const;
+    // Known to have no image: not there, or not decodable
+    bool Failed(const std::string& path, TextureSource source = TextureSource::File, int pixels = 0) const;
+    // Uploads what has been decoded, within the frame's budget, and ages
+    // pending requests. Call once a frame, before the Get() calls.
+    void Upload();
+    // Deletes every texture; call while the context is still current.
+    void Release();
+
+    GLuint Placeholder();
+    TextureLoaderStats Stats() const;
+    // Bytes of textures held before the least recently used go
+    void SetBudget(uint64_t bytes) { budget_ = bytes; }
+    // BC1 thumbnails, on by default where the context supports S3TC; asking
+    // for them where it doesn't changes nothing
+    void SetCompression(bool enabled);
+
+private:
+    struct Job {
+        std::string key;
+        std::string path;
+        TextureSource source = TextureSource::File;
+        int thumbnail = 0; // fixed thumbnail size, 0 for the whole image
+        std::atomic<uint64_t> wanted{0}; // frame of the last Get()
+    };
+    struct Decoded {
+        std::string key;
+        int width = 0; // of level 0
+        int height = 0;
+        TextureFormat format = TextureFormat::Rgba8;
+        int levels = 1;
+        std::vector<uint8_t> pixels; // every level; empty if decoding failed
+        bool dropped = false;      // gone stale before it was decoded
+    };
+    struct Entry {
+        GLuint texture = 0;
+        uint64_t bytes = 0;
+        std::shared_ptr<Job> job; // while decoding or uploading
+        bool failed = false;
+        uint64_t used = 0; // frame of the last Get()
+        std::list<std::string>::iterator recent;
+    };
+
+    static std::string Key(const std::string& path, TextureSource source, int thumbnail);
+    void WorkerMain();
+    // Decodes the image of `job` into `image`, through the thumbnail pack for
+    // thumbnails; false if there is none
+    bool Decode(const Job& job, Decoded& image);
+    ThumbnailPack& Pack();
+    void UploadImage(Entry& entry, const Decoded& image);
+    void Evict();
+
+    // UI thread only
+    std::unordered_map<std::string, Entry> entries_;
+    std::list<std::string> recent_; // keys of entries_, most recently used first
+    uint64_t frame_ = 0;
+    GLuint placeholder_ = 0;
+    GLuint pixelBuffers_[3] = {};
+    size_t nextPixelBuffer_ = 0;
+    bool pixelBuffersReady_ = false;
+    uint64_t uploadedBytes_ = 0;
+    uint64_t residentBytes_ = 0;
+    uint64_t budget_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+    uint64_t evictedBytes_ = 0;
+
+    std::vector<std::thread> workers_;
+    mutable std::mutex mutex_;
+    std::condition_variable wakeWorkers_;
+    bool stop_ = false;
+    std::deque<std::shared_ptr<Job>> jobs_; // newest at the back
+    std::deque<Decoded> decoded_;
+    size_t decodedBytes_ = 0;
+    std::atomic<uint64_t> currentFrame_{0};
+    uint64_t decodedCount_ = 0;
+    uint64_t failedCount_ = 0;
+    uint64_t thumbnailsLoaded_ = 0;
+    uint64_t thumbnailsMade_ = 0;
+
+    std::atomic<bool> compress_{false};
+    std::once_flag packOpened_;
+    ThumbnailPack pack_;
+};
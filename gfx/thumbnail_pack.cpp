@@ -0,0 +1,228 @@
+#include "thumbnail_pack.h"
+
+#include "bc1.h"
+#include "image_resize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+static const char kPackMagic[4] = {'T', 'H', 'M', 'B'};
+static const uint32_t kPackVersion = 2;
+static const int kThumbnailSizes[] = {64, 128, 256};
+
+struct ThumbnailPackHeader {
+    char magic[4];
+    uint32_t version;
+};
+
+// Followed by the levels, largest first
+struct ThumbnailRecordHeader {
+    uint64_t hash;
+    uint16_t size;
+    uint16_t width;
+    uint16_t height;
+    uint8_t format;
+    uint8_t levels;
+    uint32_t bytes;
+    uint32_t reserved;
+};
+
+size_t LevelBytes(TextureFormat format, int width, int height) {
+    return format == TextureFormat::Bc1 ? Bc1Size(width, height) : (size_t)width * height * 4;
+}
+
+int MipLevels(int width, int height) {
+    int levels = 1;
+    while (width > 1 || height > 1) {
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+        levels++;
+    }
+    return levels;
+}
+
+// Bytes of the first `levels` levels
+static size_t ChainBytes(TextureFormat format, int width, int height, int levels) {
+    size_t bytes = 0;
+    for (int level = 0; level < levels; level++) {
+        bytes += LevelBytes(format, width, height);
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return bytes;
+}
+
+int ThumbnailSize(int pixels) {
+    for (int size : kThumbnailSizes)
+        if (size >= pixels) return size;
+    return kThumbnailSizes[sizeof(kThumbnailSizes) / sizeof(kThumbnailSizes[0]) - 1];
+}
+
+Thumbnail MakeThumbnail(const uint8_t* rgba, int width, int height, int size, bool compress) {
+    Thumbnail thumbnail;
+    if (width <= 0 || height <= 0) return thumbnail;
+    // The whole RGBA chain first, each level halved from the one before
+    std::vector<uint8_t> chain;
+    if (std::max(width, height) <= size) {
+        thumbnail.width = width;
+        thumbnail.height = height;
+        chain.assign(rgba, rgba + (size_t)width * height * 4);
+    } else {
+        const double scale = (double)size / std::max(width, height);
+        thumbnail.width = std::max(1, (int)std::lrint(width * scale));
+        thumbnail.height = std::max(1, (int)std::lrint(height * scale));
+        chain.resize((size_t)thumbnail.width * thumbnail.height * 4);
+        ResizeRgba(rgba, width, height, chain.data(), thumbnail.width, thumbnail.height);
+    }
+    thumbnail.levels = MipLevels(thumbnail.width, thumbnail.height);
+    chain.resize(ChainBytes(TextureFormat::Rgba8, thumbnail.width, thumbnail.height, thumbnail.levels));
+    size_t offset = 0;
+    for (int level = 0, w = thumbnail.width, h = thumbnail.height; level + 1 < thumbnail.levels; level++) {
+        const size_t next = offset + LevelBytes(TextureFormat::Rgba8, w, h);
+        HalveRgba(chain.data() + offset, w, h, chain.data() + next);
+        offset = next;
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+
+    bool opaque = true;
+    for (size_t i = 3; opaque && i < LevelBytes(TextureFormat::Rgba8, thumbnail.width, thumbnail.height); i += 4)
+        opaque = chain[i] == 255;
+    if (!compress || !opaque) {
+        thumbnail.pixels = std::move(chain);
+        return thumbnail;
+    }
+    thumbnail.format = TextureFormat::Bc1;
+    thumbnail.pixels.resize(ChainBytes(TextureFormat::Bc1, thumbnail.width, thumbnail.height, thumbnail.levels));
+    offset = 0;
+    size_t out = 0;
+    for (int level = 0, w = thumbnail.width, h = thumbnail.height; level < thumbnail.levels; level++) {
+        EncodeBc1(chain.data() + offset, w, h, thumbnail.pixels.data() + out);
+        offset += LevelBytes(TextureFormat::Rgba8, w, h);
+        out += LevelBytes(TextureFormat::Bc1, w, h);
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+    return thumbnail;
+}
+
+ThumbnailPack::~ThumbnailPack() {
+    if (file_) fclose(file_);
+}
+
+uint64_t ThumbnailPack::Key(uint64_t hash, int size) { return hash ^ (uint64_t)size * 0x9e3779b97f4a7c15ull; }
+
+bool ThumbnailPack::Open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    std::error_code ec;
+    const uint64_t size = fs::file_size(path, ec);
+    if (!ec && size > kMaxBytes) fs::remove(path, ec);
+
+    file_ = fopen(path.c_str(), "r+b");
+    ThumbnailPackHeader header;
+    if (file_ && map_.Open(path) && map_.Size() >= sizeof(header)) {
+        memcpy(&header, map_.Data(), sizeof(header));
+        if (memcmp(header.magic, kPackMagic, 4) == 0 && header.version == kPackVersion) {
+            end_ = IndexRecords();
+            if (end_ == map_.Size()) return true;
+            // A torn record at the end: cut off, or the next one would follow it
+            map_.Close();
+            fs::resize_file(path, end_, ec);
+            if (!ec && map_.Open(path)) return true;
+        }
+    }
+    return Create();
+}
+
+bool ThumbnailPack::Create() {
+    map_.Close();
+    index_.clear();
+    if (file_) fclose(file_);
+    file_ = fopen(path_.c_str(), "w+b");
+    ThumbnailPackHeader header;
+    memcpy(header.magic, kPackMagic, 4);
+    header.version = kPackVersion;
+    if (!file_ || fwrite(&header, sizeof(header), 1, file_) != 1 || fflush(file_) != 0 || !map_.Open(path_)) {
+        std::cerr << "Failed to create thumbnail pack: " << path_ << std::endl;
+        if (file_) fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+    end_ = sizeof(header);
+    return true;
+}
+
+uint64_t ThumbnailPack::IndexRecords() {
+    uint64_t offset = sizeof(ThumbnailPackHeader);
+    ThumbnailRecordHeader record;
+    while (offset + sizeof(record) <= map_.Size()) {
+        memcpy(&record, map_.Data() + offset, sizeof(record));
+        const TextureFormat format = (TextureFormat)record.format;
+        if (record.width == 0 || record.height == 0 || std::max(record.width, record.height) > record.size ||
+            record.format > (uint8_t)TextureFormat::Bc1 || record.levels == 0 ||
+            record.levels > MipLevels(record.width, record.height) ||
+            record.bytes != ChainBytes(format, record.width, record.height, record.levels) ||
+            record.bytes > map_.Size() - offset - sizeof(record))
+            break;
+        index_[Key(record.hash, record.size)] = {offset, format};
+        offset += sizeof(record) + record.bytes;
+    }
+    return offset;
+}
+
+bool ThumbnailPack::Find(uint64_t hash, int size, bool acceptBc1, Thumbnail* out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(Key(hash, size));
+    if (it == index_.end() || (it->second.format == TextureFormat::Bc1 && !acceptBc1)) return false;
+    const uint64_t offset = it->second.offset;
+    ThumbnailRecordHeader record;
+    // Appended since the file was mapped
+    if (offset + sizeof(record) > map_.Size() && !map_.Open(path_)) return false;
+    if (offset + sizeof(record) > map_.Size()) return false;
+    memcpy(&record, map_.Data() + offset, sizeof(record));
+    if (record.hash != hash || record.size != size) return false;
+    if (record.bytes > map_.Size() - offset - sizeof(record)) return false;
+    out->width = record.width;
+    out->height = record.height;
+    out->format = (TextureFormat)record.format;
+    out->levels = record.levels;
+    const uint8_t* pixels = map_.Data() + offset + sizeof(record);
+    out->pixels.assign(pixels, pixels + record.bytes);
+    return true;
+}
+
+bool ThumbnailPack::Add(uint64_t hash, int size, const Thumbnail& thumbnail) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_) return false;
+    auto it = index_.find(Key(hash, size));
+    if (it != index_.end() && it->second.format == thumbnail.format) return true;
+    ThumbnailRecordHeader record = {};
+    record.hash = hash;
+    record.size = (uint16_t)size;
+    record.width = (uint16_t)thumbnail.width;
+    record.height = (uint16_t)thumbnail.height;
+    record.format = (uint8_t)thumbnail.format;
+    record.levels = (uint8_t)thumbnail.levels;
+    record.bytes = (uint32_t)thumbnail.pixels.size();
+    if (end_ + sizeof(record) + record.bytes > kMaxBytes) return false;
+    // Written where the last whole record ends, over whatever a failed append left
+    if (fseek(file_, (long)end_, SEEK_SET) != 0 || fwrite(&record, sizeof(record), 1, file_) != 1 ||
+        fwrite(thumbnail.pixels.data(), 1, record.bytes, file_) != record.bytes || fflush(file_) != 0) {
+        std::cerr << "Failed to write thumbnail pack: " << path_ << std::endl;
+        return false;
+    }
+    index_[Key(hash, size)] = {end_, thumbnail.format};
+    end_ += sizeof(record) + record.bytes;
+    return true;
+}
+
+size_t ThumbnailPack::Count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index_.size();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "util/mapped_file.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class TextureFormat : uint8_t {
+    Rgba8,
+    Bc1, // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+};
+
+// Bytes of one mipmap level
+size_t LevelBytes(TextureFormat format, int width, int height);
+// Levels of a full mipmap chain, down to 1x1
+int MipLevels(int width, int height);
+
+// An image shrunk to fit a square of one of the fixed thumbnail sizes, ready
+// for upload: every level of its mipmap chain, largest first, back to back
+struct Thumbnail {
+    int width = 0; // of level 0
+    int height = 0;
+    TextureFormat format = TextureFormat::Rgba8;
+    int levels = 1;
+    std::vector<uint8_t> pixels;
+};
+
+// Sizes thumbnails are made in: the smallest one at least as big as asked for
+// (the largest if none is), so the pack holds a few copies of a cover at most
+int ThumbnailSize(int pixels);
+// `rgba` (width x height) shrunk to fit size x size, aspect kept (smaller
+// images as they are), with mipmaps made by halving (HalveRgba) so the cover
+// doesn't shimmer drawn smaller than that. With `compress`, every level is
+// encoded to BC1, unless the image has transparent pixels, which BC1 can't
+// keep apart from its colors; those stay RGBA8.
+Thumbnail MakeThumbnail(const uint8_t* rgba, int width, int height, int size, bool compress);
+
+// All thumbnails in one file, keyed by a hash of the encoded image they were
+// made from (ContentHash64) and their size, so the same cover in a hundred
+// tracks is stored once and a changed file never finds a stale entry. They
+// are stored as uploaded, mipmaps and compression done, so a hit costs a copy
+// and nothing else.
+// Records are appended and never rewritten: a header, then the pixels. The
+// file is memory-mapped, and opening it reads the record headers only; a
+// lookup copies the pixels straight out of the mapping.
+//
+// A record torn by a crash mid-append is cut off on open. Past kMaxBytes the
+// pack stops growing, and it is started over on the next open.
+//
+// Safe to use from several threads; a single process is assumed to write.
+class ThumbnailPack {
+public:
+    static const uint64_t kMaxBytes = 1ull << 30;
+
+    ThumbnailPack() = default;
+    ~ThumbnailPack();
+
+    ThumbnailPack(const ThumbnailPack&) = delete;
+    ThumbnailPack& operator=(const ThumbnailPack&) = delete;
+
+    // Opens (or creates) the pack at `path`. False if it can't; Find() and
+    // Add() then do nothing.
+    bool Open(const std::string& path);
+    // A BC1 thumbnail only counts with `acceptBc1`; otherwise it is made
+    // again in RGBA8 and replaces the compressed one
+    bool Find(uint64_t hash, int size, bool acceptBc1, Thumbnail* out);
+    bool Add(uint64_t hash, int size, const Thumbnail& thumbnail);
+    size_t Count() const;
+
+private:
+    static uint64_t Key(uint64_t hash, int size);
+    bool Create();
+    // Indexes the records of the mapping; returns where the last whole one ends
+    uint64_t IndexRecords();
+
+    mutable std::mutex mutex_;
+    std::string path_;
+    FILE* file_ = nullptr;
+    MappedFile map_; // remapped when a record lies past its end
+    uint64_t end_ = 0;
+    struct Record {
+        uint64_t offset;
+        TextureFormat format;
+    };
+    std::unordered_map<uint64_t, Record> index_; // by Key()
+};
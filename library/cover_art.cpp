@@ -0,0 +1,63 @@
+#include "cover_art.h"
+
+#include "track_info.h"
+#include "util/mapped_file.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// Image files that stand for the cover of whatever is in their directory, in
+// order of preference
+static const char* const kCoverNames[] = {"cover", "folder", "front", "album", "albumart"};
+static const char* const kCoverExtensions[] = {".jpg", ".jpeg", ".png"};
+// Anything bigger is not a cover
+static const uint64_t kMaxCoverFile = 32 * 1024 * 1024;
+
+static std::string Lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return text;
+}
+
+// Rank of a file name in kCoverNames, or -1 if it isn't a cover image
+static int CoverRank(const fs::path& name) {
+    const std::string extension = Lower(name.extension().u8string());
+    if (std::find(std::begin(kCoverExtensions), std::end(kCoverExtensions), extension) == std::end(kCoverExtensions))
+        return -1;
+    const std::string stem = Lower(name.stem().u8string());
+    for (size_t i = 0; i < sizeof(kCoverNames) / sizeof(kCoverNames[0]); i++)
+        if (stem == kCoverNames[i]) return (int)i;
+    return -1;
+}
+
+static bool ReadFolderCover(const std::string& trackPath, std::vector<uint8_t>* image) {
+    std::error_code ec;
+    fs::directory_iterator it(fs::u8path(trackPath).parent_path(), fs::directory_options::skip_permission_denied, ec);
+    if (ec) return false;
+    fs::path best;
+    int bestRank = -1;
+    for (; it != fs::directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        const int rank = CoverRank(it->path().filename());
+        if (rank >= 0 && (bestRank < 0 || rank < bestRank) && it->is_regular_file(ec)) {
+            best = it->path();
+            bestRank = rank;
+        }
+    }
+    MappedFile file;
+    if (bestRank < 0 || !file.Open(best.u8string()) || file.Size() == 0 || file.Size() > kMaxCoverFile) return false;
+    image->assign(file.Data(), file.Data() + file.Size());
+    return true;
+}
+
+bool ReadCoverArt(const std::string& trackPath, std::vector<uint8_t>* image) {
+    image->clear();
+    EmbeddedPicture picture;
+    if (ReadEmbeddedPicture(trackPath, &picture)) {
+        *image = std::move(picture.data);
+        return true;
+    }
+    return ReadFolderCover(trackPath, image);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The cover of a track, as an encoded image (JPEG or PNG as a rule): the
+// picture embedded in its tags if it has one, otherwise an image file next to
+// it (cover.jpg, folder.jpg, front.png, ..., matched case-insensitively; the
+// first name in that order wins). False if neither exists.
+bool ReadCoverArt(const std::string& trackPath, std::vector<uint8_t>* image);
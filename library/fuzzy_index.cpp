@@ -0,0 +1,358 @@
+#include "fuzzy_index.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define FUZZY_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FUZZY_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FUZZY_NEON 1
+#include <arm_neon.h>
+#endif
+
+// fzf's scoring constants
+static const int kScoreMatch = 16;
+static const int kScoreGapStart = -3;
+static const int kScoreGapExtension = -1;
+static const int kBonusBoundary = kScoreMatch / 2;
+static const int kBonusNonWord = kScoreMatch / 2;
+static const int kBonusCamel123 = kBonusBoundary + kScoreGapExtension;
+static const int kBonusConsecutive = -(kScoreGapStart + kScoreGapExtension);
+static const int kBonusFirstCharMultiplier = 2;
+static const int kBonusBoundaryWhite = kBonusBoundary + 2;
+static const int kBonusBoundaryDelimiter = kBonusBoundary + 1;
+
+// Scoring is CPU-bound: one thread per core, and only for enough candidates
+static const unsigned kMaxThreads = 16;
+static const size_t kCandidatesPerChunk = 4096;
+
+enum CharClass { kWhite, kNonWord, kDelimiter, kLower, kUpper, kLetter, kNumber };
+
+static CharClass ClassOf(unsigned char c) {
+    if (c >= 'a' && c <= 'z') return kLower;
+    if (c >= 'A' && c <= 'Z') return kUpper;
+    if (c >= '0' && c <= '9') return kNumber;
+    if (c >= 0x80) return kLetter;
+    if (c == ' ' || c == '\t' || c == '\n') return kWhite;
+    if (c == '/' || c == ',' || c == ':' || c == ';' || c == '|') return kDelimiter;
+    return kNonWord;
+}
+
+static int BonusFor(CharClass previous, CharClass current) {
+    if (current > kNonWord) {
+        switch (previous) {
+        case kWhite: return kBonusBoundaryWhite;
+        case kDelimiter: return kBonusBoundaryDelimiter;
+        case kNonWord: return kBonusBoundary;
+        default: break;
+        }
+    }
+    if ((previous == kLower && current == kUpper) || (previous != kNumber && current == kNumber)) return kBonusCamel123;
+    if (current == kNonWord || current == kDelimiter) return kBonusNonWord;
+    if (current == kWhite) return kBonusBoundaryWhite;
+    return 0;
+}
+
+static unsigned char Fold(unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+int FuzzyScore(std::string_view pattern, std::string_view text, bool caseSensitive) {
+    if (pattern.empty()) return 0;
+    const auto at = [&](size_t i) {
+        const unsigned char c = (unsigned char)text[i];
+        return caseSensitive ? c : Fold(c);
+    };
+
+    // Forward to the end of the first complete match...
+    size_t p = 0, start = 0, end = 0;
+    unsigned char want = (unsigned char)pattern[0];
+    for (size_t i = 0; i < text.size(); i++) {
+        if (at(i) != want) continue;
+        if (p == 0) start = i;
+        if (++p == pattern.size()) {
+            end = i + 1;
+            break;
+        }
+        want = (unsigned char)pattern[p];
+    }
+    if (p < pattern.size()) return -1;
+    // ...and back from there to the latest start, for the shortest window
+    p = pattern.size() - 1;
+    for (size_t i = end; i-- > start;) {
+        if (at(i) != (unsigned char)pattern[p]) continue;
+        if (p == 0) {
+            start = i;
+            break;
+        }
+        p--;
+    }
+
+    int score = 0, consecutive = 0, firstBonus = 0;
+    bool inGap = false;
+    CharClass previous = start > 0 ? ClassOf((unsigned char)text[start - 1]) : kWhite;
+    p = 0;
+    for (size_t i = start; i < end; i++) {
+        const CharClass current = ClassOf((unsigned char)text[i]);
+        if (at(i) == (unsigned char)pattern[p]) {
+            score += kScoreMatch;
+            int bonus = BonusFor(previous, current);
+            if (consecutive == 0) {
+                firstBonus = bonus;
+            } else {
+                // A run keeps the bonus of the boundary it started at
+                if (bonus >= kBonusBoundary && bonus > firstBonus) firstBonus = bonus;
+                bonus = std::max(std::max(bonus, firstBonus), kBonusConsecutive);
+            }
+            score += p == 0 ? bonus * kBonusFirstCharMultiplier : bonus;
+            inGap = false;
+            consecutive++;
+            p++;
+        } else {
+            score += inGap ? kScoreGapExtension : kScoreGapStart;
+            inGap = true;
+            consecutive = 0;
+            firstBonus = 0;
+        }
+        previous = current;
+    }
+    // Long gaps can outweigh a few matches; that is still a match
+    return std::max(score, 0);
+}
+
+// Which of 64 buckets a byte falls in: letters (folded) and digits have their
+// own, other bytes share
+static int MaskBit(unsigned char c) {
+    c = Fold(c);
+    if (c >= 'a' && c <= 'z') return c - 'a';
+    if (c >= '0' && c <= '9') return 26 + (c - '0');
+    if (c >= 0x80) return 36 + (c & 15);
+    return 52 + c % 12;
+}
+
+static uint64_t MaskOf(std::string_view text) {
+    uint64_t mask = 0;
+    for (char c : text) {
+        if (c != ' ' && c != '\n') mask |= (uint64_t)1 << MaskBit((unsigned char)c);
+    }
+    return mask;
+}
+
+// Appends to `out` every i in [begin, end) whose mask has all the bits of `need`
+static void FilterMasksScalar(const uint64_t* masks, size_t begin, size_t end, uint64_t need,
+                              std::vector<uint32_t>& out) {
+    for (size_t i = begin; i < end; i++) {
+        if ((masks[i] & need) == need) out.push_back((uint32_t)i);
+    }
+}
+
+#if FUZZY_SSE2
+// No 64-bit compare in SSE2: both 32-bit halves have to match
+static size_t FilterMasksSse2(const uint64_t* masks, size_t count, uint64_t need, std::vector<uint32_t>& out) {
+    const __m128i vneed = _mm_set1_epi64x((long long)need);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128i m = _mm_and_si128(_mm_loadu_si128((const __m128i*)(masks + i)), vneed);
+        const int equal = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(m, vneed)));
+        if ((equal & 3) == 3) out.push_back((uint32_t)i);
+        if ((equal & 12) == 12) out.push_back((uint32_t)i + 1);
+    }
+    return i;
+}
+#endif
+
+#if FUZZY_AVX2
+__attribute__((target("avx2")))
+static size_t FilterMasksAvx2(const uint64_t* masks, size_t count, uint64_t need, std::vector<uint32_t>& out) {
+    const __m256i vneed = _mm256_set1_epi64x((long long)need);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(masks + i)), vneed);
+        const __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(masks + i + 4)), vneed);
+        unsigned equal = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, vneed))) |
+                         (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(b, vneed))) << 4;
+        // Most tracks fail on a specific enough query: skip them eight at a time
+        for (; equal; equal &= equal - 1) out.push_back((uint32_t)(i + __builtin_ctz(equal)));
+    }
+    return i;
+}
+#endif
+
+#if FUZZY_NEON
+static size_t FilterMasksNeon(const uint64_t* masks, size_t count, uint64_t need, std::vector<uint32_t>& out) {
+    const uint32x4_t vneed = vreinterpretq_u32_u64(vdupq_n_u64(need));
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const uint32x4_t m = vandq_u32(vreinterpretq_u32_u64(vld1q_u64(masks + i)), vneed);
+        const uint64x2_t equal = vreinterpretq_u64_u32(vceqq_u32(m, vneed));
+        if (vgetq_lane_u64(equal, 0) == UINT64_MAX) out.push_back((uint32_t)i);
+        if (vgetq_lane_u64(equal, 1) == UINT64_MAX) out.push_back((uint32_t)i + 1);
+    }
+    return i;
+}
+#endif
+
+static void FilterMasks(const uint64_t* masks, size_t count, uint64_t need, std::vector<uint32_t>& out) {
+    size_t i = 0;
+#if FUZZY_AVX2
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    if (hasAvx2) {
+        i = FilterMasksAvx2(masks, count, need, out);
+    } else
+#endif
+    {
+#if FUZZY_SSE2
+        i = FilterMasksSse2(masks, count, need, out);
+#elif FUZZY_NEON
+        i = FilterMasksNeon(masks, count, need, out);
+#endif
+    }
+    FilterMasksScalar(masks, i, count, need, out);
+}
+
+// Runs f(begin, end) over [0, count) in chunks, on up to a thread per core
+template <typename F>
+static void ParallelFor(size_t count, F&& f) {
+    const size_t chunks = (count + kCandidatesPerChunk - 1) / kCandidatesPerChunk;
+    const unsigned threads =
+        (unsigned)std::min<size_t>(chunks, std::min(kMaxThreads, std::max(1u, std::thread::hardware_concurrency())));
+    if (threads <= 1) {
+        f((size_t)0, count);
+        return;
+    }
+    std::atomic<size_t> next{0};
+    const auto work = [&] {
+        for (size_t begin; (begin = next.fetch_add(kCandidatesPerChunk)) < count;) {
+            f(begin, std::min(count, begin + kCandidatesPerChunk));
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) pool.emplace_back(work);
+    work();
+    for (std::thread& thread : pool) thread.join();
+}
+
+FuzzyIndex::FuzzyIndex(std::shared_ptr<const SearchSnapshot> snapshot)
+    : snapshot_(std::move(snapshot)), ids_(snapshot_->ids), text_(snapshot_->text), textEnd_(snapshot_->textEnd),
+      nameStart_(snapshot_->nameStart), artist_(snapshot_->artist), albumArtist_(snapshot_->albumArtist),
+      album_(snapshot_->album), artists_(snapshot_->artists), albums_(snapshot_->albums) {
+    std::vector<uint64_t> artistMasks(artists_.Count()), albumMasks(albums_.Count());
+    for (size_t id = 0; id < artistMasks.size(); id++) artistMasks[id] = MaskOf(artists_.Get((uint32_t)id));
+    for (size_t id = 0; id < albumMasks.size(); id++) albumMasks[id] = MaskOf(albums_.Get((uint32_t)id));
+    masks_.resize(ids_.size());
+    for (uint32_t doc = 0; doc < ids_.size(); doc++) {
+        masks_[doc] = MaskOf(Title(doc)) | MaskOf(Name(doc)) | artistMasks[artist_[doc]] |
+                      artistMasks[albumArtist_[doc]] | albumMasks[album_[doc]];
+    }
+}
+
+std::vector<std::string> FuzzyIndex::Terms(std::string_view query) {
+    std::vector<std::string> terms;
+    size_t i = 0;
+    while (i < query.size()) {
+        while (i < query.size() && query[i] == ' ') i++;
+        const size_t start = i;
+        while (i < query.size() && query[i] != ' ') i++;
+        if (i > start) terms.emplace_back(query.substr(start, i - start));
+    }
+    return terms;
+}
+
+FuzzyIndex::Match FuzzyIndex::Search(std::string_view query, const Match* previous) const {
+    Match match;
+    match.terms = Terms(query);
+    if (match.terms.empty()) return match;
+    for (const std::string& term : match.terms) {
+        for (char c : term) match.caseSensitive |= c >= 'A' && c <= 'Z';
+    }
+    if (!match.caseSensitive) {
+        for (std::string& term : match.terms) {
+            for (char& c : term) c = (char)Fold((unsigned char)c);
+        }
+    }
+    const std::vector<std::string>& terms = match.terms;
+
+    // A longer pattern matches a subset of what a shorter one did, and so
+    // does turning case-sensitive
+    bool narrows = previous && !previous->terms.empty() && previous->terms.size() <= terms.size() &&
+                   (match.caseSensitive || !previous->caseSensitive);
+    for (size_t i = 0; narrows && i < previous->terms.size(); i++) {
+        narrows = terms[i].size() >= previous->terms[i].size() &&
+                  std::equal(previous->terms[i].begin(), previous->terms[i].end(), terms[i].begin(),
+                             [](char a, char b) { return Fold((unsigned char)a) == Fold((unsigned char)b); });
+    }
+
+    std::vector<uint32_t> candidates;
+    if (narrows) {
+        candidates = previous->candidates;
+    } else {
+        uint64_t need = 0;
+        for (const std::string& term : terms) need |= MaskOf(term);
+        FilterMasks(masks_.data(), masks_.size(), need, candidates);
+    }
+
+    // Artists and albums repeat: score each distinct one once per term
+    const size_t termCount = terms.size();
+    std::vector<int> artistScores(termCount * artists_.Count()), albumScores(termCount * albums_.Count());
+    for (size_t t = 0; t < termCount; t++) {
+        for (size_t id = 0; id < artists_.Count(); id++) {
+            artistScores[t * artists_.Count() + id] =
+                FuzzyScore(terms[t], artists_.Get((uint32_t)id), match.caseSensitive);
+        }
+        for (size_t id = 0; id < albums_.Count(); id++) {
+            albumScores[t * albums_.Count() + id] =
+                FuzzyScore(terms[t], albums_.Get((uint32_t)id), match.caseSensitive);
+        }
+    }
+
+    std::vector<int> scores(candidates.size());
+    ParallelFor(candidates.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const uint32_t doc = candidates[i];
+            int total = 0;
+            for (size_t t = 0; t < termCount && total >= 0; t++) {
+                const int* artistScore = &artistScores[t * artists_.Count()];
+                int best = std::max(artistScore[artist_[doc]], artistScore[albumArtist_[doc]]);
+                best = std::max(best, albumScores[t * albums_.Count() + album_[doc]]);
+                best = std::max(best, FuzzyScore(terms[t], Title(doc), match.caseSensitive));
+                best = std::max(best, FuzzyScore(terms[t], Name(doc), match.caseSensitive));
+                total = best < 0 ? -1 : total + best;
+            }
+            scores[i] = total;
+        }
+    });
+
+    // Best first, ties in path order: a counting sort, scores being small
+    int maxScore = 0;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (scores[i] < 0) continue;
+        match.candidates.push_back(candidates[i]);
+        maxScore = std::max(maxScore, scores[i]);
+    }
+    std::vector<uint32_t> start(maxScore + 2, 0);
+    for (int score : scores) {
+        if (score >= 0) start[maxScore - score + 1]++;
+    }
+    for (size_t i = 1; i < start.size(); i++) start[i] += start[i - 1];
+    match.documents.resize(match.candidates.size());
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (scores[i] >= 0) match.documents[start[maxScore - scores[i]]++] = candidates[i];
+    }
+    return match;
+}
+
+size_t FuzzyIndex::MemoryBytes() const {
+    return text_.capacity() + artists_.MemoryBytes() + albums_.MemoryBytes() + masks_.capacity() * sizeof(uint64_t) +
+           (ids_.capacity() + textEnd_.capacity() + nameStart_.capacity() + artist_.capacity() +
+            albumArtist_.capacity() + album_.capacity()) *
+               sizeof(uint32_t);
+}
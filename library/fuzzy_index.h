@@ -0,0 +1,71 @@
+#pragma once
+
+#include "search_index.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Score of `pattern` as a subsequence of `text`, fzf style (its "v1"
+// algorithm): the shortest window that holds the pattern, scored per matched
+// byte with bonuses for the start of a word, a camelCase hump or a digit run,
+// and for runs of consecutive matches; gaps cost, down to 0 at most. -1 if
+// `text` doesn't contain the pattern. Unless `caseSensitive`, ASCII letters in `text` are
+// folded and `pattern` must already be lower case.
+int FuzzyScore(std::string_view pattern, std::string_view text, bool caseSensitive);
+
+// Fuzzy search over the library: every word of a query (split at spaces) must
+// fuzzy-match the title, artist, album or path of a track, and the track
+// scores the sum of its best field per word. Smart case: a query with an
+// upper-case letter matches case-sensitively.
+//
+// Before anything is scored, a 64-bit mask per track of the bytes its fields
+// contain (letters folded, the rest in buckets) weeds out the tracks missing
+// any byte of the query, a few tracks per vector compare. What survives is
+// scored on all cores. Artists and albums are scored once per distinct string.
+class FuzzyIndex {
+public:
+    // Searches the snapshot's text in place; it may be shared, it isn't changed
+    explicit FuzzyIndex(std::shared_ptr<const SearchSnapshot> snapshot);
+
+    struct Match {
+        std::vector<std::string> terms;
+        bool caseSensitive = false;
+        std::vector<uint32_t> candidates; // every matching document, ascending
+        std::vector<uint32_t> documents;  // the same, best score first
+    };
+
+    static std::vector<std::string> Terms(std::string_view query);
+
+    // `previous` is an earlier match on this index; if the query only narrows
+    // it, its documents are the only ones scored
+    Match Search(std::string_view query, const Match* previous) const;
+
+    size_t Documents() const { return ids_.size(); }
+    uint32_t Id(uint32_t document) const { return ids_[document]; }
+    size_t MemoryBytes() const;
+
+private:
+    std::string_view Title(uint32_t doc) const {
+        const uint32_t start = doc ? textEnd_[doc - 1] : 0;
+        return std::string_view(text_.data() + start, nameStart_[doc] - 1 - start);
+    }
+    std::string_view Name(uint32_t doc) const {
+        return std::string_view(text_.data() + nameStart_[doc], textEnd_[doc] - nameStart_[doc]);
+    }
+
+    std::shared_ptr<const SearchSnapshot> snapshot_;
+    // Its fields
+    const std::vector<uint32_t>& ids_;
+    const std::string& text_; // title '\n' name, per document
+    const std::vector<uint32_t>& textEnd_;
+    const std::vector<uint32_t>& nameStart_;
+    const std::vector<uint32_t>& artist_;
+    const std::vector<uint32_t>& albumArtist_;
+    const std::vector<uint32_t>& album_;
+    const StringPool& artists_;
+    const StringPool& albums_;
+    std::vector<uint64_t> masks_; // by document, including its artists and album
+};
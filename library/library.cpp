@@ -0,0 +1,207 @@
+#include "library.h"
+
+#include <algorithm>
+#include <chrono>
+
+Library::Library(std::unordered_set<std::string> extensions)
+    : scanner_(extensions), watcher_(std::move(extensions)) {}
+
+std::vector<std::string> Library::Paths() const {
+    std::vector<std::string> paths;
+    paths.reserve(tracks_.Size());
+    for (size_t i = 0; i < tracks_.Size(); i++) paths.emplace_back(tracks_.Path(i));
+    return paths;
+}
+
+// Files in both scans whose size, mtime or inode differ: rewritten in place.
+// `files` is sorted by path, like the database.
+static std::vector<std::string> ChangedFiles(const LibraryDb& previous, const std::vector<ScannedFile>& files) {
+    std::vector<std::string> changed;
+    size_t old = 0;
+    std::string oldPath = previous.FileCount() > 0 ? previous.FilePath(0) : std::string();
+    for (const ScannedFile& file : files) {
+        while (old < previous.FileCount() && oldPath < file.path) {
+            if (++old < previous.FileCount()) oldPath = previous.FilePath(old);
+        }
+        if (old == previous.FileCount()) break;
+        if (oldPath != file.path) continue;
+        const LibraryDb::File& record = previous.FileAt(old);
+        if (record.size != file.stamp.size || record.mtime != file.stamp.mtime || record.inode != file.inode) {
+            changed.push_back(file.path);
+        }
+    }
+    return changed;
+}
+
+// Tags already read (or on their way) are kept for paths that stay; only new
+// paths are queued
+void Library::SetFiles(const std::vector<std::string>& paths) {
+    std::vector<std::string> unread;
+    tracks_.Replace(paths, &unread);
+    tags_.Add(std::move(unread));
+}
+
+bool Library::LoadSaved() {
+    std::string dbPath = LibraryDb::DefaultPath();
+    auto db = std::make_shared<LibraryDb>();
+    if (dbPath.empty() || !db->Open(dbPath)) return false;
+    db_ = std::move(db);
+    root_ = std::string(db_->Root());
+    tracks_.Clear();
+    tracks_.SetRoot(root_);
+
+    std::vector<std::string> paths;
+    paths.reserve(db_->FileCount());
+    for (size_t i = 0; i < db_->FileCount(); i++) paths.push_back(db_->FilePath(i));
+    SetFiles(paths);
+
+    // Whatever changed while we weren't running; cheap when nothing did, one
+    // stat() per directory. The watcher starts once this is through.
+    Rescan();
+    return true;
+}
+
+void Library::Scan(const std::string& root) {
+    std::string normalized = root;
+    while (normalized.size() > 1 && (normalized.back() == '/' || normalized.back() == '\\')) normalized.pop_back();
+    if (normalized.empty()) return;
+
+    watcher_.Stop();
+    // A sort under way can't be stopped, and dropping its future would wait
+    // for it: it is waited for on a worker instead, which the next sort waits
+    // for in turn before it writes the database
+    if (sorting_.valid()) {
+        superseded_ = std::async(std::launch::async, [sorting = std::move(sorting_),
+                                                      before = std::move(superseded_)]() mutable {
+            if (before.valid()) before.wait();
+            sorting.wait();
+        });
+    }
+    scanned_.clear();
+    background_ = !root_.empty() && normalized == root_;
+    if (!background_) {
+        root_ = normalized;
+        tracks_.Clear();
+        tracks_.SetRoot(root_);
+        tags_.Clear();
+        db_.reset();
+    }
+    scanner_.Start(root_, db_);
+    scanning_ = true;
+}
+
+Library::Update Library::Poll() {
+    Update update = Update::None;
+
+    // Results arrive in batches; once done they are sorted and the database is
+    // written off the UI thread
+    if (scanning_) {
+        bool done = scanner_.Progress().done;
+        size_t before = scanned_.size();
+        scanner_.Poll(scanned_);
+        // A new root is shown as it is found; a rescan swaps in at the end
+        if (!background_) {
+            for (size_t i = before; i < scanned_.size(); i++) tracks_.Append(scanned_[i].path);
+        }
+        if (done) {
+            scanning_ = false;
+            std::vector<ScannedDirectory> directories;
+            scanner_.TakeDirectories(directories);
+            sorting_ = std::async(std::launch::async, [files = std::move(scanned_),
+                                                       directories = std::move(directories), root = root_,
+                                                       previous = background_ ? db_ : nullptr,
+                                                       superseded = std::move(superseded_)]() mutable {
+                ScanResult result;
+                std::sort(files.begin(), files.end(),
+                          [](const ScannedFile& a, const ScannedFile& b) { return a.path < b.path; });
+                if (previous) result.changed = ChangedFiles(*previous, files);
+                result.directories.reserve(directories.size());
+                for (const ScannedDirectory& dir : directories) result.directories.push_back(dir.path);
+                std::string dbPath = LibraryDb::DefaultPath();
+                if (superseded.valid()) superseded.wait();
+                if (!dbPath.empty()) LibraryDb::Write(dbPath, root, std::move(directories), files);
+                result.files = std::move(files);
+                return result;
+            });
+            scanned_.clear();
+        }
+    }
+
+    if (sorting_.valid() && sorting_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        ScanResult result = sorting_.get();
+        std::vector<std::string> paths;
+        paths.reserve(result.files.size());
+        for (ScannedFile& file : result.files) paths.push_back(std::move(file.path));
+        if (!background_) {
+            // The list shown during the scan is unsorted and has no tags
+            tracks_.Clear();
+        }
+        SetFiles(paths);
+        // Paths that stay keep their tags, unless the file was rewritten
+        tags_.Add(std::move(result.changed));
+        update = background_ ? Update::Changed : Update::Replaced;
+        background_ = false;
+
+        // The next rescan only lists directories that changed since this one
+        db_ = std::make_shared<LibraryDb>();
+        if (!db_->Open(LibraryDb::DefaultPath())) db_.reset();
+        watcher_.Start(root_, std::move(result.directories));
+    }
+
+    // Live changes; the watcher isn't running during a scan
+    std::vector<LibraryChange> changes;
+    if (!Busy() && watcher_.Poll(changes) && Apply(changes) && update == Update::None) update = Update::Changed;
+
+    // Tags land by path: the list may have changed since they were queued.
+    // While a new root is being scanned the list isn't sorted yet; they wait.
+    if (!Replacing()) {
+        std::vector<TagResult> results;
+        tags_.Poll(results);
+        for (TagResult& result : results) {
+            int index = tracks_.Find(result.path);
+            if (index >= 0) tracks_.SetInfo(index, result.info, result.ok);
+        }
+    }
+    return update;
+}
+
+bool Library::Apply(const std::vector<LibraryChange>& changes) {
+    bool changed = false;
+    for (const LibraryChange& change : changes) {
+        const std::string& path = change.file.path;
+        switch (change.type) {
+        case LibraryChange::Type::Upsert: {
+            // New or rewritten: either way its tags are (re)read
+            tags_.Add({path});
+            size_t index = tracks_.LowerBound(path);
+            if (index < tracks_.Size() && tracks_.Path(index) == path) break;
+            tracks_.Insert(index, path);
+            changed = true;
+            break;
+        }
+        case LibraryChange::Type::Remove: {
+            int index = tracks_.Find(path);
+            if (index < 0) break;
+            tracks_.Erase(index, index + 1);
+            changed = true;
+            break;
+        }
+        case LibraryChange::Type::RemoveTree: {
+            // Everything under "dir/" sorts together, right after "dir/"
+            const std::string prefix = path + '/';
+            const size_t first = tracks_.LowerBound(prefix);
+            size_t last = first;
+            while (last < tracks_.Size() && tracks_.Path(last).compare(0, prefix.size(), prefix) == 0) last++;
+            if (first == last) break;
+            tracks_.Erase(first, last);
+            changed = true;
+            break;
+        }
+        case LibraryChange::Type::Rescan:
+            // Picks up where the database left off; the list stays meanwhile
+            Rescan();
+            return changed;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "library_db.h"
+#include "scanner.h"
+#include "tag_reader.h"
+#include "track_table.h"
+#include "watcher.h"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// The music library as the UI sees it: the files under one root folder,
+// sorted by path, with their tags. Ties together the scanner, the on-disk
+// database, the watcher and the tag reader. All methods are for the UI
+// thread; the work happens elsewhere.
+class Library {
+public:
+    enum class Update {
+        None,
+        Replaced, // a different library; the old track indices mean nothing
+        Changed,  // files came or went; tracks keep their paths
+    };
+
+    // `extensions` are lower case with the dot (".mp3").
+    explicit Library(std::unordered_set<std::string> extensions);
+
+    // Shows the library saved by the last run and checks it for changes in
+    // the background. False if there is none.
+    bool LoadSaved();
+    // Scans `root` from scratch, or incrementally if it is the current root.
+    // A new root empties the list until the scan is done; a rescan keeps the
+    // current one meanwhile.
+    void Scan(const std::string& root);
+    void Rescan() { Scan(root_); }
+
+    // Call once per frame.
+    Update Poll();
+
+    // Rows in path order; tags are filled in as the tag reader gets to them
+    const TrackTable& Tracks() const { return tracks_; }
+    // The paths alone, for the engine's playlist
+    std::vector<std::string> Paths() const;
+    const std::string& Root() const { return root_; }
+    // Row of `path`, or -1
+    int Find(const std::string& path) const { return tracks_.Find(path); }
+
+    // Scanning a new root: the list is partial and unsorted.
+    bool Replacing() const { return (scanning_ || sorting_.valid()) && !background_; }
+    bool Busy() const { return scanning_ || sorting_.valid(); }
+    ScanProgress Progress() const { return scanner_.Progress(); }
+    WatcherStatus Watching() const { return watcher_.Status(); }
+    TagProgress TagsProgress() const { return tags_.Progress(); }
+
+private:
+    struct ScanResult {
+        std::vector<ScannedFile> files;
+        std::vector<std::string> directories;
+        std::vector<std::string> changed; // files of the last scan rewritten since
+    };
+
+    void SetFiles(const std::vector<std::string>& paths);
+    bool Apply(const std::vector<LibraryChange>& changes);
+
+    LibraryScanner scanner_;
+    LibraryWatcher watcher_;
+    TagReader tags_;
+    std::shared_ptr<LibraryDb> db_;
+
+    std::string root_; // without a trailing slash
+    TrackTable tracks_;
+
+    bool scanning_ = false;
+    bool background_ = false;
+    std::vector<ScannedFile> scanned_;
+    std::future<ScanResult> sorting_;
+    std::future<void> superseded_; // sorts of scans given up on, until they finish
+};
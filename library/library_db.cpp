@@ -0,0 +1,217 @@
+#include "library_db.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+static const char kLibraryMagic[4] = {'C', 'M', 'L', 'B'};
+static const uint32_t kLibraryVersion = 1;
+
+struct LibraryDbHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t directoryCount;
+    uint32_t fileCount;
+    uint32_t refCount;
+    uint32_t rootOffset;
+    uint32_t rootLength;
+    uint32_t reserved;
+    uint64_t stringBytes;
+};
+
+static_assert(sizeof(LibraryDbHeader) % 8 == 0 && sizeof(LibraryDb::Directory) % 8 == 0 &&
+                  sizeof(LibraryDb::File) % 8 == 0,
+              "records are read in place and must stay 8-byte aligned");
+
+bool LibraryDb::Open(const std::string& path) {
+    directories_ = nullptr;
+    files_ = nullptr;
+    directoryCount_ = fileCount_ = 0;
+    if (!file_.Open(path) || file_.Size() < sizeof(LibraryDbHeader)) return false;
+
+    LibraryDbHeader header;
+    memcpy(&header, file_.Data(), sizeof(header));
+    const uint64_t expected = sizeof(header) + (uint64_t)header.directoryCount * sizeof(Directory) +
+                              (uint64_t)header.fileCount * sizeof(File) + (uint64_t)header.refCount * 4 +
+                              header.stringBytes;
+    if (memcmp(header.magic, kLibraryMagic, 4) != 0 || header.version != kLibraryVersion ||
+        expected != file_.Size() || (uint64_t)header.rootOffset + header.rootLength > header.stringBytes) {
+        file_.Close();
+        return false;
+    }
+
+    const uint8_t* p = file_.Data() + sizeof(header);
+    const Directory* directories = (const Directory*)p;
+    p += (size_t)header.directoryCount * sizeof(Directory);
+    const File* files = (const File*)p;
+    p += (size_t)header.fileCount * sizeof(File);
+    const uint32_t* refs = (const uint32_t*)p;
+    p += (size_t)header.refCount * 4;
+
+    // One pass over the records so a damaged file is rejected here rather
+    // than read out of bounds later
+    for (uint32_t i = 0; i < header.directoryCount; i++) {
+        const Directory& dir = directories[i];
+        bool ok = (uint64_t)dir.pathOffset + dir.pathLength <= header.stringBytes &&
+                  (uint64_t)dir.firstFile + dir.fileCount <= header.refCount &&
+                  (uint64_t)dir.firstSubdir + dir.subdirCount <= header.refCount;
+        for (uint32_t j = 0; ok && j < dir.fileCount; j++) ok = refs[dir.firstFile + j] < header.fileCount;
+        for (uint32_t j = 0; ok && j < dir.subdirCount; j++) ok = refs[dir.firstSubdir + j] < header.directoryCount;
+        if (!ok) {
+            file_.Close();
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header.fileCount; i++) {
+        const File& f = files[i];
+        if (f.directory >= header.directoryCount || (uint64_t)f.nameOffset + f.nameLength > header.stringBytes) {
+            file_.Close();
+            return false;
+        }
+    }
+
+    directories_ = directories;
+    files_ = files;
+    refs_ = refs;
+    strings_ = (const char*)p;
+    directoryCount_ = header.directoryCount;
+    fileCount_ = header.fileCount;
+    rootOffset_ = header.rootOffset;
+    rootLength_ = header.rootLength;
+    return true;
+}
+
+int64_t LibraryDb::FindDirectory(std::string_view path) const {
+    size_t lo = 0, hi = directoryCount_;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        int c = DirectoryPath(directories_[mid]).compare(path);
+        if (c == 0) return (int64_t)mid;
+        if (c < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return -1;
+}
+
+std::string LibraryDb::FilePath(size_t index) const {
+    const File& f = files_[index];
+    std::string_view dir = DirectoryPath(directories_[f.directory]);
+    std::string path;
+    path.reserve(dir.size() + 1 + f.nameLength);
+    path.append(dir.data(), dir.size());
+    if (path.empty() || path.back() != '/') path += '/';
+    path.append(strings_ + f.nameOffset, f.nameLength);
+    return path;
+}
+
+ScannedFile LibraryDb::ScannedFileAt(size_t index) const {
+    const File& f = files_[index];
+    ScannedFile file;
+    file.path = FilePath(index);
+    file.stamp.size = f.size;
+    file.stamp.mtime = f.mtime;
+    file.inode = f.inode;
+    return file;
+}
+
+static std::string_view ParentOf(std::string_view path) {
+    size_t slash = path.rfind('/');
+    if (slash == std::string_view::npos) return std::string_view();
+    return slash == 0 ? path.substr(0, 1) : path.substr(0, slash);
+}
+
+bool LibraryDb::Write(const std::string& path, const std::string& root, std::vector<ScannedDirectory> directories,
+                      const std::vector<ScannedFile>& files) {
+    std::sort(directories.begin(), directories.end(),
+              [](const ScannedDirectory& a, const ScannedDirectory& b) { return a.path < b.path; });
+    std::unordered_map<std::string_view, uint32_t> index;
+    index.reserve(directories.size());
+    for (size_t i = 0; i < directories.size(); i++) index.emplace(directories[i].path, (uint32_t)i);
+
+    std::string strings = root;
+    std::vector<Directory> dirRecords(directories.size());
+    for (size_t i = 0; i < directories.size(); i++) {
+        Directory& dir = dirRecords[i];
+        memset(&dir, 0, sizeof(dir));
+        dir.pathOffset = (uint32_t)strings.size();
+        dir.pathLength = (uint32_t)directories[i].path.size();
+        dir.mtime = directories[i].mtime;
+        dir.inode = directories[i].inode;
+        strings += directories[i].path;
+    }
+
+    // Files keep their (sorted) order; each directory lists its own
+    std::vector<File> fileRecords;
+    fileRecords.reserve(files.size());
+    std::vector<std::vector<uint32_t>> filesOf(directories.size());
+    for (const ScannedFile& scanned : files) {
+        std::string_view parent = ParentOf(scanned.path);
+        auto it = index.find(parent);
+        if (it == index.end()) continue;
+        File f;
+        memset(&f, 0, sizeof(f));
+        f.directory = it->second;
+        std::string_view name = std::string_view(scanned.path).substr(parent.size() + (parent == "/" ? 0 : 1));
+        f.nameOffset = (uint32_t)strings.size();
+        f.nameLength = (uint32_t)name.size();
+        f.size = scanned.stamp.size;
+        f.mtime = scanned.stamp.mtime;
+        f.inode = scanned.inode;
+        strings.append(name.data(), name.size());
+        filesOf[it->second].push_back((uint32_t)fileRecords.size());
+        fileRecords.push_back(f);
+    }
+    std::vector<std::vector<uint32_t>> subdirsOf(directories.size());
+    for (size_t i = 0; i < directories.size(); i++) {
+        auto it = index.find(ParentOf(directories[i].path));
+        if (it != index.end() && it->second != i) subdirsOf[it->second].push_back((uint32_t)i);
+    }
+    if (strings.size() > UINT32_MAX) return false;
+
+    std::vector<uint32_t> refs;
+    refs.reserve(fileRecords.size() + directories.size());
+    for (size_t i = 0; i < directories.size(); i++) {
+        dirRecords[i].firstFile = (uint32_t)refs.size();
+        dirRecords[i].fileCount = (uint32_t)filesOf[i].size();
+        refs.insert(refs.end(), filesOf[i].begin(), filesOf[i].end());
+        dirRecords[i].firstSubdir = (uint32_t)refs.size();
+        dirRecords[i].subdirCount = (uint32_t)subdirsOf[i].size();
+        refs.insert(refs.end(), subdirsOf[i].begin(), subdirsOf[i].end());
+    }
+
+    LibraryDbHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kLibraryMagic, 4);
+    header.version = kLibraryVersion;
+    header.directoryCount = (uint32_t)dirRecords.size();
+    header.fileCount = (uint32_t)fileRecords.size();
+    header.refCount = (uint32_t)refs.size();
+    header.rootOffset = 0;
+    header.rootLength = (uint32_t)root.size();
+    header.stringBytes = strings.size();
+
+    std::vector<uint8_t> blob(sizeof(header) + dirRecords.size() * sizeof(Directory) +
+                              fileRecords.size() * sizeof(File) + refs.size() * 4 + strings.size());
+    uint8_t* p = blob.data();
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    memcpy(p, dirRecords.data(), dirRecords.size() * sizeof(Directory));
+    p += dirRecords.size() * sizeof(Directory);
+    memcpy(p, fileRecords.data(), fileRecords.size() * sizeof(File));
+    p += fileRecords.size() * sizeof(File);
+    memcpy(p, refs.data(), refs.size() * 4);
+    p += refs.size() * 4;
+    memcpy(p, strings.data(), strings.size());
+
+    if (!WriteFileAtomic(path, blob.data(), blob.size())) {
+        std::cerr << "Failed to write library database: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string LibraryDb::DefaultPath() {
+    std::string dir = CacheDir("library");
+    return dir.empty() ? std::string() : dir + "/library.db";
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "util/cache_dir.h"
+#include "util/mapped_file.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ScannedFile {
+    std::string path;
+    FileStamp stamp;
+    uint64_t inode = 0;
+};
+
+struct ScannedDirectory {
+    std::string path;
+    int64_t mtime = 0; // nanoseconds; 0 where the platform can't tell
+    uint64_t inode = 0;
+};
+
+// The library as of the last scan, memory-mapped read-only. Files are stored
+// in playlist order (sorted by path), directories sorted by path with their
+// own mtime/inode, files and subdirectories, so a rescan can tell from one
+// stat() that a directory is unchanged and take its contents from here.
+//
+// A directory's mtime changes when entries are added, removed or renamed, not
+// when a file inside is rewritten in place. Each file's size, mtime and inode
+// are kept too: a rescan stats the files of unchanged directories and compares
+// them, so rewritten files have their tags read again.
+//
+// Layout (native endian, like the other caches): header, directory records,
+// file records, u32 reference lists, string bytes.
+class LibraryDb {
+public:
+    struct Directory {
+        uint32_t pathOffset;
+        uint32_t pathLength;
+        int64_t mtime;
+        uint64_t inode;
+        uint32_t firstFile; // into the reference list, `fileCount` file indices
+        uint32_t fileCount;
+        uint32_t firstSubdir; // into the reference list, `subdirCount` directory indices
+        uint32_t subdirCount;
+    };
+
+    struct File {
+        uint32_t directory;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t reserved;
+        uint64_t size;
+        int64_t mtime;
+        uint64_t inode;
+    };
+
+    bool Open(const std::string& path);
+    bool IsOpen() const { return file_.IsOpen(); }
+
+    std::string_view Root() const { return String(rootOffset_, rootLength_); }
+
+    size_t DirectoryCount() const { return directoryCount_; }
+    const Directory& DirectoryAt(size_t index) const { return directories_[index]; }
+    std::string_view DirectoryPath(const Directory& dir) const { return String(dir.pathOffset, dir.pathLength); }
+    // Index of the directory at `path`, or -1.
+    int64_t FindDirectory(std::string_view path) const;
+    // The file and subdirectory indices listed for `dir`
+    const uint32_t* Refs(uint32_t first) const { return refs_ + first; }
+
+    size_t FileCount() const { return fileCount_; }
+    const File& FileAt(size_t index) const { return files_[index]; }
+    std::string FilePath(size_t index) const;
+    ScannedFile ScannedFileAt(size_t index) const;
+
+    // Writes a new database for a scan of `root`. `files` must be sorted by path.
+    static bool Write(const std::string& path, const std::string& root, std::vector<ScannedDirectory> directories,
+                      const std::vector<ScannedFile>& files);
+
+    // Where the library is kept between runs; empty if there is no cache dir.
+    static std::string DefaultPath();
+
+private:
+    std::string_view String(uint32_t offset, uint32_t length) const {
+        return std::string_view(strings_ + offset, length);
+    }
+
+    MappedFile file_;
+    const Directory* directories_ = nullptr;
+    const File* files_ = nullptr;
+    const uint32_t* refs_ = nullptr;
+    const char* strings_ = nullptr;
+    size_t directoryCount_ = 0;
+    size_t fileCount_ = 0;
+    uint32_t rootOffset_ = 0;
+    uint32_t rootLength_ = 0;
+};
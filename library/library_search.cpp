@@ -0,0 +1,135 @@
+#include "library_search.h"
+
+// While the library keeps changing (tags coming in), it is reindexed at most
+// this often, counted from the end of the last build
+static const auto kReindexInterval = std::chrono::seconds(2);
+
+LibrarySearch::~LibrarySearch() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void LibrarySearch::Query(const std::string& query, bool fuzzy) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        query_ = query;
+        fuzzy_ = fuzzy;
+        queryPending_ = !query.empty();
+        resultsReady_ = false;
+    }
+    if (!thread_.joinable()) thread_ = std::thread(&LibrarySearch::WorkerMain, this);
+    wake_.notify_one();
+}
+
+void LibrarySearch::Sync(const TrackTable& tracks) {
+    const auto now = std::chrono::steady_clock::now();
+    if (indexing_.valid()) {
+        if (indexing_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+        Indexes indexes = indexing_.get();
+        snapshot_ = std::move(indexes.snapshot);
+        indexedAt_ = now;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Results of the old indexes don't carry over; the query runs again
+            index_ = std::move(indexes.index);
+            fuzzyIndex_ = std::move(indexes.fuzzyIndex);
+            indexGeneration_++;
+            queryPending_ = !query_.empty();
+        }
+        wake_.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (query_.empty()) return;
+    }
+    if (snapshot_ && tracks.Revision() == indexedRevision_) return;
+    if (snapshot_ && now - indexedAt_ < kReindexInterval) return;
+
+    std::unique_ptr<SearchPatch> patch;
+    if (snapshot_) patch = SearchPatch::Since(tracks, indexedRevision_, indexedLayout_, *snapshot_);
+    if (patch) {
+        indexing_ = std::async(std::launch::async, [snapshot = snapshot_, patch = std::move(patch)] {
+            return Build(snapshot->Patched(*patch));
+        });
+    } else {
+        // Every string of the table: read on the build's thread, from a copy
+        auto copy = std::make_shared<const TrackTable>(tracks);
+        indexing_ = std::async(std::launch::async, [copy = std::move(copy)]() mutable {
+            std::unique_ptr<SearchSnapshot> snapshot = SearchSnapshot::Of(*copy);
+            // The sooner it goes, the fewer columns the UI thread copies on change
+            copy.reset();
+            return Build(std::move(snapshot));
+        });
+    }
+    indexedRevision_ = tracks.Revision();
+    indexedLayout_ = tracks.Layout();
+}
+
+bool LibrarySearch::Poll(SearchResults& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!resultsReady_) return false;
+    out = std::move(results_);
+    resultsReady_ = false;
+    return true;
+}
+
+bool LibrarySearch::Indexing() const {
+    return indexing_.valid();
+}
+
+LibrarySearch::Indexes LibrarySearch::Build(std::shared_ptr<const SearchSnapshot> snapshot) {
+    Indexes indexes;
+    indexes.index = std::make_shared<SearchIndex>(*snapshot);
+    indexes.fuzzyIndex = std::make_shared<FuzzyIndex>(snapshot);
+    indexes.snapshot = std::move(snapshot);
+    return indexes;
+}
+
+void LibrarySearch::WorkerMain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [this] { return stop_ || (queryPending_ && index_); });
+        if (stop_) return;
+
+        const std::string query = query_;
+        const bool fuzzy = fuzzy_;
+        // Kept alive while searched even if new ones come in meanwhile
+        const std::shared_ptr<SearchIndex> index = index_;
+        const std::shared_ptr<FuzzyIndex> fuzzyIndex = fuzzyIndex_;
+        const uint64_t generation = indexGeneration_;
+        queryPending_ = false;
+        lock.unlock();
+        if (generation != searchedGeneration_) {
+            last_ = SearchIndex::Match();
+            lastFuzzy_ = FuzzyIndex::Match();
+            searchedGeneration_ = generation;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        SearchResults results;
+        results.query = query;
+        results.ranked = fuzzy;
+        if (fuzzy) {
+            FuzzyIndex::Match match = fuzzyIndex->Search(query, &lastFuzzy_);
+            results.ids.reserve(match.documents.size());
+            for (uint32_t doc : match.documents) results.ids.push_back(fuzzyIndex->Id(doc));
+            lastFuzzy_ = std::move(match);
+        } else {
+            SearchIndex::Match match = index->Search(SearchIndex::Terms(query), &last_);
+            results.ids.reserve(match.documents.size());
+            for (uint32_t doc : match.documents) results.ids.push_back(index->Id(doc));
+            last_ = std::move(match);
+        }
+        results.milliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        lock.lock();
+        // Only if nothing newer was asked for in the meantime
+        if (query_ == query && fuzzy_ == fuzzy) {
+            results_ = std::move(results);
+            resultsReady_ = true;
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "fuzzy_index.h"
+#include "search_index.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SearchResults {
+    std::string query;
+    std::vector<uint32_t> ids; // track ids
+    bool ranked = false;       // ids are best match first, not in path order
+    double milliseconds = 0;   // spent on the query, not counting the wait
+};
+
+// Search-as-you-type over the library on a thread of its own. The UI posts
+// the query on every keystroke and polls for results; queries that pile up
+// while one runs collapse into the latest. The indexes (SearchIndex for word
+// prefixes, FuzzyIndex for fuzzy matching) are built the first time something
+// is searched for and rebuilt when the library has changed since. Builds run
+// on a thread of their own while queries go on with the old indexes, from a
+// copy of the table that the build reads, or, while only tags come in, from
+// the last snapshot patched with the tracks retagged since.
+class LibrarySearch {
+public:
+    LibrarySearch() = default;
+    ~LibrarySearch();
+
+    LibrarySearch(const LibrarySearch&) = delete;
+    LibrarySearch& operator=(const LibrarySearch&) = delete;
+
+    // An empty query cancels the search; there are no results for it. A fuzzy
+    // query has its results ranked.
+    void Query(const std::string& query, bool fuzzy = false);
+    // Reindexes `tracks` when needed and takes in new indexes; call every frame.
+    void Sync(const TrackTable& tracks);
+
+    // Results of the current query, once. Returns false if there are none yet.
+    bool Poll(SearchResults& out);
+    bool Indexing() const;
+
+private:
+    struct Indexes {
+        std::shared_ptr<const SearchSnapshot> snapshot;
+        std::shared_ptr<SearchIndex> index;
+        std::shared_ptr<FuzzyIndex> fuzzyIndex;
+    };
+
+    static Indexes Build(std::shared_ptr<const SearchSnapshot> snapshot);
+    void WorkerMain();
+
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::shared_ptr<SearchIndex> index_; // put in by the UI thread
+    std::shared_ptr<FuzzyIndex> fuzzyIndex_;
+    uint64_t indexGeneration_ = 0;
+    std::string query_;
+    bool fuzzy_ = false;
+    bool queryPending_ = false;
+    SearchResults results_;
+    bool resultsReady_ = false;
+
+    // Worker only
+    uint64_t searchedGeneration_ = 0; // of the indexes last_ and lastFuzzy_ are from
+    SearchIndex::Match last_;
+    FuzzyIndex::Match lastFuzzy_;
+
+    // UI only
+    std::future<Indexes> indexing_;
+    std::shared_ptr<const SearchSnapshot> snapshot_; // the current indexes are of it
+    uint32_t indexedRevision_ = 0;
+    uint32_t indexedLayout_ = 0;
+    std::chrono::steady_clock::time_point indexedAt_;
+};
@@ -0,0 +1,318 @@
+#include "scanner.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#include <filesystem>
+#include <system_error>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+// Files collected by a worker before they are handed to the UI
+static const size_t kBatchFiles = 512;
+// Stat latency, not CPU, is what limits a scan of a network share
+static const unsigned kMinThreads = 4;
+static const unsigned kMaxThreads = 32;
+
+LibraryScanner::LibraryScanner(std::unordered_set<std::string> extensions) : extensions_(std::move(extensions)) {}
+
+LibraryScanner::~LibraryScanner() {
+    Cancel();
+}
+
+void LibraryScanner::Start(const std::string& root, std::shared_ptr<const LibraryDb> previous) {
+    Cancel();
+    cancel_.store(false);
+    directories_.store(0);
+    files_.store(0);
+    errors_.store(0);
+    reused_.store(0);
+    {
+        std::lock_guard<std::mutex> lock(resultMutex_);
+        results_.clear();
+        visited_.clear();
+    }
+    previous_ = previous && previous->IsOpen() ? std::move(previous) : nullptr;
+
+    // Directories are keyed without a trailing slash
+    std::string top = root;
+    while (top.size() > 1 && top.back() == '/') top.pop_back();
+
+    const unsigned threads = std::min(kMaxThreads, std::max(kMinThreads, 2 * std::thread::hardware_concurrency()));
+    workers_.clear();
+    for (unsigned i = 0; i < threads; i++) workers_.push_back(std::make_unique<Worker>());
+    workers_[0]->tasks.push_back(top);
+    pending_.store(1);
+    running_.store(threads);
+    for (unsigned i = 0; i < threads; i++) threads_.emplace_back(&LibraryScanner::WorkerMain, this, (size_t)i);
+}
+
+void LibraryScanner::Cancel() {
+    cancel_.store(true);
+    idle_.notify_all();
+    Join();
+}
+
+void LibraryScanner::Join() {
+    for (std::thread& thread : threads_) thread.join();
+    threads_.clear();
+    workers_.clear();
+    previous_.reset();
+    pending_.store(0);
+    running_.store(0);
+}
+
+bool LibraryScanner::Poll(std::vector<ScannedFile>& out) {
+    std::lock_guard<std::mutex> lock(resultMutex_);
+    if (results_.empty()) return false;
+    if (out.empty()) {
+        out.swap(results_);
+    } else {
+        out.insert(out.end(), std::make_move_iterator(results_.begin()), std::make_move_iterator(results_.end()));
+        results_.clear();
+    }
+    return true;
+}
+
+void LibraryScanner::TakeDirectories(std::vector<ScannedDirectory>& out) {
+    std::lock_guard<std::mutex> lock(resultMutex_);
+    out.swap(visited_);
+    visited_.clear();
+}
+
+ScanProgress LibraryScanner::Progress() const {
+    ScanProgress progress;
+    progress.directories = directories_.load(std::memory_order_relaxed);
+    progress.files = files_.load(std::memory_order_relaxed);
+    progress.errors = errors_.load(std::memory_order_relaxed);
+    progress.reused = reused_.load(std::memory_order_relaxed);
+    progress.done = running_.load(std::memory_order_acquire) == 0;
+    return progress;
+}
+
+void LibraryScanner::WorkerMain(size_t index) {
+    std::vector<std::string> subdirs;
+    std::vector<ScannedFile> batch;
+    std::vector<ScannedDirectory> visited;
+    std::string dir;
+
+    while (!cancel_.load(std::memory_order_relaxed)) {
+        if (!TakeTask(index, &dir)) {
+            if (pending_.load(std::memory_order_acquire) == 0) break;
+            // Others are still listing and may queue more; show what we have meanwhile
+            Deliver(batch, visited);
+            std::unique_lock<std::mutex> lock(idleMutex_);
+            idle_.wait_for(lock, std::chrono::milliseconds(2));
+            continue;
+        }
+
+        ScanDirectory(dir, subdirs, batch, visited);
+        Push(index, subdirs);
+        if (batch.size() >= kBatchFiles) Deliver(batch, visited);
+        // Children were counted before the parent is retired, so zero means done
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) idle_.notify_all();
+    }
+    Deliver(batch, visited);
+    running_.fetch_sub(1, std::memory_order_release);
+}
+
+// Own deque from the back, other workers' from the front
+bool LibraryScanner::TakeTask(size_t index, std::string* dir) {
+    const size_t count = workers_.size();
+    {
+        Worker& own = *workers_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            *dir = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < count; i++) {
+        Worker& victim = *workers_[(index + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            *dir = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void LibraryScanner::Push(size_t index, std::vector<std::string>& dirs) {
+    if (dirs.empty()) return;
+    pending_.fetch_add((int64_t)dirs.size(), std::memory_order_acq_rel);
+    {
+        Worker& own = *workers_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        for (std::string& dir : dirs) own.tasks.push_back(std::move(dir));
+    }
+    if (dirs.size() > 1) idle_.notify_all();
+    dirs.clear();
+}
+
+void LibraryScanner::Deliver(std::vector<ScannedFile>& batch, std::vector<ScannedDirectory>& visited) {
+    if (batch.empty() && visited.empty()) return;
+    std::lock_guard<std::mutex> lock(resultMutex_);
+    visited_.insert(visited_.end(), std::make_move_iterator(visited.begin()), std::make_move_iterator(visited.end()));
+    visited.clear();
+    if (results_.empty()) {
+        results_.swap(batch);
+    } else {
+        results_.insert(results_.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+        batch.clear();
+    }
+}
+
+bool MatchesExtension(const std::unordered_set<std::string>& extensions, const char* name) {
+    const char* dot = strrchr(name, '.');
+    if (!dot || strlen(dot) > 8) return false;
+    char ext[9];
+    size_t n = 0;
+    for (; dot[n]; n++) ext[n] = (char)tolower((unsigned char)dot[n]);
+    return extensions.count(std::string(ext, n)) != 0;
+}
+
+static std::string JoinPath(const std::string& dir, const char* name) {
+    std::string path;
+    path.reserve(dir.size() + strlen(name) + 1);
+    path = dir;
+    if (path.empty() || path.back() != '/') path += '/';
+    path += name;
+    return path;
+}
+
+#ifdef _WIN32
+
+// No cheap change detection here, so every directory is listed
+void LibraryScanner::ScanDirectory(const std::string& dir, std::vector<std::string>& subdirs,
+                                   std::vector<ScannedFile>& batch, std::vector<ScannedDirectory>& visited) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::directory_iterator it(fs::u8path(dir), fs::directory_options::skip_permission_denied, ec);
+    if (ec) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    directories_.fetch_add(1, std::memory_order_relaxed);
+    visited.push_back({dir, 0, 0});
+    for (; it != fs::directory_iterator() && !cancel_.load(std::memory_order_relaxed); it.increment(ec)) {
+        if (ec) break;
+        const fs::directory_entry& entry = *it;
+        if (entry.is_symlink(ec)) continue;
+        std::string path = entry.path().u8string();
+        if (entry.is_directory(ec)) {
+            subdirs.push_back(std::move(path));
+        } else if (entry.is_regular_file(ec) &&
+                   MatchesExtension(extensions_, entry.path().filename().u8string().c_str())) {
+            ScannedFile file;
+            file.path = std::move(path);
+            if (!GetFileStamp(file.path, &file.stamp)) continue;
+            batch.push_back(std::move(file));
+            files_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+#else
+
+static int64_t MtimeNs(const struct stat& st) {
+#ifdef __APPLE__
+    return (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+bool LibraryScanner::Reuse(const std::string& dir, int64_t mtime, uint64_t inode, std::vector<std::string>& subdirs,
+                           std::vector<ScannedFile>& batch) {
+    if (!previous_ || mtime == 0) return false;
+    int64_t index = previous_->FindDirectory(dir);
+    if (index < 0) return false;
+    const LibraryDb::Directory& record = previous_->DirectoryAt((size_t)index);
+    if (record.mtime != mtime || record.inode != inode) return false;
+
+    // The directory's mtime misses files rewritten in place, so each file gets
+    // a stat() of its own; the library reads the tags of changed ones again
+    const uint32_t* files = previous_->Refs(record.firstFile);
+    for (uint32_t i = 0; i < record.fileCount; i++) {
+        if (cancel_.load(std::memory_order_relaxed)) break;
+        ScannedFile file = previous_->ScannedFileAt(files[i]);
+        struct stat st;
+        if (stat(file.path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        file.stamp.size = (uint64_t)st.st_size;
+        file.stamp.mtime = (int64_t)st.st_mtime;
+        file.inode = (uint64_t)st.st_ino;
+        batch.push_back(std::move(file));
+        files_.fetch_add(1, std::memory_order_relaxed);
+    }
+    const uint32_t* dirs = previous_->Refs(record.firstSubdir);
+    for (uint32_t i = 0; i < record.subdirCount; i++)
+        subdirs.emplace_back(previous_->DirectoryPath(previous_->DirectoryAt(dirs[i])));
+    reused_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void LibraryScanner::ScanDirectory(const std::string& dir, std::vector<std::string>& subdirs,
+                                   std::vector<ScannedFile>& batch, std::vector<ScannedDirectory>& visited) {
+    // Stamped before listing: a change made while we list shows up as a newer
+    // mtime next time rather than being missed
+    struct stat dirStat;
+    if (stat(dir.c_str(), &dirStat) != 0) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    directories_.fetch_add(1, std::memory_order_relaxed);
+    visited.push_back({dir, MtimeNs(dirStat), (uint64_t)dirStat.st_ino});
+    if (Reuse(dir, visited.back().mtime, visited.back().inode, subdirs, batch)) return;
+
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        visited.pop_back();
+        return;
+    }
+    const int fd = dirfd(d);
+
+    // d_type saves a stat for everything but audio files on most file systems
+    while (dirent* entry = readdir(d)) {
+        if (cancel_.load(std::memory_order_relaxed)) break;
+        const char* name = entry->d_name;
+        if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) continue;
+
+        unsigned char type = entry->d_type;
+        struct stat st;
+        bool haveStat = false;
+        if (type == DT_UNKNOWN) {
+            if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISLNK(st.st_mode) ? DT_LNK : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+            haveStat = type == DT_REG;
+        }
+        if (type == DT_DIR) {
+            subdirs.push_back(JoinPath(dir, name));
+            continue;
+        }
+        if ((type != DT_REG && type != DT_LNK) || !MatchesExtension(extensions_, name)) continue;
+        // Symlinks count as the file they point at, never as a directory
+        if (!haveStat && fstatat(fd, name, &st, 0) != 0) continue;
+        if (!S_ISREG(st.st_mode)) continue;
+
+        ScannedFile file;
+        file.path = JoinPath(dir, name);
+        file.stamp.size = (uint64_t)st.st_size;
+        file.stamp.mtime = (int64_t)st.st_mtime;
+        file.inode = (uint64_t)st.st_ino;
+        batch.push_back(std::move(file));
+        files_.fetch_add(1, std::memory_order_relaxed);
+    }
+    closedir(d);
+}
+
+#endif
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "library_db.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// True if `name` ends in one of `extensions` (lower case, with the dot),
+// ignoring case.
+bool MatchesExtension(const std::unordered_set<std::string>& extensions, const char* name);
+
+struct ScanProgress {
+    uint64_t directories = 0; // listed so far
+    uint64_t files = 0;       // matching files found so far
+    uint64_t errors = 0;      // directories that could not be opened
+    uint64_t reused = 0;      // directories taken unchanged from the previous scan
+    bool done = true;
+};
+
+// Recursive directory scan on a small pool of threads. Every directory is a
+// task: a worker lists it, stats the entries, queues the subdirectories on its
+// own deque and takes work LIFO from there (depth first, warm dentry cache);
+// a worker that runs dry steals the oldest task of another, which tends to be
+// a whole unvisited subtree. Stat calls on network shares are mostly waiting,
+// so the pool is larger than the core count.
+//
+// Matching files are handed back in batches; the UI picks them up with Poll()
+// every frame and never blocks on the scan. Symlinked directories are not
+// followed, so link loops can't make the scan run forever.
+//
+// Given the database of an earlier scan, a directory whose mtime and inode
+// are unchanged is not listed again: its files and subdirectories come from
+// the database, and the directory costs one stat() plus one per audio file,
+// whose stamp may have changed without the directory's.
+class LibraryScanner {
+public:
+    // `extensions` are lower case with the dot (".mp3").
+    explicit LibraryScanner(std::unordered_set<std::string> extensions);
+    ~LibraryScanner();
+
+    LibraryScanner(const LibraryScanner&) = delete;
+    LibraryScanner& operator=(const LibraryScanner&) = delete;
+
+    // Starts scanning `root`, cancelling a scan still in progress. `previous`,
+    // the database of an earlier scan, is held until the next Start/Cancel.
+    void Start(const std::string& root, std::shared_ptr<const LibraryDb> previous = nullptr);
+    void Cancel();
+
+    // Moves files found since the last call to the end of `out`. Returns false
+    // if there were none. Single consumer.
+    bool Poll(std::vector<ScannedFile>& out);
+    // Every directory visited, for writing the next database. Once done.
+    void TakeDirectories(std::vector<ScannedDirectory>& out);
+    ScanProgress Progress() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::string> tasks;
+    };
+
+    void WorkerMain(size_t index);
+    bool TakeTask(size_t index, std::string* dir);
+    void Push(size_t index, std::vector<std::string>& dirs);
+    void ScanDirectory(const std::string& dir, std::vector<std::string>& subdirs, std::vector<ScannedFile>& batch,
+                       std::vector<ScannedDirectory>& visited);
+    bool Reuse(const std::string& dir, int64_t mtime, uint64_t inode, std::vector<std::string>& subdirs,
+               std::vector<ScannedFile>& batch);
+    void Deliver(std::vector<ScannedFile>& batch, std::vector<ScannedDirectory>& visited);
+    void Join();
+
+    std::unordered_set<std::string> extensions_;
+    std::shared_ptr<const LibraryDb> previous_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+
+    // Directories queued or being listed; the scan is over when it hits zero
+    std::atomic<int64_t> pending_{0};
+    std::atomic<bool> cancel_{false};
+    std::mutex idleMutex_;
+    std::condition_variable idle_;
+
+    std::mutex resultMutex_;
+    std::vector<ScannedFile> results_;
+    std::vector<ScannedDirectory> visited_;
+
+    std::atomic<uint64_t> directories_{0};
+    std::atomic<uint64_t> files_{0};
+    std::atomic<uint64_t> errors_{0};
+    std::atomic<uint64_t> reused_{0};
+    std::atomic<size_t> running_{0};
+};
@@ -0,0 +1,294 @@
+#include "search_index.h"
+
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static int LowestBit(uint64_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (int)index;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+// Past this share of the rows retagged, a patch costs the UI thread more than
+// the columns a copy of the table may have it duplicate
+static const size_t kPatchDivisor = 64;
+
+static bool IsWordByte(unsigned char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+// Calls f(word) for every word of `text`, folded into `scratch`
+template <typename F>
+static void ForEachWord(std::string_view text, std::string& scratch, F&& f) {
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && !IsWordByte((unsigned char)text[i])) i++;
+        if (i == text.size()) break;
+        scratch.clear();
+        for (; i < text.size() && IsWordByte((unsigned char)text[i]); i++) {
+            const unsigned char c = (unsigned char)text[i];
+            scratch += (char)(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+        }
+        f(std::string_view(scratch));
+    }
+}
+
+std::unique_ptr<SearchSnapshot> SearchSnapshot::Of(const TrackTable& tracks) {
+    auto snapshot = std::make_unique<SearchSnapshot>();
+    snapshot->nameStart.reserve(tracks.Size());
+    snapshot->textEnd.reserve(tracks.Size());
+    for (size_t i = 0; i < tracks.Size(); i++) snapshot->Add(tracks, i);
+    snapshot->ids = tracks.Ids();
+    snapshot->artist = tracks.ArtistIds();
+    snapshot->albumArtist = tracks.AlbumArtistIds();
+    snapshot->album = tracks.AlbumIds();
+    snapshot->artists = tracks.Artists();
+    snapshot->albums = tracks.Albums();
+    return snapshot;
+}
+
+void SearchSnapshot::Add(const TrackTable& tracks, size_t row) {
+    text += tracks.Title(row);
+    text += '\n';
+    nameStart.push_back((uint32_t)text.size());
+    text += tracks.Name(row);
+    textEnd.push_back((uint32_t)text.size());
+}
+
+std::unique_ptr<SearchPatch> SearchPatch::Since(const TrackTable& tracks, uint32_t revision, uint32_t layout,
+                                                const SearchSnapshot& snapshot) {
+    if (tracks.Layout() != layout || tracks.Artists().Generation() != snapshot.artists.Generation() ||
+        tracks.Albums().Generation() != snapshot.albums.Generation()) {
+        return nullptr;
+    }
+    auto patch = std::make_unique<SearchPatch>();
+    for (size_t row = 0; row < tracks.Size(); row++) {
+        if (tracks.ChangedAt(row) <= revision) continue;
+        patch->rows.push_back((uint32_t)row);
+        if (patch->rows.size() * kPatchDivisor > tracks.Size()) return nullptr;
+    }
+
+    SearchSnapshot& changed = patch->changed;
+    for (uint32_t row : patch->rows) {
+        changed.Add(tracks, row);
+        changed.artist.push_back(tracks.ArtistIds()[row]);
+        changed.albumArtist.push_back(tracks.AlbumArtistIds()[row]);
+        changed.album.push_back(tracks.AlbumIds()[row]);
+    }
+    for (size_t id = snapshot.artists.Count(); id < tracks.Artists().Count(); id++) {
+        patch->artists.emplace_back(tracks.Artists().Get((uint32_t)id));
+    }
+    for (size_t id = snapshot.albums.Count(); id < tracks.Albums().Count(); id++) {
+        patch->albums.emplace_back(tracks.Albums().Get((uint32_t)id));
+    }
+    return patch;
+}
+
+std::unique_ptr<SearchSnapshot> SearchSnapshot::Patched(const SearchPatch& patch) const {
+    auto next = std::make_unique<SearchSnapshot>();
+    next->text.reserve(text.size() + patch.changed.text.size());
+    next->nameStart.reserve(ids.size());
+    next->textEnd.reserve(ids.size());
+    // Rows didn't move: document i is still row i, and only some of them changed
+    size_t change = 0;
+    for (uint32_t doc = 0; doc < ids.size(); doc++) {
+        const SearchSnapshot* from = this;
+        uint32_t i = doc;
+        if (change < patch.rows.size() && patch.rows[change] == doc) {
+            from = &patch.changed;
+            i = (uint32_t)change++;
+        }
+        const uint32_t start = i ? from->textEnd[i - 1] : 0;
+        const uint32_t base = (uint32_t)next->text.size();
+        next->text.append(from->text, start, from->textEnd[i] - start);
+        next->nameStart.push_back(base + (from->nameStart[i] - start));
+        next->textEnd.push_back((uint32_t)next->text.size());
+    }
+    next->ids = ids;
+    next->artist = artist;
+    next->albumArtist = albumArtist;
+    next->album = album;
+    for (size_t i = 0; i < patch.rows.size(); i++) {
+        next->artist[patch.rows[i]] = patch.changed.artist[i];
+        next->albumArtist[patch.rows[i]] = patch.changed.albumArtist[i];
+        next->album[patch.rows[i]] = patch.changed.album[i];
+    }
+    // Interned in the same order, they get the same ids as in the table
+    next->artists = artists;
+    next->albums = albums;
+    for (const std::string& name : patch.artists) next->artists.Intern(name);
+    for (const std::string& name : patch.albums) next->albums.Intern(name);
+    return next;
+}
+
+// The words of every string of a pool, interned into `words`: those of id i
+// are words[start[i]..start[i + 1])
+static void PoolWords(const StringPool& pool, StringPool& words, std::vector<uint32_t>& start,
+                      std::vector<uint32_t>& list) {
+    std::string scratch;
+    start.assign(1, 0);
+    for (size_t id = 0; id < pool.Count(); id++) {
+        ForEachWord(pool.Get((uint32_t)id), scratch,
+                    [&](std::string_view word) { list.push_back(words.Intern(word)); });
+        start.push_back((uint32_t)list.size());
+    }
+}
+
+SearchIndex::SearchIndex(const SearchSnapshot& snapshot) : ids_(snapshot.ids) {
+    const size_t documents = ids_.size();
+    std::vector<uint32_t> artistStart, artistWords, albumStart, albumWords;
+    PoolWords(snapshot.artists, words_, artistStart, artistWords);
+    PoolWords(snapshot.albums, words_, albumStart, albumWords);
+
+    // Every document's distinct words, by word id for now
+    std::string scratch;
+    std::vector<uint32_t> words;
+    forwardStart_.reserve(documents + 1);
+    forwardStart_.push_back(0);
+    uint32_t textStart = 0;
+    for (size_t doc = 0; doc < documents; doc++) {
+        words.clear();
+        const std::string_view text(snapshot.text.data() + textStart, snapshot.textEnd[doc] - textStart);
+        textStart = snapshot.textEnd[doc];
+        ForEachWord(text, scratch, [&](std::string_view word) { words.push_back(words_.Intern(word)); });
+        for (uint32_t id : {snapshot.artist[doc], snapshot.albumArtist[doc]}) {
+            words.insert(words.end(), artistWords.begin() + artistStart[id], artistWords.begin() + artistStart[id + 1]);
+        }
+        const uint32_t album = snapshot.album[doc];
+        words.insert(words.end(), albumWords.begin() + albumStart[album], albumWords.begin() + albumStart[album + 1]);
+        std::sort(words.begin(), words.end());
+        forward_.insert(forward_.end(), words.begin(), std::unique(words.begin(), words.end()));
+        forwardStart_.push_back((uint32_t)forward_.size());
+    }
+
+    // Ids to ranks, so that a prefix is a range
+    const std::vector<uint32_t> ranks = words_.Ranks();
+    sorted_.resize(ranks.size());
+    for (size_t id = 0; id < ranks.size(); id++) sorted_[ranks[id]] = (uint32_t)id;
+    for (uint32_t& word : forward_) word = ranks[word];
+    for (size_t doc = 0; doc < documents; doc++) {
+        std::sort(forward_.begin() + forwardStart_[doc], forward_.begin() + forwardStart_[doc + 1]);
+    }
+
+    postingStart_.assign(ranks.size() + 1, 0);
+    for (uint32_t rank : forward_) postingStart_[rank + 1]++;
+    for (size_t rank = 0; rank < ranks.size(); rank++) postingStart_[rank + 1] += postingStart_[rank];
+    postings_.resize(forward_.size());
+    std::vector<uint32_t> fill(postingStart_.begin(), postingStart_.end() - 1);
+    for (size_t doc = 0; doc < documents; doc++) {
+        for (uint32_t i = forwardStart_[doc]; i < forwardStart_[doc + 1]; i++) {
+            postings_[fill[forward_[i]]++] = (uint32_t)doc;
+        }
+    }
+    seen_.assign((documents + 63) / 64, 0);
+}
+
+std::vector<std::string> SearchIndex::Terms(std::string_view query) {
+    std::vector<std::string> terms;
+    std::string scratch;
+    ForEachWord(query, scratch, [&terms](std::string_view word) { terms.emplace_back(word); });
+    return terms;
+}
+
+SearchIndex::Range SearchIndex::WordsStartingWith(std::string_view prefix) const {
+    const auto first = std::lower_bound(sorted_.begin(), sorted_.end(), prefix,
+                                        [this](uint32_t id, std::string_view p) { return words_.Get(id) < p; });
+    const auto last = std::upper_bound(first, sorted_.end(), prefix, [this](std::string_view p, uint32_t id) {
+        return p < words_.Get(id).substr(0, p.size());
+    });
+    return Range{(uint32_t)(first - sorted_.begin()), (uint32_t)(last - sorted_.begin())};
+}
+
+void SearchIndex::Mark(Range range) {
+    for (uint32_t i = postingStart_[range.first]; i < postingStart_[range.last]; i++) {
+        seen_[postings_[i] / 64] |= (uint64_t)1 << (postings_[i] % 64);
+    }
+}
+
+SearchIndex::Match SearchIndex::Search(std::vector<std::string> terms, const Match* previous) {
+    Match match;
+    match.terms = std::move(terms);
+    const std::vector<std::string>& query = match.terms;
+    if (query.empty()) return match;
+
+    // Terms a previous match already guarantees need no checking
+    bool narrows = previous && !previous->terms.empty() && previous->terms.size() <= query.size();
+    std::vector<bool> settled(query.size(), false);
+    for (size_t i = 0; narrows && i < previous->terms.size(); i++) {
+        narrows = query[i].compare(0, previous->terms[i].size(), previous->terms[i]) == 0;
+        settled[i] = query[i] == previous->terms[i];
+    }
+
+    std::vector<Range> ranges;
+    size_t rarest = 0;
+    for (const std::string& term : query) {
+        ranges.push_back(WordsStartingWith(term));
+        if (ranges.back().first == ranges.back().last) return match;
+        if (Postings(ranges.back()) < Postings(ranges[rarest])) rarest = ranges.size() - 1;
+    }
+
+    // Checking a document against a term is a few dependent loads; taking it
+    // from a posting list is one store
+    static const size_t kCheckCost = 8;
+    size_t unsettled = 0;
+    for (bool done : settled) unsettled += !done;
+    const size_t postings = Postings(ranges[rarest]);
+    const size_t postingsCost = postings + postings * (query.size() - 1) * kCheckCost;
+    const bool narrow = narrows && previous->documents.size() * unsettled * kCheckCost < postingsCost;
+
+    std::vector<uint32_t>& found = match.documents;
+    if (narrow) {
+        found = previous->documents;
+    } else {
+        // The rarest term's postings, in document order: one word's are
+        // already; several are merged through the bitmap, which also drops
+        // the documents that have more than one of the words
+        const Range start = ranges[rarest];
+        if (start.last - start.first == 1) {
+            found.assign(postings_.begin() + postingStart_[start.first],
+                         postings_.begin() + postingStart_[start.last]);
+        } else {
+            Mark(start);
+            for (size_t word = 0; word < seen_.size(); word++) {
+                for (uint64_t bits = seen_[word]; bits; bits &= bits - 1) {
+                    found.push_back((uint32_t)(word * 64 + LowestBit(bits)));
+                }
+                seen_[word] = 0;
+            }
+        }
+        std::fill(settled.begin(), settled.end(), false);
+        settled[rarest] = true;
+    }
+
+    // The other terms, one at a time: a short term has many postings, but
+    // marking them all can still beat checking every document found so far
+    for (size_t i = 0; i < ranges.size() && !found.empty(); i++) {
+        if (settled[i]) continue;
+        const Range range = ranges[i];
+        if (Postings(range) + found.size() < found.size() * kCheckCost) {
+            Mark(range);
+            found.erase(std::remove_if(found.begin(), found.end(),
+                                       [this](uint32_t doc) { return !(seen_[doc / 64] >> (doc % 64) & 1); }),
+                        found.end());
+            std::fill(seen_.begin(), seen_.end(), 0);
+        } else {
+            found.erase(std::remove_if(found.begin(), found.end(),
+                                       [&](uint32_t doc) { return !HasWordIn(doc, range); }),
+                        found.end());
+        }
+    }
+    return match;
+}
+
+size_t SearchIndex::MemoryBytes() const {
+    return words_.MemoryBytes() + (ids_.capacity() + sorted_.capacity() + postingStart_.capacity() +
+                                   postings_.capacity() + forwardStart_.capacity() + forward_.capacity()) *
+                                      sizeof(uint32_t) +
+           seen_.capacity() * sizeof(uint64_t);
+}
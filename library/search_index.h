@@ -0,0 +1,108 @@
+#pragma once
+
+#include "track_table.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct SearchPatch;
+
+// What the index is built from: the searchable text of every track, a
+// document per row. Artists and albums stay interned, pools and all.
+struct SearchSnapshot {
+    std::vector<uint32_t> ids;       // track id of every document
+    std::string text;                // title '\n' path below the root, per document
+    std::vector<uint32_t> nameStart; // where each document's path starts
+    std::vector<uint32_t> textEnd;   // end of each document's text
+    std::vector<uint32_t> artist;
+    std::vector<uint32_t> albumArtist;
+    std::vector<uint32_t> album;
+    StringPool artists;
+    StringPool albums;
+
+    // Reads every string of the table: on a copy of it, off the UI thread
+    static std::unique_ptr<SearchSnapshot> Of(const TrackTable& tracks);
+    // This snapshot with `patch` applied
+    std::unique_ptr<SearchSnapshot> Patched(const SearchPatch& patch) const;
+    // Appends the document of `row`
+    void Add(const TrackTable& tracks, size_t row);
+};
+
+// What changed in the table since a snapshot was taken of it, if no rows came
+// or went since: the documents of the rows retagged and the artists and
+// albums interned since. Cheap to take on the UI thread while tags stream in.
+struct SearchPatch {
+    std::vector<uint32_t> rows;     // ascending
+    SearchSnapshot changed;         // a document per row; no pools
+    std::vector<std::string> artists; // interned after the snapshot's, in id order
+    std::vector<std::string> albums;
+
+    // Rows changed after `revision`, when `snapshot` was taken. nullptr if
+    // rows moved since, or if so much changed that a new snapshot is cheaper.
+    static std::unique_ptr<SearchPatch> Since(const TrackTable& tracks, uint32_t revision, uint32_t layout,
+                                              const SearchSnapshot& snapshot);
+};
+
+// Inverted index of the words in titles, artists, albums and paths, for
+// search-as-you-type: a track matches a query if every word of the query is
+// the start of one of its words ("beat hel" finds "The Beatles - Help!").
+// Words are runs of ASCII letters and digits, or of non-ASCII bytes, folded to
+// lower case.
+//
+// The vocabulary is sorted, so a query word covers a range of word ranks, and
+// the postings of those words sit next to each other: the number of postings
+// a word would have to visit is known up front. A query starts from its
+// rarest word, or from the results of a query it extends (which can only
+// shrink), whichever is less work, and checks the other words against the
+// forward index: every track's words, as sorted ranks.
+class SearchIndex {
+public:
+    explicit SearchIndex(const SearchSnapshot& snapshot);
+
+    struct Match {
+        std::vector<std::string> terms;
+        std::vector<uint32_t> documents; // ascending
+    };
+
+    // The words of a query, folded
+    static std::vector<std::string> Terms(std::string_view query);
+
+    // Documents matching all `terms`. `previous` is an earlier match on this
+    // index, to start from if the terms narrow it (each of its terms is the
+    // start of the term in the same place, and there may be more).
+    Match Search(std::vector<std::string> terms, const Match* previous);
+
+    size_t Documents() const { return ids_.size(); }
+    uint32_t Id(uint32_t document) const { return ids_[document]; }
+    size_t MemoryBytes() const;
+
+private:
+    struct Range {
+        uint32_t first; // word ranks
+        uint32_t last;
+    };
+
+    Range WordsStartingWith(std::string_view prefix) const;
+    uint32_t Postings(Range range) const { return postingStart_[range.last] - postingStart_[range.first]; }
+    // Sets the bits in `seen_` of the documents with a word in `range`
+    void Mark(Range range);
+    bool HasWordIn(uint32_t document, Range range) const {
+        const uint32_t* first = forward_.data() + forwardStart_[document];
+        const uint32_t* last = forward_.data() + forwardStart_[document + 1];
+        const uint32_t* word = std::lower_bound(first, last, range.first);
+        return word != last && *word < range.last;
+    }
+
+    std::vector<uint32_t> ids_;
+    StringPool words_;
+    std::vector<uint32_t> sorted_;        // word ids by rank
+    std::vector<uint32_t> postingStart_;  // by rank, plus the end
+    std::vector<uint32_t> postings_;      // documents
+    std::vector<uint32_t> forwardStart_;  // by document, plus the end
+    std::vector<uint32_t> forward_;       // word ranks, sorted per document
+    std::vector<uint64_t> seen_;          // scratch for Search(), a bit per document
+};
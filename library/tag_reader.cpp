@@ -0,0 +1,104 @@
+#include "tag_reader.h"
+
+#include <algorithm>
+
+// Paths a worker takes from the queue at once
+static const size_t kChunk = 16;
+// Results collected by a worker before they are handed to the UI
+static const size_t kBatchResults = 256;
+// Read latency, not CPU, is what limits tag reading
+static const unsigned kMinThreads = 4;
+static const unsigned kMaxThreads = 16;
+
+TagReader::~TagReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        queue_.clear();
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_) thread.join();
+}
+
+void TagReader::Add(std::vector<std::string> paths) {
+    if (paths.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_.fetch_add(paths.size(), std::memory_order_relaxed);
+        queue_.insert(queue_.end(), std::make_move_iterator(paths.begin()), std::make_move_iterator(paths.end()));
+    }
+    wake_.notify_all();
+    if (threads_.empty()) {
+        const unsigned threads =
+            std::min(kMaxThreads, std::max(kMinThreads, 2 * std::thread::hardware_concurrency()));
+        for (unsigned i = 0; i < threads; i++) threads_.emplace_back(&TagReader::WorkerMain, this);
+    }
+}
+
+void TagReader::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.clear();
+    results_.clear();
+    generation_++;
+    queued_.store(0);
+    done_.store(0);
+    failed_.store(0);
+}
+
+bool TagReader::Poll(std::vector<TagResult>& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (results_.empty()) return false;
+    out.insert(out.end(), std::make_move_iterator(results_.begin()), std::make_move_iterator(results_.end()));
+    results_.clear();
+    return true;
+}
+
+TagProgress TagReader::Progress() const {
+    TagProgress progress;
+    progress.queued = queued_.load(std::memory_order_relaxed);
+    progress.done = done_.load(std::memory_order_relaxed);
+    progress.failed = failed_.load(std::memory_order_relaxed);
+    return progress;
+}
+
+void TagReader::Deliver(std::vector<TagResult>& batch, uint64_t generation) {
+    if (batch.empty()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (generation == generation_) {
+        results_.insert(results_.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+    }
+    batch.clear();
+}
+
+void TagReader::WorkerMain() {
+    std::vector<std::string> chunk;
+    std::vector<TagResult> batch;
+    uint64_t generation = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (queue_.empty() || generation != generation_) {
+                // Nothing more right now (or a Clear() made the batch stale):
+                // hand over what we have before going to sleep
+                lock.unlock();
+                Deliver(batch, generation);
+                lock.lock();
+                wake_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+            }
+            if (stop_) return;
+            generation = generation_;
+            const size_t take = std::min(kChunk, queue_.size());
+            chunk.assign(std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.begin() + take));
+            queue_.erase(queue_.begin(), queue_.begin() + take);
+        }
+        for (std::string& path : chunk) {
+            TagResult result;
+            result.ok = ReadTrackInfo(path, &result.info);
+            result.path = std::move(path);
+            if (!result.ok) failed_.fetch_add(1, std::memory_order_relaxed);
+            done_.fetch_add(1, std::memory_order_relaxed);
+            batch.push_back(std::move(result));
+        }
+        if (batch.size() >= kBatchResults) Deliver(batch, generation);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "track_info.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TagResult {
+    std::string path;
+    TrackInfo info;
+    bool ok = false; // false: unreadable or unknown format; `info` is empty
+};
+
+struct TagProgress {
+    uint64_t queued = 0; // since the last Clear()
+    uint64_t done = 0;
+    uint64_t failed = 0;
+};
+
+// Reads track metadata (ReadTrackInfo) for many files on a pool of threads.
+// Each file costs a couple of small positioned reads, so the pool is sized for
+// I/O in flight rather than for cores, like the scanner's. Workers take paths
+// from a shared queue a few at a time and hand results back in batches that
+// the UI picks up with Poll() every frame.
+class TagReader {
+public:
+    TagReader() = default;
+    ~TagReader();
+
+    TagReader(const TagReader&) = delete;
+    TagReader& operator=(const TagReader&) = delete;
+
+    // Queues `paths` behind whatever is still waiting. Threads start on first use.
+    void Add(std::vector<std::string> paths);
+    // Drops everything queued, in flight or not yet polled.
+    void Clear();
+
+    // Moves results gathered since the last call to the end of `out`. Returns
+    // false if there were none. Single consumer.
+    bool Poll(std::vector<TagResult>& out);
+    TagProgress Progress() const;
+
+private:
+    void WorkerMain();
+    void Deliver(std::vector<TagResult>& batch, uint64_t generation);
+
+    std::vector<std::thread> threads_;
+    bool stop_ = false;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::string> queue_;
+    uint64_t generation_ = 0; // bumped by Clear(); older results are dropped
+    std::vector<TagResult> results_;
+
+    std::atomic<uint64_t> queued_{0};
+    std::atomic<uint64_t> done_{0};
+    std::atomic<uint64_t> failed_{0};
+};
@@ -0,0 +1,979 @@
+#include "track_info.h"
+#include "audio/mp3dec.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Bytes fetched per read; a tag without pictures or the first MP3 frame fit
+// in one. On a disk the seek costs the same either way; from the page cache
+// the copy is what counts.
+static const size_t kWindow = 16 * 1024;
+// Largest possible Ogg page: header, 255 lacing values, 255 full segments
+static const size_t kMaxOggPage = 27 + 255 + 255 * 255;
+// Longest field we read; anything longer is a picture or junk
+static const size_t kMaxField = 64 * 1024;
+// Largest embedded picture we load
+static const size_t kMaxPicture = 16 * 1024 * 1024;
+// A tag unsynchronised as a whole has to be read whole to undo it
+static const size_t kMaxUnsyncTag = 1024 * 1024;
+// RIFF chunks looked at before giving up on a WAV
+static const int kMaxChunks = 64;
+
+static uint16_t ReadLE16(const uint8_t* p) { return (uint16_t)(p[0] | p[1] << 8); }
+static uint32_t ReadLE32(const uint8_t* p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+static uint64_t ReadLE64(const uint8_t* p) { return (uint64_t)ReadLE32(p) | (uint64_t)ReadLE32(p + 4) << 32; }
+static uint32_t ReadBE32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+static uint32_t ReadSyncsafe(const uint8_t* p) {
+    return (uint32_t)(p[0] & 0x7F) << 21 | (uint32_t)(p[1] & 0x7F) << 14 | (uint32_t)(p[2] & 0x7F) << 7 | (p[3] & 0x7F);
+}
+
+// Positioned reads through a window, so walking a header with many small
+// reads costs one system call per kWindow bytes and never moves a file offset
+// shared with anyone.
+class HeaderFile {
+public:
+    ~HeaderFile();
+    bool Open(const std::string& path);
+    uint64_t Size() const { return size_; }
+    // `size` bytes at `offset`, valid until the next call; nullptr past the end
+    const uint8_t* Read(uint64_t offset, size_t size);
+
+private:
+    size_t ReadAt(uint64_t offset, uint8_t* out, size_t size);
+
+#ifdef _WIN32
+    FILE* file_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+    uint64_t size_ = 0;
+    std::vector<uint8_t> window_;
+    uint64_t windowOffset_ = 0;
+    size_t windowSize_ = 0;
+};
+
+#ifdef _WIN32
+
+HeaderFile::~HeaderFile() {
+    if (file_) fclose(file_);
+}
+
+bool HeaderFile::Open(const std::string& path) {
+    file_ = fopen(path.c_str(), "rb");
+    if (!file_ || _fseeki64(file_, 0, SEEK_END) != 0) return false;
+    int64_t size = _ftelli64(file_);
+    if (size <= 0) return false;
+    size_ = (uint64_t)size;
+    return true;
+}
+
+size_t HeaderFile::ReadAt(uint64_t offset, uint8_t* out, size_t size) {
+    if (_fseeki64(file_, (int64_t)offset, SEEK_SET) != 0) return 0;
+    return fread(out, 1, size, file_);
+}
+
+#else
+
+HeaderFile::~HeaderFile() {
+    if (fd_ >= 0) close(fd_);
+}
+
+bool HeaderFile::Open(const std::string& path) {
+    fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) return false;
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size <= 0) return false;
+    size_ = (uint64_t)st.st_size;
+    return true;
+}
+
+size_t HeaderFile::ReadAt(uint64_t offset, uint8_t* out, size_t size) {
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = pread(fd_, out + got, size - got, (off_t)(offset + got));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    return got;
+}
+
+#endif
+
+const uint8_t* HeaderFile::Read(uint64_t offset, size_t size) {
+    if (offset > size_ || size > size_ - offset) return nullptr;
+    if (offset >= windowOffset_ && offset + size <= windowOffset_ + windowSize_)
+        return window_.data() + (offset - windowOffset_);
+    const size_t want = (size_t)std::min<uint64_t>(std::max(size, kWindow), size_ - offset);
+    window_.resize(want);
+    windowOffset_ = offset;
+    windowSize_ = ReadAt(offset, window_.data(), want);
+    return windowSize_ >= size ? window_.data() : nullptr;
+}
+
+// Text
+
+static void AppendUtf8(std::string& out, uint32_t c) {
+    if (c < 0x80) {
+        out += (char)c;
+    } else if (c < 0x800) {
+        out += (char)(0xC0 | c >> 6);
+        out += (char)(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        out += (char)(0xE0 | c >> 12);
+        out += (char)(0x80 | (c >> 6 & 0x3F));
+        out += (char)(0x80 | (c & 0x3F));
+    } else {
+        out += (char)(0xF0 | c >> 18);
+        out += (char)(0x80 | (c >> 12 & 0x3F));
+        out += (char)(0x80 | (c >> 6 & 0x3F));
+        out += (char)(0x80 | (c & 0x3F));
+    }
+}
+
+static std::string Latin1ToUtf8(const uint8_t* p, size_t size) {
+    std::string out;
+    out.reserve(size);
+    for (size_t i = 0; i < size && p[i] != 0; i++) AppendUtf8(out, p[i]);
+    return out;
+}
+
+static std::string Utf16ToUtf8(const uint8_t* p, size_t size, bool bigEndian) {
+    std::string out;
+    out.reserve(size);
+    for (size_t i = 0; i + 1 < size; i += 2) {
+        uint32_t c = bigEndian ? (uint32_t)(p[i] << 8 | p[i + 1]) : ReadLE16(p + i);
+        if (c == 0) break;
+        if (c >= 0xD800 && c < 0xDC00 && i + 3 < size) {
+            uint32_t low = bigEndian ? (uint32_t)(p[i + 2] << 8 | p[i + 3]) : ReadLE16(p + i + 2);
+            if (low >= 0xDC00 && low < 0xE000) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                i += 2;
+            }
+        }
+        AppendUtf8(out, c);
+    }
+    return out;
+}
+
+static bool IsUtf8(const uint8_t* p, size_t size) {
+    for (size_t i = 0; i < size;) {
+        const uint8_t c = p[i];
+        size_t extra = c < 0x80 ? 0 : (c & 0xE0) == 0xC0 ? 1 : (c & 0xF0) == 0xE0 ? 2 : (c & 0xF8) == 0xF0 ? 3 : 4;
+        if (extra == 4 || i + extra >= size) return false;
+        for (size_t j = 1; j <= extra; j++)
+            if ((p[i + j] & 0xC0) != 0x80) return false;
+        i += extra + 1;
+    }
+    return true;
+}
+
+// Text in fields that are Latin-1 on paper (ID3v1, ID3v2 encoding 0, RIFF
+// INFO) but that plenty of taggers fill with UTF-8. Valid UTF-8 with anything
+// above ASCII is next to impossible to come from real Latin-1 text.
+static std::string LegacyText(const uint8_t* p, size_t size) {
+    size = std::find(p, p + size, 0) - p;
+    return IsUtf8(p, size) ? std::string((const char*)p, size) : Latin1ToUtf8(p, size);
+}
+
+// Text up to the first NUL, without the blanks around it
+static std::string Clean(std::string text) {
+    size_t nul = text.find('\0');
+    if (nul != std::string::npos) text.resize(nul);
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return std::string();
+    size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last + 1 - first);
+}
+
+static unsigned LeadingNumber(const std::string& text) {
+    unsigned value = 0;
+    for (size_t i = 0; i < text.size() && isdigit((unsigned char)text[i]) && value < 100000; i++)
+        value = value * 10 + (unsigned)(text[i] - '0');
+    return value;
+}
+
+enum class Field { None, Title, Artist, Album, AlbumArtist, Genre, Year, Track, Disc, Length };
+
+// The first value found wins, so ID3v1 after ID3v2 only fills gaps
+static void SetField(TrackInfo* info, Field field, std::string value) {
+    value = Clean(std::move(value));
+    if (value.empty()) return;
+    auto setText = [&](std::string& target) {
+        if (target.empty()) target = std::move(value);
+    };
+    auto setNumber = [&](uint16_t& target, unsigned limit) {
+        unsigned number = LeadingNumber(value);
+        if (target == 0 && number <= limit) target = (uint16_t)number;
+    };
+    switch (field) {
+    case Field::Title: setText(info->title); break;
+    case Field::Artist: setText(info->artist); break;
+    case Field::Album: setText(info->album); break;
+    case Field::AlbumArtist: setText(info->albumArtist); break;
+    case Field::Genre: setText(info->genre); break;
+    case Field::Year: setNumber(info->year, 9999); break; // "2004" or "2004-05-01"
+    case Field::Track: setNumber(info->track, 9999); break; // "3" or "3/12"
+    case Field::Disc: setNumber(info->disc, 999); break;
+    case Field::Length:
+        if (info->duration == 0) info->duration = LeadingNumber(value) / 1000.0; // milliseconds
+        break;
+    case Field::None: break;
+    }
+}
+
+// Pictures
+
+// Whether a picture is still worth reading: one was asked for and no front
+// cover has turned up yet
+static bool WantPicture(const EmbeddedPicture* picture) { return picture && picture->type != 3; }
+
+// The first picture is kept unless a front cover comes later
+static void SetPicture(EmbeddedPicture* picture, int type, std::string mimeType, const uint8_t* data, size_t size) {
+    if (!WantPicture(picture) || size == 0 || (!picture->data.empty() && type != 3)) return;
+    picture->type = type;
+    picture->mimeType = std::move(mimeType);
+    picture->data.assign(data, data + size);
+}
+
+// FLAC PICTURE block, also found base64-encoded in Vorbis comments: type,
+// MIME type, description, width, height, depth, colors, then the image, all
+// sizes big-endian
+static void ReadFlacPicture(const uint8_t* p, size_t size, EmbeddedPicture* picture) {
+    size_t at = 0;
+    auto next = [&](uint32_t* value) {
+        if (size - at < 4) return false;
+        *value = ReadBE32(p + at);
+        at += 4;
+        return true;
+    };
+    uint32_t type, mimeSize, descriptionSize, skipped, dataSize;
+    if (!next(&type) || !next(&mimeSize) || mimeSize > size - at) return;
+    std::string mimeType((const char*)p + at, mimeSize);
+    at += mimeSize;
+    if (!next(&descriptionSize) || descriptionSize > size - at) return;
+    at += descriptionSize;
+    for (int i = 0; i < 4; i++)
+        if (!next(&skipped)) return;
+    if (!next(&dataSize) || dataSize > size - at) return;
+    SetPicture(picture, (int)type, std::move(mimeType), p + at, dataSize);
+}
+
+// Stops at the first character outside the alphabet ('=' padding included)
+static void DecodeBase64(const char* p, size_t size, std::vector<uint8_t>& out) {
+    out.clear();
+    out.reserve(size / 4 * 3);
+    uint32_t bits = 0;
+    int count = 0;
+    for (size_t i = 0; i < size; i++) {
+        const char c = p[i];
+        int value = c >= 'A' && c <= 'Z' ? c - 'A' : c >= 'a' && c <= 'z' ? c - 'a' + 26
+                  : c >= '0' && c <= '9' ? c - '0' + 52 : c == '+' ? 62 : c == '/' ? 63 : -1;
+        if (value < 0) break;
+        bits = bits << 6 | (uint32_t)value;
+        if (++count == 4) {
+            out.push_back((uint8_t)(bits >> 16));
+            out.push_back((uint8_t)(bits >> 8));
+            out.push_back((uint8_t)bits);
+            bits = 0;
+            count = 0;
+        }
+    }
+    if (count >= 2) out.push_back((uint8_t)(bits >> (count * 6 - 8)));
+    if (count == 3) out.push_back((uint8_t)(bits >> 2));
+}
+
+// ID3
+
+static const char* const kId3Genres[] = {
+    "Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge", "Hip-Hop", "Jazz", "Metal", "New Age",
+    "Oldies", "Other", "Pop", "R&B", "Rap", "Reggae", "Rock", "Techno", "Industrial", "Alternative", "Ska",
+    "Death Metal", "Pranks", "Soundtrack", "Euro-Techno", "Ambient", "Trip-Hop", "Vocal", "Jazz+Funk", "Fusion",
+    "Trance", "Classical", "Instrumental", "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise", "Alternative Rock",
+    "Bass", "Soul", "Punk", "Space", "Meditative", "Instrumental Pop", "Instrumental Rock", "Ethnic", "Gothic",
+    "Darkwave", "Techno-Industrial", "Electronic", "Pop-Folk", "Eurodance", "Dream", "Southern Rock", "Comedy", "Cult",
+    "Gangsta", "Top 40", "Christian Rap", "Pop/Funk", "Jungle", "Native American", "Cabaret", "New Wave", "Psychedelic",
+    "Rave", "Showtunes", "Trailer", "Lo-Fi", "Tribal", "Acid Punk", "Acid Jazz", "Polka", "Retro", "Musical",
+    "Rock & Roll", "Hard Rock",
+};
+static const size_t kId3GenreCount = sizeof(kId3Genres) / sizeof(kId3Genres[0]);
+
+// "Rock", "17", "(17)" or "(17)Rock" (ID3v1 reference with a refinement)
+static std::string Id3Genre(std::string text) {
+    if (text.size() >= 3 && text[0] == '(' && isdigit((unsigned char)text[1])) {
+        size_t close = text.find(')');
+        if (close != std::string::npos) {
+            if (close + 1 < text.size()) return text.substr(close + 1);
+            text = text.substr(1, close - 1);
+        }
+    }
+    if (!text.empty() && std::all_of(text.begin(), text.end(), [](char c) { return isdigit((unsigned char)c); })) {
+        unsigned index = LeadingNumber(text);
+        return index < kId3GenreCount ? kId3Genres[index] : std::string();
+    }
+    return text;
+}
+
+static Field Id3Field(const char* id, int version) {
+    static const struct {
+        const char* v22;
+        const char* v23;
+        Field field;
+    } kFrames[] = {
+        {"TT2", "TIT2", Field::Title}, {"TP1", "TPE1", Field::Artist}, {"TAL", "TALB", Field::Album},
+        {"TP2", "TPE2", Field::AlbumArtist}, {"TCO", "TCON", Field::Genre}, {"TYE", "TYER", Field::Year},
+        {"", "TDRC", Field::Year}, {"TRK", "TRCK", Field::Track}, {"TPA", "TPOS", Field::Disc},
+        {"TLE", "TLEN", Field::Length},
+    };
+    for (const auto& frame : kFrames)
+        if (strcmp(id, version == 2 ? frame.v22 : frame.v23) == 0) return frame.field;
+    return Field::None;
+}
+
+// Text frame body: an encoding byte, then the text. v2.4 may list several
+// values separated by NULs; the first one is kept.
+static std::string Id3Text(const uint8_t* p, size_t size) {
+    if (size < 1) return std::string();
+    const uint8_t encoding = p[0];
+    p++;
+    size--;
+    switch (encoding) {
+    case 0: return LegacyText(p, size);
+    case 1:
+        if (size >= 2 && p[0] == 0xFE && p[1] == 0xFF) return Utf16ToUtf8(p + 2, size - 2, true);
+        if (size >= 2 && p[0] == 0xFF && p[1] == 0xFE) return Utf16ToUtf8(p + 2, size - 2, false);
+        return Utf16ToUtf8(p, size, false);
+    case 2: return Utf16ToUtf8(p, size, true);
+    case 3: return std::string((const char*)p, size);
+    default: return std::string();
+    }
+}
+
+// APIC body: encoding, MIME type (v2.2's PIC: a three-letter format
+// instead), picture type, description in the frame's encoding, image
+static void ReadId3Picture(const uint8_t* p, size_t size, int version, EmbeddedPicture* picture) {
+    if (size < 2) return;
+    const uint8_t encoding = p[0];
+    size_t at = 1;
+    std::string mimeType;
+    if (version == 2) {
+        if (size < 5) return;
+        mimeType = memcmp(p + 1, "PNG", 3) == 0 ? "image/png" : "image/jpeg";
+        at = 4;
+    } else {
+        const uint8_t* nul = (const uint8_t*)memchr(p + at, 0, size - at);
+        if (!nul) return;
+        mimeType.assign((const char*)p + at, (size_t)(nul - (p + at)));
+        at = (size_t)(nul - p) + 1;
+    }
+    if (at >= size) return;
+    const int type = p[at++];
+    if (encoding == 1 || encoding == 2) {
+        while (at + 1 < size && (p[at] != 0 || p[at + 1] != 0)) at += 2;
+        at += 2;
+    } else {
+        while (at < size && p[at] != 0) at++;
+        at++;
+    }
+    if (at < size) SetPicture(picture, type, std::move(mimeType), p + at, size - at);
+}
+
+// Samples an MP3 encoder put before and after the audio, which the decoder
+// trims so that an album plays without gaps
+struct Mp3Gapless {
+    bool found = false;
+    uint32_t delay = 0;
+    uint32_t padding = 0;
+};
+
+// iTunes stores them in an ID3v2 comment named "iTunSMPB": Latin-1 or UTF-8,
+// " 00000000 DDDDDDDD PPPPPPPP LLLLLLLLLLLLLLLL ..." with delay, padding and
+// length in hex. COMM body: encoding, language, description, NUL, text.
+static void ReadItunesGapless(const uint8_t* p, size_t size, Mp3Gapless* gapless) {
+    if (size <= 13 || (p[0] != 0 && p[0] != 3) || memcmp(p + 4, "iTunSMPB", 9) != 0) return;
+    const std::string text((const char*)p + 13, size - 13);
+    unsigned int zero = 0, delay = 0, padding = 0;
+    if (sscanf(text.c_str(), "%x %x %x", &zero, &delay, &padding) == 3 && delay < 0x10000 && padding < 0x10000) {
+        gapless->found = true;
+        gapless->delay = delay;
+        gapless->padding = padding;
+    }
+}
+
+// Drops the 0x00 stuffed after every 0xFF. Returns the new size.
+static size_t RemoveUnsync(uint8_t* p, size_t size) {
+    size_t out = 0;
+    for (size_t i = 0; i < size; i++) {
+        p[out++] = p[i];
+        if (p[i] == 0xFF && i + 1 < size && p[i + 1] == 0x00) i++;
+    }
+    return out;
+}
+
+static bool IsFrameId(const uint8_t* p, size_t size) {
+    for (size_t i = 0; i < size; i++)
+        if (!((p[i] >= 'A' && p[i] <= 'Z') || (p[i] >= '0' && p[i] <= '9'))) return false;
+    return true;
+}
+
+// Walks the frames in [offset, end). `read(offset, size)` is a HeaderFile or a
+// buffer holding the tag; only the frames we want have their bodies read.
+template <typename Read>
+static void ReadId3Frames(Read read, uint64_t offset, uint64_t end, int version, bool unsyncFrames,
+                          TrackInfo* info, EmbeddedPicture* picture, Mp3Gapless* gapless) {
+    const size_t headerSize = version == 2 ? 6 : 10;
+    const size_t idSize = version == 2 ? 3 : 4;
+    // Padding (zeros) or the end of the tag after a frame
+    auto frameAt = [&](uint64_t at) {
+        if (at == end) return true;
+        if (at + headerSize > end) return false;
+        const uint8_t* h = read(at, idSize);
+        return h && (h[0] == 0 || IsFrameId(h, idSize));
+    };
+    std::vector<uint8_t> copy;
+    while (offset + headerSize <= end) {
+        const uint8_t* h = read(offset, headerSize);
+        if (!h || h[0] == 0 || !IsFrameId(h, idSize)) break;
+        char id[5] = {};
+        memcpy(id, h, idSize);
+        uint64_t length;
+        uint8_t format = 0;
+        if (version == 2) {
+            length = (uint64_t)h[3] << 16 | h[4] << 8 | h[5];
+        } else {
+            format = h[9];
+            length = ReadBE32(h + 4);
+            if (version >= 4) {
+                // Syncsafe, except from writers that got it wrong; believe
+                // whichever reading lands on the next frame
+                const uint64_t plain = length;
+                length = ReadSyncsafe(h + 4);
+                if (length != plain && !frameAt(offset + headerSize + length) && frameAt(offset + headerSize + plain))
+                    length = plain;
+            }
+        }
+        const uint64_t body = offset + headerSize;
+        if (length > end - body) break;
+        offset = body + length;
+
+        const Field field = Id3Field(id, version);
+        const bool isPicture = WantPicture(picture) && strcmp(id, version == 2 ? "PIC" : "APIC") == 0;
+        const bool isComment = gapless && version >= 3 && strcmp(id, "COMM") == 0;
+        if (isPicture ? length > kMaxPicture : (field == Field::None && !isComment) || length > kMaxField) continue;
+        const uint8_t* data = read(body, (size_t)length);
+        if (!data) break;
+        size_t size = (size_t)length;
+        bool unsync = false;
+        if (version == 3) {
+            if (format & 0xC0) continue; // compressed or encrypted
+            if (format & 0x20) data++, size--; // group id
+        } else if (version >= 4) {
+            if (format & 0x0C) continue;
+            size_t skip = (format & 0x40 ? 1 : 0) + (format & 0x01 ? 4 : 0); // group id, data length
+            if (skip > size) continue;
+            data += skip;
+            size -= skip;
+            unsync = (format & 0x02) || unsyncFrames;
+        }
+        if (unsync) {
+            copy.assign(data, data + size);
+            size = RemoveUnsync(copy.data(), copy.size());
+            data = copy.data();
+        }
+        if (isPicture) {
+            ReadId3Picture(data, size, version, picture);
+            continue;
+        }
+        if (isComment) {
+            ReadItunesGapless(data, size, gapless);
+            continue;
+        }
+        std::string text = Id3Text(data, size);
+        SetField(info, field, field == Field::Genre ? Id3Genre(Clean(std::move(text))) : std::move(text));
+    }
+}
+
+// Reads the ID3v2 tag at `offset`, if there is one. Returns where it ends.
+// `gapless` is nullptr unless the tag leads an MP3.
+static uint64_t ReadId3v2(HeaderFile& file, uint64_t offset, TrackInfo* info, EmbeddedPicture* picture,
+                          Mp3Gapless* gapless) {
+    const uint8_t* h = file.Read(offset, 10);
+    if (!h || memcmp(h, "ID3", 3) != 0 || h[3] < 2 || h[3] > 4) return offset;
+    const int version = h[3];
+    const uint8_t flags = h[5];
+    const uint64_t size = ReadSyncsafe(h + 6);
+    const uint64_t end = offset + 10 + size + (version >= 4 && (flags & 0x10) ? 10 : 0);
+    uint64_t frames = offset + 10;
+    const uint64_t framesEnd = std::min(frames + size, file.Size());
+    if (version == 2 && (flags & 0x40)) return end; // compressed; nobody could read it
+
+    if ((flags & 0x80) && version < 4) {
+        // Unsynchronised as a whole, frame headers included: undo that first
+        if (framesEnd - frames > kMaxUnsyncTag) return end;
+        const uint8_t* p = file.Read(frames, (size_t)(framesEnd - frames));
+        if (!p) return end;
+        std::vector<uint8_t> tag(p, p + (framesEnd - frames));
+        tag.resize(RemoveUnsync(tag.data(), tag.size()));
+        uint64_t start = 0;
+        if (version == 3 && (flags & 0x40) && tag.size() >= 4) start = 4 + (uint64_t)ReadBE32(tag.data());
+        auto read = [&](uint64_t at, size_t bytes) -> const uint8_t* {
+            return at <= tag.size() && bytes <= tag.size() - at ? tag.data() + at : nullptr;
+        };
+        ReadId3Frames(read, start, tag.size(), version, false, info, picture, gapless);
+        return end;
+    }
+
+    if (flags & 0x40) {
+        // Extended header: v2.3 gives the size of what follows, v2.4 the whole
+        const uint8_t* x = file.Read(frames, 4);
+        if (!x) return end;
+        frames += version == 3 ? 4 + (uint64_t)ReadBE32(x) : ReadSyncsafe(x);
+    }
+    auto read = [&](uint64_t at, size_t bytes) { return file.Read(at, bytes); };
+    ReadId3Frames(read, frames, framesEnd, version, version >= 4 && (flags & 0x80), info, picture, gapless);
+    return end;
+}
+
+static void ReadId3v1(HeaderFile& file, TrackInfo* info) {
+    if (file.Size() < 128) return;
+    const uint8_t* t = file.Read(file.Size() - 128, 128);
+    if (!t || memcmp(t, "TAG", 3) != 0) return;
+    SetField(info, Field::Title, LegacyText(t + 3, 30));
+    SetField(info, Field::Artist, LegacyText(t + 33, 30));
+    SetField(info, Field::Album, LegacyText(t + 63, 30));
+    SetField(info, Field::Year, LegacyText(t + 93, 4));
+    if (t[125] == 0 && t[126] != 0 && info->track == 0) info->track = t[126]; // ID3v1.1
+    if (t[127] < kId3GenreCount) SetField(info, Field::Genre, kId3Genres[t[127]]);
+}
+
+// The first frame after the tag. A Xing/Info or VBRI header there gives the
+// exact length; without one the stream is taken as constant bitrate. The
+// length is what the decoder plays: less the encoder delay and padding from
+// the LAME tag, or else from `gapless` (iTunSMPB).
+static bool ReadMp3Stream(HeaderFile& file, uint64_t start, Mp3Gapless gapless, TrackInfo* info) {
+    uint64_t end = file.Size();
+    if (end >= start + 128) {
+        const uint8_t* t = file.Read(end - 128, 3);
+        if (t && memcmp(t, "TAG", 3) == 0) end -= 128;
+    }
+    if (start + 4 > end) return false;
+    const size_t span = (size_t)std::min<uint64_t>(kWindow, end - start);
+    const uint8_t* data = file.Read(start, span);
+    if (!data) return false;
+
+    mp3dec_header h;
+    size_t offset = 0;
+    for (;; offset++) {
+        if (offset + 4 > span) return false;
+        if (data[offset] != 0xFF) continue;
+        const size_t bytes = (size_t)mp3dec_parse_header(data + offset, &h);
+        if (bytes == 0) continue;
+        // A second frame right behind rules out a stray sync word
+        mp3dec_header next;
+        if (offset + bytes + 4 <= span &&
+            !(mp3dec_parse_header(data + offset + bytes, &next) && next.sample_rate == h.sample_rate))
+            continue;
+        break;
+    }
+    info->sampleRate = (uint32_t)h.sample_rate;
+    info->channels = (uint8_t)h.channels;
+
+    const uint8_t* frame = data + offset;
+    const size_t available = span - offset;
+    const size_t side = 4 + (h.protection ? 2 : 0) + (size_t)h.side_info_bytes;
+    uint64_t audioBytes = end - start - offset;
+    uint32_t frames = 0;
+    if (side + 16 <= available && (memcmp(frame + side, "Xing", 4) == 0 || memcmp(frame + side, "Info", 4) == 0)) {
+        const uint32_t flags = ReadBE32(frame + side + 4);
+        const uint8_t* p = frame + side + 8;
+        if (flags & 1) frames = ReadBE32(p), p += 4;
+        if ((flags & 2) && ReadBE32(p) != 0) audioBytes = std::min<uint64_t>(audioBytes, ReadBE32(p));
+        if (flags & 2) p += 4;
+        if (flags & 4) p += 100; // TOC
+        if (flags & 8) p += 4;   // quality
+        // LAME tag: a 9-byte encoder string, then at 21 delay and padding as
+        // two 12-bit numbers
+        const uint8_t* end = frame + std::min<size_t>(available, (size_t)h.frame_bytes);
+        if (p + 24 <= end && isalpha(p[0]) && isalpha(p[1]) && isalpha(p[2]) && isalpha(p[3])) {
+            gapless.found = true;
+            gapless.delay = (uint32_t)p[21] << 4 | p[22] >> 4;
+            gapless.padding = (uint32_t)(p[22] & 0x0F) << 8 | p[23];
+        }
+    } else if (36 + 18 <= available && memcmp(frame + 36, "VBRI", 4) == 0) {
+        audioBytes = std::min<uint64_t>(audioBytes, ReadBE32(frame + 36 + 10));
+        frames = ReadBE32(frame + 36 + 14);
+    }
+    if (frames != 0) {
+        uint64_t samples = (uint64_t)frames * h.samples;
+        if (gapless.found && gapless.delay + gapless.padding < samples) samples -= gapless.delay + gapless.padding;
+        info->duration = (double)samples / h.sample_rate;
+        info->bitrate = (uint32_t)(audioBytes * 8 / info->duration / 1000);
+    } else if (h.bitrate_kbps > 0) {
+        info->bitrate = (uint32_t)h.bitrate_kbps;
+        if (info->duration == 0) info->duration = audioBytes * 8.0 / (h.bitrate_kbps * 1000.0);
+    }
+    return true;
+}
+
+// Vorbis comments
+
+// Sequential reads over data that may be split up (Ogg pages). Long fields
+// are stepped over without being read.
+class ByteStream {
+public:
+    virtual ~ByteStream() = default;
+    virtual bool Read(void* out, size_t size) = 0;
+    virtual bool Skip(uint64_t size) = 0;
+};
+
+class FileStream : public ByteStream {
+public:
+    FileStream(HeaderFile& file, uint64_t offset, uint64_t end) : file_(file), pos_(offset), end_(end) {}
+
+    bool Read(void* out, size_t size) override {
+        const uint8_t* p = size <= end_ - pos_ ? file_.Read(pos_, size) : nullptr;
+        if (!p) return false;
+        memcpy(out, p, size);
+        pos_ += size;
+        return true;
+    }
+    bool Skip(uint64_t size) override {
+        if (size > end_ - pos_) return false;
+        pos_ += size;
+        return true;
+    }
+
+private:
+    HeaderFile& file_;
+    uint64_t pos_;
+    uint64_t end_;
+};
+
+// Page bodies of one logical Ogg stream, back to back. Skipping reads page
+// headers only, so a picture spanning a hundred pages costs a hundred small
+// reads of data we already have in the window or skip past entirely.
+class OggStream : public ByteStream {
+public:
+    explicit OggStream(HeaderFile& file) : file_(file) {}
+
+    // Starts at the body of the page at `offset` and follows its stream
+    bool Begin(uint64_t offset) {
+        if (!LoadPage(offset)) return false;
+        serial_ = pageSerial_;
+        left_ = pageBody_;
+        return true;
+    }
+    uint32_t Serial() const { return serial_; }
+    // Bytes left on the current page
+    uint64_t Left() const { return left_; }
+
+    bool Read(void* out, size_t size) override {
+        uint8_t* dst = (uint8_t*)out;
+        while (size > 0) {
+            if (left_ == 0 && !NextPage()) return false;
+            const size_t n = (size_t)std::min<uint64_t>(size, left_);
+            const uint8_t* p = file_.Read(pos_, n);
+            if (!p) return false;
+            memcpy(dst, p, n);
+            dst += n;
+            size -= n;
+            pos_ += n;
+            left_ -= n;
+        }
+        return true;
+    }
+    bool Skip(uint64_t size) override {
+        while (size > 0) {
+            if (left_ == 0 && !NextPage()) return false;
+            const uint64_t n = std::min(size, left_);
+            size -= n;
+            pos_ += n;
+            left_ -= n;
+        }
+        return true;
+    }
+
+private:
+    bool LoadPage(uint64_t offset) {
+        const uint8_t* h = file_.Read(offset, 27);
+        if (!h || memcmp(h, "OggS", 4) != 0 || h[4] != 0) return false;
+        pageSerial_ = ReadLE32(h + 14);
+        const size_t segments = h[26];
+        const uint8_t* lacing = file_.Read(offset + 27, segments);
+        if (!lacing) return false;
+        pageBody_ = 0;
+        for (size_t i = 0; i < segments; i++) pageBody_ += lacing[i];
+        pos_ = offset + 27 + segments;
+        next_ = pos_ + pageBody_;
+        return true;
+    }
+    bool NextPage() {
+        do {
+            if (!LoadPage(next_)) return false;
+        } while (pageSerial_ != serial_);
+        left_ = pageBody_;
+        return left_ > 0 || NextPage();
+    }
+
+    HeaderFile& file_;
+    uint32_t serial_ = 0;
+    uint32_t pageSerial_ = 0;
+    uint64_t pageBody_ = 0;
+    uint64_t pos_ = 0;
+    uint64_t left_ = 0;
+    uint64_t next_ = 0;
+};
+
+static Field VorbisField(std::string key) {
+    for (char& c : key) c = (char)toupper((unsigned char)c);
+    if (key == "TITLE") return Field::Title;
+    if (key == "ARTIST") return Field::Artist;
+    if (key == "ALBUM") return Field::Album;
+    if (key == "ALBUMARTIST" || key == "ALBUM ARTIST") return Field::AlbumArtist;
+    if (key == "GENRE") return Field::Genre;
+    if (key == "DATE" || key == "YEAR") return Field::Year;
+    if (key == "TRACKNUMBER") return Field::Track;
+    if (key == "DISCNUMBER") return Field::Disc;
+    return Field::None;
+}
+
+// Vendor string, then "KEY=value" fields, every string preceded by its
+// little-endian length. Cover art (METADATA_BLOCK_PICTURE) lives here too,
+// which is why a field is looked at by its key before its value is read.
+static bool ReadVorbisComment(ByteStream& in, TrackInfo* info, EmbeddedPicture* picture) {
+    uint8_t b[4];
+    if (!in.Read(b, 4) || !in.Skip(ReadLE32(b)) || !in.Read(b, 4)) return false;
+    const uint32_t count = ReadLE32(b);
+    static const char kPictureKey[] = "METADATA_BLOCK_PICTURE=";
+    const size_t pictureKeySize = sizeof(kPictureKey) - 1;
+    std::string field;
+    std::vector<uint8_t> block;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!in.Read(b, 4)) return false;
+        const uint32_t length = ReadLE32(b);
+        const size_t head = std::min<uint32_t>(length, 32);
+        field.resize(head);
+        if (!in.Read(&field[0], head)) return false;
+        const size_t eq = field.find('=');
+        const Field key = eq == std::string::npos ? Field::None : VorbisField(field.substr(0, eq));
+        const bool isPicture = WantPicture(picture) && eq + 1 == pictureKeySize &&
+                               std::equal(kPictureKey, kPictureKey + eq, field.begin(),
+                                          [](char a, char b) { return a == toupper((unsigned char)b); });
+        if (isPicture && length <= kMaxPicture / 3 * 4 + 4) {
+            field.resize(length);
+            if (!in.Read(&field[head], length - head)) return false;
+            DecodeBase64(field.data() + pictureKeySize, length - pictureKeySize, block);
+            ReadFlacPicture(block.data(), block.size(), picture);
+            continue;
+        }
+        if (key == Field::None || length > kMaxField) {
+            if (!in.Skip(length - head)) return false;
+            continue;
+        }
+        field.resize(length);
+        if (!in.Read(&field[head], length - head)) return false;
+        SetField(info, key, field.substr(eq + 1));
+    }
+    return true;
+}
+
+static bool ReadFlac(HeaderFile& file, uint64_t offset, TrackInfo* info, EmbeddedPicture* picture) {
+    const uint8_t* magic = file.Read(offset, 4);
+    if (!magic || memcmp(magic, "fLaC", 4) != 0) return false;
+    offset += 4;
+    uint64_t totalSamples = 0;
+    for (bool last = false; !last;) {
+        const uint8_t* h = file.Read(offset, 4);
+        if (!h) return false;
+        last = (h[0] & 0x80) != 0;
+        const int type = h[0] & 0x7F;
+        const uint64_t length = (uint64_t)h[1] << 16 | h[2] << 8 | h[3];
+        const uint64_t body = offset + 4;
+        if (type == 0 && length >= 18) {
+            // STREAMINFO: rate (20 bits), channels - 1 (3), bits - 1 (5), samples (36)
+            const uint8_t* s = file.Read(body, 18);
+            if (!s) return false;
+            info->sampleRate = (uint32_t)s[10] << 12 | (uint32_t)s[11] << 4 | s[12] >> 4;
+            info->channels = (uint8_t)(((s[12] >> 1) & 7) + 1);
+            totalSamples = (uint64_t)(s[13] & 0x0F) << 32 | ReadBE32(s + 14);
+        } else if (type == 4) {
+            FileStream comment(file, body, std::min(body + length, file.Size()));
+            ReadVorbisComment(comment, info, picture);
+        } else if (type == 6 && WantPicture(picture) && length <= kMaxPicture) {
+            const uint8_t* p = file.Read(body, (size_t)length);
+            if (p) ReadFlacPicture(p, (size_t)length, picture);
+        }
+        offset = body + length;
+    }
+    if (info->sampleRate != 0 && totalSamples != 0) {
+        info->duration = (double)totalSamples / info->sampleRate;
+        if (offset < file.Size()) info->bitrate = (uint32_t)((file.Size() - offset) * 8 / info->duration / 1000);
+    }
+    return true;
+}
+
+// Granule of the last page of the stream, which starts within the last
+// kMaxOggPage bytes
+static int64_t LastGranule(HeaderFile& file, uint32_t serial) {
+    const size_t span = (size_t)std::min<uint64_t>(kMaxOggPage, file.Size());
+    const uint8_t* p = file.Read(file.Size() - span, span);
+    if (!p || span < 27) return -1;
+    for (size_t i = span - 27 + 1; i-- > 0;) {
+        if (p[i] != 'O' || memcmp(p + i, "OggS", 4) != 0 || p[i + 4] != 0 || ReadLE32(p + i + 14) != serial) continue;
+        const int64_t granule = (int64_t)ReadLE64(p + i + 6);
+        if (granule >= 0) return granule;
+    }
+    return -1;
+}
+
+static bool ReadOgg(HeaderFile& file, TrackInfo* info, EmbeddedPicture* picture) {
+    OggStream stream(file);
+    if (!stream.Begin(0)) return false;
+    // The identification header has the first page to itself and the comment
+    // header starts the second (both Vorbis and Opus require it)
+    uint8_t head[30] = {};
+    const size_t size = (size_t)std::min<uint64_t>(sizeof(head), stream.Left());
+    if (!stream.Read(head, size)) return false;
+    const bool opus = size >= 19 && memcmp(head, "OpusHead", 8) == 0;
+    const bool vorbis = size >= 30 && head[0] == 1 && memcmp(head + 1, "vorbis", 6) == 0;
+    int preSkip = 0;
+    if (opus) {
+        info->channels = head[9];
+        info->sampleRate = 48000; // what Opus decodes to, whatever the input was
+        preSkip = ReadLE16(head + 10);
+    } else if (vorbis) {
+        info->channels = head[11];
+        info->sampleRate = ReadLE32(head + 12);
+    } else {
+        return false;
+    }
+
+    char magic[8];
+    const size_t magicSize = opus ? 8 : 7;
+    if (stream.Skip(stream.Left()) && stream.Read(magic, magicSize) &&
+        memcmp(magic, opus ? "OpusTags" : "\x03vorbis", magicSize) == 0)
+        ReadVorbisComment(stream, info, picture);
+
+    const int64_t granule = LastGranule(file, stream.Serial());
+    if (granule > preSkip && info->sampleRate != 0) {
+        info->duration = (double)(granule - preSkip) / info->sampleRate;
+        info->bitrate = (uint32_t)(file.Size() * 8 / info->duration / 1000);
+    }
+    return true;
+}
+
+// RIFF
+
+static Field RiffInfoField(const uint8_t* id) {
+    static const struct {
+        char id[5];
+        Field field;
+    } kChunks[] = {
+        {"INAM", Field::Title}, {"IART", Field::Artist}, {"IPRD", Field::Album}, {"IGNR", Field::Genre},
+        {"ICRD", Field::Year},  {"ITRK", Field::Track},  {"IPRT", Field::Track},
+    };
+    for (const auto& chunk : kChunks)
+        if (memcmp(id, chunk.id, 4) == 0) return chunk.field;
+    return Field::None;
+}
+
+// LIST/INFO: one chunk per field
+static void ReadRiffInfo(HeaderFile& file, uint64_t offset, uint64_t end, TrackInfo* info) {
+    const uint8_t* type = file.Read(offset, 4);
+    if (!type || memcmp(type, "INFO", 4) != 0) return;
+    offset += 4;
+    while (offset + 8 <= end) {
+        const uint8_t* c = file.Read(offset, 8);
+        if (!c) return;
+        const Field field = RiffInfoField(c);
+        const uint64_t length = ReadLE32(c + 4);
+        const uint64_t body = offset + 8;
+        if (length > end - body) return;
+        if (field != Field::None && length <= kMaxField) {
+            const uint8_t* text = file.Read(body, (size_t)length);
+            if (!text) return;
+            SetField(info, field, LegacyText(text, (size_t)length));
+        }
+        offset = body + length + (length & 1);
+    }
+}
+
+static bool ReadWav(HeaderFile& file, TrackInfo* info, EmbeddedPicture* picture) {
+    const uint8_t* h = file.Read(0, 12);
+    if (!h || memcmp(h, "RIFF", 4) != 0 || memcmp(h + 8, "WAVE", 4) != 0) return false;
+    uint64_t offset = 12;
+    uint32_t byteRate = 0;
+    uint64_t dataBytes = 0;
+    for (int chunk = 0; chunk < kMaxChunks && offset + 8 <= file.Size(); chunk++) {
+        const uint8_t* c = file.Read(offset, 8);
+        if (!c) break;
+        char id[4];
+        memcpy(id, c, 4);
+        const uint64_t length = ReadLE32(c + 4);
+        const uint64_t body = offset + 8;
+        if (memcmp(id, "fmt ", 4) == 0 && length >= 16) {
+            const uint8_t* f = file.Read(body, 16);
+            if (!f) break;
+            info->channels = (uint8_t)ReadLE16(f + 2);
+            info->sampleRate = ReadLE32(f + 4);
+            byteRate = ReadLE32(f + 8);
+        } else if (memcmp(id, "data", 4) == 0) {
+            // Streamed files leave the size at 0 or ~0; the file size knows better
+            dataBytes = std::min(length, file.Size() - body);
+            if (length == 0 || length == 0xFFFFFFFF) dataBytes = file.Size() - body;
+        } else if (memcmp(id, "LIST", 4) == 0) {
+            ReadRiffInfo(file, body, std::min(body + length, file.Size()), info);
+        } else if (memcmp(id, "id3 ", 4) == 0 || memcmp(id, "ID3 ", 4) == 0) {
+            ReadId3v2(file, body, info, picture, nullptr);
+        }
+        offset = body + length + (length & 1);
+    }
+    if (byteRate != 0) {
+        info->bitrate = byteRate * 8 / 1000;
+        info->duration = (double)dataBytes / byteRate;
+    }
+    return true;
+}
+
+// `picture` is nullptr unless one is wanted
+static bool ReadFile(const std::string& path, TrackInfo* info, EmbeddedPicture* picture) {
+    *info = TrackInfo();
+    HeaderFile file;
+    if (!file.Open(path)) return false;
+    const uint8_t* magic = file.Read(0, 12);
+    if (!magic) return false;
+    if (memcmp(magic, "RIFF", 4) == 0) return ReadWav(file, info, picture);
+    if (memcmp(magic, "OggS", 4) == 0) return ReadOgg(file, info, picture);
+
+    // ID3v2 leads MP3s and, now and then, FLACs
+    Mp3Gapless gapless;
+    const uint64_t start = ReadId3v2(file, 0, info, picture, &gapless);
+    const uint8_t* flac = file.Read(start, 4);
+    if (flac && memcmp(flac, "fLaC", 4) == 0) return ReadFlac(file, start, info, picture);
+    const bool stream = ReadMp3Stream(file, start, gapless, info);
+    ReadId3v1(file, info);
+    return stream || start > 0;
+}
+
+bool ReadTrackInfo(const std::string& path, TrackInfo* info) { return ReadFile(path, info, nullptr); }
+
+bool ReadEmbeddedPicture(const std::string& path, EmbeddedPicture* picture) {
+    *picture = EmbeddedPicture();
+    TrackInfo info;
+    ReadFile(path, &info, picture);
+    return !picture->data.empty();
+}
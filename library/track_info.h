@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What the tags and stream headers of one file say. Strings are UTF-8; empty
+// or 0 where the file doesn't tell.
+struct TrackInfo {
+    std::string title;
+    std::string artist;
+    std::string album;
+    std::string albumArtist;
+    std::string genre;
+    double duration = 0;  // seconds
+    uint32_t bitrate = 0; // kbit/s, averaged over the file
+    uint32_t sampleRate = 0;
+    uint16_t year = 0;
+    uint16_t track = 0;
+    uint16_t disc = 0;
+    uint8_t channels = 0;
+};
+
+// Reads the metadata of one file: ID3v2.2-2.4 and ID3v1 (MP3, and ID3v2 in
+// front of FLAC or inside WAV), Vorbis comments (FLAC, Ogg Vorbis, Opus) and
+// RIFF LIST/INFO, plus duration and bitrate from the stream headers. The
+// format is told by content, not by extension.
+//
+// Only headers are read, through a few bounded pread()s: fields nobody shows
+// (embedded pictures above all) are stepped over, never loaded, and the audio
+// is only touched for the first MP3 frame and the last Ogg page. False if the
+// file can't be opened or is of no known format.
+bool ReadTrackInfo(const std::string& path, TrackInfo* info);
+
+// A picture stored in the tags, as stored: JPEG or PNG as a rule
+struct EmbeddedPicture {
+    int type = -1; // ID3/FLAC picture type: 3 is the front cover
+    std::string mimeType;
+    std::vector<uint8_t> data;
+};
+
+// The cover among the pictures embedded in the file (ID3v2 APIC, FLAC PICTURE
+// blocks, METADATA_BLOCK_PICTURE Vorbis comments): the one marked as the front
+// cover, or else the first. The same walk as ReadTrackInfo(), except that
+// pictures up to 16 MiB are read instead of stepped over. False if there is
+// none.
+bool ReadEmbeddedPicture(const std::string& path, EmbeddedPicture* picture);
@@ -0,0 +1,396 @@
+#include "track_order.h"
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+
+// Retagged tracks move to their new place at most this often
+static const auto kResortInterval = std::chrono::milliseconds(500);
+// A sync that has more than this share of the tracks to place sorts them all
+static const size_t kRebuildDivisor = 4;
+static const uint32_t kNoRow = UINT32_MAX;
+
+static unsigned char Fold(char c) {
+    const unsigned char u = (unsigned char)c;
+    return u >= 'A' && u <= 'Z' ? (unsigned char)(u + ('a' - 'A')) : u;
+}
+
+static int CompareFolded(std::string_view a, std::string_view b) {
+    const size_t n = std::min(a.size(), b.size());
+    for (size_t i = 0; i < n; i++) {
+        const unsigned char x = Fold(a[i]);
+        const unsigned char y = Fold(b[i]);
+        if (x != y) return x < y ? -1 : 1;
+    }
+    return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+}
+
+// Eight bytes of `text` from `offset` on, folded, big-endian so that the
+// integers compare like the strings; zeros past the end
+static uint64_t FoldedPrefix(std::string_view text, size_t offset) {
+    uint64_t key = 0;
+    for (size_t i = offset; i < offset + 8; i++) key = key << 8 | (i < text.size() ? Fold(text[i]) : 0);
+    return key;
+}
+
+struct SortEntry {
+    uint64_t key;
+    uint32_t row; // or whatever is being sorted
+};
+
+// The sort key of every row for one column, and the full comparison the keys
+// stand in for
+class SortKeys {
+public:
+    // The ranks are by interned id, needed for the artist and album columns
+    SortKeys(const TrackTable& tracks, SortColumn column, const std::vector<uint32_t>& artistRanks,
+             const std::vector<uint32_t>& albumRanks)
+        : tracks_(tracks), column_(column), artistRanks_(artistRanks), albumRanks_(albumRanks) {}
+
+    uint64_t Key(size_t row) const {
+        switch (column_) {
+        case SortColumn::Title:
+            return TitlePrefix(tracks_.DisplayTitle(row));
+        case SortColumn::Artist:
+            return Pack(artistRanks_[tracks_.ArtistIds()[row]], albumRanks_[tracks_.AlbumIds()[row]], row);
+        case SortColumn::Album: {
+            const uint32_t artist = tracks_.AlbumArtistIds()[row] ? tracks_.AlbumArtistIds()[row]
+                                                                  : tracks_.ArtistIds()[row];
+            return Pack(albumRanks_[tracks_.AlbumIds()[row]], artistRanks_[artist], row);
+        }
+        case SortColumn::Duration:
+            return tracks_.DurationsMs()[row];
+        case SortColumn::Bitrate:
+            return tracks_.Bitrates()[row];
+        default:
+            return 0;
+        }
+    }
+
+    // Whether equal keys mean equal values; titles only compare a prefix
+    bool Exact() const { return column_ != SortColumn::Title; }
+
+    // Equal values keep path order, i.e. row order
+    bool Less(uint32_t a, uint32_t b) const {
+        const uint64_t x = Key(a);
+        const uint64_t y = Key(b);
+        if (x != y) return x < y;
+        if (!Exact()) {
+            if (int c = CompareFolded(tracks_.DisplayTitle(a), tracks_.DisplayTitle(b))) return c < 0;
+        }
+        return a < b;
+    }
+
+private:
+    // Two 24-bit ranks, then the disc and track numbers
+    uint64_t Pack(uint32_t first, uint32_t second, size_t row) const {
+        const uint64_t disc = std::min<uint32_t>(tracks_.Disc(row), 0xF);
+        const uint64_t track = std::min<uint32_t>(tracks_.Track(row), 0xFFF);
+        const uint64_t high = std::min<uint32_t>(first, 0xFFFFFF);
+        const uint64_t low = std::min<uint32_t>(second, 0xFFFFFF);
+        return high << 40 | low << 16 | disc << 12 | track;
+    }
+
+    static uint64_t TitlePrefix(std::string_view title) { return FoldedPrefix(title, 0); }
+
+    const TrackTable& tracks_;
+    SortColumn column_;
+    const std::vector<uint32_t>& artistRanks_;
+    const std::vector<uint32_t>& albumRanks_;
+};
+
+// LSD radix sort by key, a byte at a time; stable. Bytes that are the same in
+// every key (the high ones of durations and bitrates, say) are skipped.
+static void RadixSort(std::vector<SortEntry>& entries) {
+    if (entries.size() < 2) return;
+    std::vector<size_t> counts(8 * 256);
+    for (const SortEntry& entry : entries) {
+        for (int byte = 0; byte < 8; byte++) counts[byte * 256 + ((entry.key >> (byte * 8)) & 0xFF)]++;
+    }
+    std::vector<SortEntry> scratch(entries.size());
+    for (int byte = 0; byte < 8; byte++) {
+        size_t* count = &counts[byte * 256];
+        if (count[(entries[0].key >> (byte * 8)) & 0xFF] == entries.size()) continue;
+        size_t offset = 0;
+        for (int value = 0; value < 256; value++) {
+            const size_t n = count[value];
+            count[value] = offset;
+            offset += n;
+        }
+        for (const SortEntry& entry : entries) scratch[count[(entry.key >> (byte * 8)) & 0xFF]++] = entry;
+        entries.swap(scratch);
+    }
+}
+
+// Sorts runs of equal keys in [begin, end) on the next eight bytes of text
+template <typename TextOf>
+static void RefineRuns(std::vector<SortEntry>& entries, size_t begin, size_t end, size_t depth, const TextOf& textOf) {
+    for (size_t first = begin, last; first < end; first = last) {
+        for (last = first + 1; last < end && entries[last].key == entries[first].key; last++) {}
+        // A key that ends in a zero byte means the texts ended there too
+        if (last - first < 2 || (entries[first].key & 0xFF) == 0) continue;
+        for (size_t i = first; i < last; i++) entries[i].key = FoldedPrefix(textOf(entries[i].row), depth + 8);
+        std::sort(entries.begin() + first, entries.begin() + last, [](const SortEntry& a, const SortEntry& b) {
+            return a.key != b.key ? a.key < b.key : a.row < b.row;
+        });
+        RefineRuns(entries, first, last, depth + 8, textOf);
+    }
+}
+
+// Sorts `entries` by textOf(row), ASCII case-insensitively, equal texts by
+// row. Radix sort on the first eight bytes, then each run of equal prefixes on
+// the next eight, and so on, so long shared prefixes ("The ...") stay cheap.
+template <typename TextOf>
+static void SortByText(std::vector<SortEntry>& entries, const TextOf& textOf) {
+    for (SortEntry& entry : entries) entry.key = FoldedPrefix(textOf(entry.row), 0);
+    RadixSort(entries);
+    RefineRuns(entries, 0, entries.size(), 0, textOf);
+}
+
+bool TrackOrder::ExtendRanks(const StringPool& pool, Ranks& ranks) {
+    if (ranks.generation != pool.Generation() || ranks.count > pool.Count()) return false;
+    if (ranks.count == pool.Count()) return true;
+    const auto less = [&pool](uint32_t a, uint32_t b) { return CompareFolded(pool.Get(a), pool.Get(b)) < 0; };
+    std::vector<uint32_t> added(pool.Count() - ranks.count);
+    std::iota(added.begin(), added.end(), (uint32_t)ranks.count);
+    std::sort(added.begin(), added.end(), less);
+    std::vector<uint32_t> sorted;
+    sorted.reserve(pool.Count());
+    auto from = ranks.sorted.begin();
+    for (uint32_t id : added) {
+        auto at = std::upper_bound(from, ranks.sorted.end(), id, less);
+        sorted.insert(sorted.end(), from, at);
+        sorted.push_back(id);
+        from = at;
+    }
+    sorted.insert(sorted.end(), from, ranks.sorted.end());
+
+    // Renumbered: two strings ranked before are as equal as they were, only
+    // next to a new one do the strings need comparing
+    std::vector<uint32_t> next(pool.Count());
+    uint32_t rank = 0;
+    for (size_t i = 1; i < sorted.size(); i++) {
+        const uint32_t a = sorted[i - 1], b = sorted[i];
+        const bool equal = a < ranks.count && b < ranks.count ? ranks.ranks[a] == ranks.ranks[b]
+                                                              : CompareFolded(pool.Get(a), pool.Get(b)) == 0;
+        if (!equal) rank++;
+        next[b] = rank;
+    }
+    ranks.ranks = std::move(next);
+    ranks.sorted = std::move(sorted);
+    ranks.count = pool.Count();
+    return true;
+}
+
+void TrackOrder::UpdateRanks(const StringPool& pool, Ranks& ranks) {
+    if (ExtendRanks(pool, ranks)) return;
+    std::vector<SortEntry> entries(pool.Count());
+    for (size_t id = 0; id < entries.size(); id++) entries[id].row = (uint32_t)id;
+    const auto textOf = [&pool](uint32_t id) { return pool.Get(id); };
+    SortByText(entries, textOf);
+    // Strings that differ only in case share a rank
+    ranks.ranks.resize(entries.size());
+    ranks.sorted.resize(entries.size());
+    uint32_t rank = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (i > 0 && CompareFolded(pool.Get(entries[i - 1].row), pool.Get(entries[i].row)) != 0) rank++;
+        ranks.ranks[entries[i].row] = rank;
+        ranks.sorted[i] = entries[i].row;
+    }
+    ranks.count = pool.Count();
+    ranks.generation = pool.Generation();
+}
+
+void TrackOrder::SetSort(SortColumn column, bool descending) {
+    // A column coming back is brought up to date right away
+    if (column != column_ && column != SortColumn::Path) orders_[(int)column].synced = {};
+    if (column != column_) visibleValid_ = false;
+    column_ = column;
+    descending_ = descending;
+}
+
+void TrackOrder::SetFilter(const std::vector<uint32_t>& ids, bool ranked) {
+    filter_.assign(filter_.size(), false);
+    for (uint32_t id : ids) {
+        if (id >= filter_.size()) filter_.resize(id + 1);
+        filter_[id] = true;
+    }
+    if (ranked) {
+        ranked_ = ids;
+    } else {
+        ranked_.clear();
+    }
+    filtered_ = true;
+    visibleValid_ = false;
+}
+
+void TrackOrder::ClearFilter() {
+    filtered_ = false;
+    filter_.clear();
+    visible_.clear();
+    ranked_.clear();
+    visibleValid_ = false;
+}
+
+void TrackOrder::Sync(const TrackTable& tracks) {
+    size_ = tracks.Size();
+    if (sorting_.valid() && sorting_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        Install(sorting_.get());
+    }
+    // The view switches to the column asked for once its order is there
+    if (column_ == SortColumn::Path || orders_[(int)column_].built) {
+        if (shown_ != column_) visibleValid_ = false;
+        shown_ = column_;
+        shownDescending_ = descending_;
+    }
+    if (column_ != SortColumn::Path && !sorting_.valid() &&
+        (!orders_[(int)column_].built || orders_[(int)column_].stale)) {
+        StartSort(tracks, column_);
+    }
+    if (shown_ == SortColumn::Path && !filtered_) return;
+
+    if (!rowsValid_ || rowsLayout_ != tracks.Layout()) {
+        rowOfId_.assign(tracks.IdLimit(), kNoRow);
+        for (size_t row = 0; row < tracks.Size(); row++) rowOfId_[tracks.Id(row)] = (uint32_t)row;
+        rowsLayout_ = tracks.Layout();
+        rowsValid_ = true;
+        visibleValid_ = false;
+    }
+    if (shown_ != SortColumn::Path && SyncOrder(tracks, shown_)) visibleValid_ = false;
+
+    if (!filtered_ || visibleValid_) return;
+    const auto shown = [this](uint32_t id) { return id < filter_.size() && filter_[id]; };
+    visible_.clear();
+    if (shown_ == SortColumn::Path && !ranked_.empty()) {
+        // Less the tracks removed since
+        for (uint32_t id : ranked_) {
+            if (id < rowOfId_.size() && rowOfId_[id] != kNoRow) visible_.push_back(id);
+        }
+    } else if (shown_ == SortColumn::Path) {
+        for (uint32_t id : tracks.Ids()) {
+            if (shown(id)) visible_.push_back(id);
+        }
+    } else {
+        for (uint32_t id : orders_[(int)shown_].ids) {
+            if (shown(id)) visible_.push_back(id);
+        }
+    }
+    visibleValid_ = true;
+}
+
+void TrackOrder::StartSort(const TrackTable& tracks, SortColumn column) {
+    // The copy shares the table's columns; the UI thread copies the ones it
+    // changes while the sort still has them
+    auto copy = std::make_shared<const TrackTable>(tracks);
+    sorting_ = std::async(std::launch::async, [copy = std::move(copy), column, artistRanks = artistRanks_,
+                                               albumRanks = albumRanks_]() mutable {
+        // Dropped as soon as it is sorted, not when the result is collected
+        const std::shared_ptr<const TrackTable> tracks = std::move(copy);
+        return Sort(*tracks, column, std::move(artistRanks), std::move(albumRanks));
+    });
+}
+
+void TrackOrder::Install(Sorted sorted) {
+    Order& order = orders_[(int)sorted.column];
+    order.ids = std::move(sorted.ids);
+    order.built = true;
+    order.stale = false;
+    order.revision = sorted.revision;
+    order.layout = sorted.layout;
+    // Changes made while it was being sorted are merged in at the next sync
+    order.synced = {};
+    if (sorted.column == shown_) visibleValid_ = false;
+    // The worker's ranks replace ours if they are for a later state of the pool
+    const auto later = [](const Ranks& a, const Ranks& b) {
+        return a.generation != b.generation ? a.generation > b.generation : a.count > b.count;
+    };
+    if (later(sorted.artistRanks, artistRanks_)) artistRanks_ = std::move(sorted.artistRanks);
+    if (later(sorted.albumRanks, albumRanks_)) albumRanks_ = std::move(sorted.albumRanks);
+}
+
+TrackOrder::Sorted TrackOrder::Sort(const TrackTable& tracks, SortColumn column, Ranks artistRanks,
+                                    Ranks albumRanks) {
+    if (column == SortColumn::Artist || column == SortColumn::Album) {
+        UpdateRanks(tracks.Artists(), artistRanks);
+        UpdateRanks(tracks.Albums(), albumRanks);
+    }
+    const SortKeys keys(tracks, column, artistRanks.ranks, albumRanks.ranks);
+    std::vector<SortEntry> entries(tracks.Size());
+    for (size_t row = 0; row < entries.size(); row++) entries[row].row = (uint32_t)row;
+    if (keys.Exact()) {
+        for (SortEntry& entry : entries) entry.key = keys.Key(entry.row);
+        RadixSort(entries);
+    } else {
+        SortByText(entries, [&tracks](uint32_t row) { return tracks.DisplayTitle(row); });
+    }
+
+    Sorted sorted;
+    sorted.column = column;
+    sorted.ids.resize(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) sorted.ids[i] = tracks.Id(entries[i].row);
+    sorted.revision = tracks.Revision();
+    sorted.layout = tracks.Layout();
+    sorted.artistRanks = std::move(artistRanks);
+    sorted.albumRanks = std::move(albumRanks);
+    return sorted;
+}
+
+bool TrackOrder::SyncOrder(const TrackTable& tracks, SortColumn column) {
+    Order& order = orders_[(int)column];
+    const auto now = std::chrono::steady_clock::now();
+    if (order.revision == tracks.Revision()) return false;
+    // Same tracks, new tags: the order is still complete, just not quite right
+    if (order.layout == tracks.Layout() && now - order.synced < kResortInterval) return false;
+    Update(tracks, column, order);
+    order.revision = tracks.Revision();
+    order.layout = tracks.Layout();
+    order.synced = now;
+    return true;
+}
+
+// Merge: the tracks that are still there and unchanged are in order already
+// (rows only ever move together, in path order), so only the new and retagged
+// ones need placing
+void TrackOrder::Update(const TrackTable& tracks, SortColumn column, Order& order) {
+    std::vector<uint32_t> placed;
+    for (size_t row = 0; row < tracks.Size(); row++) {
+        if (tracks.ChangedAt(row) > order.revision) placed.push_back((uint32_t)row);
+    }
+    std::vector<uint32_t> kept;
+    kept.reserve(tracks.Size() - placed.size());
+    for (uint32_t id : order.ids) {
+        const uint32_t row = id < rowOfId_.size() ? rowOfId_[id] : kNoRow;
+        if (row != kNoRow && tracks.ChangedAt(row) <= order.revision) kept.push_back(row);
+    }
+
+    // Strings new to the pools are ranked here; a pool rebuilt by a rescan
+    // takes a full sort of its strings, which is left to the worker
+    const bool ranked = (column != SortColumn::Artist && column != SortColumn::Album) ||
+                        (ExtendRanks(tracks.Artists(), artistRanks_) && ExtendRanks(tracks.Albums(), albumRanks_));
+    std::vector<uint32_t> rows;
+    rows.reserve(kept.size() + placed.size());
+    if (ranked && placed.size() * kRebuildDivisor <= tracks.Size()) {
+        const SortKeys keys(tracks, column, artistRanks_.ranks, albumRanks_.ranks);
+        const auto less = [&keys](uint32_t a, uint32_t b) { return keys.Less(a, b); };
+        // Few of them: each goes in by binary search, so the kept tracks'
+        // keys are looked at only O(placed log kept) times
+        std::sort(placed.begin(), placed.end(), less);
+        auto from = kept.begin();
+        for (uint32_t row : placed) {
+            auto at = std::upper_bound(from, kept.end(), row, less);
+            rows.insert(rows.end(), from, at);
+            rows.push_back(row);
+            from = at;
+        }
+        rows.insert(rows.end(), from, kept.end());
+    } else {
+        // Too many to place here, or no ranks for them yet: at the end for
+        // now, the worker sorts them
+        rows = std::move(kept);
+        rows.insert(rows.end(), placed.begin(), placed.end());
+        order.stale = true;
+    }
+
+    order.ids.resize(rows.size());
+    for (size_t i = 0; i < rows.size(); i++) order.ids[i] = tracks.Id(rows[i]);
+}
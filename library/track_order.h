@@ -0,0 +1,127 @@
+#pragma once
+
+#include "track_table.h"
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+enum class SortColumn {
+    Path, // the table's own order, nothing to sort
+    Title,
+    Artist, // then album, disc and track
+    Album,  // then artist, disc and track
+    Duration,
+    Bitrate,
+    Count
+};
+
+// The library in the order of one of its columns, for the table view.
+//
+// Each column's order is a permutation of track ids, built the first time the
+// column is asked for and then kept, so switching columns or direction is free.
+// A full build radix-sorts precomputed 64-bit keys (artists and albums by the
+// rank of their interned string, titles eight bytes at a time), which is
+// stable: equal keys stay in path order. It runs on a worker, on a copy of the
+// table, and the view keeps the order it had until the new one is done. After
+// that the library's changes are merged in: only tracks added or retagged
+// since the last sync are sorted, the rest keep their relative order. Too
+// many of them at once go to the end of the order, unsorted, until another
+// full build on the worker puts them in place.
+//
+// Strings compare ASCII case-insensitively.
+//
+// A filter (search results) narrows the view to some tracks, still in order;
+// ranked results (fuzzy search) keep their own order while no column is sorted.
+class TrackOrder {
+public:
+    void SetSort(SortColumn column, bool descending);
+    SortColumn Column() const { return column_; }
+    bool Descending() const { return descending_; }
+    // The column asked for is being sorted on the worker. Meanwhile the view
+    // keeps the order it had before, or has the tracks not yet placed last.
+    bool Sorting() const {
+        return column_ != SortColumn::Path && (shown_ != column_ || orders_[(int)column_].stale);
+    }
+
+    // Shows only the tracks with these ids; tracks added later stay hidden
+    // until the next filter. If `ranked`, `ids` is best first, and that is the
+    // order of the Path column.
+    void SetFilter(const std::vector<uint32_t>& ids, bool ranked = false);
+    void ClearFilter();
+    bool Filtered() const { return filtered_; }
+
+    // Brings the current column's order up to date with `tracks`; call once a
+    // frame before Row(). Rows added or removed are picked up at once, retagged
+    // ones at most twice a second, since tags stream in for a while.
+    void Sync(const TrackTable& tracks);
+
+    size_t Size() const { return filtered_ ? visible_.size() : size_; }
+    // Table row of the i-th track in the view
+    size_t Row(size_t i) const {
+        if (shownDescending_) i = Size() - 1 - i;
+        if (filtered_) return rowOfId_[visible_[i]];
+        if (shown_ == SortColumn::Path) return i;
+        return rowOfId_[orders_[(int)shown_].ids[i]];
+    }
+
+private:
+    struct Order {
+        std::vector<uint32_t> ids;
+        bool built = false;
+        bool stale = false;    // complete, but wants a full build
+        uint32_t revision = 0; // the table's at the last sync
+        uint32_t layout = 0;
+        std::chrono::steady_clock::time_point synced;
+    };
+
+    // Ranks of a pool's strings in sort order, by interned id
+    struct Ranks {
+        std::vector<uint32_t> ranks;
+        std::vector<uint32_t> sorted; // ids in rank order
+        size_t count = 0;             // the pool's, when computed
+        uint32_t generation = 0;
+    };
+
+    // A column sorted from scratch, on a worker
+    struct Sorted {
+        SortColumn column = SortColumn::Path;
+        std::vector<uint32_t> ids;
+        uint32_t revision = 0;
+        uint32_t layout = 0;
+        Ranks artistRanks;
+        Ranks albumRanks;
+    };
+
+    // Ranks the strings added to the pool since, each by binary search.
+    // Returns false if the pool was rebuilt since, which takes UpdateRanks().
+    static bool ExtendRanks(const StringPool& pool, Ranks& ranks);
+    static void UpdateRanks(const StringPool& pool, Ranks& ranks);
+    static Sorted Sort(const TrackTable& tracks, SortColumn column, Ranks artistRanks, Ranks albumRanks);
+    void StartSort(const TrackTable& tracks, SortColumn column);
+    void Install(Sorted sorted);
+    // Returns whether the column's order changed
+    bool SyncOrder(const TrackTable& tracks, SortColumn column);
+    void Update(const TrackTable& tracks, SortColumn column, Order& order);
+
+    SortColumn column_ = SortColumn::Path;
+    bool descending_ = false;
+    SortColumn shown_ = SortColumn::Path; // column_ once its order is built
+    bool shownDescending_ = false;
+    size_t size_ = 0;
+    std::future<Sorted> sorting_;
+
+    Order orders_[(int)SortColumn::Count];
+    Ranks artistRanks_;
+    Ranks albumRanks_;
+    std::vector<uint32_t> rowOfId_; // id -> row, for the table's current layout
+    uint32_t rowsLayout_ = 0;
+    bool rowsValid_ = false;
+
+    bool filtered_ = false;
+    std::vector<bool> filter_;      // by id
+    std::vector<uint32_t> visible_; // ids of the filtered view, in order
+    std::vector<uint32_t> ranked_;  // ids of a ranked filter, best first
+    bool visibleValid_ = false;
+};
@@ -0,0 +1,299 @@
+#include "track_table.h"
+#include "util/hash.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <numeric>
+#include <type_traits>
+
+// Dead bytes in the track arena tolerated before it is rebuilt: above this
+// much and more than half of it
+static const size_t kCompactBytes = 64 * 1024;
+
+StringPool::StringPool() {
+    Clear();
+}
+
+void StringPool::Clear() {
+    static std::atomic<uint32_t> generations{0};
+    arena_.assign(1, '\0');
+    offsets_.assign({0, 1});
+    slots_.assign(16, 0);
+    generation_ = generations.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+uint32_t StringPool::Intern(std::string_view text) {
+    if (text.empty()) return 0;
+    // At most half full, so probe sequences stay short
+    if ((Count() + 1) * 2 > slots_.size()) Rehash(slots_.size() * 2);
+    const size_t mask = slots_.size() - 1;
+    for (size_t i = Fnv1a64(text.data(), text.size()) & mask;; i = (i + 1) & mask) {
+        const uint32_t slot = slots_[i];
+        if (slot == 0) {
+            const uint32_t id = (uint32_t)Count();
+            arena_.insert(arena_.end(), text.begin(), text.end());
+            arena_.push_back('\0');
+            offsets_.push_back((uint32_t)arena_.size());
+            slots_[i] = id + 1;
+            return id;
+        }
+        if (Get(slot - 1) == text) return slot - 1;
+    }
+}
+
+void StringPool::Rehash(size_t slots) {
+    slots_.assign(slots, 0);
+    const size_t mask = slots - 1;
+    for (uint32_t id = 1; id < Count(); id++) {
+        std::string_view text = Get(id);
+        size_t i = Fnv1a64(text.data(), text.size()) & mask;
+        while (slots_[i] != 0) i = (i + 1) & mask;
+        slots_[i] = id + 1;
+    }
+}
+
+std::vector<uint32_t> StringPool::Ranks() const {
+    std::vector<uint32_t> order(Count());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return Get(a) < Get(b); });
+    std::vector<uint32_t> ranks(order.size());
+    for (size_t rank = 0; rank < order.size(); rank++) ranks[order[rank]] = (uint32_t)rank;
+    return ranks;
+}
+
+size_t StringPool::MemoryBytes() const {
+    return arena_.capacity() + offsets_.capacity() * sizeof(uint32_t) + slots_.capacity() * sizeof(uint32_t);
+}
+
+StringArena::StringArena() {
+    Add(std::string_view("", 0));
+}
+
+// The copy's chunks are all full: it writes to new ones, never after the end
+// of a chunk the original may still be filling
+StringArena::StringArena(const StringArena& other)
+    : chunks_(other.chunks_), used_(other.capacity_), capacity_(other.capacity_), size_(other.size_),
+      allocated_(other.allocated_) {}
+
+StringArena& StringArena::operator=(const StringArena& other) {
+    if (this != &other) *this = StringArena(other);
+    return *this;
+}
+
+uint32_t StringArena::Add(std::string_view text) {
+    const size_t bytes = text.size() + 1;
+    if (chunks_.empty() || used_ + bytes > capacity_) {
+        // A string longer than a chunk gets one of its own
+        capacity_ = std::max<size_t>(bytes, (size_t)1 << kChunkBits);
+        chunks_.emplace_back(new char[capacity_]);
+        used_ = 0;
+        allocated_ += capacity_;
+    }
+    const uint32_t position = (uint32_t)((chunks_.size() - 1) << kChunkBits | used_);
+    char* out = chunks_.back().get() + used_;
+    memcpy(out, text.data(), text.size());
+    out[text.size()] = '\0';
+    used_ = bytes > (size_t)1 << kChunkBits ? capacity_ : used_ + bytes;
+    size_ += bytes;
+    return position;
+}
+
+template <typename To, typename From, typename F>
+void TrackTable::ForEachColumn(To& to, From& from, F&& f) {
+    f(to.path_, from.path_);
+    f(to.title_, from.title_);
+    f(to.artist_, from.artist_);
+    f(to.albumArtist_, from.albumArtist_);
+    f(to.album_, from.album_);
+    f(to.genre_, from.genre_);
+    f(to.durationMs_, from.durationMs_);
+    f(to.sampleRate_, from.sampleRate_);
+    f(to.bitrate_, from.bitrate_);
+    f(to.year_, from.year_);
+    f(to.track_, from.track_);
+    f(to.disc_, from.disc_);
+    f(to.channels_, from.channels_);
+    f(to.flags_, from.flags_);
+    f(to.id_, from.id_);
+    f(to.changed_, from.changed_);
+}
+
+TrackTable::TrackTable() = default;
+
+void TrackTable::Clear() {
+    ForEachColumn(*this, *this, [](auto& column, auto&) { column = std::decay_t<decltype(column)>(); });
+    arena_ = StringArena();
+    garbage_ = 0;
+    revision_++;
+    layout_++;
+    artists_.Edit().Clear();
+    albums_.Edit().Clear();
+    genres_.Edit().Clear();
+}
+
+void TrackTable::Reserve(size_t rows) {
+    ForEachColumn(*this, *this, [rows](auto& column, auto&) { column.Edit().reserve(rows); });
+}
+
+void TrackTable::SetRoot(std::string_view root) {
+    nameOffset_ = root.size() + (root == "/" ? 0 : 1);
+}
+
+TrackTable::StringRef TrackTable::Store(std::string_view text) {
+    if (text.empty()) return StringRef{0, 0};
+    return StringRef{arena_.Add(text), (uint32_t)text.size()};
+}
+
+// Copies of the table keep the old arena's chunks alive for as long as they need them
+void TrackTable::CompactIfWasteful() {
+    if (garbage_ < kCompactBytes || garbage_ * 2 < arena_.Size()) return;
+    const StringArena old = std::move(arena_);
+    arena_ = StringArena();
+    std::vector<StringRef>& paths = path_.Edit();
+    std::vector<StringRef>& titles = title_.Edit();
+    for (size_t i = 0; i < Size(); i++) {
+        paths[i] = Store(std::string_view(old.At(paths[i].offset), paths[i].length));
+        titles[i] = Store(std::string_view(old.At(titles[i].offset), titles[i].length));
+    }
+    garbage_ = 0;
+}
+
+void TrackTable::Insert(size_t index, std::string_view path) {
+    ForEachColumn(*this, *this, [index](auto& column, auto&) {
+        auto& values = column.Edit();
+        values.insert(values.begin() + index, typename std::decay_t<decltype(values)>::value_type());
+    });
+    path_.Edit()[index] = Store(path);
+    id_.Edit()[index] = nextId_++;
+    changed_.Edit()[index] = ++revision_;
+    layout_++;
+}
+
+void TrackTable::Erase(size_t first, size_t last) {
+    for (size_t i = first; i < last; i++) {
+        garbage_ += (*path_)[i].length + 1;
+        if ((*title_)[i].length != 0) garbage_ += (*title_)[i].length + 1;
+    }
+    ForEachColumn(*this, *this, [first, last](auto& column, auto&) {
+        auto& values = column.Edit();
+        values.erase(values.begin() + first, values.begin() + last);
+    });
+    revision_++;
+    layout_++;
+    CompactIfWasteful();
+}
+
+void TrackTable::Replace(const std::vector<std::string>& paths, std::vector<std::string>* added) {
+    TrackTable next;
+    next.nameOffset_ = nameOffset_;
+    next.revision_ = revision_;
+    next.layout_ = layout_;
+    next.nextId_ = nextId_;
+    next.Reserve(paths.size());
+    // Fresh pools too: strings of removed files and of tags since rewritten
+    // would otherwise pile up with every rescan
+    struct Remap {
+        const StringPool& from;
+        StringPool& to;
+        std::vector<uint32_t> ids; // old id -> new id + 1, 0 = not yet interned
+        uint32_t operator()(uint32_t id) {
+            if (ids[id] == 0) ids[id] = to.Intern(from.Get(id)) + 1;
+            return ids[id] - 1;
+        }
+    };
+    Remap artists{*artists_, next.artists_.Edit(), std::vector<uint32_t>(artists_->Count())};
+    Remap albums{*albums_, next.albums_.Edit(), std::vector<uint32_t>(albums_->Count())};
+    Remap genres{*genres_, next.genres_.Edit(), std::vector<uint32_t>(genres_->Count())};
+    size_t old = 0;
+    for (const std::string& path : paths) {
+        while (old < Size() && Path(old) < path) old++;
+        if (old < Size() && Path(old) == path) {
+            ForEachColumn(next, *this, [old](auto& to, auto& from) { to.Edit().push_back((*from)[old]); });
+            next.path_.Edit().back() = next.Store(path);
+            next.title_.Edit().back() = next.Store(Title(old));
+            next.artist_.Edit().back() = artists((*artist_)[old]);
+            next.albumArtist_.Edit().back() = artists((*albumArtist_)[old]);
+            next.album_.Edit().back() = albums((*album_)[old]);
+            next.genre_.Edit().back() = genres((*genre_)[old]);
+        } else {
+            next.Append(path);
+            added->push_back(path);
+        }
+    }
+    next.revision_++;
+    next.layout_++;
+    *this = std::move(next);
+}
+
+void TrackTable::SetInfo(size_t index, const TrackInfo& info, bool ok) {
+    if ((*title_)[index].length != 0) garbage_ += (*title_)[index].length + 1;
+    title_.Edit()[index] = Store(info.title);
+    artist_.Edit()[index] = artists_.Edit().Intern(info.artist);
+    albumArtist_.Edit()[index] = artists_.Edit().Intern(info.albumArtist);
+    album_.Edit()[index] = albums_.Edit().Intern(info.album);
+    genre_.Edit()[index] = genres_.Edit().Intern(info.genre);
+    durationMs_.Edit()[index] = (uint32_t)std::min(info.duration * 1000.0 + 0.5, (double)UINT32_MAX);
+    sampleRate_.Edit()[index] = info.sampleRate;
+    bitrate_.Edit()[index] = (uint16_t)std::min<uint32_t>(info.bitrate, UINT16_MAX);
+    year_.Edit()[index] = info.year;
+    track_.Edit()[index] = info.track;
+    disc_.Edit()[index] = (uint8_t)std::min<uint16_t>(info.disc, UINT8_MAX);
+    channels_.Edit()[index] = info.channels;
+    flags_.Edit()[index] = kTagsRead | (ok ? 0 : kTagsFailed);
+    changed_.Edit()[index] = ++revision_;
+    CompactIfWasteful();
+}
+
+size_t TrackTable::LowerBound(std::string_view path) const {
+    size_t lo = 0, hi = Size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (Path(mid) < path) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+int TrackTable::Find(std::string_view path) const {
+    size_t i = LowerBound(path);
+    return i < Size() && Path(i) == path ? (int)i : -1;
+}
+
+const char* TrackTable::Name(size_t i) const {
+    const StringRef path = (*path_)[i];
+    return arena_.At(path.offset) + std::min<size_t>(nameOffset_, path.length);
+}
+
+std::string_view TrackTable::DisplayTitle(size_t i) const {
+    if ((*title_)[i].length != 0) return Title(i);
+    std::string_view name = Path(i);
+    name.remove_prefix(name.rfind('/') + 1);
+    const size_t dot = name.rfind('.');
+    return dot != std::string_view::npos && dot > 0 ? name.substr(0, dot) : name;
+}
+
+TrackInfo TrackTable::InfoAt(size_t i) const {
+    TrackInfo info;
+    info.title = std::string(Title(i));
+    info.artist = std::string(Artist(i));
+    info.album = std::string(Album(i));
+    info.albumArtist = std::string(AlbumArtist(i));
+    info.genre = std::string(Genre(i));
+    info.duration = Duration(i);
+    info.bitrate = Bitrate(i);
+    info.sampleRate = SampleRate(i);
+    info.year = Year(i);
+    info.track = Track(i);
+    info.disc = Disc(i);
+    info.channels = Channels(i);
+    return info;
+}
+
+size_t TrackTable::MemoryBytes() const {
+    size_t bytes = arena_.MemoryBytes();
+    ForEachColumn(*this, *this, [&bytes](auto& column, auto&) {
+        bytes += column->capacity() * sizeof(typename std::decay_t<decltype(*column)>::value_type);
+    });
+    return bytes + artists_->MemoryBytes() + albums_->MemoryBytes() + genres_->MemoryBytes();
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include "track_info.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Interned strings: every distinct value is stored once, NUL-terminated, in
+// one arena and named by a 32-bit id. Id 0 is the empty string.
+class StringPool {
+public:
+    StringPool();
+
+    uint32_t Intern(std::string_view text);
+    std::string_view Get(uint32_t id) const {
+        return std::string_view(arena_.data() + offsets_[id], offsets_[id + 1] - offsets_[id] - 1);
+    }
+    const char* CStr(uint32_t id) const { return arena_.data() + offsets_[id]; }
+    size_t Count() const { return offsets_.size() - 1; }
+    // New for every Clear(), and different between pools not copied from one
+    // another: with Count(), tells whether anything derived from the pool
+    // still matches it
+    uint32_t Generation() const { return generation_; }
+
+    // Rank of every id in the sorted order of the strings, so comparing ranks
+    // compares the strings. Computed on demand, O(count log count).
+    std::vector<uint32_t> Ranks() const;
+
+    void Clear();
+    size_t MemoryBytes() const;
+
+private:
+    void Rehash(size_t slots);
+
+    std::vector<char> arena_;
+    std::vector<uint32_t> offsets_; // id -> start in the arena, plus the end
+    std::vector<uint32_t> slots_;   // open addressing by hash: id + 1, 0 = free
+    uint32_t generation_ = 0;
+};
+
+// Copies share the value until one of them is changed, which then gets a
+// copy of its own. The sharing is thread-safe; a copy can be read on another
+// thread while the original is changed.
+template <typename T>
+class CopyOnWrite {
+public:
+    CopyOnWrite() : value_(std::make_shared<T>()) {}
+
+    const T& operator*() const { return *value_; }
+    const T* operator->() const { return value_.get(); }
+    T& Edit() {
+        // A copy dropped on another thread right now only costs a needless copy.
+        // use_count() is a relaxed load: the fence orders that thread's last
+        // reads of the value, before it let go, ahead of our writes.
+        if (value_.use_count() > 1) value_ = std::make_shared<T>(*value_);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return *value_;
+    }
+
+private:
+    std::shared_ptr<T> value_;
+};
+
+// Append-only storage for NUL-terminated strings, in chunks that never move
+// or change once written. Copies share the chunks written so far and append
+// to chunks of their own, so a copy reads the same bytes as the original
+// however much either grows.
+class StringArena {
+public:
+    StringArena();
+    StringArena(const StringArena& other);
+    StringArena& operator=(const StringArena& other);
+    StringArena(StringArena&&) = default;
+    StringArena& operator=(StringArena&&) = default;
+
+    // Position of the copy of `text`; position 0 is ""
+    uint32_t Add(std::string_view text);
+    const char* At(uint32_t position) const {
+        return chunks_[position >> kChunkBits].get() + (position & ((1u << kChunkBits) - 1));
+    }
+    // Bytes stored, NULs included
+    size_t Size() const { return size_; }
+    size_t MemoryBytes() const { return allocated_; }
+
+private:
+    static const int kChunkBits = 20;
+
+    std::vector<std::shared_ptr<char[]>> chunks_;
+    size_t used_ = 0;     // of the last chunk; a full one if it is shared
+    size_t capacity_ = 0; // of the last chunk
+    size_t size_ = 0;
+    size_t allocated_ = 0;
+};
+
+// The library's tracks, column by column. Paths and titles, unique per track,
+// sit back to back in one arena; artists, albums and genres repeat across
+// tracks and are interned. Everything else per track is a small fixed-size
+// number. Sorting, filtering and drawing read just the columns they need,
+// contiguously, instead of chasing a few heap strings per track.
+//
+// Rows are kept in path order by the owner; Find() relies on it. Every track
+// also has an id that stays with it while rows come and go around it, and
+// every row remembers the Revision() it last changed at, so views built on the
+// table (TrackOrder) can catch up with just what changed.
+//
+// Copying a table costs next to nothing: the copy shares the columns, the
+// pools and the arena, and a column is copied only when one side changes it
+// while the other still has it. Workers sort and index such copies while the
+// UI thread keeps updating the original.
+class TrackTable {
+public:
+    enum Flags : uint8_t {
+        kTagsRead = 0x01,   // the tag reader has been through the file
+        kTagsFailed = 0x02, // ...and found nothing it could read
+    };
+
+    TrackTable();
+
+    size_t Size() const { return path_->size(); }
+    // Bumped by every change
+    uint32_t Revision() const { return revision_; }
+    // Bumped when rows are inserted or removed, i.e. when rows move
+    uint32_t Layout() const { return layout_; }
+    // Ids are below this
+    uint32_t IdLimit() const { return nextId_; }
+    void Clear();
+    void Reserve(size_t rows);
+
+    // Paths are under `root`; Name() is the part after it.
+    void SetRoot(std::string_view root);
+
+    void Insert(size_t index, std::string_view path);
+    void Append(std::string_view path) { Insert(Size(), path); }
+    void Erase(size_t first, size_t last);
+    // Replaces the rows with `paths` (sorted). Rows whose path stays keep their
+    // tags; the paths that are new are appended to `added`. The string pools
+    // are rebuilt from the rows kept, so interned ids change.
+    void Replace(const std::vector<std::string>& paths, std::vector<std::string>* added);
+    void SetInfo(size_t index, const TrackInfo& info, bool ok);
+
+    // First row whose path is not less than `path`
+    size_t LowerBound(std::string_view path) const;
+    // Row of `path`, or -1
+    int Find(std::string_view path) const;
+
+    std::string_view Path(size_t i) const { return String((*path_)[i]); }
+    // Path relative to the root, NUL-terminated
+    const char* Name(size_t i) const;
+    std::string_view Title(size_t i) const { return String((*title_)[i]); }
+    const char* TitleCStr(size_t i) const { return arena_.At((*title_)[i].offset); }
+    // The title, or the file name without its extension until there are tags
+    std::string_view DisplayTitle(size_t i) const;
+    std::string_view Artist(size_t i) const { return artists_->Get((*artist_)[i]); }
+    std::string_view AlbumArtist(size_t i) const { return artists_->Get((*albumArtist_)[i]); }
+    std::string_view Album(size_t i) const { return albums_->Get((*album_)[i]); }
+    std::string_view Genre(size_t i) const { return genres_->Get((*genre_)[i]); }
+    double Duration(size_t i) const { return (*durationMs_)[i] / 1000.0; }
+    uint16_t Bitrate(size_t i) const { return (*bitrate_)[i]; }
+    uint32_t SampleRate(size_t i) const { return (*sampleRate_)[i]; }
+    uint16_t Year(size_t i) const { return (*year_)[i]; }
+    uint16_t Track(size_t i) const { return (*track_)[i]; }
+    uint8_t Disc(size_t i) const { return (*disc_)[i]; }
+    uint8_t Channels(size_t i) const { return (*channels_)[i]; }
+    uint8_t Flags(size_t i) const { return (*flags_)[i]; }
+    uint32_t Id(size_t i) const { return (*id_)[i]; }
+    // Revision() at which the row was inserted or last had its tags set
+    uint32_t ChangedAt(size_t i) const { return (*changed_)[i]; }
+
+    // Whole columns, for sorting and filtering
+    const std::vector<uint32_t>& ArtistIds() const { return *artist_; }
+    const std::vector<uint32_t>& AlbumArtistIds() const { return *albumArtist_; }
+    const std::vector<uint32_t>& AlbumIds() const { return *album_; }
+    const std::vector<uint32_t>& GenreIds() const { return *genre_; }
+    const std::vector<uint32_t>& DurationsMs() const { return *durationMs_; }
+    const std::vector<uint16_t>& Bitrates() const { return *bitrate_; }
+    const std::vector<uint32_t>& Ids() const { return *id_; }
+    const StringPool& Artists() const { return *artists_; } // album artists too
+    const StringPool& Albums() const { return *albums_; }
+    const StringPool& Genres() const { return *genres_; }
+
+    TrackInfo InfoAt(size_t i) const;
+    size_t MemoryBytes() const;
+
+private:
+    struct StringRef {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    template <typename T>
+    using Column = CopyOnWrite<std::vector<T>>;
+
+    std::string_view String(StringRef ref) const { return std::string_view(arena_.At(ref.offset), ref.length); }
+    StringRef Store(std::string_view text);
+    void CompactIfWasteful();
+
+    // Calls f(to.column, from.column) for every per-row column
+    template <typename To, typename From, typename F>
+    static void ForEachColumn(To& to, From& from, F&& f);
+
+    StringArena arena_;  // StringRef{0, 0} is ""
+    size_t garbage_ = 0; // arena bytes no row refers to any more
+    size_t nameOffset_ = 0;
+    uint32_t revision_ = 0;
+    uint32_t layout_ = 0;
+    uint32_t nextId_ = 0;
+
+    Column<StringRef> path_;
+    Column<StringRef> title_;
+    Column<uint32_t> artist_;
+    Column<uint32_t> albumArtist_;
+    Column<uint32_t> album_;
+    Column<uint32_t> genre_;
+    Column<uint32_t> durationMs_;
+    Column<uint32_t> sampleRate_;
+    Column<uint16_t> bitrate_;
+    Column<uint16_t> year_;
+    Column<uint16_t> track_;
+    Column<uint8_t> disc_;
+    Column<uint8_t> channels_;
+    Column<uint8_t> flags_;
+    Column<uint32_t> id_;
+    Column<uint32_t> changed_;
+
+    CopyOnWrite<StringPool> artists_;
+    CopyOnWrite<StringPool> albums_;
+    CopyOnWrite<StringPool> genres_;
+};
@@ -0,0 +1,278 @@
+#include "watcher.h"
+#include "scanner.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+// Changes are applied once events have stopped for kQuiet, or kMaxDelay after
+// the first one while they keep coming (a long copy into the library)
+static const std::chrono::milliseconds kQuiet(250);
+static const std::chrono::milliseconds kMaxDelay(1000);
+
+LibraryWatcher::LibraryWatcher(std::unordered_set<std::string> extensions) : extensions_(std::move(extensions)) {}
+
+LibraryWatcher::~LibraryWatcher() {
+    Stop();
+}
+
+bool LibraryWatcher::Poll(std::vector<LibraryChange>& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (changes_.empty()) return false;
+    out.insert(out.end(), std::make_move_iterator(changes_.begin()), std::make_move_iterator(changes_.end()));
+    changes_.clear();
+    return true;
+}
+
+WatcherStatus LibraryWatcher::Status() const {
+    WatcherStatus status;
+    status.watches = watchCount_.load(std::memory_order_relaxed);
+    status.failed = failedCount_.load(std::memory_order_relaxed);
+    status.active = active_.load(std::memory_order_relaxed);
+    return status;
+}
+
+#ifdef __linux__
+
+static const uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB |
+                                   IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+static std::string JoinPath(const std::string& dir, const char* name) {
+    std::string path = dir;
+    if (path.empty() || path.back() != '/') path += '/';
+    path += name;
+    return path;
+}
+
+void LibraryWatcher::Start(const std::string& root, std::vector<std::string> directories) {
+    Stop();
+    root_ = root;
+    inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_ < 0) {
+        std::cerr << "inotify unavailable, the library won't update live: " << strerror(errno) << std::endl;
+        return;
+    }
+    wake_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    running_.store(true);
+    thread_ = std::thread(&LibraryWatcher::ThreadMain, this, std::move(directories));
+}
+
+void LibraryWatcher::Stop() {
+    running_.store(false);
+    if (wake_ >= 0) {
+        uint64_t one = 1;
+        (void)!write(wake_, &one, sizeof(one));
+    }
+    if (thread_.joinable()) thread_.join();
+    if (inotify_ >= 0) close(inotify_);
+    if (wake_ >= 0) close(wake_);
+    inotify_ = wake_ = -1;
+
+    watches_.clear();
+    touched_.clear();
+    newDirs_.clear();
+    goneDirs_.clear();
+    overflow_ = pending_ = false;
+    watchCount_.store(0);
+    failedCount_.store(0);
+    active_.store(false);
+    std::lock_guard<std::mutex> lock(mutex_);
+    changes_.clear();
+}
+
+void LibraryWatcher::ThreadMain(std::vector<std::string> directories) {
+    // Thousands of watches take a moment; events start queueing for the first
+    // ones straight away, so nothing is lost while the rest are added
+    for (const std::string& dir : directories) {
+        if (!running_.load(std::memory_order_relaxed)) return;
+        AddWatch(dir);
+    }
+    directories = std::vector<std::string>();
+    active_.store(true);
+
+    while (running_.load(std::memory_order_relaxed)) {
+        int timeout = -1;
+        if (pending_) {
+            auto due = std::min(lastEvent_ + kQuiet, firstEvent_ + kMaxDelay);
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(due - std::chrono::steady_clock::now());
+            timeout = (int)std::max<int64_t>(0, wait.count());
+        }
+        pollfd fds[2] = {{inotify_, POLLIN, 0}, {wake_, POLLIN, 0}};
+        if (poll(fds, 2, timeout) < 0 && errno != EINTR) {
+            std::cerr << "inotify poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        if (fds[0].revents & POLLIN) ReadEvents();
+        if (pending_ && std::chrono::steady_clock::now() >= std::min(lastEvent_ + kQuiet, firstEvent_ + kMaxDelay))
+            Flush();
+    }
+}
+
+void LibraryWatcher::AddWatch(const std::string& dir) {
+    int wd = inotify_add_watch(inotify_, dir.c_str(), kWatchMask);
+    if (wd < 0) {
+        // ENOSPC: fs.inotify.max_user_watches is used up; say so once
+        if (errno == ENOSPC && failedCount_.fetch_add(1) == 0) {
+            std::cerr << "inotify watch limit reached (fs.inotify.max_user_watches), "
+                         "part of the library won't update live"
+                      << std::endl;
+        }
+        return;
+    }
+    watches_[wd] = dir;
+    watchCount_.store(watches_.size(), std::memory_order_relaxed);
+}
+
+void LibraryWatcher::DropWatches(const std::string& dir) {
+    const std::string prefix = dir + '/';
+    for (auto it = watches_.begin(); it != watches_.end();) {
+        if (it->second == dir || it->second.compare(0, prefix.size(), prefix) == 0) {
+            inotify_rm_watch(inotify_, it->first);
+            it = watches_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    watchCount_.store(watches_.size(), std::memory_order_relaxed);
+}
+
+void LibraryWatcher::ReadEvents() {
+    alignas(inotify_event) char buffer[64 * 1024];
+    bool any = false;
+    for (;;) {
+        ssize_t length = read(inotify_, buffer, sizeof(buffer));
+        if (length <= 0) break;
+        for (char* p = buffer; p < buffer + length;) {
+            const inotify_event* event = (const inotify_event*)p;
+            p += sizeof(inotify_event) + event->len;
+            any = true;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow_ = true;
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                watches_.erase(event->wd);
+                continue;
+            }
+            auto it = watches_.find(event->wd);
+            if (it == watches_.end() || event->len == 0) continue;
+            std::string path = JoinPath(it->second, event->name);
+
+            if (event->mask & IN_ISDIR) {
+                // Removals are applied before additions, so a directory that
+                // is replaced within one burst ends up walked afresh
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    newDirs_.insert(std::move(path));
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    newDirs_.erase(path);
+                    goneDirs_.insert(std::move(path));
+                }
+            } else if (MatchesExtension(extensions_, event->name)) {
+                touched_.insert(std::move(path));
+            }
+        }
+    }
+    if (!any) return;
+
+    lastEvent_ = std::chrono::steady_clock::now();
+    if (!pending_) firstEvent_ = lastEvent_;
+    pending_ = true;
+}
+
+bool LibraryWatcher::Stat(const std::string& path, ScannedFile* file) const {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    file->path = path;
+    file->stamp.size = (uint64_t)st.st_size;
+    file->stamp.mtime = (int64_t)st.st_mtime;
+    file->inode = (uint64_t)st.st_ino;
+    return true;
+}
+
+// Watch first, then list: anything created in between is either listed or
+// arrives as an event
+void LibraryWatcher::WalkNewDirectory(const std::string& dir, std::vector<LibraryChange>& changes) {
+    std::vector<std::string> stack{dir};
+    while (!stack.empty() && running_.load(std::memory_order_relaxed)) {
+        std::string current = std::move(stack.back());
+        stack.pop_back();
+        AddWatch(current);
+        DIR* d = opendir(current.c_str());
+        if (!d) continue;
+        const int fd = dirfd(d);
+        while (dirent* entry = readdir(d)) {
+            const char* name = entry->d_name;
+            if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) continue;
+            unsigned char type = entry->d_type;
+            if (type == DT_UNKNOWN) {
+                struct stat st;
+                if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+                type = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+            }
+            if (type == DT_DIR) {
+                stack.push_back(JoinPath(current, name));
+            } else if (MatchesExtension(extensions_, name)) {
+                LibraryChange change{LibraryChange::Type::Upsert, {}};
+                if (Stat(JoinPath(current, name), &change.file)) changes.push_back(std::move(change));
+            }
+        }
+        closedir(d);
+    }
+}
+
+void LibraryWatcher::Flush() {
+    std::vector<LibraryChange> changes;
+    if (overflow_) {
+        // Unknown losses; whatever else we collected is covered by the rescan
+        changes.push_back({LibraryChange::Type::Rescan, {}});
+    } else {
+        for (const std::string& dir : goneDirs_) {
+            DropWatches(dir);
+            LibraryChange change{LibraryChange::Type::RemoveTree, {}};
+            change.file.path = dir;
+            changes.push_back(std::move(change));
+        }
+        for (const std::string& dir : newDirs_) WalkNewDirectory(dir, changes);
+        // Final state only: whatever happened to a path in between doesn't matter
+        for (const std::string& path : touched_) {
+            LibraryChange change{LibraryChange::Type::Upsert, {}};
+            if (!Stat(path, &change.file)) {
+                change.type = LibraryChange::Type::Remove;
+                change.file.path = path;
+            }
+            changes.push_back(std::move(change));
+        }
+    }
+    touched_.clear();
+    newDirs_.clear();
+    goneDirs_.clear();
+    overflow_ = false;
+    pending_ = false;
+    if (changes.empty()) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    changes_.insert(changes_.end(), std::make_move_iterator(changes.begin()), std::make_move_iterator(changes.end()));
+}
+
+#else
+
+void LibraryWatcher::Start(const std::string& root, std::vector<std::string>) {
+    root_ = root;
+}
+
+void LibraryWatcher::Stop() {}
+
+#endif
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "library_db.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct LibraryChange {
+    enum class Type {
+        Upsert,     // file added or modified; `file` has its new stamp
+        Remove,     // file gone
+        RemoveTree, // directory gone with everything below it
+        Rescan,     // events were lost; only a rescan can tell what changed
+    };
+    Type type;
+    ScannedFile file; // path is the directory for RemoveTree, empty for Rescan
+};
+
+struct WatcherStatus {
+    size_t watches = 0;  // directories being watched
+    size_t failed = 0;   // directories that could not be watched (watch limit)
+    bool active = false; // false where inotify is not available
+};
+
+// Keeps the library live with inotify: one watch per directory, added and
+// dropped as directories come and go. Events are coalesced and applied in
+// bursts: once things have been quiet for a moment, every path that was
+// touched is stat()ed once and reported as its final state, so a file that is
+// written in many chunks, or created and deleted again, costs one change at
+// most. A directory that appears (created or moved in) is walked right there,
+// which is the only listing the watcher ever does.
+//
+// When the kernel queue overflows the watcher reports Rescan; the incremental
+// scanner then only lists the directories whose mtime moved.
+//
+// Only Linux has an implementation; elsewhere Start() does nothing.
+class LibraryWatcher {
+public:
+    // `extensions` as for LibraryScanner.
+    explicit LibraryWatcher(std::unordered_set<std::string> extensions);
+    ~LibraryWatcher();
+
+    LibraryWatcher(const LibraryWatcher&) = delete;
+    LibraryWatcher& operator=(const LibraryWatcher&) = delete;
+
+    // Watches `directories` (the library under `root`, as found by a scan),
+    // replacing whatever was watched before.
+    void Start(const std::string& root, std::vector<std::string> directories);
+    void Stop();
+
+    // Moves the changes collected since the last call to the end of `out`.
+    // Returns false if there were none. Single consumer.
+    bool Poll(std::vector<LibraryChange>& out);
+    WatcherStatus Status() const;
+
+private:
+    void ThreadMain(std::vector<std::string> directories);
+    void AddWatch(const std::string& dir);
+    void DropWatches(const std::string& dir);
+    void ReadEvents();
+    void Flush();
+    void WalkNewDirectory(const std::string& dir, std::vector<LibraryChange>& changes);
+    bool Stat(const std::string& path, ScannedFile* file) const;
+
+    std::unordered_set<std::string> extensions_;
+    std::string root_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    int inotify_ = -1;
+    int wake_ = -1; // eventfd that interrupts the thread's poll()
+
+    // Watcher thread only
+    std::unordered_map<int, std::string> watches_; // wd -> directory
+    std::unordered_set<std::string> touched_;      // files with events since the last flush
+    std::unordered_set<std::string> newDirs_;
+    std::unordered_set<std::string> goneDirs_;
+    bool overflow_ = false;
+    std::chrono::steady_clock::time_point firstEvent_;
+    std::chrono::steady_clock::time_point lastEvent_;
+    bool pending_ = false;
+
+    mutable std::mutex mutex_;
+    std::vector<LibraryChange> changes_;
+    std::atomic<size_t> watchCount_{0};
+    std::atomic<size_t> failedCount_{0};
+    std::atomic<bool> active_{false};
+};
@@ -3,16 +3,25 @@
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
 #include <string>
+#include <algorithm>
 #include <filesystem>
 #include <vector>
 #include <unordered_set>
 #include <iostream>
 #include "thirdparty/tinyfiledialogs/tinyfiledialogs.h"
+#include "audio/audio_engine.h"
+#include "audio/spectrum.h"
+#include "audio/waveform.h"
+#include "gfx/texture_loader.h"
+#include "library/library.h"
+#include "library/library_search.h"
+#include "library/track_order.h"
 
-#define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include <chrono>
 #include <cstdint>
+#include <cstring>
 namespace fs = std::filesystem;
 
 static_assert(sizeof(ImTextureID) >= sizeof(GLuint), "ImTextureID too small for GLuint");
@@ -106,6 +115,10 @@ bool IconButton(const char* id, GLuint texture_id, const ImVec2& size) {
     return clicked;
 }
 
+void TextView(std::string_view text) {
+    ImGui::TextUnformatted(text.data(), text.data() + text.size());
+}
+
 void ShowThemeEditor(CustomTheme& theme) {
     static char windowBgHex[8] = "#1d2021";
     static char childBgHex[8] = "#282828";
@@ -160,12 +173,98 @@ void ShowThemeEditor(CustomTheme& theme) {
     }
 }
 
-void ShowMainInterface(CustomTheme& theme, GLuint my_texture, const ImVec2& image_size, GLuint play, GLuint nazad, GLuint vpered) {
-    static bool isPlaying = false;
-    static float progress = 0.65f;
-    static std::vector<std::string> loadedFiles;
-    static std::unordered_set<std::string> supportedFormats = {".mp3", ".wav", ".ogg"};
-    static bool showLoadedFiles = false;
+std::string FormatTime(double seconds) {
+    int total = seconds > 0 ? (int)seconds : 0;
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d:%02d", total / 60, total % 60);
+    return buf;
+}
+
+// CPU time spent building and submitting a frame, not counting the wait for
+// vsync, over the last couple of seconds. Shown in the header with
+// CATMP3_SHOW_FRAME_TIME=1.
+struct FrameTimer {
+    static const int kFrames = 120;
+    float samples[kFrames] = {};
+    int next = 0;
+    int count = 0;
+
+    void Add(float ms) {
+        samples[next] = ms;
+        next = (next + 1) % kFrames;
+        count = std::min(count + 1, kFrames);
+    }
+    float Average() const {
+        float sum = 0;
+        for (int i = 0; i < count; i++) sum += samples[i];
+        return count ? sum / count : 0.0f;
+    }
+    float Max() const { return count ? *std::max_element(samples, samples + count) : 0.0f; }
+};
+
+static FrameTimer frameTimer;
+static bool showFrameTime = false;
+
+static const int kSpectrumBars = 50;
+
+void ShowMainInterface(CustomTheme& theme, TextureLoader& textures, const ImVec2& image_size, GLuint play, GLuint nazad, GLuint vpered, AudioEngine& engine) {
+    static int selectedFile = -1;
+    static float volume = 1.0f;
+    static bool seeking = false;
+    static float seekFraction = 0.0f;
+    static std::unordered_set<std::string> supportedFormats = {
+        ".mp3", ".wav", ".ogg", ".flac",
+#ifdef CATMP3_HAVE_OPUS
+        ".opus",
+#endif
+    };
+    static Library library(supportedFormats);
+    static bool libraryLoaded = false;
+    static int rowsDrawn = 0;
+    static TrackOrder trackOrder;
+    static LibrarySearch search;
+    static SearchResults searchResults;
+    static char searchText[256] = "";
+    static bool fuzzySearch = false;
+
+    // Медиатека с прошлого запуска: отображается сразу, изменения с тех пор
+    // подтягиваются фоновым пересканированием
+    if (!libraryLoaded) {
+        libraryLoaded = true;
+        if (library.LoadSaved()) engine.SetPlaylist(library.Paths());
+    }
+
+    // Rescans and live changes keep the current track playing; the engine
+    // follows it by path, and so does the selection
+    std::string selectedPath;
+    if (selectedFile >= 0 && selectedFile < (int)library.Tracks().Size())
+        selectedPath = std::string(library.Tracks().Path(selectedFile));
+    switch (library.Poll()) {
+    case Library::Update::Replaced:
+        engine.SetPlaylist(library.Paths());
+        selectedFile = -1;
+        break;
+    case Library::Update::Changed:
+        engine.UpdatePlaylist(library.Paths());
+        selectedFile = library.Find(selectedPath);
+        break;
+    case Library::Update::None:
+        break;
+    }
+
+    auto startScan = [&](const std::string& root) {
+        // A new folder replaces the list; nothing is playable until it's sorted
+        library.Scan(root);
+        if (library.Replacing()) {
+            engine.SetPlaylist({});
+            selectedFile = -1;
+        }
+    };
+
+    const PlaybackSnapshot& playback = engine.Snapshot();
+    double position = playback.position;
+    double duration = playback.duration;
+    float progress = duration > 0 ? (float)(position / duration) : 0.0f;
     
     ImGuiIO& io = ImGui::GetIO();
     ImVec2 windowSize = io.DisplaySize;
@@ -183,6 +282,19 @@ void ShowMainInterface(CustomTheme& theme, GLuint my_texture, const ImVec2& imag
     // Header with title and settings
     ImGui::SetCursorPos(ImVec2(20, 15));
     ImGui::TextColored(theme.accent, "CatMp3");
+    if (showFrameTime) {
+        ImGui::SameLine(0, 20);
+        ImGui::TextDisabled("%.2f ms (max %.2f ms), %zu tracks, %d rows drawn", frameTimer.Average(), frameTimer.Max(),
+                            library.Tracks().Size(), rowsDrawn);
+        const TextureLoaderStats cache = textures.Stats();
+        const uint64_t lookups = cache.hits + cache.misses;
+        ImGui::SameLine(0, 20);
+        ImGui::TextDisabled("textures: %zu, %.1f of %.0f MB, %.1f%% hits, %llu evicted; thumbnails: %llu from pack, "
+                            "%llu made",
+                            cache.textures, cache.residentBytes / 1048576.0, cache.budgetBytes / 1048576.0,
+                            lookups ? 100.0 * cache.hits / lookups : 0.0, (unsigned long long)cache.evictions,
+                            (unsigned long long)cache.thumbnailsLoaded, (unsigned long long)cache.thumbnailsMade);
+    }
     ImGui::SameLine(windowSize.x - 120);
     ShowThemeEditor(theme);
 
@@ -193,27 +305,131 @@ void ShowMainInterface(CustomTheme& theme, GLuint my_texture, const ImVec2& imag
         ImGui::TextColored(theme.accent, "Playlists");
         ImGui::Separator();
         
-        if (showLoadedFiles) {
-            ImGui::BeginChild("File List", ImVec2(0, ImGui::GetContentRegionAvail().y - 40), true);
-            for (const auto& file : loadedFiles) {
-                ImGui::Selectable(file.c_str(), false);
-            }
-            ImGui::EndChild();
+        if (library.Busy()) {
+            ScanProgress progress = library.Progress();
+            ImGui::Text("Scanning... %llu files, %llu folders (%llu unchanged)", (unsigned long long)progress.files,
+                        (unsigned long long)progress.directories, (unsigned long long)progress.reused);
         }
-        
-        if (ImGui::Button("Add Playlist", ImVec2(-1, 0))) {
-            const char* folderPath = tinyfd_selectFolderDialog("Select Folder", nullptr);
-            if (folderPath) {
-                loadedFiles.clear();
-                for (const auto& entry : fs::directory_iterator(folderPath)) {
-                    std::string ext = entry.path().extension().string();
-                    if (entry.is_regular_file() && supportedFormats.count(ext)) {
-                        loadedFiles.push_back(entry.path().filename().string());
+        TagProgress tagging = library.TagsProgress();
+        if (tagging.done < tagging.queued) {
+            ImGui::Text("Reading tags... %llu / %llu", (unsigned long long)tagging.done,
+                        (unsigned long long)tagging.queued);
+        }
+        WatcherStatus watching = library.Watching();
+        if (watching.failed > 0) {
+            ImGui::TextColored(ImVec4(1, 0.6f, 0, 1), "%zu folders not watched (inotify limit)", watching.failed);
+        }
+        if (!library.Root().empty()) {
+            const TrackTable& tracks = library.Tracks();
+
+            // Поиск по мере ввода: результаты приходят из фонового потока
+            ImGui::SetNextItemWidth(-70);
+            bool searchChanged = ImGui::InputTextWithHint("##search", "Search", searchText, sizeof(searchText));
+            ImGui::SameLine();
+            searchChanged |= ImGui::Checkbox("Fuzzy", &fuzzySearch);
+            if (searchChanged) {
+                const bool empty =
+                    fuzzySearch ? FuzzyIndex::Terms(searchText).empty() : SearchIndex::Terms(searchText).empty();
+                if (empty) {
+                    search.Query("");
+                    trackOrder.ClearFilter();
+                } else {
+                    search.Query(searchText, fuzzySearch);
+                }
+            }
+            search.Sync(tracks);
+            if (search.Poll(searchResults)) trackOrder.SetFilter(searchResults.ids, searchResults.ranked);
+            if (trackOrder.Filtered()) {
+                ImGui::TextDisabled("%zu found (%.2f ms)", trackOrder.Size(), searchResults.milliseconds);
+            } else if (searchText[0] && search.Indexing()) {
+                ImGui::TextDisabled("Indexing...");
+            }
+
+            const ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_SortTristate |
+                                          ImGuiTableFlags_Resizable | ImGuiTableFlags_Reorderable |
+                                          ImGuiTableFlags_Hideable | ImGuiTableFlags_RowBg |
+                                          ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersInnerV |
+                                          ImGuiTableFlags_ScrollX | ImGuiTableFlags_ScrollY |
+                                          ImGuiTableFlags_SizingFixedFit;
+            if (ImGui::BeginTable("File List", 5, flags, ImVec2(0, ImGui::GetContentRegionAvail().y - 40))) {
+                ImGui::TableSetupScrollFreeze(0, 1);
+                // A column still being sorted says so in its header; "###" keeps its id the same
+                const auto setupColumn = [&](const char* name, float width, SortColumn column) {
+                    char label[64];
+                    const bool sorting = trackOrder.Sorting() && trackOrder.Column() == column;
+                    snprintf(label, sizeof(label), sorting ? "%s (sorting)###%s" : "%s###%s", name, name);
+                    ImGui::TableSetupColumn(label, ImGuiTableColumnFlags_None, width, (ImGuiID)column);
+                };
+                setupColumn("Title", 220, SortColumn::Title);
+                setupColumn("Artist", 140, SortColumn::Artist);
+                setupColumn("Album", 140, SortColumn::Album);
+                setupColumn("Time", 0, SortColumn::Duration);
+                setupColumn("kbps", 0, SortColumn::Bitrate);
+                ImGui::TableHeadersRow();
+
+                // Без сортировки - порядок папок
+                ImGuiTableSortSpecs* sortSpecs = ImGui::TableGetSortSpecs();
+                if (sortSpecs && sortSpecs->SpecsDirty) {
+                    if (sortSpecs->SpecsCount > 0) {
+                        const ImGuiTableColumnSortSpecs& spec = sortSpecs->Specs[0];
+                        trackOrder.SetSort((SortColumn)spec.ColumnUserID,
+                                           spec.SortDirection == ImGuiSortDirection_Descending);
+                    } else {
+                        trackOrder.SetSort(SortColumn::Path, false);
+                    }
+                    sortSpecs->SpecsDirty = false;
+                }
+                trackOrder.Sync(tracks);
+
+                // Only the rows in view are submitted; the rest is skipped by
+                // height, which is one text line for every row
+                ImGuiListClipper clipper;
+                clipper.Begin((int)trackOrder.Size());
+                rowsDrawn = 0;
+                while (clipper.Step()) {
+                    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                        const int row = (int)trackOrder.Row(i);
+                        ImGui::TableNextRow();
+                        ImGui::TableNextColumn();
+                        ImGui::PushID(row);
+                        bool highlighted = selectedFile == row || playback.track == row;
+                        if (ImGui::Selectable("##track", highlighted,
+                                              ImGuiSelectableFlags_SpanAllColumns |
+                                                  ImGuiSelectableFlags_AllowDoubleClick)) {
+                            selectedFile = row;
+                            if (ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left) && !library.Replacing()) {
+                                engine.Play(row);
+                            }
+                        }
+                        ImGui::PopID();
+                        ImGui::SameLine(0, 0);
+                        TextView(tracks.DisplayTitle(row));
+                        ImGui::TableNextColumn();
+                        TextView(tracks.Artist(row));
+                        ImGui::TableNextColumn();
+                        TextView(tracks.Album(row));
+                        ImGui::TableNextColumn();
+                        if (const uint32_t seconds = (uint32_t)tracks.Duration(row)) {
+                            ImGui::Text("%u:%02u", seconds / 60, seconds % 60);
+                        }
+                        ImGui::TableNextColumn();
+                        if (tracks.Bitrate(row)) ImGui::Text("%u", (unsigned)tracks.Bitrate(row));
                     }
+                    rowsDrawn += clipper.DisplayEnd - clipper.DisplayStart;
                 }
-                showLoadedFiles = true;
+                ImGui::EndTable();
             }
         }
+        
+        bool canRescan = !library.Root().empty() && !library.Busy();
+        if (ImGui::Button("Add Playlist", ImVec2(canRescan ? ImGui::GetContentRegionAvail().x * 0.6f : -1, 0))) {
+            const char* folderPath = tinyfd_selectFolderDialog("Select Folder", nullptr);
+            if (folderPath) startScan(folderPath);
+        }
+        if (canRescan) {
+            ImGui::SameLine();
+            if (ImGui::Button("Rescan", ImVec2(-1, 0))) library.Rescan();
+        }
     }
     ImGui::EndChild();
     
@@ -231,9 +447,22 @@ void ShowMainInterface(CustomTheme& theme, GLuint my_texture, const ImVec2& imag
                 (ImGui::GetContentRegionAvail().y - cover_size - 80) * 0.3f
             );
             
-            // Album cover
+            // Album cover: the playing track's, else the selected one's, else
+            // the default picture
             ImGui::SetCursorPos(center_pos);
-            
+            const TrackTable& coverTracks = library.Tracks();
+            const int coverTrack = playback.track >= 0 && playback.track < (int)coverTracks.Size() ? playback.track
+                                                                                                   : selectedFile;
+            // Миниатюра под размер на экране, а не исходник 3000x3000
+            const int coverPixels = (int)(image_size.x * io.DisplayFramebufferScale.x);
+            GLuint my_texture = 0;
+            if (coverTrack >= 0 && coverTrack < (int)coverTracks.Size()) {
+                const std::string coverPath(coverTracks.Path((size_t)coverTrack));
+                my_texture = textures.Get(coverPath, TextureSource::TrackCover, coverPixels);
+                if (textures.Failed(coverPath, TextureSource::TrackCover, coverPixels)) my_texture = 0;
+            }
+            if (my_texture == 0) my_texture = textures.Get("example.jpg", TextureSource::File, coverPixels);
+
             if (my_texture != 0) {
                 ImTextureID tex_id = (ImTextureID)(intptr_t)my_texture;
                 ImGui::Image(tex_id, image_size);
@@ -247,25 +476,46 @@ void ShowMainInterface(CustomTheme& theme, GLuint my_texture, const ImVec2& imag
                 center_pos.y + cover_size + 30
             );
             ImGui::SetCursorPos(text_pos);
-            //ImGui::Text("Now Playing");
-            ImGui::SetCursorPosX(text_pos.x);
-           // ImGui::Text("Artist - Track Name");
+            const TrackTable& tracks = library.Tracks();
+            if (playback.track >= 0 && playback.track < (int)tracks.Size()) {
+                const size_t track = (size_t)playback.track;
+                // Без тегов показываем имя файла
+                std::string title(tracks.DisplayTitle(track));
+                if (!tracks.Artist(track).empty()) title = std::string(tracks.Artist(track)) + " - " + title;
+                const float panelWidth = ImGui::GetContentRegionAvail().x;
+                ImGui::SetCursorPosX(std::max(0.0f, (panelWidth - ImGui::CalcTextSize(title.c_str()).x) * 0.5f));
+                ImGui::TextUnformatted(title.c_str());
+                if (!tracks.Album(track).empty()) {
+                    std::string album = std::string(tracks.Album(track));
+                    if (tracks.Year(track)) album += " (" + std::to_string(tracks.Year(track)) + ")";
+                    ImGui::SetCursorPosX(std::max(0.0f, (panelWidth - ImGui::CalcTextSize(album.c_str()).x) * 0.5f));
+                    ImGui::TextDisabled("%s", album.c_str());
+                }
+            }
             
-static float wave[50];
-for (int i = 0; i < 50; i++) 
-    wave[i] = 0.2f + 0.8f * sinf(ImGui::GetTime() * 3.0f + i * 0.2f) * 0.5f;
+// Спектр того, что сейчас слышно: окно берётся с задержкой вывода
+static SpectrumAnalyzer spectrum;
+static std::vector<float> spectrumSamples(spectrum.WindowSize());
+const AudioTap& tap = engine.Tap();
+const size_t tapDelay = (size_t)(playback.stats.outputLatency * tap.SampleRate());
+if (tap.Read(spectrumSamples.data(), spectrumSamples.size(), tapDelay)) {
+    spectrum.Update(spectrumSamples.data(), tap.SampleRate(), kSpectrumBars, io.DeltaTime);
+} else {
+    spectrum.Decay(io.DeltaTime);
+}
+const std::vector<float>& wave = spectrum.Bars();
 
 // Отрисовка
 ImDrawList* draw_list = ImGui::GetWindowDrawList();
 ImVec2 p = ImGui::GetCursorScreenPos();
 float width = ImGui::GetContentRegionAvail().x;
 
-for (int i = 0; i < 50; i++) {
-    float x = p.x + (width / 50.0f) * i;
+for (size_t i = 0; i < wave.size(); i++) {
+    float x = p.x + (width / kSpectrumBars) * i;
     float h = 15 * wave[i];
     draw_list->AddRectFilled(
         ImVec2(x, p.y + 10 - h),
-        ImVec2(x + (width / 50.0f) - 2, p.y + 10),
+        ImVec2(x + (width / kSpectrumBars) - 2, p.y + 10),
         IM_COL32(100, 200, 255, 150)
     );
 }
@@ -273,14 +523,48 @@ for (int i = 0; i < 50; i++) {
 // Прогресс-бар поверх волн
 ImGui::SetCursorScreenPos(p);
 ImGui::PushStyleColor(ImGuiCol_PlotHistogram, IM_COL32(255, 255, 255, 50));
-ImGui::ProgressBar(progress, ImVec2(width, 20), "");
+ImGui::ProgressBar(seeking ? seekFraction : progress, ImVec2(width, 20), "");
 ImGui::PopStyleColor();
+
+// Обзор дорожки поверх полосы: пики (min/max) и RMS, сыгранное ярче
+static WaveformLoader waveformLoader;
+static std::vector<WaveformPeak> waveformColumns;
+const TrackTable& playingTracks = library.Tracks();
+const bool hasTrack = playback.state != PlaybackState::Stopped && playback.track >= 0 &&
+                      playback.track < (int)playingTracks.Size();
+const Waveform* waveform =
+    waveformLoader.Get(hasTrack ? std::string(playingTracks.Path((size_t)playback.track)) : std::string());
+if (waveform) {
+    waveform->Columns((int)width, waveformColumns);
+    const float middle = p.y + 10, scale = 9.0f / 127.0f, rmsScale = 9.0f / 255.0f;
+    const float played = (seeking ? seekFraction : progress) * waveformColumns.size();
+    for (size_t x = 0; x < waveformColumns.size(); x++) {
+        const WaveformPeak& peak = waveformColumns[x];
+        const bool heard = x < played;
+        draw_list->AddRectFilled(ImVec2(p.x + x, middle - peak.max * scale),
+                                 ImVec2(p.x + x + 1, middle - peak.min * scale + 1),
+                                 heard ? IM_COL32(100, 200, 255, 140) : IM_COL32(255, 255, 255, 50));
+        draw_list->AddRectFilled(ImVec2(p.x + x, middle - peak.rms * rmsScale),
+                                 ImVec2(p.x + x + 1, middle + peak.rms * rmsScale + 1),
+                                 heard ? IM_COL32(100, 200, 255, 220) : IM_COL32(255, 255, 255, 90));
+    }
+}
+
+// Перемотка: тянем мышью по прогресс-бару, позиция отправляется при отпускании
+if (ImGui::IsItemClicked(ImGuiMouseButton_Left) && duration > 0) seeking = true;
+if (seeking) {
+    seekFraction = std::min(std::max((io.MousePos.x - p.x) / width, 0.0f), 1.0f);
+    if (!ImGui::IsMouseDown(ImGuiMouseButton_Left)) {
+        engine.Seek(seekFraction * duration);
+        seeking = false;
+    }
+}
             // Track time
             ImGui::SetCursorPosX(30);
-            ImGui::Text("0:00");
+            ImGui::Text("%s", FormatTime(seeking ? seekFraction * duration : position).c_str());
             ImGui::SameLine();
             ImGui::SetCursorPosX(ImGui::GetContentRegionAvail().x - 50);
-            ImGui::Text("3:45");
+            ImGui::Text("%s", FormatTime(duration).c_str());
         }
         ImGui::EndChild();
 
@@ -308,21 +592,33 @@ ImGui::BeginChild("Controls", ImVec2(0, 96), true);
     // Кнопка "Назад"
     ImTextureID tex_id_prev = (ImTextureID)(intptr_t)nazad;
     if (IconButton("prev", tex_id_prev, ImVec2(buttonWidth, buttonHeight))) {
-        // Previous track
+        engine.Previous();
     }
     
     // Кнопка "Play/Pause"
     ImGui::SameLine(0, ImGui::GetStyle().ItemSpacing.x);
     ImTextureID tex_id_play = (ImTextureID)(intptr_t)play;
     if (IconButton("play", tex_id_play, ImVec2(playButtonWidth, playButtonWidth))) {
-        isPlaying = !isPlaying;
+        if (playback.state == PlaybackState::Stopped && selectedFile >= 0) {
+            engine.Play(selectedFile);
+        } else {
+            engine.TogglePause();
+        }
     }
     
     // Кнопка "Вперед"
     ImGui::SameLine(0, ImGui::GetStyle().ItemSpacing.x);
     ImTextureID tex_id_next = (ImTextureID)(intptr_t)vpered;
     if (IconButton("next", tex_id_next, ImVec2(buttonWidth, buttonHeight))) {
-        // Next track
+        engine.Next();
+    }
+
+    // Громкость
+    ImGui::SameLine();
+    ImGui::SetCursorPos(ImVec2(availWidth - 110, startY + (buttonHeight - ImGui::GetFrameHeight()) * 0.5f));
+    ImGui::SetNextItemWidth(110);
+    if (ImGui::SliderFloat("##volume", &volume, 0.0f, 1.0f, "vol %.2f")) {
+        engine.SetVolume(volume);
     }
 }
 ImGui::EndChild();
@@ -364,23 +660,38 @@ int main() {
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 130");
 
-    GLuint my_texture = LoadTextureFromFile("example.jpg");
+    // Обложка декодируется в фоне; до загрузки рисуется заглушка.
+    // Миниатюры сжимаются в BC1, где драйвер умеет; CATMP3_TEXTURE_COMPRESSION=0 отключает
+    TextureLoader textures;
+    const char* compressionSpec = getenv("CATMP3_TEXTURE_COMPRESSION");
+    if (compressionSpec && strcmp(compressionSpec, "0") == 0) textures.SetCompression(false);
     ImVec2 image_size(200.0f, 200.0f); // Square aspect ratio
 
     GLuint play = LoadTextureFromFile("play.png");
     GLuint vpered = LoadTextureFromFile("nazad.png");
     GLuint nazad = LoadTextureFromFile("vpered.png");
 
+    // Аудио: CATMP3_AUDIO_OUTPUT=auto | pulse | alsa[:<device>] | null[:<period ms>] | wav:<file>
+    //        CATMP3_RESAMPLER_QUALITY=low | medium | high | best
+    //        CATMP3_SHOW_FRAME_TIME=1
+    const char* outputSpec = getenv("CATMP3_AUDIO_OUTPUT");
+    AudioEngine engine;
+    engine.SetResamplerQuality(ParseResamplerQuality(getenv("CATMP3_RESAMPLER_QUALITY"), ResamplerQuality::High));
+    engine.Start(CreateAudioOutput(outputSpec ? outputSpec : "auto"));
+    const char* frameTimeSpec = getenv("CATMP3_SHOW_FRAME_TIME");
+    showFrameTime = frameTimeSpec && strcmp(frameTimeSpec, "0") != 0;
 
 
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
 
+        auto frameStart = std::chrono::steady_clock::now();
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        ShowMainInterface(theme, my_texture, image_size, play, vpered, nazad);
+        textures.Upload();
+        ShowMainInterface(theme, textures, image_size, play, vpered, nazad, engine);
 
         ImGui::Render();
         int display_w, display_h;
@@ -394,11 +705,13 @@ int main() {
         );
         glClear(GL_COLOR_BUFFER_BIT);
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        frameTimer.Add(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
         glfwSwapBuffers(window);
     }
 
     // Cleanup
-    if (my_texture != 0) glDeleteTextures(1, &my_texture);
+    engine.Shutdown();
+    textures.Release();
     if (play != 0) glDeleteTextures(1, &play);
     if (vpered != 0) glDeleteTextures(1, &vpered);
     if (nazad != 0) glDeleteTextures(1, &nazad);
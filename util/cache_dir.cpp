@@ -0,0 +1,71 @@
+#include "cache_dir.h"
+#include "hash.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <system_error>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+std::string CacheDir(const std::string& name) {
+    fs::path base;
+#ifdef _WIN32
+    if (const char* local = getenv("LOCALAPPDATA")) base = fs::path(local) / "catmp3";
+#else
+    if (const char* xdg = getenv("XDG_CACHE_HOME"); xdg && *xdg) base = fs::path(xdg) / "catmp3";
+    else if (const char* home = getenv("HOME"); home && *home) base = fs::path(home) / ".cache" / "catmp3";
+#endif
+    if (base.empty()) return std::string();
+
+    fs::path dir = base / name;
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) return std::string();
+    return dir.string();
+}
+
+std::string CachePathFor(const std::string& name, const std::string& sourcePath, const char* extension) {
+    std::string dir = CacheDir(name);
+    if (dir.empty()) return std::string();
+    char file[32];
+    snprintf(file, sizeof(file), "%016llx%s", (unsigned long long)Fnv1a64(sourcePath), extension);
+    return (fs::path(dir) / file).string();
+}
+
+bool GetFileStamp(const std::string& path, FileStamp* stamp) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    stamp->size = (uint64_t)st.st_size;
+    stamp->mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+bool WriteFileAtomic(const std::string& path, const void* data, size_t size) {
+    // A temporary of its own for every writer: two threads (or two instances)
+    // may save the same entry at once, and must not write into each other's file
+    static std::atomic<uint32_t> serial{0};
+    char suffix[48];
+    snprintf(suffix, sizeof(suffix), ".%d.%u.tmp", (int)getpid(), serial.fetch_add(1, std::memory_order_relaxed));
+    std::string tmp = path + suffix;
+    FILE* f = fopen(tmp.c_str(), "wbx");
+    if (!f) return false;
+    bool ok = fwrite(data, 1, size, f) == size;
+    ok = fclose(f) == 0 && ok;
+    std::error_code ec;
+    if (ok) fs::rename(tmp, path, ec);
+    if (!ok || ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
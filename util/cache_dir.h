@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Per-user cache directory for derived data (seek indexes, thumbnails, ...):
+// $XDG_CACHE_HOME/catmp3/<name>, ~/.cache/catmp3/<name> or
+// %LOCALAPPDATA%\catmp3\<name>. Created on first use. Returns an empty string
+// if no usable location exists; callers then simply skip caching.
+std::string CacheDir(const std::string& name);
+
+// Cache file path for `sourcePath`, keyed by a hash of the path.
+std::string CachePathFor(const std::string& name, const std::string& sourcePath, const char* extension);
+
+// Size and modification time used to tell whether a cache entry is stale.
+struct FileStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+};
+bool GetFileStamp(const std::string& path, FileStamp* stamp);
+
+// Writes to a temporary file and renames it over `path`, so readers never see
+// a half-written cache entry. Safe to call for the same `path` from several
+// threads or processes at once: the last rename wins.
+bool WriteFileAtomic(const std::string& path, const void* data, size_t size);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// 64-bit FNV-1a. Used for cache file names, not for anything adversarial.
+inline uint64_t Fnv1a64(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+inline uint64_t Fnv1a64(const std::string& s) { return Fnv1a64(s.data(), s.size()); }
+
+// 64-bit hash of large buffers (whole image files, to key caches by content):
+// four independent lanes over 8-byte words, so it runs at close to memory
+// speed where FNV-1a manages a byte per multiply. Not for anything
+// adversarial either, and not the same values as Fnv1a64.
+inline uint64_t ContentHash64(const void* data, size_t size) {
+    static const uint64_t kPrime1 = 0x9e3779b185ebca87ull;
+    static const uint64_t kPrime2 = 0xc2b2ae3d27d4eb4full;
+    auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+    auto mix = [](uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ull;
+        return x ^ (x >> 33);
+    };
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    uint64_t lanes[4] = {kPrime1 + kPrime2, kPrime2, 0, 0 - kPrime1};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int lane = 0; lane < 4; lane++) {
+            uint64_t word;
+            memcpy(&word, p + i + lane * 8, 8);
+            lanes[lane] = rotl(lanes[lane] + word * kPrime2, 31) * kPrime1;
+        }
+    }
+    uint64_t h = (uint64_t)size;
+    for (int lane = 0; lane < 4; lane++) h = rotl(h ^ mix(lanes[lane]), 27) * kPrime1;
+    return mix(Fnv1a64(p + i, size - i, h));
+}
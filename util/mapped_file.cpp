@@ -0,0 +1,113 @@
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+#ifdef _WIN32
+        std::swap(mapping_, other.mapping_);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) return false;
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(mapping);
+        return false;
+    }
+    mapping_ = mapping;
+    data_ = (const uint8_t*)data;
+    size_ = (size_t)size.QuadPart;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    data_ = nullptr;
+    mapping_ = nullptr;
+    size_ = 0;
+}
+
+void MappedFile::AdviseSequential() {}
+void MappedFile::WillNeed(size_t, size_t) {}
+void MappedFile::Release(size_t, size_t) {}
+
+#else
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+    data_ = (const uint8_t*)data;
+    size_ = (size_t)st.st_size;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data_) munmap((void*)data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+void MappedFile::AdviseSequential() {
+    if (data_) madvise((void*)data_, size_, MADV_SEQUENTIAL);
+}
+
+// madvise() wants page-aligned ranges; widen to whole pages inside the mapping.
+static bool PageRange(size_t size, size_t& offset, size_t& length) {
+    static const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    if (offset >= size) return false;
+    size_t end = std::min(size, offset + length);
+    offset &= ~(page - 1);
+    length = end - offset;
+    return length > 0;
+}
+
+void MappedFile::WillNeed(size_t offset, size_t length) {
+    if (data_ && PageRange(size_, offset, length)) madvise((void*)(data_ + offset), length, MADV_WILLNEED);
+}
+
+void MappedFile::Release(size_t offset, size_t length) {
+    if (data_ && PageRange(size_, offset, length)) madvise((void*)(data_ + offset), length, MADV_DONTNEED);
+}
+
+#endif